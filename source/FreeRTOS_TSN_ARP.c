@@ -0,0 +1,581 @@
+/**
+ * @file FreeRTOS_TSN_ARP.c
+ * @brief Address resolution for the frames sent by TSN sockets
+ *
+ * Plus TCP owns the ARP cache, this file only adds what the TSN sockets need
+ * on top of it:
+ * - frames for a destination that is not resolved yet are parked in a small
+ *   queue per destination, instead of being dropped, and released to the
+ *   network scheduler by a controller once the ARP reply is in the cache;
+ * - a table of neighbors resolved once and never aged, which can be filled
+ *   at boot with known addresses or with addresses to resolve in advance.
+ * IPv6 destinations are resolved by the neighbor cache of Plus TCP, this
+ * file only sends the solicitations on its behalf.
+ */
+
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "FreeRTOS_IP.h"
+#include "FreeRTOS_IP_Private.h"
+#include "FreeRTOS_ARP.h"
+
+#if ( ipconfigUSE_IPv6 != 0 )
+    #include "FreeRTOS_ND.h"
+#endif
+
+#include "FreeRTOS_TSN_ARP.h"
+#include "FreeRTOS_TSN_Controller.h"
+#include "FreeRTOS_TSN_NetworkScheduler.h"
+
+/* ARP requests are sent again four times before giving up on a destination */
+#define tsnarpRETRY_TICKS    ( pdMS_TO_TICKS( tsnconfigARP_PENDING_TIMEOUT_MS ) / 4U + 1U )
+
+#if ( tsnconfigARP_STATIC_NEIGHBORS > 0 )
+
+/** @brief A neighbor which is never aged */
+    struct xTSN_ARP_NEIGHBOR
+    {
+        uint32_t ulIPAddress;           /**< Address of the neighbor, 0 if the entry is free */
+        MACAddress_t xMACAddress;       /**< Its MAC address, valid if xResolved is pdTRUE */
+        NetworkEndPoint_t * pxEndPoint; /**< Endpoint on the network of the neighbor */
+        BaseType_t xResolved;           /**< pdFALSE while waiting for the ARP reply */
+        TickType_t xLastRequest;        /**< Tick of the last ARP request */
+    };
+
+    static struct xTSN_ARP_NEIGHBOR xNeighbors[ tsnconfigARP_STATIC_NEIGHBORS ];
+
+/* Number of neighbors still to be resolved by uxTSNARPPoll() */
+    static volatile UBaseType_t uxUnresolvedNeighbors = 0U;
+
+#endif /* if ( tsnconfigARP_STATIC_NEIGHBORS > 0 ) */
+
+#if ( tsnconfigARP_PENDING_DESTINATIONS > 0 )
+
+/** @brief Frames waiting for the resolution of a destination */
+    struct xTSN_ARP_PENDING
+    {
+        uint32_t ulIPAddress;    /**< Destination of the frames, 0 if the entry is free */
+        uint32_t ulNextHop;      /**< Address to resolve, i.e. the destination or the gateway */
+        TickType_t xFirstRequest; /**< Tick of the first ARP request */
+        TickType_t xLastRequest; /**< Tick of the last ARP request */
+        UBaseType_t uxHead;      /**< Index of the oldest frame */
+        UBaseType_t uxCount;     /**< Number of frames waiting */
+        NetworkQueueItem_t xItems[ tsnconfigARP_PENDING_PER_DESTINATION ];
+    };
+
+    static struct xTSN_ARP_PENDING xPending[ tsnconfigARP_PENDING_DESTINATIONS ];
+
+/* Number of used entries of xPending, to skip the table when empty */
+    static volatile UBaseType_t uxPendingDestinations = 0U;
+
+/* Number of parked frames dropped, see uxTSNARPPendingGetDrops() */
+    static volatile UBaseType_t uxPendingDrops = 0U;
+
+#endif /* if ( tsnconfigARP_PENDING_DESTINATIONS > 0 ) */
+
+#if ( tsnconfigARP_PENDING_DESTINATIONS > 0 ) || ( tsnconfigARP_STATIC_NEIGHBORS > 0 )
+    static TickType_t xLastPoll = 0U;
+#endif
+
+/**
+ * @brief Look up the MAC address of a destination
+ *
+ * Same as eARPGetCacheEntry(), but the static neighbors are checked first.
+ *
+ * @param[in,out] pulIPAddress The destination, replaced by the gateway if
+ * the destination is not on a local network
+ * @param[out] pxMACAddress The MAC address, if found
+ * @param[out] ppxEndPoint The endpoint to use
+ * @return eARPCacheHit if the MAC address is found
+ */
+eARPLookupResult_t eTSNARPGetCacheEntry( uint32_t * pulIPAddress,
+                                         MACAddress_t * const pxMACAddress,
+                                         struct xNetworkEndPoint ** ppxEndPoint )
+{
+    #if ( tsnconfigARP_STATIC_NEIGHBORS > 0 )
+        for( UBaseType_t uxIndex = 0; uxIndex < tsnconfigARP_STATIC_NEIGHBORS; ++uxIndex )
+        {
+            const struct xTSN_ARP_NEIGHBOR * pxNeighbor = &xNeighbors[ uxIndex ];
+
+            if( ( pxNeighbor->ulIPAddress == *pulIPAddress ) && ( pxNeighbor->xResolved != pdFALSE ) &&
+                ( pxNeighbor->pxEndPoint != NULL ) )
+            {
+                memcpy( pxMACAddress, &pxNeighbor->xMACAddress, sizeof( MACAddress_t ) );
+                *ppxEndPoint = pxNeighbor->pxEndPoint;
+                return eARPCacheHit;
+            }
+        }
+    #endif
+
+    return eARPGetCacheEntry( pulIPAddress, pxMACAddress, ppxEndPoint );
+}
+
+#if ( tsnconfigARP_STATIC_NEIGHBORS > 0 )
+
+/**
+ * @brief Add a neighbor which is never aged
+ *
+ * Call after the endpoints are configured, e.g. at boot. If the MAC address
+ * is NULL, an ARP request is sent and the neighbor is used once the reply is
+ * received, otherwise it is used right away.
+ *
+ * @param[in] ulIPAddress The address of the neighbor, in network byte order
+ * @param[in] pxMACAddress Its MAC address, or NULL to resolve it
+ * @return pdPASS if the neighbor is added, pdFAIL if the table is full or no
+ * endpoint can reach the address
+ */
+    BaseType_t xTSNARPAddNeighbor( uint32_t ulIPAddress,
+                                   const MACAddress_t * pxMACAddress )
+    {
+        NetworkEndPoint_t * pxEndPoint = FreeRTOS_FindEndPointOnNetMask( ulIPAddress, 0 );
+        struct xTSN_ARP_NEIGHBOR * pxNeighbor = NULL;
+
+        if( ( ulIPAddress == 0U ) || ( pxEndPoint == NULL ) )
+        {
+            return pdFAIL;
+        }
+
+        taskENTER_CRITICAL();
+        {
+            for( UBaseType_t uxIndex = 0; uxIndex < tsnconfigARP_STATIC_NEIGHBORS; ++uxIndex )
+            {
+                if( xNeighbors[ uxIndex ].ulIPAddress == 0U )
+                {
+                    pxNeighbor = &xNeighbors[ uxIndex ];
+                    pxNeighbor->pxEndPoint = pxEndPoint;
+                    pxNeighbor->xLastRequest = xTaskGetTickCount();
+
+                    if( pxMACAddress != NULL )
+                    {
+                        memcpy( &pxNeighbor->xMACAddress, pxMACAddress, sizeof( MACAddress_t ) );
+                        pxNeighbor->xResolved = pdTRUE;
+                    }
+                    else
+                    {
+                        pxNeighbor->xResolved = pdFALSE;
+                        uxUnresolvedNeighbors++;
+                    }
+
+                    pxNeighbor->ulIPAddress = ulIPAddress;
+                    break;
+                }
+            }
+        }
+        taskEXIT_CRITICAL();
+
+        if( pxNeighbor == NULL )
+        {
+            return pdFAIL;
+        }
+
+        if( pxMACAddress == NULL )
+        {
+            FreeRTOS_OutputARPRequest( ulIPAddress );
+
+            /* Any controller can poll, wake them all to shorten their sleep */
+            for( BaseType_t xIndex = 0; xIndex < tsnconfigMAX_CONTROLLERS; ++xIndex )
+            {
+                ( void ) xNotifyController( pxTSNControllerGet( xIndex ) );
+            }
+        }
+
+        return pdPASS;
+    }
+
+/**
+ * @brief Look up the ARP cache for the neighbors not resolved yet
+ *
+ * @param[in] xNow The current tick
+ */
+    static void prvPollNeighbors( TickType_t xNow )
+    {
+        MACAddress_t xMACAddress;
+        NetworkEndPoint_t * pxEndPoint;
+        uint32_t ulIPAddress;
+
+        for( UBaseType_t uxIndex = 0; ( uxIndex < tsnconfigARP_STATIC_NEIGHBORS ) && ( uxUnresolvedNeighbors > 0U ); ++uxIndex )
+        {
+            struct xTSN_ARP_NEIGHBOR * pxNeighbor = &xNeighbors[ uxIndex ];
+
+            if( ( pxNeighbor->ulIPAddress == 0U ) || ( pxNeighbor->xResolved != pdFALSE ) )
+            {
+                continue;
+            }
+
+            ulIPAddress = pxNeighbor->ulIPAddress;
+
+            if( eARPGetCacheEntry( &ulIPAddress, &xMACAddress, &pxEndPoint ) == eARPCacheHit )
+            {
+                memcpy( &pxNeighbor->xMACAddress, &xMACAddress, sizeof( MACAddress_t ) );
+                pxNeighbor->xResolved = pdTRUE;
+
+                taskENTER_CRITICAL();
+                {
+                    uxUnresolvedNeighbors--;
+                }
+                taskEXIT_CRITICAL();
+            }
+            else if( ( xNow - pxNeighbor->xLastRequest ) >= tsnarpRETRY_TICKS )
+            {
+                /* Keep asking, static neighbors are expected to show up */
+                pxNeighbor->xLastRequest = xNow;
+                FreeRTOS_OutputARPRequest( pxNeighbor->ulIPAddress );
+            }
+        }
+    }
+
+#endif /* if ( tsnconfigARP_STATIC_NEIGHBORS > 0 ) */
+
+#if ( tsnconfigARP_PENDING_DESTINATIONS > 0 )
+
+/**
+ * @brief Check if frames are waiting for the resolution of a destination
+ *
+ * Frames for such a destination must be parked as well, even if the
+ * address got resolved in the meantime, so that they are not sent before
+ * the frames already waiting.
+ *
+ * @param[in] ulIPAddress The destination, in network byte order
+ * @return pdTRUE if frames are waiting for the destination
+ */
+    BaseType_t xTSNARPIsPending( uint32_t ulIPAddress )
+    {
+        BaseType_t xReturn = pdFALSE;
+
+        if( uxPendingDestinations == 0U )
+        {
+            return pdFALSE;
+        }
+
+        taskENTER_CRITICAL();
+        {
+            for( UBaseType_t uxIndex = 0; uxIndex < tsnconfigARP_PENDING_DESTINATIONS; ++uxIndex )
+            {
+                if( xPending[ uxIndex ].ulIPAddress == ulIPAddress )
+                {
+                    xReturn = pdTRUE;
+                    break;
+                }
+            }
+        }
+        taskEXIT_CRITICAL();
+
+        return xReturn;
+    }
+
+/**
+ * @brief Park a frame until its destination is resolved
+ *
+ * The frame must be ready to be sent but for the destination MAC address.
+ * An ARP request is sent for the first frame of a destination. On success,
+ * the buffer is owned by the TSN layer, which either releases it to the
+ * network scheduler or drops it after tsnconfigARP_PENDING_TIMEOUT_MS.
+ *
+ * @param[in] pxItem The item which would be inserted in the network queues
+ * @return pdPASS if the frame is parked, pdFAIL if there is no room for it
+ */
+    BaseType_t xTSNARPPendingAdd( const NetworkQueueItem_t * pxItem )
+    {
+        const NetworkBufferDescriptor_t * pxBuf = ( const NetworkBufferDescriptor_t * ) pxItem->pxBuf;
+        const uint32_t ulIPAddress = pxBuf->xIPAddress.ulIP_IPv4;
+        struct xTSN_ARP_PENDING * pxEntry = NULL;
+        struct xTSN_ARP_PENDING * pxFree = NULL;
+        BaseType_t xNewEntry = pdFALSE;
+        BaseType_t xReturn = pdFAIL;
+        uint32_t ulNextHop = ulIPAddress;
+        MACAddress_t xMACAddress;
+        NetworkEndPoint_t * pxEndPoint = NULL;
+        NetworkQueue_t * pxQueue;
+
+        if( ulIPAddress == 0U )
+        {
+            return pdFAIL;
+        }
+
+        /* The gateway is resolved for destinations out of the local networks */
+        ( void ) eARPGetCacheEntry( &ulNextHop, &xMACAddress, &pxEndPoint );
+
+        taskENTER_CRITICAL();
+        {
+            for( UBaseType_t uxIndex = 0; uxIndex < tsnconfigARP_PENDING_DESTINATIONS; ++uxIndex )
+            {
+                if( xPending[ uxIndex ].ulIPAddress == ulIPAddress )
+                {
+                    pxEntry = &xPending[ uxIndex ];
+                    break;
+                }
+                else if( ( pxFree == NULL ) && ( xPending[ uxIndex ].ulIPAddress == 0U ) )
+                {
+                    pxFree = &xPending[ uxIndex ];
+                }
+            }
+
+            if( ( pxEntry == NULL ) && ( pxFree != NULL ) )
+            {
+                pxEntry = pxFree;
+                pxEntry->ulIPAddress = ulIPAddress;
+                pxEntry->ulNextHop = ulNextHop;
+                pxEntry->xFirstRequest = xTaskGetTickCount();
+                pxEntry->xLastRequest = pxEntry->xFirstRequest;
+                pxEntry->uxHead = 0U;
+                pxEntry->uxCount = 0U;
+                uxPendingDestinations++;
+                xNewEntry = pdTRUE;
+            }
+
+            if( ( pxEntry != NULL ) && ( pxEntry->uxCount < tsnconfigARP_PENDING_PER_DESTINATION ) )
+            {
+                const UBaseType_t uxTail = ( pxEntry->uxHead + pxEntry->uxCount ) % tsnconfigARP_PENDING_PER_DESTINATION;
+
+                memcpy( &pxEntry->xItems[ uxTail ], pxItem, sizeof( NetworkQueueItem_t ) );
+                pxEntry->uxCount++;
+                xReturn = pdPASS;
+            }
+        }
+        taskEXIT_CRITICAL();
+
+        if( xNewEntry != pdFALSE )
+        {
+            FreeRTOS_OutputARPRequest( ulNextHop );
+
+            /* Let the controller which will send the frame shorten its sleep
+             * to poll the entry */
+            pxQueue = pxNetworkQueueFindByFilter( pxItem );
+
+            if( pxQueue != NULL )
+            {
+                ( void ) xNotifyController( pxQueue->pxController );
+            }
+        }
+
+        return xReturn;
+    }
+
+/**
+ * @brief Count the frames dropped while waiting for ARP
+ *
+ * Frames are dropped when their destination is not resolved within
+ * tsnconfigARP_PENDING_TIMEOUT_MS, cannot be resolved, or when the network
+ * queue refuses them once released. Frames refused by xTSNARPPendingAdd()
+ * are not counted, as the send call fails instead.
+ *
+ * @return The number of frames dropped since boot, wrapping around
+ */
+    UBaseType_t uxTSNARPPendingGetDrops( void )
+    {
+        return uxPendingDrops;
+    }
+
+/**
+ * @brief Release a parked frame and count the drop
+ *
+ * @param[in] pxBuf The buffer of the frame
+ */
+    static void prvPendingDrop( NetworkBufferDescriptor_t * pxBuf )
+    {
+        vReleaseNetworkBufferAndDescriptor( pxBuf );
+
+        taskENTER_CRITICAL();
+        {
+            uxPendingDrops++;
+        }
+        taskEXIT_CRITICAL();
+    }
+
+/**
+ * @brief Take the oldest frame of a pending entry
+ *
+ * The entry is freed when it becomes empty, after which it can be taken by
+ * another destination.
+ *
+ * @param[in] pxEntry The entry
+ * @param[in] ulIPAddress The destination the entry is expected to hold
+ * @param[out] pxItem The frame
+ * @return pdPASS if a frame is taken, pdFAIL if the entry is empty
+ */
+    static BaseType_t prvPendingTake( struct xTSN_ARP_PENDING * pxEntry,
+                                      uint32_t ulIPAddress,
+                                      NetworkQueueItem_t * pxItem )
+    {
+        BaseType_t xReturn = pdFAIL;
+
+        taskENTER_CRITICAL();
+        {
+            if( ( pxEntry->ulIPAddress == ulIPAddress ) && ( pxEntry->uxCount > 0U ) )
+            {
+                memcpy( pxItem, &pxEntry->xItems[ pxEntry->uxHead ], sizeof( NetworkQueueItem_t ) );
+                pxEntry->uxHead = ( pxEntry->uxHead + 1U ) % tsnconfigARP_PENDING_PER_DESTINATION;
+                pxEntry->uxCount--;
+                xReturn = pdPASS;
+
+                if( pxEntry->uxCount == 0U )
+                {
+                    pxEntry->ulIPAddress = 0U;
+                    uxPendingDestinations--;
+                }
+            }
+        }
+        taskEXIT_CRITICAL();
+
+        return xReturn;
+    }
+
+/**
+ * @brief Release or drop the frames of the pending destinations
+ *
+ * @param[in] xNow The current tick
+ */
+    static void prvPollPending( TickType_t xNow )
+    {
+        NetworkQueueItem_t xItem;
+        NetworkBufferDescriptor_t * pxBuf;
+        MACAddress_t xMACAddress;
+        NetworkEndPoint_t * pxEndPoint;
+        uint32_t ulIPAddress, ulNextHop;
+        eARPLookupResult_t eResult;
+
+        for( UBaseType_t uxIndex = 0; ( uxIndex < tsnconfigARP_PENDING_DESTINATIONS ) && ( uxPendingDestinations > 0U ); ++uxIndex )
+        {
+            struct xTSN_ARP_PENDING * pxEntry = &xPending[ uxIndex ];
+
+            ulIPAddress = pxEntry->ulIPAddress;
+
+            if( ulIPAddress == 0U )
+            {
+                continue;
+            }
+
+            ulNextHop = ulIPAddress;
+            pxEndPoint = NULL;
+            eResult = eTSNARPGetCacheEntry( &ulNextHop, &xMACAddress, &pxEndPoint );
+
+            if( eResult == eARPCacheHit )
+            {
+                while( prvPendingTake( pxEntry, ulIPAddress, &xItem ) != pdFAIL )
+                {
+                    pxBuf = ( NetworkBufferDescriptor_t * ) xItem.pxBuf;
+                    memcpy( &( ( EthernetHeader_t * ) pxBuf->pucEthernetBuffer )->xDestinationAddress, &xMACAddress, sizeof( MACAddress_t ) );
+
+                    if( xNetworkQueueInsertPacketByFilter( &xItem, 0U ) != pdPASS )
+                    {
+                        prvPendingDrop( pxBuf );
+                    }
+                }
+            }
+            else if( ( eResult == eCantSendPacket ) || ( ( xNow - pxEntry->xFirstRequest ) >= pdMS_TO_TICKS( tsnconfigARP_PENDING_TIMEOUT_MS ) ) )
+            {
+                FreeRTOS_debug_printf( ( "TSN ARP: dropping frames for %xip\n", ( unsigned ) FreeRTOS_ntohl( ulIPAddress ) ) );
+
+                while( prvPendingTake( pxEntry, ulIPAddress, &xItem ) != pdFAIL )
+                {
+                    prvPendingDrop( ( NetworkBufferDescriptor_t * ) xItem.pxBuf );
+                }
+            }
+            else if( ( xNow - pxEntry->xLastRequest ) >= tsnarpRETRY_TICKS )
+            {
+                pxEntry->xLastRequest = xNow;
+                FreeRTOS_OutputARPRequest( pxEntry->ulNextHop );
+            }
+        }
+    }
+
+#endif /* if ( tsnconfigARP_PENDING_DESTINATIONS > 0 ) */
+
+#if ( ipconfigUSE_IPv6 != 0 )
+
+/**
+ * @brief Send a neighbor solicitation for an IPv6 address
+ *
+ * The reply is stored in the neighbor cache of Plus TCP by the IP task.
+ * Nothing is sent if no network buffer or no IPv6 endpoint is available.
+ *
+ * @param[in] pxIPAddress The address to resolve, i.e. the destination or
+ * the gateway
+ */
+    void vTSNNDSendSolicitation( const IPv6_Address_t * pxIPAddress )
+    {
+        NetworkEndPoint_t * pxEndPoint = FreeRTOS_FindEndPointOnNetMask_IPv6( pxIPAddress );
+        NetworkBufferDescriptor_t * pxBuf;
+
+        if( pxEndPoint == NULL )
+        {
+            pxEndPoint = FreeRTOS_FirstEndPoint_IPv6( NULL );
+        }
+
+        if( pxEndPoint == NULL )
+        {
+            return;
+        }
+
+        pxBuf = pxGetNetworkBufferWithDescriptor( ipSIZE_OF_ETH_HEADER + ipSIZE_OF_IPv6_HEADER + sizeof( ICMPHeader_IPv6_t ), 0U );
+
+        if( pxBuf != NULL )
+        {
+            /* The buffer is sent and released by Plus TCP */
+            pxBuf->pxEndPoint = pxEndPoint;
+            vNDSendNeighbourSolicitation( pxBuf, pxIPAddress );
+        }
+    }
+
+#endif /* if ( ipconfigUSE_IPv6 != 0 ) */
+
+/**
+ * @brief Handle the pending destinations and the neighbors to resolve
+ *
+ * Called by every controller at every pass. The ARP cache is looked up at
+ * most once every tsnconfigARP_POLL_MS: the first controller to call after
+ * the period claims the poll, the others just get the time left.
+ *
+ * @return The ticks until the next poll, portMAX_DELAY if nothing is waiting
+ */
+TickType_t uxTSNARPPoll( void )
+{
+    #if ( tsnconfigARP_PENDING_DESTINATIONS > 0 ) || ( tsnconfigARP_STATIC_NEIGHBORS > 0 )
+        const TickType_t xNow = xTaskGetTickCount();
+        const TickType_t xPeriod = pdMS_TO_TICKS( tsnconfigARP_POLL_MS ) + 1U;
+        UBaseType_t uxWaiting = 0U;
+        TickType_t xElapsed;
+
+        #if ( tsnconfigARP_PENDING_DESTINATIONS > 0 )
+            uxWaiting += uxPendingDestinations;
+        #endif
+        #if ( tsnconfigARP_STATIC_NEIGHBORS > 0 )
+            uxWaiting += uxUnresolvedNeighbors;
+        #endif
+
+        if( uxWaiting == 0U )
+        {
+            return portMAX_DELAY;
+        }
+
+        taskENTER_CRITICAL();
+        {
+            xElapsed = xNow - xLastPoll;
+
+            if( xElapsed >= xPeriod )
+            {
+                xLastPoll = xNow;
+            }
+        }
+        taskEXIT_CRITICAL();
+
+        if( xElapsed < xPeriod )
+        {
+            return xPeriod - xElapsed;
+        }
+
+        #if ( tsnconfigARP_PENDING_DESTINATIONS > 0 )
+            prvPollPending( xNow );
+        #endif
+        #if ( tsnconfigARP_STATIC_NEIGHBORS > 0 )
+            prvPollNeighbors( xNow );
+        #endif
+
+        return xPeriod;
+    #else /* if ( tsnconfigARP_PENDING_DESTINATIONS > 0 ) || ( tsnconfigARP_STATIC_NEIGHBORS > 0 ) */
+        return portMAX_DELAY;
+    #endif /* if ( tsnconfigARP_PENDING_DESTINATIONS > 0 ) || ( tsnconfigARP_STATIC_NEIGHBORS > 0 ) */
+}
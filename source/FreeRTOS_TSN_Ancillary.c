@@ -6,12 +6,21 @@
  * These functions are used to allocate, fill, and free ancillary messages, which are used
  * to pass control and data information between sockets.
  */
+#include <string.h>
+
 #include "FreeRTOS_TSN_Ancillary.h"
 
+#include "FreeRTOS.h"
+#include "task.h"
+
 #include "FreeRTOS_IP.h"
 
+#include "FreeRTOSTSNConfig.h"
+#include "FreeRTOSTSNConfigDefaults.h"
+
 #include "FreeRTOS_TSN_Sockets.h"
 #include "FreeRTOS_TSN_Timestamp.h"
+#include "FreeRTOS_TSN_VLANTags.h"
 
 
 /// @brief Aligns the size of a control message buffer. 
@@ -32,21 +41,168 @@ portINLINE struct cmsghdr * __CMSG_NXTHDR( void * ctl,
 }
 
 
+/* Control space needed by the largest set of control messages generated by
+ * this layer, i.e. the TX timestamp report */
+#define ancillaryMAX_CONTROL_SPACE                                   \
+    ( CMSG_SPACE( sizeof( struct sock_extended_err ) ) +             \
+      CMSG_SPACE( sizeof( struct freertos_scm_timestamping ) ) )
+
+/**
+ * @brief A msghdr with all the storage it points to
+ *
+ * The msghdr is the first member, so that a pointer to the record can be
+ * used as a pointer to the msghdr and freed as such. The name, the iovec and
+ * the control messages are stored in the record itself, so a message needs a
+ * single allocation. Only a control buffer larger than
+ * ancillaryMAX_CONTROL_SPACE is allocated separately.
+ */
+struct xANCILLARY_RECORD
+{
+    struct msghdr xMsgh;                 /**< The message header handed to the sockets */
+    PacketMetadata_t xMeta;              /**< Metadata of the received frame */
+    AncillaryRxInfo_t xRxInfo;           /**< Raw receive information, serialized on request */
+    struct freertos_sockaddr xName;      /**< Storage for msg_name */
+    struct iovec xIovec;                 /**< Storage for msg_iov */
+    BaseType_t xControlOnHeap;           /**< pdTRUE if msg_control was allocated separately */
+    struct xANCILLARY_RECORD * pxNextFree; /**< Next free record, while in the pool */
+    long lControl[ ( ancillaryMAX_CONTROL_SPACE + sizeof( long ) - 1 ) / sizeof( long ) ]; /**< Storage for msg_control */
+};
+
+#if ( tsnconfigANCILLARY_POOL_SIZE > 0 )
+
+/* @brief Records used before falling back to the heap
+ *
+ * Free records are kept in a singly linked list. Allocations and releases
+ * are O(1) and only hold a critical section for a couple of pointer
+ * updates, so they can be performed by any task. Whether a record belongs
+ * to the pool is told by its address.
+ */
+    static struct xANCILLARY_RECORD xAncillaryPool[ tsnconfigANCILLARY_POOL_SIZE ];
+
+    static struct xANCILLARY_RECORD * pxAncillaryFreeList = NULL;
+
+    static BaseType_t xAncillaryPoolInitialised = pdFALSE;
+
+/**
+ * @brief Take a record from the pool
+ *
+ * @return The record, or NULL if the pool is empty
+ */
+    static struct xANCILLARY_RECORD * prvAncillaryPoolTake( void )
+    {
+        struct xANCILLARY_RECORD * pxRecord;
+
+        taskENTER_CRITICAL();
+        {
+            if( xAncillaryPoolInitialised == pdFALSE )
+            {
+                for( size_t uxIndex = 0; uxIndex < tsnconfigANCILLARY_POOL_SIZE; ++uxIndex )
+                {
+                    xAncillaryPool[ uxIndex ].pxNextFree = pxAncillaryFreeList;
+                    pxAncillaryFreeList = &xAncillaryPool[ uxIndex ];
+                }
+
+                xAncillaryPoolInitialised = pdTRUE;
+            }
+
+            pxRecord = pxAncillaryFreeList;
+
+            if( pxRecord != NULL )
+            {
+                pxAncillaryFreeList = pxRecord->pxNextFree;
+            }
+        }
+        taskEXIT_CRITICAL();
+
+        return pxRecord;
+    }
+
+/**
+ * @brief Give a record back to the pool
+ *
+ * @param pxRecord The record, which must belong to the pool
+ */
+    static void prvAncillaryPoolGive( struct xANCILLARY_RECORD * pxRecord )
+    {
+        taskENTER_CRITICAL();
+        {
+            pxRecord->pxNextFree = pxAncillaryFreeList;
+            pxAncillaryFreeList = pxRecord;
+        }
+        taskEXIT_CRITICAL();
+    }
+
+    #define ancillaryIS_POOL_RECORD( pxRecord )                                      \
+    ( ( ( pxRecord ) >= &xAncillaryPool[ 0 ] ) &&                                    \
+      ( ( pxRecord ) < &xAncillaryPool[ tsnconfigANCILLARY_POOL_SIZE ] ) )
+
+#endif /* if ( tsnconfigANCILLARY_POOL_SIZE > 0 ) */
+
 /**
  * @brief Allocates memory for a new msghdr structure.
  *
- * This function allocates memory for a new msghdr structure using the pvPortMalloc function.
- * The allocated memory is then initialized with zeros using the memset function.
+ * This function takes a record from the ancillary pool, or allocates it
+ * using the pvPortMalloc function if the pool is exhausted.
+ * The msghdr, the metadata and the receive information are then
+ * initialized. The record
+ * also holds the storage for the name, the iovec and the control messages,
+ * which is used by the xAncillaryMsgFill* functions, and the metadata of the
+ * frame, see pxAncillaryMsgGetMetadata().
  *
  * @return A pointer to the newly allocated msghdr structure.
  */
 struct msghdr * pxAncillaryMsgMalloc()
 {
-    struct msghdr * pxMsgh = pvPortMalloc( sizeof( struct msghdr ) );
+    struct xANCILLARY_RECORD * pxRecord = NULL;
 
-    memset( pxMsgh, '\0', sizeof( struct msghdr ) );
+    #if ( tsnconfigANCILLARY_POOL_SIZE > 0 )
+        pxRecord = prvAncillaryPoolTake();
+    #endif
+
+    if( pxRecord == NULL )
+    {
+        pxRecord = pvPortMalloc( sizeof( struct xANCILLARY_RECORD ) );
+
+        if( pxRecord == NULL )
+        {
+            return NULL;
+        }
+    }
+
+    memset( &pxRecord->xMsgh, '\0', sizeof( pxRecord->xMsgh ) );
+    memset( &pxRecord->xMeta, '\0', sizeof( pxRecord->xMeta ) );
+    pxRecord->xRxInfo.ulValid = 0;
+    pxRecord->xControlOnHeap = pdFALSE;
+
+    return &pxRecord->xMsgh;
+}
+
+/**
+ * @brief Get the frame metadata stored with a msghdr.
+ *
+ * For received frames the network wrapper stores here the metadata computed
+ * by the parser, so that the socket does not have to parse the frame again.
+ *
+ * @param pxMsgh A msghdr allocated with pxAncillaryMsgMalloc().
+ * @return A pointer to the metadata.
+ */
+PacketMetadata_t * pxAncillaryMsgGetMetadata( struct msghdr * pxMsgh )
+{
+    return &( ( struct xANCILLARY_RECORD * ) pxMsgh )->xMeta;
+}
 
-    return pxMsgh;
+/**
+ * @brief Get the receive information stored with a msghdr.
+ *
+ * The receive path records here the timestamps and the scheduling
+ * information of the frame. Only the fields flagged in ulValid are set.
+ *
+ * @param pxMsgh A msghdr allocated with pxAncillaryMsgMalloc().
+ * @return A pointer to the receive information.
+ */
+AncillaryRxInfo_t * pxAncillaryMsgGetRxInfo( struct msghdr * pxMsgh )
+{
+    return &( ( struct xANCILLARY_RECORD * ) pxMsgh )->xRxInfo;
 }
 
 /**
@@ -58,37 +214,78 @@ struct msghdr * pxAncillaryMsgMalloc()
  */
 void vAncillaryMsgFree( struct msghdr * pxMsgh )
 {
-    vPortFree( pxMsgh );
+    struct xANCILLARY_RECORD * pxRecord = ( struct xANCILLARY_RECORD * ) pxMsgh;
+
+    #if ( tsnconfigANCILLARY_POOL_SIZE > 0 )
+        if( ancillaryIS_POOL_RECORD( pxRecord ) )
+        {
+            prvAncillaryPoolGive( pxRecord );
+            return;
+        }
+    #endif
+
+    vPortFree( pxRecord );
 }
 
 /**
  * @brief Frees a msghdr
  *
- * This will free all the non null members of the msghdr. In order to make sense
- * it should always be used on a msghdr created using pxAncillaryMsgMalloc(),
- * which takes the duty of initializing the struct to zero. Also note that this
- * frees the iovec array, but not the iov_base buffers.
+ * This will free the msghdr together with its name, iovec and control
+ * messages. It must only be used on a msghdr created using
+ * pxAncillaryMsgMalloc(), which stores them in the same record. Also note
+ * that this does not free the iov_base buffers.
  *
  * @param pxMsgh Pointer to msghdr to free
  */
 void vAncillaryMsgFreeAll( struct msghdr * pxMsgh )
 {
-    if( pxMsgh->msg_iov != NULL )
+    vAncillaryMsgFreeControl( pxMsgh );
+
+    vAncillaryMsgFree( pxMsgh );
+}
+
+/**
+ * @brief Duplicates the message of a received frame.
+ *
+ * Used to deliver the same frame to several sockets. The name, the iovec,
+ * the metadata and the receive information are copied in a new record, the
+ * copy refers to the same payload. Received messages carry no control
+ * messages, so none are copied.
+ *
+ * @param pxMsgh A msghdr allocated with pxAncillaryMsgMalloc().
+ * @return The copy, or NULL if no memory is available.
+ */
+struct msghdr * pxAncillaryMsgDuplicate( struct msghdr * pxMsgh )
+{
+    struct xANCILLARY_RECORD * const pxRecord = ( struct xANCILLARY_RECORD * ) pxMsgh;
+    struct xANCILLARY_RECORD * pxCopy;
+
+    pxCopy = ( struct xANCILLARY_RECORD * ) pxAncillaryMsgMalloc();
+
+    if( pxCopy == NULL )
     {
-        vPortFree( pxMsgh->msg_iov );
+        return NULL;
     }
 
+    pxCopy->xMeta = pxRecord->xMeta;
+    pxCopy->xRxInfo = pxRecord->xRxInfo;
+    pxCopy->xMsgh.msg_flags = pxMsgh->msg_flags;
+
     if( pxMsgh->msg_name != NULL )
     {
-        vPortFree( pxMsgh->msg_name );
+        pxCopy->xName = pxRecord->xName;
+        pxCopy->xMsgh.msg_name = &pxCopy->xName;
+        pxCopy->xMsgh.msg_namelen = pxMsgh->msg_namelen;
     }
 
-    if( pxMsgh->msg_control != NULL )
+    if( pxMsgh->msg_iov != NULL )
     {
-        vPortFree( pxMsgh->msg_control );
+        pxCopy->xIovec = pxRecord->xIovec;
+        pxCopy->xMsgh.msg_iov = &pxCopy->xIovec;
+        pxCopy->xMsgh.msg_iovlen = 1;
     }
 
-    vAncillaryMsgFree( pxMsgh );
+    return &pxCopy->xMsgh;
 }
 
 /**
@@ -113,14 +310,9 @@ BaseType_t xAncillaryMsgFillName( struct msghdr * pxMsgh,
 
     if( xAddr != NULL )
     {
-        pxSockAddr = ( struct freertos_sockaddr * ) pvPortMalloc( sizeof( struct freertos_sockaddr ) );
-
-        if( pxSockAddr == NULL )
-        {
-            return pdFAIL;
-        }
+        pxSockAddr = &( ( struct xANCILLARY_RECORD * ) pxMsgh )->xName;
 
-        pxSockAddr->sin_len = sizeof( pxSockAddr );
+        pxSockAddr->sin_len = sizeof( struct freertos_sockaddr );
         pxSockAddr->sin_address = *xAddr;
         pxSockAddr->sin_family = xFamily;
         /* port is in network bytes order for both input and output */
@@ -128,7 +320,7 @@ BaseType_t xAncillaryMsgFillName( struct msghdr * pxMsgh,
         pxSockAddr->sin_flowinfo = 0;
 
         pxMsgh->msg_name = pxSockAddr;
-        pxMsgh->msg_namelen = sizeof( pxSockAddr );
+        pxMsgh->msg_namelen = sizeof( struct freertos_sockaddr );
     }
     else
     {
@@ -139,16 +331,71 @@ BaseType_t xAncillaryMsgFillName( struct msghdr * pxMsgh,
     return pdPASS;
 }
 
+/* The link address is stored in the name field of the record, so it must
+ * fit in a freertos_sockaddr. The array has a negative size otherwise,
+ * which fails the compilation. */
+typedef char ancillarySOCKADDR_LL_FITS_t[ ( sizeof( struct freertos_sockaddr_ll ) <= sizeof( struct freertos_sockaddr ) ) ? 1 : -1 ];
+
 /**
- * @brief Frees the memory allocated for the name field in the given msghdr structure.
+ * @brief Fills in the name field of a message header with the link layer source of a frame.
  *
- * This function frees the memory allocated for the name field in the provided msghdr structure.
+ * Used for the frames received by raw sockets. The name is a
+ * freertos_sockaddr_ll, stored in place of the freertos_sockaddr.
+ *
+ * @param pxMsgh A pointer to the message header structure.
+ * @param pucEthernetBuffer The ethernet buffer of the frame.
+ * @param pxMeta The metadata of the frame.
+ *
+ * @return pdPASS if the name field is successfully filled, pdFAIL otherwise.
+ */
+BaseType_t xAncillaryMsgFillLinkName( struct msghdr * pxMsgh,
+                                      const uint8_t * pucEthernetBuffer,
+                                      const PacketMetadata_t * pxMeta )
+{
+    struct freertos_sockaddr_ll * pxLinkAddr;
+    const EthernetHeader_t * pxEthernetHeader = ( const EthernetHeader_t * ) pucEthernetBuffer;
+    const uint8_t * pucDestination = pxEthernetHeader->xDestinationAddress.ucBytes;
+
+    pxLinkAddr = ( struct freertos_sockaddr_ll * ) &( ( struct xANCILLARY_RECORD * ) pxMsgh )->xName;
+
+    memset( pxLinkAddr, 0, sizeof( struct freertos_sockaddr_ll ) );
+    pxLinkAddr->sll_len = sizeof( struct freertos_sockaddr_ll );
+    pxLinkAddr->sll_family = FREERTOS_AF_PACKET;
+    pxLinkAddr->sll_protocol = pxMeta->usFrameType;
+    pxLinkAddr->sll_vid = ( uint16_t ) vlantagGET_VID_FROM_TCI( pxMeta->usVLANCTCI );
+    pxLinkAddr->sll_halen = ipMAC_ADDRESS_LENGTH_BYTES;
+    memcpy( pxLinkAddr->sll_addr, pxEthernetHeader->xSourceAddress.ucBytes, ipMAC_ADDRESS_LENGTH_BYTES );
+
+    if( memcmp( pucDestination, xBroadcastMACAddress.ucBytes, ipMAC_ADDRESS_LENGTH_BYTES ) == 0 )
+    {
+        pxLinkAddr->sll_pkttype = FREERTOS_PACKET_BROADCAST;
+    }
+    else if( ( pucDestination[ 0 ] & 0x01U ) != 0U )
+    {
+        pxLinkAddr->sll_pkttype = FREERTOS_PACKET_MULTICAST;
+    }
+    else
+    {
+        pxLinkAddr->sll_pkttype = FREERTOS_PACKET_HOST;
+    }
+
+    pxMsgh->msg_name = pxLinkAddr;
+    pxMsgh->msg_namelen = sizeof( struct freertos_sockaddr_ll );
+
+    return pdPASS;
+}
+
+/**
+ * @brief Clears the name field in the given msghdr structure.
+ *
+ * The name is stored in the ancillary record, so nothing is freed.
  *
  * @param pxMsgh Pointer to the msghdr structure.
  */
 void vAncillaryMsgFreeName( struct msghdr * pxMsgh )
 {
-    vPortFree( pxMsgh->msg_name );
+    pxMsgh->msg_name = NULL;
+    pxMsgh->msg_namelen = 0;
 }
 
 
@@ -167,14 +414,7 @@ BaseType_t xAncillaryMsgFillPayload( struct msghdr * pxMsgh,
                                      uint8_t * pucBuffer,
                                      size_t uxLength )
 {
-    struct iovec * pxIOvec;
-
-    pxIOvec = pvPortMalloc( sizeof( struct iovec ) );
-
-    if( pxIOvec == NULL )
-    {
-        return pdFAIL;
-    }
+    struct iovec * pxIOvec = &( ( struct xANCILLARY_RECORD * ) pxMsgh )->xIovec;
 
     pxIOvec->iov_len = uxLength;
     pxIOvec->iov_base = pucBuffer;
@@ -188,7 +428,8 @@ BaseType_t xAncillaryMsgFillPayload( struct msghdr * pxMsgh,
 /**
  * @brief Frees the payload of an ancillary message.
  *
- * This function frees the memory allocated for the payload of an ancillary message.
+ * This function frees the buffers of the payload of an ancillary message.
+ * The iovec array is stored in the ancillary record and is not freed.
  * The caller must ensure that the array is not empty before calling this function.
  *
  * @param pxMsgh Pointer to the msghdr structure representing the ancillary message.
@@ -202,7 +443,8 @@ void vAncillaryMsgFreePayload( struct msghdr * pxMsgh )
         vPortFree( pxMsgh->msg_iov[ uxIter ].iov_base );
     }
 
-    vPortFree( pxMsgh->msg_iov );
+    pxMsgh->msg_iov = NULL;
+    pxMsgh->msg_iovlen = 0;
 }
 
 /**
@@ -238,15 +480,30 @@ BaseType_t xAncillaryMsgControlFill( struct msghdr * pxMsgh,
         uxTotalSpace += CMSG_SPACE( puxDataLenVec[ uxIter ] );
     }
 
-    /* Note: the address returned by portMalloc is already aligned by 8 bytes */
-    uint8_t * pxBuffer = pvPortMalloc( uxTotalSpace );
+    struct xANCILLARY_RECORD * const pxRecord = ( struct xANCILLARY_RECORD * ) pxMsgh;
+    uint8_t * pxBuffer;
 
-    if( pxBuffer == NULL )
+    // Release a previous control buffer
+    vAncillaryMsgFreeControl( pxMsgh );
+
+    if( uxTotalSpace <= sizeof( pxRecord->lControl ) )
     {
-        // Allocation failed, set the message control fields to NULL and return pdFAIL
-        pxMsgh->msg_control = NULL;
-        pxMsgh->msg_controllen = 0;
-        return pdFAIL;
+        pxBuffer = ( uint8_t * ) pxRecord->lControl;
+    }
+    else
+    {
+        /* Note: the address returned by portMalloc is already aligned by 8 bytes */
+        pxBuffer = pvPortMalloc( uxTotalSpace );
+
+        if( pxBuffer == NULL )
+        {
+            // Allocation failed, set the message control fields to NULL and return pdFAIL
+            pxMsgh->msg_control = NULL;
+            pxMsgh->msg_controllen = 0;
+            return pdFAIL;
+        }
+
+        pxRecord->xControlOnHeap = pdTRUE;
     }
 
     // Set the message control fields to the allocated buffer and the total space
@@ -261,9 +518,7 @@ BaseType_t xAncillaryMsgControlFill( struct msghdr * pxMsgh,
         if( pxCmsghIter == NULL )
         {
             // Free the allocated buffer and set the message control fields to NULL if there is no more space for control messages
-            vPortFree( pxBuffer );
-            pxMsgh->msg_control = NULL;
-            pxMsgh->msg_controllen = 0;            
+            vAncillaryMsgFreeControl( pxMsgh );
             return pdFAIL;
         }
 
@@ -298,12 +553,144 @@ BaseType_t xAncillaryMsgControlFillSingle( struct msghdr * pxMsgh,
 /**
  * @brief Frees the memory allocated for the ancillary message control data.
  *
- * This function frees the memory allocated for the ancillary message control data
- * pointed to by the `msg_control` member of the `msghdr` structure.
+ * This function frees the ancillary message control data pointed to by the
+ * `msg_control` member of the `msghdr` structure, if it did not fit in the
+ * ancillary record, and clears the control fields.
  *
  * @param pxMsgh Pointer to the `msghdr` structure.
  */
 void vAncillaryMsgFreeControl( struct msghdr * pxMsgh )
 {
-    vPortFree( pxMsgh->msg_control );
+    struct xANCILLARY_RECORD * const pxRecord = ( struct xANCILLARY_RECORD * ) pxMsgh;
+
+    if( pxRecord->xControlOnHeap != pdFALSE )
+    {
+        vPortFree( pxMsgh->msg_control );
+        pxRecord->xControlOnHeap = pdFALSE;
+    }
+
+    pxMsgh->msg_control = NULL;
+    pxMsgh->msg_controllen = 0;
+}
+
+/**
+ * @brief Append a control message to a buffer
+ *
+ * @param[in] pucControl The control buffer
+ * @param[in] uxControlLen Length of the control buffer
+ * @param[in,out] puxUsed Bytes of the buffer already used
+ * @param[in] iLevel Level of the control message
+ * @param[in] iType Type of the control message
+ * @param[in] pvData Payload of the control message
+ * @param[in] uxDataLen Length of the payload
+ * @return pdPASS if the message fits in the buffer, pdFAIL otherwise
+ */
+static BaseType_t prvControlAppend( uint8_t * pucControl,
+                                    size_t uxControlLen,
+                                    size_t * puxUsed,
+                                    int iLevel,
+                                    int iType,
+                                    const void * pvData,
+                                    size_t uxDataLen )
+{
+    struct cmsghdr xHeader;
+
+    if( *puxUsed + CMSG_SPACE( uxDataLen ) > uxControlLen )
+    {
+        return pdFAIL;
+    }
+
+    xHeader.cmsg_len = CMSG_LEN( uxDataLen );
+    xHeader.cmsg_level = iLevel;
+    xHeader.cmsg_type = iType;
+
+    memcpy( &pucControl[ *puxUsed ], &xHeader, sizeof( xHeader ) );
+    memcpy( &pucControl[ *puxUsed + CMSG_LEN( 0 ) ], pvData, uxDataLen );
+    *puxUsed += CMSG_SPACE( uxDataLen );
+
+    return pdPASS;
+}
+
+/**
+ * @brief Write the control messages of a message into a user buffer
+ *
+ * Control messages already attached to the message, i.e. the reports of
+ * the errqueue, are copied as they are. For received frames the control
+ * messages are built from the receive information and the metadata stored
+ * in the record, for the options enabled on the socket, so nothing is
+ * formatted unless the user provides a buffer for it.
+ * FREERTOS_MSG_CTRUNC is set in the flags if the buffer is too short.
+ *
+ * @param[in] pxMsgh A msghdr allocated with pxAncillaryMsgMalloc()
+ * @param[in] pxTSNSocket The socket receiving the message
+ * @param[out] pvControl The user control buffer
+ * @param[in] uxControlLen Length of the user control buffer
+ * @param[in,out] piFlags The message flags returned to the user
+ * @return The number of bytes written in the user buffer
+ */
+size_t uxAncillaryMsgControlBuild( struct msghdr * pxMsgh,
+                                   const struct xTSN_SOCKET * pxTSNSocket,
+                                   void * pvControl,
+                                   size_t uxControlLen,
+                                   int * piFlags )
+{
+    struct xANCILLARY_RECORD * const pxRecord = ( struct xANCILLARY_RECORD * ) pxMsgh;
+    const AncillaryRxInfo_t * const pxInfo = &pxRecord->xRxInfo;
+    size_t uxUsed = 0;
+
+    if( pxMsgh->msg_control != NULL )
+    {
+        uxUsed = configMIN( uxControlLen, pxMsgh->msg_controllen );
+        memcpy( pvControl, pxMsgh->msg_control, uxUsed );
+
+        if( uxUsed < pxMsgh->msg_controllen )
+        {
+            *piFlags |= FREERTOS_MSG_CTRUNC;
+        }
+
+        return uxUsed;
+    }
+
+    if( ( pxTSNSocket->ulTSFlags & ( SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_RX_HARDWARE ) ) &&
+        ( pxInfo->ulValid & ( ancillaryRX_HAS_SW_TIMESTAMP | ancillaryRX_HAS_HW_TIMESTAMP ) ) )
+    {
+        struct freertos_scm_timestamping xTimestamp;
+
+        memset( &xTimestamp, 0, sizeof( xTimestamp ) );
+
+        if( pxInfo->ulValid & ancillaryRX_HAS_SW_TIMESTAMP )
+        {
+            xTimestamp.ts[ 0 ] = pxInfo->xSoftwareTimestamp;
+        }
+
+        if( pxInfo->ulValid & ancillaryRX_HAS_HW_TIMESTAMP )
+        {
+            xTimestamp.ts[ 2 ] = pxInfo->xHardwareTimestamp;
+        }
+
+        if( prvControlAppend( pvControl, uxControlLen, &uxUsed, FREERTOS_SOL_SOCKET, FREERTOS_SCM_TIMESTAMPING, &xTimestamp, sizeof( xTimestamp ) ) != pdPASS )
+        {
+            *piFlags |= FREERTOS_MSG_CTRUNC;
+        }
+    }
+
+    if( pxTSNSocket->ucRxInfo != pdFALSE )
+    {
+        struct freertos_tsn_rxinfo xRxInfo;
+
+        memset( &xRxInfo, 0, sizeof( xRxInfo ) );
+        xRxInfo.usVLANCTCI = pxRecord->xMeta.usVLANCTCI;
+        xRxInfo.usVLANSTCI = pxRecord->xMeta.usVLANSTCI;
+        xRxInfo.ucNumTags = pxRecord->xMeta.ucNumTags;
+        xRxInfo.ucValid = ( uint8_t ) ( pxInfo->ulValid & ( ancillaryRX_HAS_QUEUE | ancillaryRX_HAS_QUEUEING_DELAY ) );
+        xRxInfo.ulQueueIPV = ( uint32_t ) pxInfo->uxQueueIPV;
+        xRxInfo.xQueueingDelay = pxInfo->xQueueingDelay;
+
+        if( prvControlAppend( pvControl, uxControlLen, &uxUsed, FREERTOS_SOL_SOCKET, FREERTOS_SCM_TSN_RXINFO, &xRxInfo, sizeof( xRxInfo ) ) != pdPASS )
+        {
+            *piFlags |= FREERTOS_MSG_CTRUNC;
+        }
+    }
+
+    return uxUsed;
 }
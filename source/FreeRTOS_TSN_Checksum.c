@@ -0,0 +1,598 @@
+/**
+ * @file FreeRTOS_TSN_Checksum.c
+ * @brief Internet checksum helpers for the TSN layer
+ *
+ * The helpers work on the values as stored in the headers, i.e. in network
+ * byte order. The one's complement sum does not depend on the byte order, so
+ * the result can be written back to the header as it is.
+ * The kernel summing the data is chosen with tsnconfigCHECKSUM_KERNEL.
+ */
+
+#include <string.h>
+
+#include "FreeRTOS.h"
+
+#include "FreeRTOS_IP.h"
+
+#include "FreeRTOS_TSN_Checksum.h"
+
+#if ( tsnconfigCHECKSUM_KERNEL == tsnconfigCHECKSUM_SIMD )
+    #if defined( __SSE2__ )
+        #include <emmintrin.h>
+        #define checksumUSE_SSE2    1
+    #elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+        #include <arm_neon.h>
+        #define checksumUSE_NEON    1
+    #endif
+#endif
+
+/* Max number of bytes summed by the vector kernels before the lanes are
+ * folded, so that the 32 bit lanes never overflow */
+#define checksumSIMD_CHUNK    ( 65536U )
+
+/**
+ * @brief Fold a 64 bit sum of 16 bit words to 16 bits
+ *
+ * @param[in] ullSum The sum
+ * @return The one's complement sum on 16 bits
+ */
+static uint16_t prvFold( uint64_t ullSum )
+{
+    ullSum = ( ullSum & 0xFFFFFFFFULL ) + ( ullSum >> 32 );
+    ullSum = ( ullSum & 0xFFFFFFFFULL ) + ( ullSum >> 32 );
+    ullSum = ( ullSum & 0xFFFFULL ) + ( ullSum >> 16 );
+    ullSum = ( ullSum & 0xFFFFULL ) + ( ullSum >> 16 );
+
+    return ( uint16_t ) ullSum;
+}
+
+/**
+ * @brief Value of a trailing odd byte, padded with a zero byte
+ *
+ * @param[in] pucByte The last byte of the data
+ * @return The padded word, in memory byte order
+ */
+static uint16_t prvTrailingByte( const uint8_t * pucByte )
+{
+    uint8_t ucWord[ 2 ] = { pucByte[ 0 ], 0U };
+    uint16_t usWord;
+
+    memcpy( &usWord, ucWord, sizeof( usWord ) );
+
+    return usWord;
+}
+
+#if ( tsnconfigCHECKSUM_KERNEL == tsnconfigCHECKSUM_REFERENCE ) || ( tsnconfigCHECKSUM_SELF_TEST != tsnconfigDISABLE )
+
+/**
+ * @brief Reference kernel, summing a 16 bit word at a time as in RFC 1071
+ *
+ * @param[in] usSum The sum of the previous data
+ * @param[in] pucData The data
+ * @param[in] uxLength The length of the data
+ * @return The one's complement sum on 16 bits
+ */
+    static uint16_t prvAccumulateReference( uint16_t usSum,
+                                            const uint8_t * pucData,
+                                            size_t uxLength )
+    {
+        uint64_t ullSum = usSum;
+        uint16_t usWord;
+
+        while( uxLength >= 2U )
+        {
+            memcpy( &usWord, pucData, sizeof( usWord ) );
+            ullSum += usWord;
+            pucData += 2;
+            uxLength -= 2U;
+        }
+
+        if( uxLength != 0U )
+        {
+            ullSum += prvTrailingByte( pucData );
+        }
+
+        return prvFold( ullSum );
+    }
+
+#endif /* if ( tsnconfigCHECKSUM_KERNEL == tsnconfigCHECKSUM_REFERENCE ) || ( tsnconfigCHECKSUM_SELF_TEST != tsnconfigDISABLE ) */
+
+#if ( tsnconfigCHECKSUM_KERNEL != tsnconfigCHECKSUM_REFERENCE )
+
+/**
+ * @brief Word kernel, summing 32 bit words in a 64 bit accumulator
+ *
+ * Since 2^16 = 1 modulo 2^16 - 1, the sum of the 32 bit words folds to the
+ * same value as the sum of the 16 bit words. The accumulator cannot
+ * overflow, so the carries are only folded at the end. The main loop is
+ * unrolled to 32 bytes.
+ *
+ * @param[in] ullSum The sum of the previous data
+ * @param[in] pucData The data
+ * @param[in] uxLength The length of the data
+ * @return The sum, not folded
+ */
+    static uint64_t prvAccumulateWords( uint64_t ullSum,
+                                        const uint8_t * pucData,
+                                        size_t uxLength )
+    {
+        uint32_t ulWord[ 8 ];
+        uint16_t usWord;
+
+        while( uxLength >= sizeof( ulWord ) )
+        {
+            memcpy( ulWord, pucData, sizeof( ulWord ) );
+            ullSum += ( uint64_t ) ulWord[ 0 ] + ulWord[ 1 ] + ulWord[ 2 ] + ulWord[ 3 ];
+            ullSum += ( uint64_t ) ulWord[ 4 ] + ulWord[ 5 ] + ulWord[ 6 ] + ulWord[ 7 ];
+            pucData += sizeof( ulWord );
+            uxLength -= sizeof( ulWord );
+        }
+
+        while( uxLength >= sizeof( ulWord[ 0 ] ) )
+        {
+            memcpy( ulWord, pucData, sizeof( ulWord[ 0 ] ) );
+            ullSum += ulWord[ 0 ];
+            pucData += sizeof( ulWord[ 0 ] );
+            uxLength -= sizeof( ulWord[ 0 ] );
+        }
+
+        if( uxLength >= sizeof( usWord ) )
+        {
+            memcpy( &usWord, pucData, sizeof( usWord ) );
+            ullSum += usWord;
+            pucData += sizeof( usWord );
+            uxLength -= sizeof( usWord );
+        }
+
+        if( uxLength != 0U )
+        {
+            ullSum += prvTrailingByte( pucData );
+        }
+
+        return ullSum;
+    }
+
+#endif /* if ( tsnconfigCHECKSUM_KERNEL != tsnconfigCHECKSUM_REFERENCE ) */
+
+#if defined( checksumUSE_SSE2 )
+
+/**
+ * @brief SSE2 kernel, summing 16 bytes at a time in 32 bit lanes
+ *
+ * @param[in] ullSum The sum of the previous data
+ * @param[in] pucData The data
+ * @param[in] uxLength The length of the data
+ * @return The sum, not folded
+ */
+    static uint64_t prvAccumulateVector( uint64_t ullSum,
+                                         const uint8_t * pucData,
+                                         size_t uxLength )
+    {
+        const __m128i xZero = _mm_setzero_si128();
+        uint32_t ulLanes[ 4 ];
+
+        while( uxLength >= 16U )
+        {
+            size_t uxChunk = configMIN( uxLength, checksumSIMD_CHUNK ) & ~( size_t ) 15U;
+            __m128i xAcc = _mm_setzero_si128();
+
+            uxLength -= uxChunk;
+
+            for( ; uxChunk != 0U; uxChunk -= 16U, pucData += 16 )
+            {
+                const __m128i xData = _mm_loadu_si128( ( const __m128i * ) pucData );
+
+                xAcc = _mm_add_epi32( xAcc, _mm_unpacklo_epi16( xData, xZero ) );
+                xAcc = _mm_add_epi32( xAcc, _mm_unpackhi_epi16( xData, xZero ) );
+            }
+
+            _mm_storeu_si128( ( __m128i * ) ulLanes, xAcc );
+            ullSum += ( uint64_t ) ulLanes[ 0 ] + ulLanes[ 1 ] + ulLanes[ 2 ] + ulLanes[ 3 ];
+        }
+
+        return prvAccumulateWords( ullSum, pucData, uxLength );
+    }
+
+#elif defined( checksumUSE_NEON )
+
+/**
+ * @brief NEON kernel, summing 16 bytes at a time in 32 bit lanes
+ *
+ * @param[in] ullSum The sum of the previous data
+ * @param[in] pucData The data
+ * @param[in] uxLength The length of the data
+ * @return The sum, not folded
+ */
+    static uint64_t prvAccumulateVector( uint64_t ullSum,
+                                         const uint8_t * pucData,
+                                         size_t uxLength )
+    {
+        while( uxLength >= 16U )
+        {
+            size_t uxChunk = configMIN( uxLength, checksumSIMD_CHUNK ) & ~( size_t ) 15U;
+            uint32x4_t xAcc = vdupq_n_u32( 0U );
+
+            uxLength -= uxChunk;
+
+            for( ; uxChunk != 0U; uxChunk -= 16U, pucData += 16 )
+            {
+                /* Pairwise add of the 16 bit words into the 32 bit lanes */
+                xAcc = vpadalq_u16( xAcc, vreinterpretq_u16_u8( vld1q_u8( pucData ) ) );
+            }
+
+            ullSum += ( uint64_t ) vgetq_lane_u32( xAcc, 0 ) + vgetq_lane_u32( xAcc, 1 ) +
+                      vgetq_lane_u32( xAcc, 2 ) + vgetq_lane_u32( xAcc, 3 );
+        }
+
+        return prvAccumulateWords( ullSum, pucData, uxLength );
+    }
+
+#endif /* if defined( checksumUSE_SSE2 ) */
+
+/**
+ * @brief Add data to a one's complement sum
+ *
+ * The sum can be carried over several calls, as long as all the chunks but
+ * the last one have an even length.
+ *
+ * @param[in] usSum The sum of the previous data, 0 for the first chunk
+ * @param[in] pucData The data
+ * @param[in] uxLength The length of the data
+ * @return The one's complement sum on 16 bits, not complemented
+ */
+uint16_t usChecksumAccumulate( uint16_t usSum,
+                               const uint8_t * pucData,
+                               size_t uxLength )
+{
+    #if ( tsnconfigCHECKSUM_KERNEL == tsnconfigCHECKSUM_REFERENCE )
+        return prvAccumulateReference( usSum, pucData, uxLength );
+    #elif defined( checksumUSE_SSE2 ) || defined( checksumUSE_NEON )
+        return prvFold( prvAccumulateVector( usSum, pucData, uxLength ) );
+    #else
+        /* Also used when no vector extension is available */
+        return prvFold( prvAccumulateWords( usSum, pucData, uxLength ) );
+    #endif
+}
+
+/**
+ * @brief Update a checksum after changing a 16 bit word it covers
+ *
+ * Implements eqn. 3 of RFC 1624, HC' = ~( ~HC + ~m + m' ), which gives the
+ * same result as a full computation, also in the corner case where RFC 1141
+ * does not. The header does not need to be read again.
+ *
+ * @param[in] usChecksum The current checksum, as found in the header
+ * @param[in] usOldValue The old value of the word, as found in the header
+ * @param[in] usNewValue The new value of the word, as written in the header
+ * @return The checksum to write in the header
+ */
+uint16_t usChecksumUpdate16( uint16_t usChecksum,
+                             uint16_t usOldValue,
+                             uint16_t usNewValue )
+{
+    uint32_t ulSum;
+
+    ulSum = ( uint32_t ) ( uint16_t ) ~usChecksum + ( uint32_t ) ( uint16_t ) ~usOldValue + ( uint32_t ) usNewValue;
+
+    // Fold the carries back, twice to cover the carry of the first fold
+    ulSum = ( ulSum & 0xFFFFU ) + ( ulSum >> 16 );
+    ulSum = ( ulSum & 0xFFFFU ) + ( ulSum >> 16 );
+
+    return ( uint16_t ) ~ulSum;
+}
+
+/**
+ * @brief Compute the checksum of an IPv4 header
+ *
+ * The checksum field must be set to 0 before the call.
+ *
+ * @param[in] pxIPHeader The IPv4 header, options included
+ * @return The checksum to write in the header
+ */
+uint16_t usChecksumIPv4Header( const IPHeader_t * pxIPHeader )
+{
+    const size_t uxHeaderLength = ( size_t ) ( ( pxIPHeader->ucVersionHeaderLength & 0x0FU ) << 2 );
+
+    return ( uint16_t ) ~usChecksumAccumulate( 0U, ( const uint8_t * ) pxIPHeader, uxHeaderLength );
+}
+
+/**
+ * @brief Sum the IPv4 pseudo header of a UDP datagram
+ *
+ * @param[in] pxIPHeader The IPv4 header
+ * @param[in] usUDPLength The length of the datagram, in network byte order
+ * @return The one's complement sum on 16 bits
+ */
+static uint16_t prvPseudoHeaderSumIPv4( const IPHeader_t * pxIPHeader,
+                                        uint16_t usUDPLength )
+{
+    const uint8_t ucProtocol[ 2 ] = { 0U, ipPROTOCOL_UDP };
+    uint16_t usSum;
+
+    /* Source and destination addresses are contiguous */
+    usSum = usChecksumAccumulate( 0U, ( const uint8_t * ) &pxIPHeader->ulSourceIPAddress, 2U * sizeof( uint32_t ) );
+    usSum = usChecksumAccumulate( usSum, ucProtocol, sizeof( ucProtocol ) );
+
+    return usChecksumAccumulate( usSum, ( const uint8_t * ) &usUDPLength, sizeof( usUDPLength ) );
+}
+
+/**
+ * @brief Compute the checksum of a UDP datagram over IPv4
+ *
+ * The checksum field of the UDP header must be set to 0 before the call.
+ *
+ * @param[in] pxIPHeader The IPv4 header, with the addresses set
+ * @param[in] pucUDPSegment The UDP header followed by the payload
+ * @param[in] uxUDPLength The length of the UDP header and payload
+ * @return The checksum to write in the header, never 0
+ */
+uint16_t usChecksumUDPv4( const IPHeader_t * pxIPHeader,
+                          const uint8_t * pucUDPSegment,
+                          size_t uxUDPLength )
+{
+    uint16_t usSum = prvPseudoHeaderSumIPv4( pxIPHeader, FreeRTOS_htons( ( uint16_t ) uxUDPLength ) );
+
+    usSum = ( uint16_t ) ~usChecksumAccumulate( usSum, pucUDPSegment, uxUDPLength );
+
+    /* 0 means that the checksum is not used */
+    return ( usSum == 0U ) ? ( uint16_t ) 0xFFFFU : usSum;
+}
+
+/**
+ * @brief Verify the header and UDP checksums of a received IPv4 packet
+ *
+ * A valid header, or segment, sums to 0xFFFF including its checksum.
+ * Datagrams sent without a UDP checksum are accepted.
+ *
+ * @param[in] pucIPPacket The IPv4 header followed by the UDP datagram
+ * @param[in] uxIPHeaderLength The length of the IPv4 header
+ * @param[in] uxUDPLength The length of the UDP header and payload
+ * @return pdPASS if the checksums are valid, pdFAIL otherwise
+ */
+BaseType_t xChecksumVerifyIPv4UDP( const uint8_t * pucIPPacket,
+                                   size_t uxIPHeaderLength,
+                                   size_t uxUDPLength )
+{
+    const IPHeader_t * pxIPHeader = ( const IPHeader_t * ) pucIPPacket;
+    const UDPHeader_t * pxUDPHeader = ( const UDPHeader_t * ) &pucIPPacket[ uxIPHeaderLength ];
+    uint16_t usSum;
+
+    if( usChecksumAccumulate( 0U, pucIPPacket, uxIPHeaderLength ) != 0xFFFFU )
+    {
+        return pdFAIL;
+    }
+
+    if( pxUDPHeader->usChecksum == 0U )
+    {
+        return pdPASS;
+    }
+
+    usSum = prvPseudoHeaderSumIPv4( pxIPHeader, FreeRTOS_htons( ( uint16_t ) uxUDPLength ) );
+    usSum = usChecksumAccumulate( usSum, ( const uint8_t * ) pxUDPHeader, uxUDPLength );
+
+    return ( usSum == 0xFFFFU ) ? pdPASS : pdFAIL;
+}
+
+#if ( ipconfigUSE_IPv6 != 0 )
+
+/**
+ * @brief Sum the IPv6 pseudo header of a UDP datagram
+ *
+ * The upper half of the 32 bit length is always 0 for datagrams fitting in a
+ * frame, so it sums as the 16 bit length of IPv4.
+ *
+ * @param[in] pxIPHeader The IPv6 header
+ * @param[in] usUDPLength The length of the datagram, in network byte order
+ * @return The one's complement sum on 16 bits
+ */
+    static uint16_t prvPseudoHeaderSumIPv6( const IPHeader_IPv6_t * pxIPHeader,
+                                            uint16_t usUDPLength )
+    {
+        const uint8_t ucNextHeader[ 2 ] = { 0U, ipPROTOCOL_UDP };
+        uint16_t usSum;
+
+        /* Source and destination addresses are contiguous */
+        usSum = usChecksumAccumulate( 0U, pxIPHeader->xSourceAddress.ucBytes, 2U * ipSIZE_OF_IPv6_ADDRESS );
+        usSum = usChecksumAccumulate( usSum, ucNextHeader, sizeof( ucNextHeader ) );
+
+        return usChecksumAccumulate( usSum, ( const uint8_t * ) &usUDPLength, sizeof( usUDPLength ) );
+    }
+
+/**
+ * @brief Compute the checksum of a UDP datagram over IPv6
+ *
+ * The checksum field of the UDP header must be set to 0 before the call.
+ *
+ * @param[in] pxIPHeader The IPv6 header, with the addresses set
+ * @param[in] pucUDPSegment The UDP header followed by the payload
+ * @param[in] uxUDPLength The length of the UDP header and payload
+ * @return The checksum to write in the header, never 0
+ */
+    uint16_t usChecksumUDPv6( const IPHeader_IPv6_t * pxIPHeader,
+                              const uint8_t * pucUDPSegment,
+                              size_t uxUDPLength )
+    {
+        uint16_t usSum = prvPseudoHeaderSumIPv6( pxIPHeader, FreeRTOS_htons( ( uint16_t ) uxUDPLength ) );
+
+        usSum = ( uint16_t ) ~usChecksumAccumulate( usSum, pucUDPSegment, uxUDPLength );
+
+        return ( usSum == 0U ) ? ( uint16_t ) 0xFFFFU : usSum;
+    }
+
+/**
+ * @brief Verify the UDP checksum of a received IPv6 packet
+ *
+ * Unlike IPv4, the checksum is mandatory, datagrams without it are
+ * rejected (RFC 8200, section 8.1).
+ *
+ * @param[in] pucIPPacket The IPv6 header followed by the UDP datagram
+ * @param[in] uxUDPLength The length of the UDP header and payload
+ * @return pdPASS if the checksum is valid, pdFAIL otherwise
+ */
+    BaseType_t xChecksumVerifyIPv6UDP( const uint8_t * pucIPPacket,
+                                       size_t uxUDPLength )
+    {
+        const IPHeader_IPv6_t * pxIPHeader = ( const IPHeader_IPv6_t * ) pucIPPacket;
+        const UDPHeader_t * pxUDPHeader = ( const UDPHeader_t * ) &pucIPPacket[ ipSIZE_OF_IPv6_HEADER ];
+        uint16_t usSum;
+
+        if( pxUDPHeader->usChecksum == 0U )
+        {
+            return pdFAIL;
+        }
+
+        usSum = prvPseudoHeaderSumIPv6( pxIPHeader, FreeRTOS_htons( ( uint16_t ) uxUDPLength ) );
+        usSum = usChecksumAccumulate( usSum, ( const uint8_t * ) pxUDPHeader, uxUDPLength );
+
+        return ( usSum == 0xFFFFU ) ? pdPASS : pdFAIL;
+    }
+
+#endif /* if ( ipconfigUSE_IPv6 != 0 ) */
+
+#if ( tsnconfigCHECKSUM_SELF_TEST != tsnconfigDISABLE )
+
+/**
+ * @brief Compare the selected kernel with the reference one
+ *
+ * Runs on three patterns: pseudo random bytes, bytes of 0xF0 and above,
+ * where most additions carry, and bytes of 0xFF, where every word is 0xFFFF
+ * and every addition carries. Each pattern is checked for all the lengths up
+ * to the size of a frame, so odd lengths and the trailing byte are covered,
+ * and for every start offset modulo 8, so the kernels also see data that is
+ * not aligned to their words or vectors.
+ * With the default MTU both kernels go through about 56 MB of data, which
+ * takes seconds on a microcontroller, so it is meant to be called once at
+ * startup.
+ *
+ * @return pdPASS if the kernels agree, pdFAIL otherwise
+ */
+    BaseType_t xChecksumSelfTest( void )
+    {
+        static uint8_t ucData[ ipconfigNETWORK_MTU + ipSIZE_OF_ETH_HEADER + 8U ];
+        uint32_t ulSeed = 0x12345678UL;
+
+        for( BaseType_t xPattern = 0; xPattern < 3; ++xPattern )
+        {
+            for( size_t uxIndex = 0; uxIndex < sizeof( ucData ); ++uxIndex )
+            {
+                ulSeed = ulSeed * 1664525UL + 1013904223UL;
+
+                switch( xPattern )
+                {
+                    case 0:
+                        ucData[ uxIndex ] = ( uint8_t ) ( ulSeed >> 24 );
+                        break;
+
+                    case 1:
+                        ucData[ uxIndex ] = ( uint8_t ) ( 0xF0U | ( ulSeed >> 28 ) );
+                        break;
+
+                    default:
+                        ucData[ uxIndex ] = 0xFFU;
+                        break;
+                }
+            }
+
+            for( size_t uxOffset = 0; uxOffset < 8U; ++uxOffset )
+            {
+                for( size_t uxLength = 0; uxLength + uxOffset <= sizeof( ucData ); ++uxLength )
+                {
+                    const uint16_t usInitial = ( uint16_t ) uxLength;
+
+                    if( usChecksumAccumulate( usInitial, &ucData[ uxOffset ], uxLength ) !=
+                        prvAccumulateReference( usInitial, &ucData[ uxOffset ], uxLength ) )
+                    {
+                        return pdFAIL;
+                    }
+                }
+            }
+        }
+
+        return pdPASS;
+    }
+
+#endif /* if ( tsnconfigCHECKSUM_SELF_TEST != tsnconfigDISABLE ) */
+
+#if ( tsnconfigSELF_TEST != tsnconfigDISABLE )
+
+/* Step of the update self test which sets the word to the value making the
+ * checksum of the header 0x0000 */
+    #define checksumUPDATE_TO_ZERO    ( 0x10000UL )
+
+/**
+ * @brief Compare usChecksumUpdate16() with a full computation
+ *
+ * Changes the length and the identification of two IPv4 headers, one with
+ * small words and one with words close to 0xFFFF, through a sequence of
+ * values going to and from 0x0000 and 0xFFFF. The sequence also sets the
+ * word so that the checksum becomes 0x0000, and then changes it again from
+ * there, which are the cases where RFC 1141 gives 0xFFFF instead.
+ *
+ * @return pdPASS if the updates match the full computations, pdFAIL otherwise
+ */
+    BaseType_t xChecksumUpdateSelfTest( void )
+    {
+        /* Words in memory order, the checksum does not depend on it */
+        static const uint16_t usHeaders[ 2 ][ ipSIZE_OF_IPv4_HEADER / 2U ] =
+        {
+            { 0x4500U, 0x001CU, 0x0001U, 0x0000U, 0x4011U, 0x0000U, 0xC0A8U, 0x0001U, 0xC0A8U, 0x0002U },
+            { 0x45FFU, 0xFFFEU, 0xFFFFU, 0xFFFFU, 0xFF11U, 0x0000U, 0xFFFFU, 0xFFFEU, 0xFFFFU, 0xFFFFU }
+        };
+        static const uint32_t ulValues[] =
+        {
+            0x0000U, 0xFFFFU, checksumUPDATE_TO_ZERO, 0x0000U, 0xFFFEU, checksumUPDATE_TO_ZERO, 0xFFFFU, 0x0001U, 0x0000U
+        };
+        const size_t uxChecksumWord = offsetof( IPHeader_t, usHeaderChecksum ) / 2U;
+        uint16_t usHeader[ ipSIZE_OF_IPv4_HEADER / 2U ];
+        uint16_t usChecksum;
+        uint16_t usNewValue;
+        uint16_t usFull;
+
+        for( size_t uxHeader = 0; uxHeader < 2U; ++uxHeader )
+        {
+            /* The length and the identification */
+            for( size_t uxWord = 1U; uxWord <= 2U; ++uxWord )
+            {
+                memcpy( usHeader, usHeaders[ uxHeader ], sizeof( usHeader ) );
+                usChecksum = ( uint16_t ) ~usChecksumAccumulate( 0U, ( const uint8_t * ) usHeader, sizeof( usHeader ) );
+
+                for( size_t uxStep = 0; uxStep < sizeof( ulValues ) / sizeof( ulValues[ 0 ] ); ++uxStep )
+                {
+                    const uint16_t usOldValue = usHeader[ uxWord ];
+
+                    usHeader[ uxChecksumWord ] = 0U;
+
+                    if( ulValues[ uxStep ] == checksumUPDATE_TO_ZERO )
+                    {
+                        /* Complement of the sum of the other words */
+                        usHeader[ uxWord ] = 0U;
+                        usNewValue = ( uint16_t ) ~usChecksumAccumulate( 0U, ( const uint8_t * ) usHeader, sizeof( usHeader ) );
+                    }
+                    else
+                    {
+                        usNewValue = ( uint16_t ) ulValues[ uxStep ];
+                    }
+
+                    usHeader[ uxWord ] = usNewValue;
+                    usChecksum = usChecksumUpdate16( usChecksum, usOldValue, usNewValue );
+                    usFull = ( uint16_t ) ~usChecksumAccumulate( 0U, ( const uint8_t * ) usHeader, sizeof( usHeader ) );
+
+                    if( usChecksum != usFull )
+                    {
+                        return pdFAIL;
+                    }
+
+                    if( ( ulValues[ uxStep ] == checksumUPDATE_TO_ZERO ) && ( usChecksum != 0x0000U ) )
+                    {
+                        return pdFAIL;
+                    }
+
+                    usHeader[ uxChecksumWord ] = usChecksum;
+                }
+            }
+        }
+
+        return pdPASS;
+    }
+
+#endif /* if ( tsnconfigSELF_TEST != tsnconfigDISABLE ) */
@@ -7,6 +7,8 @@
  * them to the appropriate tasks or the IP task.
  */
 
+#include <string.h>
+
 #include "FreeRTOS.h"
 
 #include "FreeRTOS_IP.h"
@@ -18,17 +20,32 @@
 #include "FreeRTOS_TSN_Controller.h"
 #include "FreeRTOS_TSN_NetworkScheduler.h"
 #include "FreeRTOS_TSN_VLANTags.h"
+#include "FreeRTOS_TSN_Parser.h"
 #include "FreeRTOS_TSN_Sockets.h"
+#include "FreeRTOS_TSN_Checksum.h"
+#include "FreeRTOS_TSN_ARP.h"
+#include "FreeRTOS_TSN_FRER.h"
+#include "FreeRTOS_TSN_SharedBuffer.h"
+#include "FreeRTOS_TSN_Timebase.h"
+#include "FreeRTOS_TSN_Timestamp.h"
 #include "NetworkWrapper.h"
 
 #if ( tsnconfigCONTROLLER_HAS_DYNAMIC_PRIO != tsnconfigDISABLE )
-    #define controllerTSN_TASK_BASE_PRIO    ( tskIDLE_PRIORITY + 1 )
+    #define controllerTSN_TASK_BASE_PRIO( pxController )    ( tskIDLE_PRIORITY + 1 )
+#else
+    #define controllerTSN_TASK_BASE_PRIO( pxController )    ( ( pxController )->uxPriority )
+#endif
+
+#if defined( configUSE_CORE_AFFINITY ) && ( configUSE_CORE_AFFINITY == 1 ) && ( configNUMBER_OF_CORES > 1 )
+    #define controllerHAS_CORE_AFFINITY    ( 1 )
 #else
-    #define controllerTSN_TASK_BASE_PRIO    ( tsnconfigTSN_CONTROLLER_PRIORITY )
+    #define controllerHAS_CORE_AFFINITY    ( 0 )
 #endif
 
 
-static TaskHandle_t xTSNControllerHandle = NULL;
+static TSNController_t xTSNControllers[ tsnconfigMAX_CONTROLLERS ];
+
+static BaseType_t xTSNControllersConfigured = pdFALSE;
 
 extern NetworkQueueList_t * pxNetworkQueueList;
 
@@ -38,6 +55,10 @@ extern NetworkQueueList_t * pxNetworkQueueList;
  * This function is responsible for receiving a UDP packet for a TSN socket.
  * It handles error conditions and inserts the packet into the waiting packets list.
  * It also sets the receive event for the socket and updates the select group and user semaphore if applicable.
+ * It runs in the controller or RX stage task, or, for pass-through queues, in
+ * the context of the driver calling xSendEventStructToTSNController(). It
+ * suspends the scheduler and sets event bits, so it must not be called from
+ * an interrupt.
  *
  * @param pxItem Pointer to the NetworkQueueItem_t structure containing the received packet.
  * @param xTSNSocket The TSN socket to receive the packet for.
@@ -50,8 +71,6 @@ void prvReceiveUDPPacketTSN( NetworkQueueItem_t * pxItem,
     FreeRTOS_TSN_Socket_t * const pxTSNSocket = ( FreeRTOS_TSN_Socket_t * ) xTSNSocket;
     FreeRTOS_Socket_t * const pxBaseSocket = ( FreeRTOS_Socket_t * ) xBaseSocket;
 
-    ( void ) pxTSNSocket;
-
     // Check if the message header is not NULL
     configASSERT( pxItem->pxMsgh != NULL );
 
@@ -73,6 +92,19 @@ void prvReceiveUDPPacketTSN( NetworkQueueItem_t * pxItem,
         return;
     }
 
+    if( pxTSNSocket->ucRxInfo != pdFALSE )
+    {
+        AncillaryRxInfo_t * const pxInfo = pxAncillaryMsgGetRxInfo( pxItem->pxMsgh );
+        struct freertos_timespec xNow;
+
+        if( pxInfo->ulValid & ancillaryRX_HAS_SW_TIMESTAMP )
+        {
+            vTimestampAcquireSoftware( &xNow );
+            ( void ) xTimespecDiff( &pxInfo->xQueueingDelay, &xNow, &pxInfo->xSoftwareTimestamp );
+            pxInfo->ulValid |= ancillaryRX_HAS_QUEUEING_DELAY;
+        }
+    }
+
     /* Passing the msghdr in the network buffer. Remember that the msghdr has
      * a reference to the ethernet buffer in the iovec. This must be reverted
      * back before releasing the network buffer!
@@ -115,6 +147,189 @@ void prvReceiveUDPPacketTSN( NetworkQueueItem_t * pxItem,
     #endif
 }
 
+#if ( tsnconfigSHARED_BUFFER_POOL_SIZE > 0 )
+
+/**
+ * @brief Deliver a raw frame to the other raw sockets bound to its EtherType
+ *
+ * Each socket gets a reference to the frame and its own copy of the
+ * ancillary message, the frame itself is not copied. Sockets are skipped
+ * when the references or the messages run out. This must be done before the
+ * frame is delivered to its first socket, which changes the buffer.
+ *
+ * @param[in] pxItem The item of the received frame, with its ancillary message
+ */
+    static void prvFanOutRawFrame( NetworkQueueItem_t * pxItem )
+    {
+        TSNSocket_t xSockets[ tsnconfigSHARED_BUFFER_POOL_SIZE ];
+        NetworkQueueItem_t xCopy;
+        UBaseType_t uxCount;
+
+        if( !tsnsocketIS_RAW_FRAME_TYPE( pxItem->xMeta.usFrameType ) )
+        {
+            return;
+        }
+
+        uxCount = uxSocketRawListReceivers( &pxItem->xMeta, xSockets, tsnconfigSHARED_BUFFER_POOL_SIZE );
+
+        for( UBaseType_t uxIndex = 0; uxIndex < uxCount; ++uxIndex )
+        {
+            FreeRTOS_TSN_Socket_t * const pxSocket = ( FreeRTOS_TSN_Socket_t * ) xSockets[ uxIndex ];
+
+            xCopy.eEventType = pxItem->eEventType;
+            xCopy.xReleaseAfterSend = pxItem->xReleaseAfterSend;
+            xCopy.pxMsgh = pxAncillaryMsgDuplicate( pxItem->pxMsgh );
+
+            if( xCopy.pxMsgh == NULL )
+            {
+                break;
+            }
+
+            xCopy.pxBuf = pxSharedBufferRetain( pxItem->pxBuf );
+
+            if( xCopy.pxBuf == NULL )
+            {
+                vAncillaryMsgFreeAll( xCopy.pxMsgh );
+                break;
+            }
+
+            prvReceiveUDPPacketTSN( &xCopy, pxSocket, pxSocket->xBaseSocket );
+        }
+    }
+
+#endif /* if ( tsnconfigSHARED_BUFFER_POOL_SIZE > 0 ) */
+
+#if ( ipconfigDRIVER_INCLUDED_RX_IP_CHECKSUM == 0 )
+
+/**
+ * @brief Verify the IP header and UDP checksums of a received frame
+ *
+ * @param[in] pxBuf The network buffer, without VLAN tags
+ * @param[in] pxMeta The metadata of the frame
+ * @return pdPASS if the checksums are valid, pdFAIL otherwise
+ */
+    static BaseType_t prvVerifyUDPChecksums( const NetworkBufferDescriptor_t * pxBuf,
+                                             const PacketMetadata_t * pxMeta )
+    {
+        size_t uxUDPLength;
+
+        /* The parser only sets the payload if the UDP header is complete */
+        if( pxMeta->usPayloadOffset == 0U )
+        {
+            return pdFAIL;
+        }
+
+        uxUDPLength = ( size_t ) pxMeta->usPayloadOffset + pxMeta->usPayloadLength - pxMeta->usL4Offset;
+
+        #if ( ipconfigUSE_IPv6 != 0 )
+            if( pxMeta->usFrameType == ipIPv6_FRAME_TYPE )
+            {
+                return xChecksumVerifyIPv6UDP( &pxBuf->pucEthernetBuffer[ pxMeta->usL3Offset ], uxUDPLength );
+            }
+        #endif
+
+        return xChecksumVerifyIPv4UDP( &pxBuf->pucEthernetBuffer[ pxMeta->usL3Offset ],
+                                       ( size_t ) ( pxMeta->usL4Offset - pxMeta->usL3Offset ),
+                                       uxUDPLength );
+    }
+
+#endif /* if ( ipconfigDRIVER_INCLUDED_RX_IP_CHECKSUM == 0 ) */
+
+/**
+ * @brief Release the network buffer of a received frame
+ *
+ * The start of the buffer is restored first, since the wrapper may have
+ * advanced it over the VLAN tags.
+ *
+ * @param[in] pxItem The item holding the frame
+ */
+static void prvReleaseFrame( NetworkQueueItem_t * pxItem )
+{
+    vPacketRestoreStart( pxItem->pxBuf, &pxItem->xMeta, pdFALSE );
+    vReleaseNetworkBufferAndDescriptor( pxItem->pxBuf );
+}
+
+/**
+ * @brief Drop the cached headers of the TSN sockets whose next hop changed
+ *
+ * Called for the ARP and ICMPv6 frames passed to the IP task. The neighbor
+ * and its MAC address are read from ARP packets and from IPv6 neighbor
+ * solicitations and advertisements. Router advertisements may change the
+ * default router, so they drop all the IPv6 templates.
+ *
+ * @param[in] pxBuf The network buffer holding the frame
+ * @param[in] pxMeta The metadata of the frame
+ */
+static void prvInvalidateTemplates( const NetworkBufferDescriptor_t * pxBuf,
+                                    const PacketMetadata_t * pxMeta )
+{
+    const EthernetHeader_t * pxEthernetHeader = ( const EthernetHeader_t * ) pxBuf->pucEthernetBuffer;
+    IP_Address_t xNeighbor;
+
+    if( pxMeta->usFrameType == ipARP_FRAME_TYPE )
+    {
+        const ARPHeader_t * pxARPHeader;
+
+        if( ( size_t ) pxMeta->usL3Offset + sizeof( ARPHeader_t ) > pxBuf->xDataLength )
+        {
+            return;
+        }
+
+        pxARPHeader = ( const ARPHeader_t * ) &pxBuf->pucEthernetBuffer[ pxMeta->usL3Offset ];
+        memset( &xNeighbor, 0, sizeof( xNeighbor ) );
+        memcpy( &xNeighbor.ulIP_IPv4, pxARPHeader->ucSenderProtocolAddress, sizeof( xNeighbor.ulIP_IPv4 ) );
+        vTSNSocketInvalidateTemplates( &xNeighbor, pdFALSE, &pxARPHeader->xSenderHardwareAddress );
+    }
+
+    #if ( ipconfigUSE_IPv6 != 0 )
+        else
+        {
+            const ICMPHeader_IPv6_t * pxICMPHeader;
+            /* Both the neighbor messages carry a target address */
+            const BaseType_t xHasTarget = ( ( size_t ) pxMeta->usL4Offset + sizeof( ICMPHeader_IPv6_t ) <= pxBuf->xDataLength ) ? pdTRUE : pdFALSE;
+
+            if( ( pxMeta->usL4Offset == 0U ) || ( ( size_t ) pxMeta->usL4Offset >= pxBuf->xDataLength ) )
+            {
+                return;
+            }
+
+            pxICMPHeader = ( const ICMPHeader_IPv6_t * ) &pxBuf->pucEthernetBuffer[ pxMeta->usL4Offset ];
+
+            switch( pxICMPHeader->ucTypeOfMessage )
+            {
+                case ipICMP_NEIGHBOR_ADVERTISEMENT_IPv6:
+
+                    if( xHasTarget != pdFALSE )
+                    {
+                        memset( &xNeighbor, 0, sizeof( xNeighbor ) );
+                        memcpy( xNeighbor.xIP_IPv6.ucBytes, pxICMPHeader->xIPv6Address.ucBytes, ipSIZE_OF_IPv6_ADDRESS );
+                        vTSNSocketInvalidateTemplates( &xNeighbor, pdTRUE, &pxEthernetHeader->xSourceAddress );
+                    }
+
+                    break;
+
+                case ipICMP_NEIGHBOR_SOLICITATION_IPv6:
+
+                    if( xHasTarget != pdFALSE )
+                    {
+                        /* Plus TCP learns the MAC address of the sender */
+                        ( void ) xPacketGetSourceAddress( pxBuf, pxMeta, &xNeighbor );
+                        vTSNSocketInvalidateTemplates( &xNeighbor, pdTRUE, &pxEthernetHeader->xSourceAddress );
+                    }
+
+                    break;
+
+                case ipICMP_ROUTER_ADVERTISEMENT_IPv6:
+                    vTSNSocketInvalidateTemplates( NULL, pdTRUE, NULL );
+                    break;
+
+                default:
+                    break;
+            }
+        }
+    #endif /* if ( ipconfigUSE_IPv6 != 0 ) */
+}
+
 /**
  * @brief Function to deliver a network frame to the appropriate socket
  *
@@ -126,8 +341,6 @@ void prvReceiveUDPPacketTSN( NetworkQueueItem_t * pxItem,
 void prvDeliverFrame( NetworkQueueItem_t * pxItem,
                       BaseType_t xUsingIPTask )
 {
-    EthernetHeader_t * pxEthernetHeader;
-    UDPPacket_t * pxUDPPacket;
     BaseType_t xIsWaitingARPResolution;
     NetworkBufferDescriptor_t * const pxBuf = pxItem->pxBuf;
     Socket_t xBaseSocket = NULL;
@@ -150,21 +363,9 @@ void prvDeliverFrame( NetworkQueueItem_t * pxItem,
         return;
     }
 
-    #if ( tsnconfigSOCKET_INSERTS_VLAN_TAGS != tsnconfigDISABLE )
-        ucTagsSize = sizeof( struct xVLAN_TAG ) * ucGetNumberOfTags( pxBuf );
-
-        /* this will remove the vlan tags for reusing the
-         * FreeRTOS plus TCP functions */
-        if( ucTagsSize > 0 )
-        {
-            memmove( &pxBuf->pucEthernetBuffer[ vlantagETH_TAG_OFFSET ],
-                     &pxBuf->pucEthernetBuffer[ vlantagETH_TAG_OFFSET + ucTagsSize ],
-                     pxBuf->xDataLength - vlantagETH_TAG_OFFSET );
-        }
-    #endif
-    pxEthernetHeader = ( EthernetHeader_t * ) pxBuf->pucEthernetBuffer;
+    /* The wrapper already removed the VLAN tags */
 
-    switch( pxEthernetHeader->usFrameType )
+    switch( pxItem->xMeta.usFrameType )
     {
         /* this checks should be moved elsewhere in future, because this path
          * is in common with packets received using the IPTask and therefore
@@ -172,36 +373,78 @@ void prvDeliverFrame( NetworkQueueItem_t * pxItem,
          */
         case ipIPv4_FRAME_TYPE:
 
-            /* check checksum
-             * check destination address is my address
+            /* check destination address is my address
              * check length
              * ... */
             if( pxBuf->xDataLength < sizeof( IPPacket_t ) )
             {
-                vReleaseNetworkBufferAndDescriptor( pxBuf );
+                prvReleaseFrame( pxItem );
                 return;
             }
 
-            pxUDPPacket = ( UDPPacket_t * ) pxBuf->pucEthernetBuffer;
             /*pxBuf->usPort = pxUDPPacket->xUDPHeader.usSourcePort;//already set in the wrapper */
-            pxBuf->xIPAddress.ulIP_IPv4 = pxUDPPacket->xIPHeader.ulSourceIPAddress;
-			ucProto = pxUDPPacket->xIPHeader.ucProtocol;
+            ( void ) xPacketGetSourceAddress( pxBuf, &pxItem->xMeta, &pxBuf->xIPAddress );
+			ucProto = pxItem->xMeta.ucProtocol;
 
             break;
 
-        case ipIPv6_FRAME_TYPE:
-        /* IPv6 support TODO */
+        #if ( ipconfigUSE_IPv6 != 0 )
+            case ipIPv6_FRAME_TYPE:
+
+                if( pxBuf->xDataLength < ipSIZE_OF_ETH_HEADER + ipSIZE_OF_IPv6_HEADER )
+                {
+                    prvReleaseFrame( pxItem );
+                    return;
+                }
+
+                ( void ) xPacketGetSourceAddress( pxBuf, &pxItem->xMeta, &pxBuf->xIPAddress );
+                ucProto = pxItem->xMeta.ucProtocol;
+
+                break;
+        #endif /* if ( ipconfigUSE_IPv6 != 0 ) */
+
         case ipARP_FRAME_TYPE:
         default:
+            /* ARP, or a frame for a raw socket */
             break;
     }
 
-    vSocketFromPort( pxBuf->usBoundPort, &xBaseSocket, &xTSNSocket );
+    /* Usually resolved by the wrapper already */
+    vSocketFromMetadata( &pxItem->xMeta, pxBuf->usBoundPort, &xBaseSocket, &xTSNSocket );
+
+    #if ( ipconfigDRIVER_INCLUDED_RX_IP_CHECKSUM == 0 )
+
+        /* Frames passed to the IP task are verified by Plus TCP */
+        if( ( ucProto == ipPROTOCOL_UDP ) && ( ( xTSNSocket != NULL ) || ( ( xBaseSocket != NULL ) && ( xUsingIPTask == pdFALSE ) ) ) )
+        {
+            if( prvVerifyUDPChecksums( pxBuf, &pxItem->xMeta ) != pdPASS )
+            {
+                if( pxItem->pxMsgh != NULL )
+                {
+                    vAncillaryMsgFreeAll( pxItem->pxMsgh );
+                }
+
+                prvReleaseFrame( pxItem );
+                return;
+            }
+        }
+    #endif
 
     if( xTSNSocket != NULL )
     {
         /* Sending to a TSN socket
          */
+        if( pxItem->pxMsgh == NULL )
+        {
+            /* The wrapper could not allocate the message */
+            prvReleaseFrame( pxItem );
+            return;
+        }
+
+        #if ( tsnconfigSHARED_BUFFER_POOL_SIZE > 0 )
+            prvFanOutRawFrame( pxItem );
+        #endif
+
         prvReceiveUDPPacketTSN( pxItem, xTSNSocket, xBaseSocket );
     }
     else if( xBaseSocket != NULL )
@@ -213,6 +456,9 @@ void prvDeliverFrame( NetworkQueueItem_t * pxItem,
             vAncillaryMsgFreeAll( pxItem->pxMsgh );
         }
 
+        /* Plus TCP expects the frame at the start of the buffer */
+        vPacketRestoreStart( pxBuf, &pxItem->xMeta, pdTRUE );
+
         if( xUsingIPTask == pdTRUE || ucProto != ipPROTOCOL_UDP )
         {
             xEvent.pvData = ( void * ) pxBuf;
@@ -220,21 +466,21 @@ void prvDeliverFrame( NetworkQueueItem_t * pxItem,
 
             if( xSendEventStructToIPTask( &xEvent, tsnconfigCONTROLLER_MAX_EVENT_WAIT ) == pdFAIL )
             {
-                vReleaseNetworkBufferAndDescriptor( pxBuf );
+                prvReleaseFrame( pxItem );
                 return;
             }
         }
         else
         {
             if( xProcessReceivedUDPPacket( pxBuf,
-                                           pxUDPPacket->xUDPHeader.usDestinationPort,
+                                           pxItem->xMeta.usDestinationPort,
                                            &( xIsWaitingARPResolution ) ) == pdPASS )
             {
                 /* xIsWaitingARPResolution is currently unused */
             }
             else
             {
-                vReleaseNetworkBufferAndDescriptor( pxBuf );
+                prvReleaseFrame( pxItem );
                 return;
             }
         }
@@ -247,183 +493,1467 @@ void prvDeliverFrame( NetworkQueueItem_t * pxItem,
         /* currently, no ARP or ICMP support in TSN extension, so pass it to
          * IP task and let +TCP do the work
          */
+        if( pxItem->pxMsgh != NULL )
+        {
+            /* The socket was closed after the wrapper looked it up */
+            vAncillaryMsgFreeAll( pxItem->pxMsgh );
+        }
+
+        if( ( pxItem->xMeta.usFrameType == ipARP_FRAME_TYPE ) ||
+            ( ( pxItem->xMeta.usFrameType == ipIPv6_FRAME_TYPE ) && ( ucProto == ipPROTOCOL_ICMP_IPv6 ) ) )
+        {
+            /* The ARP or neighbor cache may change, rebuild the cached headers */
+            prvInvalidateTemplates( pxBuf, &pxItem->xMeta );
+        }
+
+        vPacketRestoreStart( pxBuf, &pxItem->xMeta, pdTRUE );
+
         xEvent.pvData = ( void * ) pxBuf;
         xEvent.eEventType = eNetworkRxEvent;
 
         if( xSendEventStructToIPTask( &xEvent, tsnconfigCONTROLLER_MAX_EVENT_WAIT ) == pdFAIL )
         {
-            vReleaseNetworkBufferAndDescriptor( pxBuf );
+            prvReleaseFrame( pxItem );
             return;
         }
     }
 }
 
+#if ( tsnconfigINCLUDE_PASSTHROUGH_QUEUES != tsnconfigDISABLE )
+
 /**
- * @brief TSN Controller task function
+ * @brief Deliver a received frame directly to its TSN socket
  *
- * This function is the entry point for the TSN Controller task.
- * It waits for notifications and processes network packets or events
- * based on the notification received.
+ * This is used by the network wrapper for frames assigned to pass-through
+ * queues, and performs the same delivery as the controller would do for a
+ * frame bound to a TSN socket. It runs in the context of the driver task
+ * which received the frame, so the socket is woken up without going through
+ * the controller; drivers calling xSendEventStructToTSNController() from an
+ * interrupt must not use pass-through queues.
  *
- * @param[in] pvParameters Pointer to the task parameters (not used)
+ * @param[in] pxItem The item generated for the received frame
+ * @return pdPASS if the frame is delivered, pdFAIL if the frame is not bound
+ * to a TSN socket, in which case the item is left untouched
  */
-static void prvTSNController( void * pvParameters )
-{
-    NetworkQueueItem_t xItem; // Variable to hold the network queue item
-    NetworkBufferDescriptor_t * pxBuf; // Pointer to the network buffer descriptor
-    NetworkInterface_t * pxInterface; // Pointer to the network interface
-    NetworkQueue_t * pxQueue; // Pointer to the network queue
-    TickType_t uxTimeToSleep; // Time to sleep before processing notifications
-
-    while( pdTRUE )
+    BaseType_t xTSNControllerDeliverToSocket( NetworkQueueItem_t * pxItem )
     {
-        uxTimeToSleep = configMIN( uxNetworkQueueGetTicksUntilWakeup(), pdMS_TO_TICKS( tsnconfigCONTROLLER_MAX_EVENT_WAIT ) );
-        /*configPRINTF( ( "[%lu] Sleeping for %lu ms\r\n", xTaskGetTickCount(), uxTimeToSleep ) ); */
-
-        ulTaskNotifyTake( pdTRUE, uxTimeToSleep ); // Wait for a notification
+        NetworkBufferDescriptor_t * const pxBuf = pxItem->pxBuf;
+        Socket_t xBaseSocket = NULL;
+        TSNSocket_t xTSNSocket = NULL;
 
-        while( pdTRUE )
+        if( ( pxBuf == NULL ) || ( pxItem->pxMsgh == NULL ) )
         {
-            pxQueue = xNetworkQueueSchedule(); // Get the next network queue to process
-
-            if( pxQueue == NULL )
-            {
-                break;
-            }
+            return pdFAIL;
+        }
 
-            if( xNetworkQueuePop( pxQueue, &xItem, 0 ) != pdFAIL ) // Pop an item from the network queue
-            {
-                pxBuf = ( NetworkBufferDescriptor_t * ) xItem.pxBuf;
+        /* The wrapper has already stripped the VLAN tags and the R-TAG, so
+         * tagged frames are delivered here as well, and the L3 offset is
+         * always that of an untagged frame. Non-UDP frames need the full
+         * processing of prvDeliverFrame(), leave them to the controller */
+        if( ( ( pxItem->xMeta.usFrameType != ipIPv4_FRAME_TYPE ) && ( pxItem->xMeta.usFrameType != ipIPv6_FRAME_TYPE ) ) ||
+            ( pxItem->xMeta.ucProtocol != ipPROTOCOL_UDP ) ||
+            ( pxItem->xMeta.usL3Offset != ipSIZE_OF_ETH_HEADER ) )
+        {
+            return pdFAIL;
+        }
 
-                if( xItem.eEventType == eNetworkTxEvent ) // If the event is a transmit event
-                {
-                    pxInterface = pxBuf->pxEndPoint->pxNetworkInterface;
-                    /*FreeRTOS_debug_printf( ( "[%lu]Sending: %32s\n", xTaskGetTickCount(), pxBuf->pucEthernetBuffer ) ); */
-					/* Up to now, pxMsgh will always be NULL because sendmsg() is
-					 * still not implemented. In future, here we should handle
-					 * the ancillary msg before freeing it and passing the
-					 * ethernet buffer to the network wrapper.
-					 */
+        vSocketFromMetadata( &pxItem->xMeta, pxBuf->usBoundPort, &xBaseSocket, &xTSNSocket );
 
-                    if( xItem.pxMsgh != NULL )
-                    {
-                        /* note: this won't free the iov_base buffers, which is
-                         * ok since we need the pxBuf ethernet buffer to be
-                         * passed to the socket
-                         * */
-                        vAncillaryMsgFreeAll( xItem.pxMsgh ); // Free the ancillary message
-                    }
+        if( xTSNSocket == NULL )
+        {
+            return pdFAIL;
+        }
 
-                    pxInterface->pfOutput( pxInterface, pxBuf, xItem.xReleaseAfterSend ); // Output the network buffer
-                }
-                else
-                {
-                    /* Receive or other events */
+        #if ( ipconfigDRIVER_INCLUDED_RX_IP_CHECKSUM == 0 )
+            /* Left to the controller, which drops the frame */
+            if( prvVerifyUDPChecksums( pxBuf, &pxItem->xMeta ) != pdPASS )
+            {
+                return pdFAIL;
+            }
+        #endif
 
-                    /*FreeRTOS_debug_printf( ( "[%lu]Received: %32s\n", xTaskGetTickCount(), pxBuf->pucEthernetBuffer ) ); */
+        ( void ) xPacketGetSourceAddress( pxBuf, &pxItem->xMeta, &pxBuf->xIPAddress );
 
-                    prvDeliverFrame( &xItem, pxQueue->ePolicy == eIPTaskEvents ? pdTRUE : pdFALSE ); // Deliver the network frame
-                }
+        prvReceiveUDPPacketTSN( pxItem, xTSNSocket, xBaseSocket );
 
-                #if ( tsnconfigCONTROLLER_HAS_DYNAMIC_PRIO != tsnconfigDISABLE )
-                    if( xNetworkQueueIsEmpty( pxQueue ) )
-                    {
-                        vTSNControllerComputePriority(); // Compute the priority if the network queue is empty
-                    }
-                #endif
-            }
-        }
+        return pdPASS;
     }
-}
+
+#endif /* if ( tsnconfigINCLUDE_PASSTHROUGH_QUEUES != tsnconfigDISABLE ) */
 
 /**
- * @brief Function to initialize the TSN Controller task
+ * @brief Set the default values of the controller instances
  *
- * This function creates the TSN Controller task and sets its priority.
+ * This is done lazily, since the controllers may be configured by the user
+ * in vNetworkQueueInit() before vTSNController_Initialise() is called.
  */
-void vTSNController_Initialise( void )
+static void prvTSNControllersSetDefaults( void )
 {
-	if ( xTSNControllerHandle == NULL )
-	{
-		xTaskCreate( prvTSNController,
-					 "TSN-controller",
-					 ipconfigIP_TASK_STACK_SIZE_WORDS,
-					 NULL,
-					 controllerTSN_TASK_BASE_PRIO,
-					 &( xTSNControllerHandle ) );
-	}
+    if( xTSNControllersConfigured == pdFALSE )
+    {
+        for( BaseType_t xIndex = 0; xIndex < tsnconfigMAX_CONTROLLERS; ++xIndex )
+        {
+            xTSNControllers[ xIndex ].xTaskHandle = NULL;
+            xTSNControllers[ xIndex ].pxRoot = NULL;
+            xTSNControllers[ xIndex ].uxPriority = tsnconfigTSN_CONTROLLER_PRIORITY;
+            xTSNControllers[ xIndex ].uxCoreAffinityMask = controllerNO_AFFINITY;
+            xTSNControllers[ xIndex ].uxNextWakeup = 0;
+            xTSNControllers[ xIndex ].xNotifyPending = pdFALSE;
+            #if ( tsnconfigCONTROLLER_HAS_EXPRESS_PATH != tsnconfigDISABLE )
+                xTSNControllers[ xIndex ].xTokenHeld = pdFALSE;
+                xTSNControllers[ xIndex ].xTokenWanted = pdFALSE;
+            #endif
+            #if ( tsnconfigCONTROLLER_HAS_DYNAMIC_PRIO != tsnconfigDISABLE )
+                xTSNControllers[ xIndex ].uxCurrentPriority = controllerTSN_TASK_BASE_PRIO( &( xTSNControllers[ xIndex ] ) );
+                xTSNControllers[ xIndex ].xPriorityStale = pdFALSE;
+            #endif
+            #if ( tsnconfigCONTROLLER_SEPARATE_RX_STAGE != tsnconfigDISABLE )
+                xTSNControllers[ xIndex ].xRxStageHandle = NULL;
+                xTSNControllers[ xIndex ].xRxStageQueue = NULL;
+                xTSNControllers[ xIndex ].uxRxStagePriority = tsnconfigCONTROLLER_RX_STAGE_PRIORITY;
+                xTSNControllers[ xIndex ].uxRxStageDrops = 0U;
+            #endif
+            #if ( tsnconfigCONTROLLER_HAS_BUDGET != tsnconfigDISABLE )
+                xTSNControllers[ xIndex ].xBudget[ eControllerBudgetTx ].uxPackets = tsnconfigCONTROLLER_TX_BUDGET_PACKETS;
+                xTSNControllers[ xIndex ].xBudget[ eControllerBudgetTx ].uxBytes = tsnconfigCONTROLLER_TX_BUDGET_BYTES;
+                xTSNControllers[ xIndex ].xBudget[ eControllerBudgetTx ].ulNanoseconds = tsnconfigCONTROLLER_TX_BUDGET_NS;
+                xTSNControllers[ xIndex ].xBudget[ eControllerBudgetRx ].uxPackets = tsnconfigCONTROLLER_RX_BUDGET_PACKETS;
+                xTSNControllers[ xIndex ].xBudget[ eControllerBudgetRx ].uxBytes = tsnconfigCONTROLLER_RX_BUDGET_BYTES;
+                xTSNControllers[ xIndex ].xBudget[ eControllerBudgetRx ].ulNanoseconds = tsnconfigCONTROLLER_RX_BUDGET_NS;
+                memset( xTSNControllers[ xIndex ].xStats, 0, sizeof( xTSNControllers[ xIndex ].xStats ) );
+            #endif
+            #if ( tsnconfigCONTROLLER_BUSY_POLL_NS > 0 )
+                xTSNControllers[ xIndex ].xIsPolling = pdFALSE;
+                xTSNControllers[ xIndex ].xPollSignal = pdFALSE;
+                xTSNControllers[ xIndex ].ulPollWindow = tsnconfigCONTROLLER_BUSY_POLL_NS;
+                xTSNControllers[ xIndex ].ulPollHits = 0;
+                xTSNControllers[ xIndex ].ulPollMisses = 0;
+            #endif
+        }
+
+        xTSNControllersConfigured = pdTRUE;
+    }
 }
 
+#if ( tsnconfigCONTROLLER_SEPARATE_RX_STAGE != tsnconfigDISABLE )
+
+/** @brief An item waiting to be delivered by the RX stage of a controller */
+    struct xRX_STAGE_ITEM
+    {
+        NetworkQueueItem_t xItem; /**< The item popped from the network queues */
+        BaseType_t xUsingIPTask;  /**< Whether the item comes from a eIPTaskEvents queue */
+    };
+
+    typedef struct xRX_STAGE_ITEM RxStageItem_t;
+
 /**
- * @brief Function to notify the TSN Controller task
+ * @brief Pass a received frame to the RX stage of the controller
  *
- * This function notifies the TSN Controller task to wake up and process
- * pending network packets or events.
+ * This is called by the controller instead of prvDeliverFrame(), so that the
+ * scheduling pass only pays for a queue copy. The frame is dropped if the RX
+ * stage cannot keep up, since the controller must never block on it; the
+ * drops are counted, see uxTSNControllerGetRxStageDrops().
  *
- * @return pdTRUE if the notification is sent successfully, pdFALSE otherwise
+ * @param[in] pxController The controller which scheduled the frame
+ * @param[in] pxItem The item popped from the network queues
+ * @param[in] xUsingIPTask pdTRUE if the frame comes from a eIPTaskEvents queue
  */
-BaseType_t xNotifyController()
-{
-    return xTaskNotifyGive( xTSNControllerHandle );
-}
+    static void prvForwardToRxStage( TSNController_t * pxController,
+                                     NetworkQueueItem_t * pxItem,
+                                     BaseType_t xUsingIPTask )
+    {
+        RxStageItem_t xRxItem;
+
+        xRxItem.xItem = *pxItem;
+        xRxItem.xUsingIPTask = xUsingIPTask;
+
+        if( xQueueSendToBack( pxController->xRxStageQueue, &xRxItem, 0 ) != pdPASS )
+        {
+            taskENTER_CRITICAL();
+            {
+                pxController->uxRxStageDrops++;
+            }
+            taskEXIT_CRITICAL();
+
+            if( pxItem->pxMsgh != NULL )
+            {
+                vAncillaryMsgFreeAll( pxItem->pxMsgh );
+            }
+
+            if( pxItem->pxBuf != NULL )
+            {
+                prvReleaseFrame( pxItem );
+            }
+        }
+    }
 
 /**
- * @brief Function to compute the priority of the TSN Controller task
+ * @brief RX stage task function
  *
- * The priority of the TSN controller is the maximum IPV among all the queues
- * which has pending messages.
+ * The RX stage delivers the frames scheduled by its controller to the sockets
+ * or to the IP task. It runs at its own priority, so that the delivery cost
+ * does not delay the transmissions of the controller. After delivering
+ * tsnconfigCONTROLLER_RX_STAGE_BUDGET frames in a row, the task yields to
+ * the other tasks with the same priority.
+ *
+ * @param[in] pvParameters Pointer to the TSNController_t owning this stage
  */
-void vTSNControllerComputePriority( void )
-{
-    NetworkQueueList_t * pxIter = pxNetworkQueueList;
-    UBaseType_t uxPriority = controllerTSN_TASK_BASE_PRIO;
-
-    while( pxIter != NULL )
+    static void prvTSNControllerRxStage( void * pvParameters )
     {
-        if( !xNetworkQueueIsEmpty( pxIter->pxQueue ) )
+        TSNController_t * const pxController = ( TSNController_t * ) pvParameters;
+        RxStageItem_t xRxItem;
+        UBaseType_t uxDelivered = 0;
+
+        while( pdTRUE )
         {
-            if( pxIter->pxQueue->uxIPV > uxPriority )
+            if( xQueueReceive( pxController->xRxStageQueue, &xRxItem, portMAX_DELAY ) != pdPASS )
             {
-                uxPriority = pxIter->pxQueue->uxIPV;
+                continue;
             }
-        }
 
-        pxIter = pxIter->pxNext;
+            prvDeliverFrame( &xRxItem.xItem, xRxItem.xUsingIPTask );
+
+            if( uxQueueMessagesWaiting( pxController->xRxStageQueue ) == 0 )
+            {
+                uxDelivered = 0;
+            }
+
+            #if ( tsnconfigCONTROLLER_RX_STAGE_BUDGET > 0 )
+                else if( ++uxDelivered >= tsnconfigCONTROLLER_RX_STAGE_BUDGET )
+                {
+                    uxDelivered = 0;
+                    taskYIELD();
+                }
+            #endif
+        }
     }
 
-    vTaskPrioritySet( xTSNControllerHandle, uxPriority );
-}
+#endif /* if ( tsnconfigCONTROLLER_SEPARATE_RX_STAGE != tsnconfigDISABLE ) */
+
+#if ( tsnconfigCONTROLLER_HAS_BUDGET != tsnconfigDISABLE )
+
+/** @brief Work done by a controller in a direction since its last wakeup */
+    struct xBUDGET_USAGE
+    {
+        UBaseType_t uxPackets;
+        size_t uxBytes;
+        uint32_t ulNanoseconds;
+    };
 
 /**
- * @brief Function to update the priority of the TSN Controller task
- *
- * This function updates the priority of the TSN Controller task if the
- * new priority is higher than the current priority.
+ * @brief Account the frames handled by the controller against its budget
  *
- * @param[in] uxPriority New priority for the TSN Controller task
- * @return pdTRUE if the priority is updated, pdFALSE otherwise
+ * @param[in] pxController The controller which handled the frames
+ * @param[in] eDirection Direction of the frames
+ * @param[in,out] pxUsage Work done in this direction since the last wakeup
+ * @param[in] uxPackets Number of frames handled
+ * @param[in] uxBytes Total length of the frames
+ * @param[in] pxStart Time at which the controller started handling the frames.
+ * Only used if the direction has a time budget.
+ * @return pdTRUE if the budget is exhausted, pdFALSE otherwise
+ */
+    static BaseType_t prvBudgetConsume( TSNController_t * pxController,
+                                        eControllerBudgetDirection_t eDirection,
+                                        struct xBUDGET_USAGE * pxUsage,
+                                        UBaseType_t uxPackets,
+                                        size_t uxBytes,
+                                        struct freertos_timespec * pxStart )
+    {
+        const TSNControllerBudget_t * pxBudget = &( pxController->xBudget[ eDirection ] );
+        TSNControllerBudgetStats_t * pxStats = &( pxController->xStats[ eDirection ] );
+        struct freertos_timespec xNow, xElapsed;
+
+        pxUsage->uxPackets += uxPackets;
+        pxUsage->uxBytes += uxBytes;
+
+        if( pxBudget->ulNanoseconds != 0 )
+        {
+            vTimebaseGetTime( &xNow );
+            xTimespecDiff( &xElapsed, &xNow, pxStart );
+            pxUsage->ulNanoseconds += ( xElapsed.tv_sec != 0 ) ? pxBudget->ulNanoseconds : xElapsed.tv_nsec;
+
+            if( pxUsage->ulNanoseconds >= pxBudget->ulNanoseconds )
+            {
+                pxStats->ulTimeExhausted++;
+                return pdTRUE;
+            }
+        }
+
+        if( ( pxBudget->uxPackets != 0 ) && ( pxUsage->uxPackets >= pxBudget->uxPackets ) )
+        {
+            pxStats->ulPacketsExhausted++;
+            return pdTRUE;
+        }
+
+        if( ( pxBudget->uxBytes != 0 ) && ( pxUsage->uxBytes >= pxBudget->uxBytes ) )
+        {
+            pxStats->ulBytesExhausted++;
+            return pdTRUE;
+        }
+
+        return pdFALSE;
+    }
+
+/**
+ * @brief Let the scheduler choose again the queues skipped during a pass
+ *
+ * @param[in] pxController The controller which deferred the queues
+ */
+    static void prvClearDeferred( TSNController_t * pxController )
+    {
+        NetworkQueueList_t * pxIter = pxNetworkQueueList;
+
+        while( pxIter != NULL )
+        {
+            if( pxIter->pxQueue->pxController == pxController )
+            {
+                pxIter->pxQueue->xDeferred = pdFALSE;
+            }
+
+            pxIter = pxIter->pxNext;
+        }
+    }
+
+#endif /* if ( tsnconfigCONTROLLER_HAS_BUDGET != tsnconfigDISABLE ) */
+
+#if ( tsnconfigCONTROLLER_TX_BATCH_SIZE > 1 )
+
+/**
+ * @brief Send a batch of packets from an unshaped queue
+ *
+ * Only used for queues marked as batchable when their tree is assigned to the
+ * controller, see xNetworkQueueAssignRootToController().
+ * After the scheduler chose pxQueue, the following packets of the same queue
+ * are popped as long as they are transmissions on the same interface with the
+ * same release flag, up to tsnconfigCONTROLLER_TX_BATCH_SIZE packets. The
+ * batch is then passed to the network wrapper with a single call.
+ *
+ * @param[in] pxQueue The queue chosen by the scheduler
+ * @param[in] pxFirst The item already popped from pxQueue
+ * @param[out] puxBytes Total length of the sent packets, can be NULL
+ * @return The number of packets popped from pxQueue
+ */
+    static UBaseType_t prvTransmitBatch( NetworkQueue_t * pxQueue,
+                                         NetworkQueueItem_t * pxFirst,
+                                         size_t * puxBytes )
+    {
+        NetworkQueueItem_t xItems[ tsnconfigCONTROLLER_TX_BATCH_SIZE ];
+        NetworkQueueItem_t xNext;
+        NetworkInterface_t * const pxInterface = pxFirst->pxBuf->pxEndPoint->pxNetworkInterface;
+        size_t uxBytes = pxFirst->pxBuf->xDataLength;
+        UBaseType_t uxCount = 1;
+
+        xItems[ 0 ] = *pxFirst;
+
+        while( uxCount < tsnconfigCONTROLLER_TX_BATCH_SIZE )
+        {
+            /* Only the controller pops from its queues, so the peeked item
+             * is the one popped below */
+            if( xQueuePeek( pxQueue->xQueue, &xNext, 0 ) != pdPASS )
+            {
+                break;
+            }
+
+            if( ( xNext.eEventType != eNetworkTxEvent ) ||
+                ( xNext.xReleaseAfterSend != pxFirst->xReleaseAfterSend ) ||
+                ( xNext.pxBuf->pxEndPoint->pxNetworkInterface != pxInterface ) )
+            {
+                break;
+            }
+
+            if( xNetworkQueuePop( pxQueue, &xItems[ uxCount ], 0 ) != pdPASS )
+            {
+                break;
+            }
+
+            uxBytes += xItems[ uxCount ].pxBuf->xDataLength;
+            ++uxCount;
+        }
+
+        for( UBaseType_t uxIndex = 0; uxIndex < uxCount; ++uxIndex )
+        {
+            if( xItems[ uxIndex ].pxMsgh != NULL )
+            {
+                vAncillaryMsgFreeAll( xItems[ uxIndex ].pxMsgh );
+            }
+        }
+
+        ( void ) xTSN_NetworkInterfaceOutputBatch( pxInterface, xItems, uxCount );
+
+        if( puxBytes != NULL )
+        {
+            *puxBytes = uxBytes;
+        }
+
+        return uxCount;
+    }
+
+#endif /* if ( tsnconfigCONTROLLER_TX_BATCH_SIZE > 1 ) */
+
+#if ( tsnconfigCONTROLLER_BUSY_POLL_NS > 0 )
+
+/**
+ * @brief Spin on the queues of the controller waiting for new packets
+ *
+ * Called after the pass ended, so that the express path can be used while
+ * the controller spins. While polling, xNetworkQueuePush() does not notify
+ * the controller, but raises its xPollSignal flag instead, so the spin reads
+ * a single variable whatever the number of queues. After the polling flag is
+ * cleared the signal is checked once more, since a producer may have raised
+ * it instead of notifying just before the flag was cleared.
+ * The window adapts to the traffic: it is halved after every miss, down to
+ * an eighth of tsnconfigCONTROLLER_BUSY_POLL_NS, and restored after a hit.
+ * Polling is skipped if the timebase is not running.
+ *
+ * @param[in] pxController The calling controller
+ * @return pdTRUE if new packets arrived, pdFALSE if the window expired
+ */
+    static BaseType_t prvBusyPoll( TSNController_t * pxController )
+    {
+        struct freertos_timespec xStart, xNow, xElapsed;
+        BaseType_t xHit = pdFALSE;
+
+        if( xTimebaseGetState() != eTimebaseEnabled )
+        {
+            return pdFALSE;
+        }
+
+        pxController->xPollSignal = pdFALSE;
+        pxController->xIsPolling = pdTRUE;
+        portMEMORY_BARRIER();
+
+        vTimebaseGetTime( &xStart );
+
+        do
+        {
+            if( pxController->xPollSignal != pdFALSE )
+            {
+                xHit = pdTRUE;
+                break;
+            }
+
+            vTimebaseGetTime( &xNow );
+            xTimespecDiff( &xElapsed, &xNow, &xStart );
+        } while( ( xElapsed.tv_sec == 0 ) && ( xElapsed.tv_nsec < pxController->ulPollWindow ) );
+
+        pxController->xIsPolling = pdFALSE;
+        portMEMORY_BARRIER();
+
+        if( ( xHit == pdFALSE ) && ( pxController->xPollSignal != pdFALSE ) )
+        {
+            xHit = pdTRUE;
+        }
+
+        if( xHit != pdFALSE )
+        {
+            pxController->ulPollHits++;
+            pxController->ulPollWindow = tsnconfigCONTROLLER_BUSY_POLL_NS;
+        }
+        else
+        {
+            pxController->ulPollMisses++;
+
+            if( pxController->ulPollWindow > ( tsnconfigCONTROLLER_BUSY_POLL_NS / 8U ) )
+            {
+                pxController->ulPollWindow /= 2U;
+            }
+        }
+
+        return xHit;
+    }
+
+#endif /* if ( tsnconfigCONTROLLER_BUSY_POLL_NS > 0 ) */
+
+static BaseType_t prvStartPass( TSNController_t * pxController );
+
+static void prvEndPass( TSNController_t * pxController );
+
+/**
+ * @brief TSN Controller task function
+ *
+ * This function is the entry point for the TSN Controller tasks.
+ * It waits for notifications and processes network packets or events
+ * based on the notification received.
+ * If tsnconfigCONTROLLER_HAS_BUDGET is enabled, the budgets of the two
+ * directions are tracked separately. Once a direction is exhausted, the
+ * queues whose next frame goes in that direction are deferred for the rest
+ * of the pass, while the other direction is still served. After the pass,
+ * the controller notifies itself and sleeps for
+ * tsnconfigCONTROLLER_BUDGET_BACKOFF_TICKS, so that the remaining frames are
+ * handled right after the other tasks had a chance to run.
+ * If tsnconfigCONTROLLER_BUSY_POLL_NS is not 0, the controller polls its
+ * queues for a short time before blocking, see prvBusyPoll().
+ *
+ * @param[in] pvParameters Pointer to the TSNController_t served by this task
+ */
+static void prvTSNController( void * pvParameters )
+{
+    TSNController_t * const pxController = ( TSNController_t * ) pvParameters;
+    NetworkQueueItem_t xItem; // Variable to hold the network queue item
+    NetworkBufferDescriptor_t * pxBuf; // Pointer to the network buffer descriptor
+    NetworkInterface_t * pxInterface; // Pointer to the network interface
+    NetworkQueue_t * pxQueue; // Pointer to the network queue
+    TickType_t uxTimeToSleep; // Time to sleep before processing notifications
+    TickType_t uxARPWait; // Time until the next check of the frames waiting for ARP
+    BaseType_t xPollHit = pdFALSE; // Whether new packets were found while polling
+    BaseType_t xBatch = pdFALSE; // Whether the popped packet starts a batch
+
+    #if ( tsnconfigCONTROLLER_HAS_BUDGET != tsnconfigDISABLE )
+        struct xBUDGET_USAGE xUsage[ eControllerBudgetDirections ];
+        struct freertos_timespec xStart;
+        eControllerBudgetDirection_t eDirection;
+        UBaseType_t uxPackets;
+        size_t uxBytes;
+        BaseType_t xExhausted[ eControllerBudgetDirections ];
+        BaseType_t xAnyExhausted;
+        BaseType_t xAnyDeferred;
+    #endif
+
+    while( pdTRUE )
+    {
+        // Release the frames whose destination got resolved, if no other controller did
+        uxARPWait = uxTSNARPPoll();
+
+        if( xPollHit == pdFALSE )
+        {
+            uxTimeToSleep = configMIN( uxNetworkQueueGetTicksUntilWakeup(), pdMS_TO_TICKS( tsnconfigCONTROLLER_MAX_EVENT_WAIT ) );
+            uxTimeToSleep = configMIN( uxTimeToSleep, uxARPWait );
+            /*configPRINTF( ( "[%lu] Sleeping for %lu ms\r\n", xTaskGetTickCount(), uxTimeToSleep ) ); */
+
+            ulTaskNotifyTake( pdTRUE, uxTimeToSleep ); // Wait for a notification
+        }
+
+        if( prvStartPass( pxController ) == pdFALSE )
+        {
+            /* A task is sending on the express path */
+            xPollHit = pdFALSE;
+            continue;
+        }
+
+        #if ( tsnconfigCONTROLLER_HAS_BUDGET != tsnconfigDISABLE )
+            memset( xUsage, 0, sizeof( xUsage ) );
+            memset( &xStart, 0, sizeof( xStart ) );
+            xExhausted[ eControllerBudgetTx ] = pdFALSE;
+            xExhausted[ eControllerBudgetRx ] = pdFALSE;
+            xAnyExhausted = pdFALSE;
+            xAnyDeferred = pdFALSE;
+        #endif
+
+        while( pdTRUE )
+        {
+            pxQueue = xNetworkQueueSchedule( pxController->pxRoot ); // Get the next network queue to process
+
+            if( pxQueue == NULL )
+            {
+                break;
+            }
+
+            #if ( tsnconfigCONTROLLER_HAS_BUDGET != tsnconfigDISABLE )
+                if( xAnyExhausted != pdFALSE )
+                {
+                    /* Skip the queue for the rest of the pass if its next
+                     * frame goes in the exhausted direction */
+                    if( ( xQueuePeek( pxQueue->xQueue, &xItem, 0 ) == pdTRUE ) &&
+                        ( xExhausted[ ( xItem.eEventType == eNetworkTxEvent ) ? eControllerBudgetTx : eControllerBudgetRx ] != pdFALSE ) )
+                    {
+                        pxQueue->xDeferred = pdTRUE;
+                        xAnyDeferred = pdTRUE;
+                        continue;
+                    }
+                }
+
+                if( pxController->xBudget[ eControllerBudgetTx ].ulNanoseconds != 0 ||
+                    pxController->xBudget[ eControllerBudgetRx ].ulNanoseconds != 0 )
+                {
+                    vTimebaseGetTime( &xStart );
+                }
+            #endif
+
+            if( xNetworkQueuePop( pxQueue, &xItem, 0 ) != pdFAIL ) // Pop an item from the network queue
+            {
+                pxBuf = ( NetworkBufferDescriptor_t * ) xItem.pxBuf;
+
+                #if ( tsnconfigCONTROLLER_HAS_BUDGET != tsnconfigDISABLE )
+                    eDirection = ( xItem.eEventType == eNetworkTxEvent ) ? eControllerBudgetTx : eControllerBudgetRx;
+                    uxPackets = 1;
+                    uxBytes = ( pxBuf != NULL ) ? pxBuf->xDataLength : 0U;
+                #endif
+
+                #if ( tsnconfigCONTROLLER_TX_BATCH_SIZE > 1 )
+                    xBatch = ( ( xItem.eEventType == eNetworkTxEvent ) && ( pxQueue->xBatchable != pdFALSE ) ) ? pdTRUE : pdFALSE;
+                #endif
+
+                if( xBatch != pdFALSE )
+                {
+                    #if ( tsnconfigCONTROLLER_TX_BATCH_SIZE > 1 )
+                        #if ( tsnconfigCONTROLLER_HAS_BUDGET != tsnconfigDISABLE )
+                            uxPackets = prvTransmitBatch( pxQueue, &xItem, &uxBytes );
+                        #else
+                            ( void ) prvTransmitBatch( pxQueue, &xItem, NULL );
+                        #endif
+                    #endif
+                }
+                else if( xItem.eEventType == eNetworkTxEvent ) // If the event is a transmit event
+                {
+                    pxInterface = pxBuf->pxEndPoint->pxNetworkInterface;
+                    /*FreeRTOS_debug_printf( ( "[%lu]Sending: %32s\n", xTaskGetTickCount(), pxBuf->pucEthernetBuffer ) ); */
+
+                    /* The send calls, FreeRTOS_TSN_sendmsg() included, build
+                     * the whole frame in pxBuf and queue it without an
+                     * ancillary message, see prvPrepareNetworkItem(). Free
+                     * one if a producer attached it anyway, which does not
+                     * free the iov_base buffers, as pxBuf holds the frame. */
+                    if( xItem.pxMsgh != NULL )
+                    {
+                        FreeRTOS_debug_printf( ( "TSN controller: dropping the ancillary message of a transmit item\n" ) );
+                        vAncillaryMsgFreeAll( xItem.pxMsgh ); // Free the ancillary message
+                        xItem.pxMsgh = NULL;
+                    }
+
+                    pxInterface->pfOutput( pxInterface, pxBuf, xItem.xReleaseAfterSend ); // Output the network buffer
+                }
+                else
+                {
+                    /* Receive or other events */
+
+                    /*FreeRTOS_debug_printf( ( "[%lu]Received: %32s\n", xTaskGetTickCount(), pxBuf->pucEthernetBuffer ) ); */
+
+                    #if ( tsnconfigCONTROLLER_SEPARATE_RX_STAGE != tsnconfigDISABLE )
+                        prvForwardToRxStage( pxController, &xItem, pxQueue->ePolicy == eIPTaskEvents ? pdTRUE : pdFALSE ); // Let the RX stage deliver the frame
+                    #else
+                        prvDeliverFrame( &xItem, pxQueue->ePolicy == eIPTaskEvents ? pdTRUE : pdFALSE ); // Deliver the network frame
+                    #endif
+                }
+
+                #if ( tsnconfigCONTROLLER_HAS_DYNAMIC_PRIO != tsnconfigDISABLE )
+                    if( xNetworkQueueIsEmpty( pxQueue ) )
+                    {
+                        vTSNControllerComputePriority( pxController ); // Compute the priority if the network queue is empty
+                    }
+                #endif
+
+                #if ( tsnconfigCONTROLLER_HAS_BUDGET != tsnconfigDISABLE )
+                    if( prvBudgetConsume( pxController, eDirection, &( xUsage[ eDirection ] ), uxPackets, uxBytes, &xStart ) != pdFALSE )
+                    {
+                        xExhausted[ eDirection ] = pdTRUE;
+                        xAnyExhausted = pdTRUE;
+                    }
+                #endif
+            }
+
+            #if ( tsnconfigCONTROLLER_HAS_BUDGET != tsnconfigDISABLE )
+                if( ( xExhausted[ eControllerBudgetTx ] != pdFALSE ) && ( xExhausted[ eControllerBudgetRx ] != pdFALSE ) )
+                {
+                    break;
+                }
+            #endif
+        }
+
+        #if ( tsnconfigCONTROLLER_HAS_BUDGET != tsnconfigDISABLE )
+            if( xAnyDeferred != pdFALSE )
+            {
+                prvClearDeferred( pxController );
+            }
+        #endif
+
+        // Release the express path before spinning
+        prvEndPass( pxController );
+
+        #if ( tsnconfigCONTROLLER_BUSY_POLL_NS > 0 )
+            #if ( tsnconfigCONTROLLER_HAS_BUDGET != tsnconfigDISABLE )
+                xPollHit = ( xAnyExhausted == pdFALSE ) ? prvBusyPoll( pxController ) : pdFALSE;
+            #else
+                xPollHit = prvBusyPoll( pxController );
+            #endif
+        #endif
+
+        #if ( tsnconfigCONTROLLER_HAS_BUDGET != tsnconfigDISABLE )
+            if( xAnyExhausted != pdFALSE )
+            {
+                /* Re-arm the notification so that the next
+                 * ulTaskNotifyTake() returns immediately, and sleep so that
+                 * also the lower priority tasks can run */
+                xTaskNotifyGive( pxController->xTaskHandle );
+                vTaskDelay( tsnconfigCONTROLLER_BUDGET_BACKOFF_TICKS );
+            }
+        #endif
+    }
+}
+
+/**
+ * @brief Configure a TSN controller instance
+ *
+ * This should be called in vNetworkQueueInit(), before the controllers are
+ * started. The affinity mask is only used on SMP ports with core affinity
+ * enabled, and is ignored otherwise.
+ *
+ * @param[in] xIndex Index of the controller, from 0 to tsnconfigMAX_CONTROLLERS - 1
+ * @param[in] uxPriority Priority of the controller task. Ignored if
+ * tsnconfigCONTROLLER_HAS_DYNAMIC_PRIO is enabled: every controller then
+ * starts at the priority of the idle task plus 1 and follows the IPV of its
+ * waiting queues, which are what decides its priority
+ * @param[in] uxCoreAffinityMask Mask of the cores on which the controller can
+ * run, or controllerNO_AFFINITY
+ * @return pdPASS if the controller is configured, pdFAIL otherwise
+ */
+BaseType_t xTSNControllerConfigure( BaseType_t xIndex,
+                                    UBaseType_t uxPriority,
+                                    UBaseType_t uxCoreAffinityMask )
+{
+    prvTSNControllersSetDefaults();
+
+    if( ( xIndex < 0 ) || ( xIndex >= tsnconfigMAX_CONTROLLERS ) )
+    {
+        return pdFAIL;
+    }
+
+    if( ( uxPriority >= configMAX_PRIORITIES ) || ( xTSNControllers[ xIndex ].xTaskHandle != NULL ) )
+    {
+        return pdFAIL;
+    }
+
+    xTSNControllers[ xIndex ].uxPriority = uxPriority;
+    xTSNControllers[ xIndex ].uxCoreAffinityMask = uxCoreAffinityMask;
+
+    return pdPASS;
+}
+
+#if ( tsnconfigCONTROLLER_SEPARATE_RX_STAGE != tsnconfigDISABLE )
+
+/**
+ * @brief Configure the RX stage of a TSN controller instance
+ *
+ * This should be called in vNetworkQueueInit(), before the controllers are
+ * started. The RX stage inherits the core affinity of its controller.
+ *
+ * @param[in] xIndex Index of the controller
+ * @param[in] uxPriority Priority of the RX stage task
+ * @return pdPASS if the RX stage is configured, pdFAIL otherwise
+ */
+    BaseType_t xTSNControllerConfigureRxStage( BaseType_t xIndex,
+                                               UBaseType_t uxPriority )
+    {
+        prvTSNControllersSetDefaults();
+
+        if( ( xIndex < 0 ) || ( xIndex >= tsnconfigMAX_CONTROLLERS ) )
+        {
+            return pdFAIL;
+        }
+
+        if( ( uxPriority >= configMAX_PRIORITIES ) || ( xTSNControllers[ xIndex ].xRxStageHandle != NULL ) )
+        {
+            return pdFAIL;
+        }
+
+        xTSNControllers[ xIndex ].uxRxStagePriority = uxPriority;
+
+        return pdPASS;
+    }
+
+/**
+ * @brief Read the number of received frames dropped before the RX stage
+ *
+ * A frame is dropped when the controller schedules it while the queue of
+ * its RX stage is full, see tsnconfigCONTROLLER_RX_STAGE_QUEUE_LENGTH.
+ *
+ * @param[in] xIndex Index of the controller
+ * @return The number of dropped frames, 0 if the index is invalid
+ */
+    UBaseType_t uxTSNControllerGetRxStageDrops( BaseType_t xIndex )
+    {
+        UBaseType_t uxDrops;
+
+        prvTSNControllersSetDefaults();
+
+        if( ( xIndex < 0 ) || ( xIndex >= tsnconfigMAX_CONTROLLERS ) )
+        {
+            return 0U;
+        }
+
+        taskENTER_CRITICAL();
+        {
+            uxDrops = xTSNControllers[ xIndex ].uxRxStageDrops;
+        }
+        taskEXIT_CRITICAL();
+
+        return uxDrops;
+    }
+
+#endif /* if ( tsnconfigCONTROLLER_SEPARATE_RX_STAGE != tsnconfigDISABLE ) */
+
+#if ( tsnconfigCONTROLLER_HAS_BUDGET != tsnconfigDISABLE )
+
+/**
+ * @brief Set the per-wakeup budget of a controller for a direction
+ *
+ * This can be called at any time. The new budget is used starting from the
+ * next frame handled by the controller.
+ *
+ * @param[in] xIndex Index of the controller
+ * @param[in] eDirection Direction the budget applies to
+ * @param[in] pxBudget The new budget. Fields set to 0 mean no limit.
+ * @return pdPASS if the budget is set, pdFAIL otherwise
+ */
+    BaseType_t xTSNControllerSetBudget( BaseType_t xIndex,
+                                        eControllerBudgetDirection_t eDirection,
+                                        const TSNControllerBudget_t * pxBudget )
+    {
+        prvTSNControllersSetDefaults();
+
+        if( ( xIndex < 0 ) || ( xIndex >= tsnconfigMAX_CONTROLLERS ) ||
+            ( eDirection >= eControllerBudgetDirections ) || ( pxBudget == NULL ) )
+        {
+            return pdFAIL;
+        }
+
+        taskENTER_CRITICAL();
+        {
+            xTSNControllers[ xIndex ].xBudget[ eDirection ] = *pxBudget;
+        }
+        taskEXIT_CRITICAL();
+
+        return pdPASS;
+    }
+
+/**
+ * @brief Read the budget exhaustion counters of a controller
+ *
+ * @param[in] xIndex Index of the controller
+ * @param[in] eDirection Direction of the counters
+ * @param[out] pxStats Where the counters are copied
+ * @return pdPASS if the counters are copied, pdFAIL otherwise
+ */
+    BaseType_t xTSNControllerGetBudgetStats( BaseType_t xIndex,
+                                             eControllerBudgetDirection_t eDirection,
+                                             TSNControllerBudgetStats_t * pxStats )
+    {
+        prvTSNControllersSetDefaults();
+
+        if( ( xIndex < 0 ) || ( xIndex >= tsnconfigMAX_CONTROLLERS ) ||
+            ( eDirection >= eControllerBudgetDirections ) || ( pxStats == NULL ) )
+        {
+            return pdFAIL;
+        }
+
+        taskENTER_CRITICAL();
+        {
+            *pxStats = xTSNControllers[ xIndex ].xStats[ eDirection ];
+        }
+        taskEXIT_CRITICAL();
+
+        return pdPASS;
+    }
+
+#endif /* if ( tsnconfigCONTROLLER_HAS_BUDGET != tsnconfigDISABLE ) */
+
+#if ( tsnconfigCONTROLLER_BUSY_POLL_NS > 0 )
+
+/**
+ * @brief Read the busy-poll counters of a controller
+ *
+ * @param[in] xIndex Index of the controller
+ * @param[out] pulHits Times new packets were found while polling
+ * @param[out] pulMisses Times the poll window expired and the controller blocked
+ * @return pdPASS if the counters are copied, pdFAIL otherwise
+ */
+    BaseType_t xTSNControllerGetPollStats( BaseType_t xIndex,
+                                           uint32_t * pulHits,
+                                           uint32_t * pulMisses )
+    {
+        prvTSNControllersSetDefaults();
+
+        if( ( xIndex < 0 ) || ( xIndex >= tsnconfigMAX_CONTROLLERS ) ||
+            ( pulHits == NULL ) || ( pulMisses == NULL ) )
+        {
+            return pdFAIL;
+        }
+
+        taskENTER_CRITICAL();
+        {
+            *pulHits = xTSNControllers[ xIndex ].ulPollHits;
+            *pulMisses = xTSNControllers[ xIndex ].ulPollMisses;
+        }
+        taskEXIT_CRITICAL();
+
+        return pdPASS;
+    }
+
+#endif /* if ( tsnconfigCONTROLLER_BUSY_POLL_NS > 0 ) */
+
+/**
+ * @brief Assign the root of the network scheduler served by a controller
+ *
+ * @param[in] xIndex Index of the controller
+ * @param[in] pxRoot The root node of the network scheduler
+ * @return pdPASS if the root is assigned, pdFAIL if the index is invalid or
+ * the controller already has a root
+ */
+BaseType_t xTSNControllerSetRoot( BaseType_t xIndex,
+                                  struct xNETQUEUE_NODE * pxRoot )
+{
+    prvTSNControllersSetDefaults();
+
+    if( ( xIndex < 0 ) || ( xIndex >= tsnconfigMAX_CONTROLLERS ) )
+    {
+        return pdFAIL;
+    }
+
+    if( xTSNControllers[ xIndex ].pxRoot != NULL )
+    {
+        return pdFAIL;
+    }
+
+    xTSNControllers[ xIndex ].pxRoot = pxRoot;
+
+    return pdPASS;
+}
+
+/**
+ * @brief Get a controller instance from its index
+ *
+ * @param[in] xIndex Index of the controller
+ * @return A pointer to the controller, or NULL if the index is invalid
+ */
+TSNController_t * pxTSNControllerGet( BaseType_t xIndex )
+{
+    prvTSNControllersSetDefaults();
+
+    if( ( xIndex < 0 ) || ( xIndex >= tsnconfigMAX_CONTROLLERS ) )
+    {
+        return NULL;
+    }
+
+    return &( xTSNControllers[ xIndex ] );
+}
+
+/**
+ * @brief Get the controller instance running the calling task
+ *
+ * @return A pointer to the controller, or NULL if the caller is not a
+ * TSN controller
+ */
+TSNController_t * pxTSNControllerGetCurrent( void )
+{
+    TaskHandle_t xCurrentTask = xTaskGetCurrentTaskHandle();
+
+    for( BaseType_t xIndex = 0; xIndex < tsnconfigMAX_CONTROLLERS; ++xIndex )
+    {
+        if( ( xTSNControllers[ xIndex ].xTaskHandle != NULL ) && ( xTSNControllers[ xIndex ].xTaskHandle == xCurrentTask ) )
+        {
+            return &( xTSNControllers[ xIndex ] );
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Build the name of a task of a controller
+ *
+ * The index is written in decimal after the prefix by hand, so that the
+ * formatted output of the C library is not linked in only for task names.
+ * The name is truncated to configMAX_TASK_NAME_LEN, as xTaskCreate() does.
+ *
+ * @param[out] pcName Buffer of configMAX_TASK_NAME_LEN characters
+ * @param[in] pcPrefix Fixed part of the name
+ * @param[in] xIndex Index of the controller
+ */
+static void prvTaskName( char * pcName,
+                         const char * pcPrefix,
+                         BaseType_t xIndex )
+{
+    char cDigits[ 10 ];
+    size_t uxDigits = 0U;
+    size_t uxLength = 0U;
+
+    while( ( pcPrefix[ uxLength ] != '\0' ) && ( uxLength < ( size_t ) ( configMAX_TASK_NAME_LEN - 1 ) ) )
+    {
+        pcName[ uxLength ] = pcPrefix[ uxLength ];
+        uxLength++;
+    }
+
+    do
+    {
+        cDigits[ uxDigits++ ] = ( char ) ( '0' + ( xIndex % 10 ) );
+        xIndex /= 10;
+    } while( xIndex > 0 );
+
+    while( ( uxDigits > 0U ) && ( uxLength < ( size_t ) ( configMAX_TASK_NAME_LEN - 1 ) ) )
+    {
+        pcName[ uxLength++ ] = cDigits[ --uxDigits ];
+    }
+
+    pcName[ uxLength ] = '\0';
+}
+
+/**
+ * @brief Function to initialize the TSN Controller tasks
+ *
+ * This function creates a task for every controller with an assigned root and
+ * sets its priority and core affinity. The first controller is always
+ * created, as it is the one used by the default configuration. If the RX
+ * stage is enabled, a second task is created for each controller to deliver
+ * the received frames.
+ */
+void vTSNController_Initialise( void )
+{
+    TSNController_t * pxController;
+    char pcName[ configMAX_TASK_NAME_LEN ];
+
+    #if ( tsnconfigCHECKSUM_SELF_TEST != tsnconfigDISABLE )
+    {
+        /* Not inside configASSERT(), which may be defined empty */
+        const BaseType_t xSelfTest = xChecksumSelfTest();
+
+        if( xSelfTest != pdPASS )
+        {
+            FreeRTOS_printf( ( "TSN: the checksum kernel differs from the reference one\n" ) );
+        }
+
+        configASSERT( xSelfTest == pdPASS );
+    }
+    #endif
+
+    #if ( tsnconfigSELF_TEST != tsnconfigDISABLE )
+    {
+        BaseType_t xSelfTest = pdPASS;
+
+        if( xPacketSelfTest() != pdPASS )
+        {
+            FreeRTOS_printf( ( "TSN: the parser self test failed\n" ) );
+            xSelfTest = pdFAIL;
+        }
+
+        if( xChecksumUpdateSelfTest() != pdPASS )
+        {
+            FreeRTOS_printf( ( "TSN: the incremental checksum update differs from a full computation\n" ) );
+            xSelfTest = pdFAIL;
+        }
+
+        #if ( tsnconfigSOCKET_HASH_SIZE > 0 )
+            if( xSocketHashSelfTest() != pdPASS )
+            {
+                FreeRTOS_printf( ( "TSN: the socket hash table self test failed\n" ) );
+                xSelfTest = pdFAIL;
+            }
+        #endif
+
+        #if ( tsnconfigFRER_STREAMS > 0 )
+            if( xFRERSelfTest() != pdPASS )
+            {
+                FreeRTOS_printf( ( "TSN: the FRER recovery window self test failed\n" ) );
+                xSelfTest = pdFAIL;
+            }
+        #endif
+
+        configASSERT( xSelfTest == pdPASS );
+        ( void ) xSelfTest;
+    }
+    #endif
+
+    prvTSNControllersSetDefaults();
+
+    for( BaseType_t xIndex = 0; xIndex < tsnconfigMAX_CONTROLLERS; ++xIndex )
+    {
+        pxController = &( xTSNControllers[ xIndex ] );
+
+        if( ( pxController->xTaskHandle != NULL ) || ( ( xIndex != 0 ) && ( pxController->pxRoot == NULL ) ) )
+        {
+            continue;
+        }
+
+        if( xIndex != 0 )
+        {
+            prvTaskName( pcName, "TSN-ctrl", xIndex );
+        }
+
+        xTaskCreate( prvTSNController,
+                     ( xIndex == 0 ) ? "TSN-controller" : pcName,
+                     ipconfigIP_TASK_STACK_SIZE_WORDS,
+                     ( void * ) pxController,
+                     controllerTSN_TASK_BASE_PRIO( pxController ),
+                     &( pxController->xTaskHandle ) );
+
+        #if ( controllerHAS_CORE_AFFINITY != 0 )
+            if( ( pxController->xTaskHandle != NULL ) && ( pxController->uxCoreAffinityMask != controllerNO_AFFINITY ) )
+            {
+                vTaskCoreAffinitySet( pxController->xTaskHandle, ( UBaseType_t ) pxController->uxCoreAffinityMask );
+            }
+        #endif
+
+        #if ( tsnconfigCONTROLLER_SEPARATE_RX_STAGE != tsnconfigDISABLE )
+            pxController->xRxStageQueue = xQueueCreate( tsnconfigCONTROLLER_RX_STAGE_QUEUE_LENGTH, sizeof( RxStageItem_t ) );
+            configASSERT( pxController->xRxStageQueue != NULL );
+
+            prvTaskName( pcName, "TSN-rx", xIndex );
+
+            xTaskCreate( prvTSNControllerRxStage,
+                         pcName,
+                         ipconfigIP_TASK_STACK_SIZE_WORDS,
+                         ( void * ) pxController,
+                         pxController->uxRxStagePriority,
+                         &( pxController->xRxStageHandle ) );
+
+            #if ( controllerHAS_CORE_AFFINITY != 0 )
+                if( ( pxController->xRxStageHandle != NULL ) && ( pxController->uxCoreAffinityMask != controllerNO_AFFINITY ) )
+                {
+                    vTaskCoreAffinitySet( pxController->xRxStageHandle, ( UBaseType_t ) pxController->uxCoreAffinityMask );
+                }
+            #endif
+        #endif /* if ( tsnconfigCONTROLLER_SEPARATE_RX_STAGE != tsnconfigDISABLE ) */
+    }
+}
+
+/**
+ * @brief Function to notify a TSN Controller task
+ *
+ * This function notifies the TSN Controller task to wake up and process
+ * pending network packets or events.
+ * Notifications are coalesced: if the controller was already notified and
+ * has not started its next pass over the queues yet, no new notification is
+ * sent, since that pass will see the new packets anyway.
+ *
+ * @param[in] pxController The controller to notify
+ * @return pdTRUE if the notification is sent, pdFALSE otherwise
+ */
+BaseType_t xNotifyController( TSNController_t * pxController )
+{
+    BaseType_t xWasPending;
+
+    if( ( pxController == NULL ) || ( pxController->xTaskHandle == NULL ) )
+    {
+        return pdFALSE;
+    }
+
+    taskENTER_CRITICAL();
+    {
+        xWasPending = pxController->xNotifyPending;
+        pxController->xNotifyPending = pdTRUE;
+    }
+    taskEXIT_CRITICAL();
+
+    if( xWasPending != pdFALSE )
+    {
+        return pdFALSE;
+    }
+
+    return xTaskNotifyGive( pxController->xTaskHandle );
+}
+
+/**
+ * @brief Function to notify a TSN Controller task from an interrupt
+ *
+ * This is the interrupt safe version of xNotifyController().
+ *
+ * @param[in] pxController The controller to notify
+ * @param[out] pxHigherPriorityTaskWoken Set to pdTRUE if a context switch
+ * should be requested before the interrupt exits
+ * @return pdTRUE if the notification is sent, pdFALSE otherwise
+ */
+BaseType_t xNotifyControllerFromISR( TSNController_t * pxController,
+                                     BaseType_t * pxHigherPriorityTaskWoken )
+{
+    BaseType_t xWasPending;
+    UBaseType_t uxSavedInterruptStatus;
+
+    if( ( pxController == NULL ) || ( pxController->xTaskHandle == NULL ) )
+    {
+        return pdFALSE;
+    }
+
+    uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+    {
+        xWasPending = pxController->xNotifyPending;
+        pxController->xNotifyPending = pdTRUE;
+    }
+    taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+
+    if( xWasPending != pdFALSE )
+    {
+        return pdFALSE;
+    }
+
+    vTaskNotifyGiveFromISR( pxController->xTaskHandle, pxHigherPriorityTaskWoken );
+
+    return pdTRUE;
+}
+
+/**
+ * @brief Mark the start of a pass of the controller over its queues
+ *
+ * This must be called by the controller before it looks at its queues, so
+ * that any packet pushed after this point sends a new notification.
+ * With the express path enabled, the controller also takes the output token
+ * of its interfaces. If a sending task is holding it, the pass is skipped and
+ * the sender will notify the controller when it releases the token.
+ *
+ * @param[in] pxController The calling controller
+ * @return pdTRUE if the controller can go on with the pass, pdFALSE otherwise
+ */
+static BaseType_t prvStartPass( TSNController_t * pxController )
+{
+    BaseType_t xReturn = pdTRUE;
+
+    taskENTER_CRITICAL();
+    {
+        pxController->xNotifyPending = pdFALSE;
+
+        #if ( tsnconfigCONTROLLER_HAS_EXPRESS_PATH != tsnconfigDISABLE )
+            if( pxController->xTokenHeld != pdFALSE )
+            {
+                pxController->xTokenWanted = pdTRUE;
+                xReturn = pdFALSE;
+            }
+            else
+            {
+                pxController->xTokenHeld = pdTRUE;
+            }
+        #endif
+    }
+    taskEXIT_CRITICAL();
+
+    if( xReturn == pdFALSE )
+    {
+        return pdFALSE;
+    }
+
+    #if ( tsnconfigCONTROLLER_HAS_DYNAMIC_PRIO != tsnconfigDISABLE )
+        if( pxController->xPriorityStale != pdFALSE )
+        {
+            /* A packet was pushed from an interrupt, where the priority
+             * could not be raised */
+            pxController->xPriorityStale = pdFALSE;
+            vTSNControllerComputePriority( pxController );
+        }
+    #endif
+
+    return pdTRUE;
+}
+
+/**
+ * @brief Mark the end of a pass of the controller over its queues
+ *
+ * @param[in] pxController The calling controller
+ */
+static void prvEndPass( TSNController_t * pxController )
+{
+    #if ( tsnconfigCONTROLLER_HAS_EXPRESS_PATH != tsnconfigDISABLE )
+        taskENTER_CRITICAL();
+        {
+            pxController->xTokenHeld = pdFALSE;
+        }
+        taskEXIT_CRITICAL();
+    #else
+        ( void ) pxController;
+    #endif
+}
+
+#if ( tsnconfigCONTROLLER_HAS_EXPRESS_PATH != tsnconfigDISABLE )
+
+/**
+ * @brief Check if all the queues of a controller are empty
+ *
+ * @param[in] pxController The controller
+ * @return pdTRUE if no packet is waiting in the queues of pxController
+ */
+    static BaseType_t prvControllerQueuesEmpty( TSNController_t * pxController )
+    {
+        NetworkQueueList_t * pxIter = pxNetworkQueueList;
+
+        while( pxIter != NULL )
+        {
+            if( ( pxIter->pxQueue->pxController == pxController ) && !xNetworkQueueIsEmpty( pxIter->pxQueue ) )
+            {
+                return pdFALSE;
+            }
+
+            pxIter = pxIter->pxNext;
+        }
+
+        return pdTRUE;
+    }
+
+/**
+ * @brief Try to take the output token of the controller serving a queue
+ *
+ * The token is granted to the calling task only if the queue is an unshaped
+ * express queue, the controller is idle, it has no pending notification and
+ * none of its queues has waiting packets. In all the other cases the packet
+ * must go through the controller, which owns every contended case.
+ * On success, the caller must send the packet with
+ * xTSN_NetworkInterfaceOutputDirect() and then call
+ * vTSNControllerReleaseExpressToken().
+ *
+ * @param[in] pxQueue The queue the packet was assigned to
+ * @return pdTRUE if the token is taken, pdFALSE otherwise
+ */
+    BaseType_t xTSNControllerTakeExpressToken( NetworkQueue_t * pxQueue )
+    {
+        TSNController_t * const pxController = pxQueue->pxController;
+        BaseType_t xTaken = pdFALSE;
+
+        if( ( pxQueue->xExpress == pdFALSE ) || ( pxQueue->xUnshaped == pdFALSE ) ||
+            ( pxController == NULL ) || ( pxController->xTaskHandle == NULL ) )
+        {
+            return pdFALSE;
+        }
+
+        taskENTER_CRITICAL();
+        {
+            if( ( pxController->xTokenHeld == pdFALSE ) && ( pxController->xNotifyPending == pdFALSE ) &&
+                ( prvControllerQueuesEmpty( pxController ) != pdFALSE ) )
+            {
+                pxController->xTokenHeld = pdTRUE;
+                xTaken = pdTRUE;
+            }
+        }
+        taskEXIT_CRITICAL();
+
+        return xTaken;
+    }
+
+/**
+ * @brief Release the output token taken with xTSNControllerTakeExpressToken()
+ *
+ * If the controller tried to start a pass while the token was held, it is
+ * notified so that it can serve the packets queued in the meantime.
+ *
+ * @param[in] pxController The controller owning the token
+ */
+    void vTSNControllerReleaseExpressToken( TSNController_t * pxController )
+    {
+        BaseType_t xWanted;
+
+        taskENTER_CRITICAL();
+        {
+            pxController->xTokenHeld = pdFALSE;
+            xWanted = pxController->xTokenWanted;
+            pxController->xTokenWanted = pdFALSE;
+        }
+        taskEXIT_CRITICAL();
+
+        if( xWanted != pdFALSE )
+        {
+            xNotifyController( pxController );
+        }
+    }
+
+#endif /* if ( tsnconfigCONTROLLER_HAS_EXPRESS_PATH != tsnconfigDISABLE ) */
+
+/**
+ * @brief Function to compute the priority of a TSN Controller task
+ *
+ * The priority of the TSN controller is the maximum IPV among all the queues
+ * bound to it which has pending messages. The kernel is only entered if the
+ * priority changes.
+ *
+ * @param[in] pxController The controller whose priority is computed
+ */
+void vTSNControllerComputePriority( TSNController_t * pxController )
+{
+    NetworkQueueList_t * pxIter = pxNetworkQueueList;
+    UBaseType_t uxPriority = controllerTSN_TASK_BASE_PRIO( pxController );
+
+    while( pxIter != NULL )
+    {
+        if( ( pxIter->pxQueue->pxController == pxController ) && !xNetworkQueueIsEmpty( pxIter->pxQueue ) )
+        {
+            if( pxIter->pxQueue->uxIPV > uxPriority )
+            {
+                uxPriority = pxIter->pxQueue->uxIPV;
+            }
+        }
+
+        pxIter = pxIter->pxNext;
+    }
+
+    if( pxController->uxCurrentPriority != uxPriority )
+    {
+        pxController->uxCurrentPriority = uxPriority;
+        vTaskPrioritySet( pxController->xTaskHandle, uxPriority );
+    }
+}
+
+/**
+ * @brief Function to update the priority of a TSN Controller task
+ *
+ * This function updates the priority of the TSN Controller task if the
+ * new priority is higher than the current priority. The current priority is
+ * cached in the controller, so that the common case, where the priority is
+ * already high enough, does not enter the kernel.
+ *
+ * @param[in] pxController The controller whose priority is updated
+ * @param[in] uxPriority New priority for the TSN Controller task
+ * @return pdTRUE if the priority is updated, pdFALSE otherwise
+ */
+BaseType_t xTSNControllerUpdatePriority( TSNController_t * pxController,
+                                         UBaseType_t uxPriority )
+{
+    #if ( tsnconfigCONTROLLER_HAS_DYNAMIC_PRIO != tsnconfigDISABLE )
+        BaseType_t xRaised = pdFALSE;
+
+        if( ( pxController != NULL ) && ( pxController->xTaskHandle != NULL ) &&
+            ( pxController->uxCurrentPriority < uxPriority ) )
+        {
+            vTaskSuspendAll();
+            {
+                /* Check again, another producer may have raised it */
+                if( pxController->uxCurrentPriority < uxPriority )
+                {
+                    pxController->uxCurrentPriority = uxPriority;
+                    vTaskPrioritySet( pxController->xTaskHandle, uxPriority );
+                    xRaised = pdTRUE;
+                }
+            }
+            ( void ) xTaskResumeAll();
+        }
+
+        return xRaised;
+    #else
+        ( void ) pxController;
+        ( void ) uxPriority;
+
+        return pdFALSE;
+    #endif
+}
+
+/**
+ * @brief Function to update the priority of a TSN Controller task from an
+ * interrupt
+ *
+ * The priority of a task cannot be changed from an interrupt, so the
+ * controller is asked to compute its priority again at the start of its next
+ * pass.
+ *
+ * @param[in] pxController The controller whose priority is updated
+ * @param[in] uxPriority New priority for the TSN Controller task
+ * @return pdTRUE if the priority will be updated, pdFALSE otherwise
  */
-BaseType_t xTSNControllerUpdatePriority( UBaseType_t uxPriority )
+BaseType_t xTSNControllerUpdatePriorityFromISR( TSNController_t * pxController,
+                                                UBaseType_t uxPriority )
 {
     #if ( tsnconfigCONTROLLER_HAS_DYNAMIC_PRIO != tsnconfigDISABLE )
-        if( uxTaskPriorityGet( xTSNControllerHandle ) < uxPriority )
+        if( ( pxController != NULL ) && ( pxController->uxCurrentPriority < uxPriority ) )
         {
-            vTaskPrioritySet( xTSNControllerHandle, uxPriority );
+            pxController->xPriorityStale = pdTRUE;
             return pdTRUE;
         }
+    #else
+        ( void ) pxController;
+        ( void ) uxPriority;
     #endif
 
     return pdFALSE;
 }
 
 /**
- * @brief Function to check if the caller task is the TSN Controller task
+ * @brief Function to check if the caller task is a TSN Controller task
  *
- * This function checks if the caller task is the TSN Controller task.
+ * This function checks if the caller task is one of the TSN Controller tasks.
  *
- * @return pdTRUE if the current task is the TSN Controller task, pdFALSE otherwise
+ * @return pdTRUE if the current task is a TSN Controller task, pdFALSE otherwise
  */
 BaseType_t xIsCallingFromTSNController( void )
 {
-    return ( xTaskGetCurrentTaskHandle() == xTSNControllerHandle ) ? pdTRUE : pdFALSE;
+    return ( pxTSNControllerGetCurrent() != NULL ) ? pdTRUE : pdFALSE;
 }
@@ -5,125 +5,94 @@
  * This file contains the implementation of functions related to retrieving and setting DiffServ class in network buffers.
  */
 
+#include <string.h>
+
 #include "FreeRTOS.h"
 
 #include "FreeRTOS_IP.h"
 
+#include "FreeRTOS_TSN_Checksum.h"
 #include "FreeRTOS_TSN_VLANTags.h"
 #include "FreeRTOS_TSN_DS.h"
+#include "FreeRTOS_TSN_Parser.h"
 
 /**
- * @brief Retrieves the IP version and offset from the given network buffer.
+ * @brief Retrieves the DiffServ class of a parsed frame.
  *
- * This function extracts the IP version and offset from the Ethernet header of the network buffer.
+ * The class is read by xPacketParse() when the frame enters the TSN layer,
+ * the headers are not parsed again.
  *
- * @param[in] pxBuf The network buffer descriptor.
- * @param[out] pusIPVersion Pointer to store the IP version.
- * @param[out] pulOffset Pointer to store the offset.
+ * @param[in] pxMeta The metadata of the frame.
+ * @return The DiffServ class value, parserNO_DSCP if the frame is not IP.
  */
-void prvGetIPVersionAndOffset( NetworkBufferDescriptor_t * pxBuf,
-                               uint16_t * pusIPVersion,
-                               size_t * pulOffset )
+uint8_t ucDSClassGet( const PacketMetadata_t * pxMeta )
 {
-    // Get a pointer to the Ethernet header
-    EthernetHeader_t * pxEthHead = ( EthernetHeader_t * ) pxBuf->pucEthernetBuffer;
-    
-    // Get the Ethernet frame type
-    uint16_t usEthType = FreeRTOS_ntohs( pxEthHead->usFrameType );
-
-    // Set the initial offset to the size of the Ethernet header
-    *pulOffset = ipSIZE_OF_ETH_HEADER;
-
-    // Check if the Ethernet frame type is double VLAN tagged
-    if( usEthType == vlantagTPID_DOUBLE_TAG )
-    {
-        // Increase the offset by the size of two VLAN tags
-        *pulOffset += 2 * sizeof( struct xVLAN_TAG );
-        
-        // Get a pointer to the double tagged Ethernet header
-        DoubleTaggedEthernetHeader_t * pxDTEthHead = ( DoubleTaggedEthernetHeader_t * ) pxBuf->pucEthernetBuffer;
-        
-        // Store the IP version
-        *pusIPVersion = pxDTEthHead->usFrameType;
-    }
-    // Check if the Ethernet frame type is single VLAN tagged
-    else if( usEthType == vlantagTPID_DEFAULT )
-    {
-        // Increase the offset by the size of a single VLAN tag
-        *pulOffset += sizeof( struct xVLAN_TAG );
-        
-        // Get a pointer to the tagged Ethernet header
-        TaggedEthernetHeader_t * pxTEthHead = ( TaggedEthernetHeader_t * ) pxBuf->pucEthernetBuffer;
-        
-        // Store the IP version
-        *pusIPVersion = pxTEthHead->usFrameType;
-    }
+    return pxMeta->ucDSCP;
 }
 
 /**
- * @brief Retrieves the DiffServ class from the given network buffer.
+ * @brief Sets the DiffServ class of an IPv4 header.
  *
- * This function extracts the DiffServ class from the IP header of the network buffer based on the IP version.
+ * The header checksum is updated incrementally, so the header must already
+ * hold a valid checksum (or one that is computed later by the driver).
  *
- * @param[in] pxBuf The network buffer descriptor.
- * @return The DiffServ class value.
+ * @param[in] pxIPHeader The IPv4 header.
+ * @param[in] ucValue The DiffServ class value to set.
  */
-uint8_t ucDSClassGet( NetworkBufferDescriptor_t * pxBuf )
+void vDSClassSetIPv4( IPHeader_t * pxIPHeader,
+                      uint8_t ucValue )
 {
-    size_t ulIPHeaderOffset;
-    uint16_t usEtherType;
+    uint16_t usOldWord, usNewWord;
 
-    // Get the IP version and offset from the network buffer
-    prvGetIPVersionAndOffset( pxBuf, &usEtherType, &ulIPHeaderOffset );
+    // The class shares the first word of the header with the version and length
+    memcpy( &usOldWord, pxIPHeader, sizeof( usOldWord ) );
+    diffservSET_DSCLASS_IPv4( pxIPHeader, ucValue );
+    memcpy( &usNewWord, pxIPHeader, sizeof( usNewWord ) );
 
-    switch( usEtherType )
-    {
-        case ipIPv4_FRAME_TYPE:
-            // If the EtherType is IPv4, cast the IP header and call diffservGET_DSCLASS_IPv4
-            IPHeader_t * pxIPHeader = ( IPHeader_t * ) &pxBuf->pucEthernetBuffer[ ulIPHeaderOffset ];
-            return diffservGET_DSCLASS_IPv4( pxIPHeader );
-
-        case ipIPv6_FRAME_TYPE:
-            // If the EtherType is IPv6, cast the IPv6 header and call diffservGET_DSCLASS_IPv6
-            IPHeader_IPv6_t * pxIPv6Header = ( IPHeader_IPv6_t * ) &pxBuf->pucEthernetBuffer[ ulIPHeaderOffset ];
-            return diffservGET_DSCLASS_IPv6( pxIPv6Header );
-
-        default:
-            // If the EtherType is neither IPv4 nor IPv6, return an invalid value
-            return ( uint8_t ) ~0;
-    }
+    pxIPHeader->usHeaderChecksum = usChecksumUpdate16( pxIPHeader->usHeaderChecksum, usOldWord, usNewWord );
 }
 
 /**
  * @brief Sets the DiffServ class for the given network buffer.
  *
  * This function sets the DiffServ class in the IP header of the network buffer based on the IP version.
+ * The IPv4 header checksum is kept valid, see vDSClassSetIPv4(). The IP
+ * header is found from the metadata, which is updated with the new class.
  *
  * @param[in] pxBuf The network buffer descriptor.
+ * @param[in,out] pxMeta The metadata of the frame.
  * @param[in] ucValue The DiffServ class value to set.
  * @return pdPASS if the DiffServ class was set successfully, pdFAIL otherwise.
  */
 BaseType_t xDSClassSet( NetworkBufferDescriptor_t * pxBuf,
+                        PacketMetadata_t * pxMeta,
                         uint8_t ucValue )
 {
-    // Get the IP version and offset in the network buffer
-    size_t ulIPHeaderOffset;
-    uint16_t usEtherType;
-    prvGetIPVersionAndOffset( pxBuf, &usEtherType, &ulIPHeaderOffset );
+    // The class is only found if the IP header is complete
+    if( pxMeta->ucDSCP == parserNO_DSCP )
+    {
+        return pdFAIL;
+    }
 
-    switch( usEtherType )
+    switch( pxMeta->usFrameType )
     {
         case ipIPv4_FRAME_TYPE:
+        {
             // Set DiffServ class for IPv4
-            IPHeader_t * pxIPHeader = ( IPHeader_t * ) &pxBuf->pucEthernetBuffer[ ulIPHeaderOffset ];
-            diffservSET_DSCLASS_IPv4( pxIPHeader, ucValue );
+            IPHeader_t * pxIPHeader = ( IPHeader_t * ) &pxBuf->pucEthernetBuffer[ pxMeta->usL3Offset ];
+            vDSClassSetIPv4( pxIPHeader, ucValue );
+            pxMeta->ucDSCP = ucValue;
             return pdPASS;
+        }
 
         case ipIPv6_FRAME_TYPE:
+        {
             // Set DiffServ class for IPv6
-            IPHeader_IPv6_t * pxIPv6Header = ( IPHeader_IPv6_t * ) &pxBuf->pucEthernetBuffer[ ulIPHeaderOffset ];
+            IPHeader_IPv6_t * pxIPv6Header = ( IPHeader_IPv6_t * ) &pxBuf->pucEthernetBuffer[ pxMeta->usL3Offset ];
             diffservSET_DSCLASS_IPv6( pxIPv6Header, ucValue );
+            pxMeta->ucDSCP = ucValue;
             return pdPASS;
+        }
 
         default:
             // Invalid EtherType
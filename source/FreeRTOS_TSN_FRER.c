@@ -0,0 +1,571 @@
+/**
+ * @file FreeRTOS_TSN_FRER.c
+ * @brief Frame Replication and Elimination for Reliability (IEEE 802.1CB)
+ *
+ * Sent frames of a configured stream get an R-TAG carrying their sequence
+ * number and are transmitted on two member streams, which differ by VID
+ * and possibly by interface. The TSN sockets build the frames of the stream
+ * VIDs with room for the R-TAG, see uxFRERTxRoom(), so that it is written in
+ * place. The network wrapper sends the same buffer twice and only rewrites
+ * the VID in between, see pxFRERTxReplica().
+ * Received frames carrying an R-TAG go through the vector recovery
+ * algorithm: a bitmap of the latest sequence numbers of the stream tells in
+ * constant time whether a frame is a duplicate, without any allocation.
+ */
+
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "FreeRTOS_IP.h"
+
+#include "FreeRTOS_TSN_VLANTags.h"
+#include "FreeRTOS_TSN_FRER.h"
+
+#if ( tsnconfigFRER_STREAMS > 0 )
+
+    #define frerRESET_TICKS    ( pdMS_TO_TICKS( tsnconfigFRER_RESET_MS ) )
+
+/** @brief State of an FRER stream */
+    struct xFRER_STREAM
+    {
+        FRERStreamConfig_t xConfig;  /**< Identification and paths of the stream */
+        BaseType_t xInUse;           /**< pdTRUE if the stream is configured */
+        uint16_t usNextSequence;     /**< Sequence number of the next sent frame */
+        uint16_t usRecoverySequence; /**< Highest sequence number received */
+        uint32_t ulHistory;          /**< Bit n is set if usRecoverySequence - n was received */
+        BaseType_t xTakeAny;         /**< pdTRUE to accept the next sequence number, whatever it is */
+        TickType_t xLastPassed;      /**< Tick of the last frame passed up */
+        FRERStreamStats_t xStats;    /**< Counters of the stream */
+    };
+
+    static struct xFRER_STREAM xStreams[ tsnconfigFRER_STREAMS ];
+
+/* Number of configured streams, to skip the table when empty */
+    static volatile UBaseType_t uxActiveStreams = 0U;
+
+/**
+ * @brief Find the stream of a frame
+ *
+ * @param pucDestination The destination MAC address of the frame
+ * @param usVID The VID of the frame, 0 if untagged
+ * @param xReplica pdTRUE to match the VID of the second member stream too
+ * @return The index of the stream, or -1 if the frame is not part of a stream
+ */
+    static BaseType_t prvFindStream( const uint8_t * pucDestination,
+                                     uint16_t usVID,
+                                     BaseType_t xReplica )
+    {
+        for( BaseType_t xStream = 0; xStream < ( BaseType_t ) tsnconfigFRER_STREAMS; ++xStream )
+        {
+            const struct xFRER_STREAM * pxStream = &xStreams[ xStream ];
+
+            if( ( pxStream->xInUse != pdFALSE ) &&
+                ( memcmp( pxStream->xConfig.xDestinationAddress.ucBytes, pucDestination, ipMAC_ADDRESS_LENGTH_BYTES ) == 0 ) &&
+                ( ( pxStream->xConfig.usVID == usVID ) ||
+                  ( ( xReplica != pdFALSE ) && ( pxStream->xConfig.usReplicaVID == usVID ) ) ) )
+            {
+                return xStream;
+            }
+        }
+
+        return -1;
+    }
+
+/**
+ * @brief Find the end of the VLAN tags of a frame being sent
+ *
+ * @param pucBuffer The ethernet buffer
+ * @param uxLength The length of the frame
+ * @param[out] puxCTagOffset Offset of the customer tag, 0 if there is none
+ * @return The offset of the field following the tags
+ */
+    static size_t prvParseVLANTags( const uint8_t * pucBuffer,
+                                    size_t uxLength,
+                                    size_t * puxCTagOffset )
+    {
+        size_t uxOffset = vlantagETH_TAG_OFFSET;
+        uint16_t usTPID;
+
+        *puxCTagOffset = 0U;
+
+        for( UBaseType_t uxTag = 0; uxTag < 2U; ++uxTag )
+        {
+            if( uxOffset + sizeof( struct xVLAN_TAG ) + sizeof( usTPID ) > uxLength )
+            {
+                break;
+            }
+
+            memcpy( &usTPID, &pucBuffer[ uxOffset ], sizeof( usTPID ) );
+
+            if( usTPID == FreeRTOS_htons( vlantagTPID_DEFAULT ) )
+            {
+                *puxCTagOffset = uxOffset;
+            }
+            else if( usTPID != FreeRTOS_htons( vlantagTPID_DOUBLE_TAG ) )
+            {
+                break;
+            }
+
+            uxOffset += sizeof( struct xVLAN_TAG );
+        }
+
+        return uxOffset;
+    }
+
+/**
+ * @brief Configure a stream, or remove it
+ *
+ * The recovery state is reset, so the first frame received afterwards is
+ * accepted whatever its sequence number.
+ * The two member streams must differ by VID or by interface: replicas with
+ * the same VID on the same interface would follow the same path, and the
+ * receivers could not tell them apart from the stream itself.
+ *
+ * @param[in] xStream Index of the stream, less than tsnconfigFRER_STREAMS
+ * @param[in] pxConfig The stream, or NULL to remove it
+ * @return pdPASS on success, pdFAIL if the arguments are not valid
+ */
+    BaseType_t xFRERStreamConfigure( BaseType_t xStream,
+                                     const FRERStreamConfig_t * pxConfig )
+    {
+        struct xFRER_STREAM * pxStream;
+
+        if( ( xStream < 0 ) || ( xStream >= ( BaseType_t ) tsnconfigFRER_STREAMS ) )
+        {
+            return pdFAIL;
+        }
+
+        if( ( pxConfig != NULL ) &&
+            ( ( pxConfig->usVID > vlantagVID_BIT_MASK ) || ( pxConfig->usReplicaVID > vlantagVID_BIT_MASK ) ) )
+        {
+            return pdFAIL;
+        }
+
+        /* The member streams need a distinct VID or egress interface */
+        if( ( pxConfig != NULL ) && ( pxConfig->usReplicaVID == pxConfig->usVID ) && ( pxConfig->pxReplicaInterface == NULL ) )
+        {
+            return pdFAIL;
+        }
+
+        pxStream = &xStreams[ xStream ];
+
+        taskENTER_CRITICAL();
+        {
+            if( pxStream->xInUse != pdFALSE )
+            {
+                uxActiveStreams--;
+            }
+
+            memset( pxStream, 0, sizeof( *pxStream ) );
+
+            if( pxConfig != NULL )
+            {
+                pxStream->xConfig = *pxConfig;
+                pxStream->xTakeAny = pdTRUE;
+                pxStream->xInUse = pdTRUE;
+                uxActiveStreams++;
+            }
+        }
+        taskEXIT_CRITICAL();
+
+        return pdPASS;
+    }
+
+/**
+ * @brief Read the counters of a stream
+ *
+ * @param[in] xStream Index of the stream
+ * @param[out] pxStats The counters
+ * @return pdPASS on success, pdFAIL if the stream is not configured
+ */
+    BaseType_t xFRERStreamGetStats( BaseType_t xStream,
+                                    FRERStreamStats_t * pxStats )
+    {
+        BaseType_t xReturn = pdFAIL;
+
+        if( ( xStream < 0 ) || ( xStream >= ( BaseType_t ) tsnconfigFRER_STREAMS ) || ( pxStats == NULL ) )
+        {
+            return pdFAIL;
+        }
+
+        taskENTER_CRITICAL();
+        {
+            if( xStreams[ xStream ].xInUse != pdFALSE )
+            {
+                *pxStats = xStreams[ xStream ].xStats;
+                xReturn = pdPASS;
+            }
+        }
+        taskEXIT_CRITICAL();
+
+        return xReturn;
+    }
+
+/**
+ * @brief Room to reserve for the R-TAG in the frames of a VID
+ *
+ * The TSN sockets build their frames with this room after the VLAN tags,
+ * holding an R-TAG with sequence number 0, see pxFRERTxTag(). The room is
+ * reserved for the VID alone, as the destination is not resolved yet when
+ * the frame is allocated.
+ *
+ * @param[in] usVID The VID of the customer tag of the frames, 0 if untagged
+ * @return sizeof( struct xFRER_RTAG ) if a stream uses the VID, 0 otherwise
+ */
+    size_t uxFRERTxRoom( uint16_t usVID )
+    {
+        if( uxActiveStreams == 0U )
+        {
+            return 0U;
+        }
+
+        for( BaseType_t xStream = 0; xStream < ( BaseType_t ) tsnconfigFRER_STREAMS; ++xStream )
+        {
+            if( ( xStreams[ xStream ].xInUse != pdFALSE ) && ( xStreams[ xStream ].xConfig.usVID == usVID ) )
+            {
+                return sizeof( struct xFRER_RTAG );
+            }
+        }
+
+        return 0U;
+    }
+
+/**
+ * @brief Remove the R-TAG room of a frame which is not part of a stream
+ *
+ * This happens to the frames sent with the VID of a stream to another
+ * destination, or after the stream was removed. The frame keeps the
+ * minimum ethernet length.
+ *
+ * @param[in] pxBuf The frame
+ * @param[in] uxOffset The offset of the room
+ */
+    static void prvRemoveRoom( NetworkBufferDescriptor_t * pxBuf,
+                               size_t uxOffset )
+    {
+        uint8_t * const pucBuffer = pxBuf->pucEthernetBuffer;
+        size_t uxLength = pxBuf->xDataLength - sizeof( struct xFRER_RTAG );
+
+        memmove( &pucBuffer[ uxOffset ], &pucBuffer[ uxOffset + sizeof( struct xFRER_RTAG ) ], uxLength - uxOffset );
+
+        #if ( ipconfigETHERNET_MINIMUM_PACKET_BYTES > 0 )
+            if( uxLength < ( size_t ) ipconfigETHERNET_MINIMUM_PACKET_BYTES )
+            {
+                memset( &pucBuffer[ uxLength ], 0, pxBuf->xDataLength - uxLength );
+                uxLength = ( pxBuf->xDataLength < ( size_t ) ipconfigETHERNET_MINIMUM_PACKET_BYTES ) ?
+                           pxBuf->xDataLength : ( size_t ) ipconfigETHERNET_MINIMUM_PACKET_BYTES;
+            }
+        #endif
+
+        pxBuf->xDataLength = uxLength;
+    }
+
+/**
+ * @brief Insert the R-TAG in a frame being sent, if it belongs to a stream
+ *
+ * The R-TAG follows the VLAN tags and carries the next sequence number of
+ * the stream. The frames of the TSN sockets already hold an R-TAG, written
+ * in the room given by uxFRERTxRoom(), so only its sequence number is set.
+ * Other frames, e.g. the ones built by Plus TCP, are resized once to insert
+ * it. The frame is then sent on the first member stream and turned into the
+ * second one with pxFRERTxReplica().
+ *
+ * @param[in] pxBuf The frame to send, with its VLAN tags
+ * @param[out] pxStream The index of the stream, or -1 if the frame is not part of a stream
+ * @return The buffer to send, which may differ from pxBuf, or NULL if the
+ * buffer could not be resized, in which case it is released
+ */
+    NetworkBufferDescriptor_t * pxFRERTxTag( NetworkBufferDescriptor_t * pxBuf,
+                                             BaseType_t * pxStream )
+    {
+        NetworkBufferDescriptor_t * pxNewBuf = pxBuf;
+        const size_t uxLength = pxBuf->xDataLength;
+        struct xFRER_RTAG xRTag;
+        size_t uxOffset, uxCTagOffset;
+        uint16_t usTCI = 0U;
+        uint16_t usTPID = 0U;
+        uint8_t * pucBuffer;
+        BaseType_t xStream = -1;
+
+        *pxStream = -1;
+
+        if( uxLength < ipSIZE_OF_ETH_HEADER )
+        {
+            return pxBuf;
+        }
+
+        uxOffset = prvParseVLANTags( pxBuf->pucEthernetBuffer, uxLength, &uxCTagOffset );
+
+        if( uxOffset + sizeof( struct xFRER_RTAG ) + sizeof( uint16_t ) <= uxLength )
+        {
+            memcpy( &usTPID, &pxBuf->pucEthernetBuffer[ uxOffset ], sizeof( usTPID ) );
+        }
+
+        if( uxActiveStreams != 0U )
+        {
+            if( uxCTagOffset != 0U )
+            {
+                memcpy( &usTCI, &pxBuf->pucEthernetBuffer[ uxCTagOffset + sizeof( uint16_t ) ], sizeof( usTCI ) );
+                usTCI = FreeRTOS_ntohs( usTCI );
+            }
+
+            xStream = prvFindStream( pxBuf->pucEthernetBuffer, ( uint16_t ) vlantagGET_VID_FROM_TCI( usTCI ), pdFALSE );
+        }
+
+        if( xStream < 0 )
+        {
+            if( usTPID == FreeRTOS_htons( frerRTAG_TPID ) )
+            {
+                prvRemoveRoom( pxBuf, uxOffset );
+            }
+
+            return pxBuf;
+        }
+
+        if( usTPID != FreeRTOS_htons( frerRTAG_TPID ) )
+        {
+            pxNewBuf = pxResizeNetworkBufferWithDescriptor( pxBuf, uxLength + sizeof( struct xFRER_RTAG ) );
+
+            if( pxNewBuf == NULL )
+            {
+                vReleaseNetworkBufferAndDescriptor( pxBuf );
+                return NULL;
+            }
+
+            pxNewBuf->xDataLength = uxLength + sizeof( struct xFRER_RTAG );
+            memmove( &pxNewBuf->pucEthernetBuffer[ uxOffset + sizeof( struct xFRER_RTAG ) ], &pxNewBuf->pucEthernetBuffer[ uxOffset ], uxLength - uxOffset );
+        }
+
+        pucBuffer = pxNewBuf->pucEthernetBuffer;
+
+        xRTag.usTPID = FreeRTOS_htons( frerRTAG_TPID );
+        xRTag.usReserved = 0U;
+
+        /* Streams may be sent by more than one controller */
+        taskENTER_CRITICAL();
+        {
+            xRTag.usSequenceNumber = FreeRTOS_htons( xStreams[ xStream ].usNextSequence );
+            xStreams[ xStream ].usNextSequence++;
+            xStreams[ xStream ].xStats.ulReplicated++;
+        }
+        taskEXIT_CRITICAL();
+
+        memcpy( &pucBuffer[ uxOffset ], &xRTag, sizeof( xRTag ) );
+
+        *pxStream = xStream;
+
+        return pxNewBuf;
+    }
+
+/**
+ * @brief Turn a frame sent on the first member stream into the second one
+ *
+ * Only the VID of the customer tag is rewritten, the R-TAG and the payload
+ * are sent as they are.
+ *
+ * @param[in] pxBuf The frame, already sent on the first member stream
+ * @param[in] xStream The index returned by pxFRERTxTag()
+ * @param[in] pxInterface The interface of the first member stream
+ * @return The interface to send the second member stream to
+ */
+    NetworkInterface_t * pxFRERTxReplica( NetworkBufferDescriptor_t * pxBuf,
+                                          BaseType_t xStream,
+                                          NetworkInterface_t * pxInterface )
+    {
+        const FRERStreamConfig_t * pxConfig = &xStreams[ xStream ].xConfig;
+        uint8_t * const pucTCI = &pxBuf->pucEthernetBuffer[ sizeof( uint16_t ) ];
+        size_t uxCTagOffset;
+        uint16_t usTCI;
+
+        ( void ) prvParseVLANTags( pxBuf->pucEthernetBuffer, pxBuf->xDataLength, &uxCTagOffset );
+
+        if( uxCTagOffset != 0U )
+        {
+            memcpy( &usTCI, &pucTCI[ uxCTagOffset ], sizeof( usTCI ) );
+            usTCI = FreeRTOS_ntohs( usTCI );
+            vlantagSET_VID_FROM_TCI( usTCI, pxConfig->usReplicaVID );
+            usTCI = FreeRTOS_htons( usTCI );
+            memcpy( &pucTCI[ uxCTagOffset ], &usTCI, sizeof( usTCI ) );
+        }
+
+        return ( pxConfig->pxReplicaInterface != NULL ) ? pxConfig->pxReplicaInterface : pxInterface;
+    }
+
+/**
+ * @brief Vector recovery algorithm of IEEE 802.1CB
+ *
+ * Updates the history window of a stream with a received sequence number.
+ * The caller must hold the stream, and handles the reset timeout.
+ *
+ * @param[in] pxStream The stream
+ * @param[in] usSequence The sequence number of the received frame
+ * @return pdPASS if the frame must be passed up, pdFAIL if it is a duplicate
+ * or out of the history window
+ */
+    static BaseType_t prvRecover( struct xFRER_STREAM * pxStream,
+                                  uint16_t usSequence )
+    {
+        BaseType_t xReturn = pdPASS;
+        int16_t sDelta;
+
+        if( pxStream->xTakeAny != pdFALSE )
+        {
+            pxStream->usRecoverySequence = usSequence;
+            pxStream->ulHistory = 1U;
+            pxStream->xTakeAny = pdFALSE;
+        }
+        else
+        {
+            sDelta = ( int16_t ) ( uint16_t ) ( usSequence - pxStream->usRecoverySequence );
+
+            if( ( sDelta >= ( int16_t ) tsnconfigFRER_HISTORY_LENGTH ) || ( sDelta <= -( int16_t ) tsnconfigFRER_HISTORY_LENGTH ) )
+            {
+                /* Too far from the latest frame to tell */
+                pxStream->xStats.ulRogue++;
+                xReturn = pdFAIL;
+            }
+            else if( sDelta > 0 )
+            {
+                /* Newer frame, slide the window */
+                pxStream->ulHistory = ( pxStream->ulHistory << sDelta ) | 1U;
+                pxStream->usRecoverySequence = usSequence;
+            }
+            else if( ( pxStream->ulHistory & ( 1UL << -sDelta ) ) != 0U )
+            {
+                /* Already received from the other member stream */
+                pxStream->xStats.ulDiscarded++;
+                xReturn = pdFAIL;
+            }
+            else
+            {
+                /* Late frame, not received yet */
+                pxStream->ulHistory |= ( 1UL << -sDelta );
+            }
+        }
+
+        if( xReturn == pdPASS )
+        {
+            pxStream->xStats.ulPassed++;
+        }
+
+        return xReturn;
+    }
+
+/**
+ * @brief Eliminate the duplicates of the received frames of a stream
+ *
+ * Vector recovery algorithm of IEEE 802.1CB. Frames without an R-TAG, or
+ * not belonging to a configured stream, are always passed.
+ *
+ * @param[in] pxBuf The received frame
+ * @param[in] pxMeta The metadata of the frame
+ * @return pdPASS if the frame must be passed up, pdFAIL if it must be
+ * discarded
+ */
+    BaseType_t xFRERReceive( const NetworkBufferDescriptor_t * pxBuf,
+                             const PacketMetadata_t * pxMeta )
+    {
+        struct xFRER_STREAM * pxStream;
+        BaseType_t xStream;
+        BaseType_t xReturn;
+        TickType_t xNow;
+
+        if( ( pxMeta->ucHasRTag == pdFALSE ) || ( uxActiveStreams == 0U ) )
+        {
+            return pdPASS;
+        }
+
+        xStream = prvFindStream( pxBuf->pucEthernetBuffer, ( uint16_t ) vlantagGET_VID_FROM_TCI( pxMeta->usVLANCTCI ), pdTRUE );
+
+        if( xStream < 0 )
+        {
+            return pdPASS;
+        }
+
+        pxStream = &xStreams[ xStream ];
+        xNow = xTaskGetTickCount();
+
+        /* The member streams may be received by different tasks */
+        taskENTER_CRITICAL();
+        {
+            if( ( pxStream->xTakeAny == pdFALSE ) && ( ( xNow - pxStream->xLastPassed ) > frerRESET_TICKS ) )
+            {
+                pxStream->xTakeAny = pdTRUE;
+                pxStream->xStats.ulResets++;
+            }
+
+            xReturn = prvRecover( pxStream, pxMeta->usSequenceNumber );
+
+            if( xReturn == pdPASS )
+            {
+                pxStream->xLastPassed = xNow;
+            }
+        }
+        taskEXIT_CRITICAL();
+
+        return xReturn;
+    }
+
+    #if ( tsnconfigSELF_TEST != tsnconfigDISABLE )
+
+/**
+ * @brief Check the sequence recovery window
+ *
+ * Runs prvRecover() on a private stream: the sequence numbers wrap around,
+ * late frames within the window are passed once, duplicates are discarded,
+ * and frames out of the window either side are counted as rogue. The late
+ * frames need a window of at least 8 sequence numbers, shorter ones are not
+ * checked.
+ *
+ * @return pdPASS if the window behaves as expected, pdFAIL otherwise
+ */
+        BaseType_t xFRERSelfTest( void )
+        {
+            #if ( tsnconfigFRER_HISTORY_LENGTH < 8 )
+                return pdPASS;
+            #else
+            /* Sequence number, expected result */
+            static const uint16_t usSteps[][ 2 ] =
+            {
+                { 65533U, pdPASS }, /* Taken whatever it is */
+                { 65533U, pdFAIL }, /* Duplicate */
+                { 65535U, pdPASS }, /* 65534 skipped */
+                { 0U,     pdPASS }, /* Wraps around */
+                { 1U,     pdPASS },
+                { 65534U, pdPASS }, /* Late, across the wrap */
+                { 65534U, pdFAIL }, /* Late duplicate */
+                { 0U,     pdFAIL }, /* Duplicate across the wrap */
+                { 1U,     pdFAIL }, /* Duplicate of the latest */
+                { ( uint16_t ) ( 1U - ( tsnconfigFRER_HISTORY_LENGTH - 1U ) ), pdPASS }, /* Oldest of the window */
+                { ( uint16_t ) ( 1U - tsnconfigFRER_HISTORY_LENGTH ), pdFAIL },          /* Just out, behind */
+                { ( uint16_t ) ( 1U + tsnconfigFRER_HISTORY_LENGTH ), pdFAIL },          /* Just out, ahead */
+                { ( uint16_t ) ( 1U + tsnconfigFRER_HISTORY_LENGTH - 1U ), pdPASS },     /* Furthest ahead in the window */
+                { 0U,     pdFAIL }                                                       /* Slid out of the window */
+            };
+            struct xFRER_STREAM xStream;
+
+            memset( &xStream, 0, sizeof( xStream ) );
+            xStream.xTakeAny = pdTRUE;
+
+            for( size_t uxIndex = 0; uxIndex < sizeof( usSteps ) / sizeof( usSteps[ 0 ] ); ++uxIndex )
+            {
+                if( prvRecover( &xStream, usSteps[ uxIndex ][ 0 ] ) != ( BaseType_t ) usSteps[ uxIndex ][ 1 ] )
+                {
+                    return pdFAIL;
+                }
+            }
+
+            if( ( xStream.xStats.ulPassed != 7U ) || ( xStream.xStats.ulDiscarded != 4U ) || ( xStream.xStats.ulRogue != 3U ) )
+            {
+                return pdFAIL;
+            }
+
+            return pdPASS;
+            #endif /* if ( tsnconfigFRER_HISTORY_LENGTH < 8 ) */
+        }
+
+    #endif /* if ( tsnconfigSELF_TEST != tsnconfigDISABLE ) */
+
+#endif /* if ( tsnconfigFRER_STREAMS > 0 ) */
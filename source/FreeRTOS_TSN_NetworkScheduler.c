@@ -6,10 +6,12 @@
 #include "FreeRTOS_TSN_NetworkScheduler.h"
 #include "FreeRTOS_TSN_Controller.h"
 
-NetworkNode_t * pxNetworkQueueRoot = NULL;
 NetworkQueueList_t * pxNetworkQueueList = NULL;
 UBaseType_t uxNumQueues = 0;
 
+extern BaseType_t prvAlwaysReady( NetworkNode_t * pxNode );
+extern NetworkQueue_t * prvSelectFirst( NetworkNode_t * pxNode );
+
 /**
  * @brief Matches the filtering policy of a network queue with a network queue item.
  *
@@ -81,28 +83,122 @@ void vNetworkQueueListAdd( NetworkQueueList_t * pxItem )
 }
 
 /**
- * @brief Assigns the root network node.
+ * @brief Binds all the queues in a scheduler subtree to a controller.
  *
- * This function assigns the specified network node as the root node for the TSN controller's scheduling function.
- * The root node is the starting point for the scheduling algorithm.
+ * This function recursively visits the subtree spanned by pxNode and binds
+ * every leaf queue to the given controller. A queue can be bound to only one
+ * controller, so linking the same queue in the trees of two different
+ * controllers is an error.
+ * Queues reached only through nodes with the default ready function are
+ * marked as unshaped, since sending them without a scheduling decision
+ * does not violate any shaper.
+ * Unshaped queues are also batchable, unless a node above them chooses
+ * among several children with a custom select function, e.g. a priority
+ * scheduler: a batch would delay the packets of a sibling queue which the
+ * select function would have chosen first.
+ *
+ * @param pxNode The root of the subtree to visit.
+ * @param pxController The controller to bind the queues to.
+ * @param xUnshaped pdTRUE if no node above pxNode has a custom ready function.
+ * @param xBatchable pdTRUE if no node above pxNode selects among children.
+ * @return pdPASS if all the queues are bound, pdFAIL otherwise.
+ */
+static BaseType_t prvNetworkQueueBindTree( NetworkNode_t * pxNode,
+                                           TSNController_t * pxController,
+                                           BaseType_t xUnshaped,
+                                           BaseType_t xBatchable )
+{
+    const struct xSCHEDULER_GENERIC * pxSched;
+
+    if( pxNode == NULL )
+    {
+        return pdFAIL;
+    }
+
+    pxSched = ( const struct xSCHEDULER_GENERIC * ) pxNode->pvScheduler;
+
+    if( ( pxSched == NULL ) || ( pxSched->fnReady != prvAlwaysReady ) )
+    {
+        xUnshaped = pdFALSE;
+    }
+
+    if( ( pxNode->pxQueue == NULL ) && ( pxNode->ucNumChildren > 1U ) &&
+        ( ( pxSched == NULL ) || ( pxSched->fnSelect != prvSelectFirst ) ) )
+    {
+        xBatchable = pdFALSE;
+    }
+
+    if( pxNode->pxQueue != NULL )
+    {
+        // The queue is already served by another controller
+        if( ( pxNode->pxQueue->pxController != NULL ) && ( pxNode->pxQueue->pxController != pxController ) )
+        {
+            return pdFAIL;
+        }
+
+        pxNode->pxQueue->pxController = pxController;
+
+        pxNode->pxQueue->xUnshaped = xUnshaped;
+
+        pxNode->pxQueue->xBatchable = ( xUnshaped != pdFALSE ) ? xBatchable : pdFALSE;
+
+        return pdPASS;
+    }
+
+    for( uint16_t usIter = 0; usIter < pxNode->ucNumChildren; ++usIter )
+    {
+        if( prvNetworkQueueBindTree( pxNode->pxNext[ usIter ], pxController, xUnshaped, xBatchable ) != pdPASS )
+        {
+            return pdFAIL;
+        }
+    }
+
+    return pdPASS;
+}
+
+/**
+ * @brief Assigns the root network node of a TSN controller.
+ *
+ * This function assigns the specified network node as the root node for the
+ * scheduling function of the controller with the given index, and binds all
+ * the queues in the tree to that controller.
  *
  * @param pxNode The network node to assign as the root.
+ * @param xControllerIndex The index of the controller, from 0 to tsnconfigMAX_CONTROLLERS - 1.
  * @return pdPASS if the root network node is successfully assigned, pdFAIL otherwise.
  */
-BaseType_t xNetworkQueueAssignRoot( NetworkNode_t * pxNode )
+BaseType_t xNetworkQueueAssignRootToController( NetworkNode_t * pxNode,
+                                                BaseType_t xControllerIndex )
 {
-    // Check if the root network node is already assigned
-    if( pxNetworkQueueRoot == NULL )
+    TSNController_t * pxController = pxTSNControllerGet( xControllerIndex );
+
+    // Check if the controller exists and has no root yet
+    if( ( pxController == NULL ) || ( pxController->pxRoot != NULL ) )
     {
-        // Assign the specified network node as the root
-        pxNetworkQueueRoot = pxNode;
-        return pdPASS;
+        return pdFAIL;
     }
-    else
+
+    if( prvNetworkQueueBindTree( pxNode, pxController, pdTRUE, pdTRUE ) != pdPASS )
     {
-        // Root network node is already assigned, return failure
         return pdFAIL;
     }
+
+    return xTSNControllerSetRoot( xControllerIndex, pxNode );
+}
+
+/**
+ * @brief Assigns the root network node.
+ *
+ * This function assigns the specified network node as the root node for the TSN controller's scheduling function.
+ * The root node is the starting point for the scheduling algorithm. This
+ * is equivalent to assigning the root of the first controller.
+ *
+ * @param pxNode The network node to assign as the root.
+ * @return pdPASS if the root network node is successfully assigned, pdFAIL otherwise.
+ */
+BaseType_t xNetworkQueueAssignRoot( NetworkNode_t * pxNode )
+{
+    return xNetworkQueueAssignRootToController( pxNode, 0 );
 }
 
 
@@ -110,40 +206,60 @@ BaseType_t xNetworkQueueAssignRoot( NetworkNode_t * pxNode )
  * @brief Iterate over the list of network queues and find a match based on the queues' filtering policy.
  *        If more than one queue matches the filter, the one with the highest IPV (Internet Protocol Version) is chosen.
  *
- * @param pxItem The network queue item to insert.
- * @param uxTimeout The timeout value for the insertion operation.
- * @return pdPASS if the network queue item is successfully inserted, pdFAIL otherwise.
+ * @param pxItem The network queue item to match.
+ * @return The chosen network queue, or NULL if no queue matches.
  */
-BaseType_t xNetworkQueueInsertPacketByFilter(const NetworkQueueItem_t *pxItem, UBaseType_t uxTimeout)
+NetworkQueue_t * pxNetworkQueueFindByFilter( const NetworkQueueItem_t * pxItem )
 {
-    NetworkQueueList_t *pxIterator = pxNetworkQueueList; // Iterator for network queue list
-    NetworkBufferDescriptor_t *pxNetworkBuffer = (NetworkBufferDescriptor_t *)pxItem->pxBuf; // Network buffer descriptor
-    NetworkQueue_t *pxChosenQueue = NULL; // Chosen network queue
+    NetworkQueueList_t * pxIterator = pxNetworkQueueList; // Iterator for network queue list
+    NetworkBufferDescriptor_t * pxNetworkBuffer = ( NetworkBufferDescriptor_t * ) pxItem->pxBuf; // Network buffer descriptor
+    NetworkQueue_t * pxChosenQueue = NULL; // Chosen network queue
 
-    while (pxIterator != NULL)
+    while( pxIterator != NULL )
     {
+        NetworkQueue_t * const pxQueue = pxIterator->pxQueue;
+        BaseType_t xMatch;
+
         // Check if the network buffer matches the filtering policy and the queue policy
-        if (pxIterator->pxQueue->fnFilter(pxNetworkBuffer) && prvMatchQueuePolicy(pxItem, pxIterator->pxQueue))
+        if( pxQueue->fnFilterMeta != NULL )
+        {
+            xMatch = pxQueue->fnFilterMeta( pxNetworkBuffer, &pxItem->xMeta );
+        }
+        else
         {
-            if (pxChosenQueue != NULL)
+            xMatch = pxQueue->fnFilter( pxNetworkBuffer );
+        }
+
+        if( xMatch && prvMatchQueuePolicy( pxItem, pxQueue ) )
+        {
+            // If more queues match, choose the one with the highest IPV
+            if( ( pxChosenQueue == NULL ) || ( pxIterator->pxQueue->uxIPV > pxChosenQueue->uxIPV ) )
             {
-                // If a chosen queue already exists, compare the IPV values and choose the one with the highest value
-                if (pxIterator->pxQueue->uxIPV <= pxChosenQueue->uxIPV)
-                {
-                    pxIterator = pxIterator->pxNext;
-                    continue;
-                }
+                pxChosenQueue = pxIterator->pxQueue; // Set the chosen queue
             }
-
-            pxChosenQueue = pxIterator->pxQueue; // Set the chosen queue
         }
 
         pxIterator = pxIterator->pxNext; // Move to the next network queue
     }
 
-    if (pxChosenQueue != NULL)
+    return pxChosenQueue;
+}
+
+/**
+ * @brief Insert a network queue item in the queue chosen by pxNetworkQueueFindByFilter().
+ *
+ * @param pxItem The network queue item to insert.
+ * @param uxTimeout The timeout value for the insertion operation.
+ * @return pdPASS if the network queue item is successfully inserted, pdFAIL otherwise.
+ */
+BaseType_t xNetworkQueueInsertPacketByFilter( const NetworkQueueItem_t * pxItem,
+                                              UBaseType_t uxTimeout )
+{
+    NetworkQueue_t * pxChosenQueue = pxNetworkQueueFindByFilter( pxItem );
+
+    if( pxChosenQueue != NULL )
     {
-        return xNetworkQueuePush(pxChosenQueue, pxItem, uxTimeout); // Push the network queue item to the chosen queue
+        return xNetworkQueuePush( pxChosenQueue, pxItem, uxTimeout ); // Push the network queue item to the chosen queue
     }
     else
     {
@@ -151,6 +267,30 @@ BaseType_t xNetworkQueueInsertPacketByFilter(const NetworkQueueItem_t *pxItem, U
     }
 }
 
+/**
+ * @brief Interrupt safe version of xNetworkQueueInsertPacketByFilter().
+ *
+ * This allows network drivers to insert received packets directly from their
+ * interrupt handlers. The filter functions of the queues must be interrupt
+ * safe as well.
+ *
+ * @param pxItem The network queue item to insert.
+ * @param pxHigherPriorityTaskWoken Set to pdTRUE if a context switch should be requested before the interrupt exits.
+ * @return pdPASS if the network queue item is successfully inserted, pdFAIL otherwise.
+ */
+BaseType_t xNetworkQueueInsertPacketByFilterFromISR( const NetworkQueueItem_t * pxItem,
+                                                     BaseType_t * pxHigherPriorityTaskWoken )
+{
+    NetworkQueue_t * pxChosenQueue = pxNetworkQueueFindByFilter( pxItem );
+
+    if( pxChosenQueue != NULL )
+    {
+        return xNetworkQueuePushFromISR( pxChosenQueue, pxItem, pxHigherPriorityTaskWoken );
+    }
+
+    return pdFAIL;
+}
+
 /**
  * @brief Inserts a network queue item into a network queue based on the queue name.
  *
@@ -188,30 +328,127 @@ BaseType_t xNetworkQueueInsertPacketByName( const NetworkQueueItem_t * pxItem,
  * calls the network scheduler function to make the selection. If there is no network
  * queue available, it returns pdFAIL.
  *
+ * @param pxRoot The root of the scheduler tree of the calling controller.
  * @return The chosen network queue, or pdFAIL if no network queue is available.
  */
-NetworkQueue_t * xNetworkQueueSchedule( void )
+NetworkQueue_t * xNetworkQueueSchedule( NetworkNode_t * pxRoot )
 {
     // Check if there is a network queue available
-    if( pxNetworkQueueRoot != NULL )
+    if( pxRoot != NULL )
     {
         // Call the network scheduler function to select the next network queue
-        return pxNetworkSchedulerCall( pxNetworkQueueRoot );
+        return pxNetworkSchedulerCall( pxRoot );
     }
 
     // No network queue available
     return pdFAIL;
 }
 
+/**
+ * @brief Append an item to a network queue, without notifying the controller
+ *
+ * @param pxQueue The network queue to push the item into.
+ * @param pxItem The network queue item to push.
+ * @param uxTimeout The timeout value for the push operation.
+ * @return pdPASS if the network queue item is successfully pushed, pdFAIL otherwise.
+ */
+static BaseType_t prvNetworkQueueEnqueue( NetworkQueue_t * pxQueue,
+                                          const NetworkQueueItem_t * pxItem,
+                                          UBaseType_t uxTimeout )
+{
+    // Call the fnOnPush callback function if queue event callbacks are enabled
+    #if ( tsnconfigINCLUDE_QUEUE_EVENT_CALLBACKS != tsnconfigDISABLE )
+        pxQueue->fnOnPush( pxItem->pxBuf );
+    #endif
+
+    // Send the item to the back of the queue using xQueueSendToBack function
+    return xQueueSendToBack( pxQueue->xQueue, ( void * ) pxItem, uxTimeout );
+}
+
+/**
+ * @brief Mark a queue which received an item as notified
+ *
+ * The flag is cleared by xNetworkQueuePop() when the queue becomes empty.
+ * While it is set, the controller was already notified for the items in
+ * the queue, and will see the new ones in the same pass.
+ *
+ * @param pxQueue The network queue.
+ * @return pdTRUE if the queue was empty since the last notification.
+ */
+static BaseType_t prvNetworkQueueArm( NetworkQueue_t * pxQueue )
+{
+    BaseType_t xFirst;
+
+    taskENTER_CRITICAL();
+    {
+        xFirst = ( pxQueue->xNotified == pdFALSE ) ? pdTRUE : pdFALSE;
+        pxQueue->xNotified = pdTRUE;
+    }
+    taskEXIT_CRITICAL();
+
+    return xFirst;
+}
+
+/**
+ * @brief Wake up the controller serving a queue which received items
+ *
+ * The controller is only notified if the queue went from empty to non
+ * empty, or if the IPV of the queue is above the current priority of the
+ * controller, in which case the priority is raised as well.
+ *
+ * @param pxQueue The network queue.
+ * @param xFirst pdTRUE if the queue was empty before the items were pushed.
+ */
+static void prvNetworkQueueNotify( NetworkQueue_t * pxQueue,
+                                   BaseType_t xFirst )
+{
+    // Update the priority of the TSN controller if dynamic priority is enabled
+    #if ( tsnconfigCONTROLLER_HAS_DYNAMIC_PRIO != tsnconfigDISABLE )
+        if( ( pxQueue->pxController != NULL ) && ( pxQueue->uxIPV > pxQueue->pxController->uxCurrentPriority ) )
+        {
+            if( xTSNControllerUpdatePriority( pxQueue->pxController, pxQueue->uxIPV ) != pdFALSE )
+            {
+                xFirst = pdTRUE;
+            }
+        }
+    #endif
+
+    if( xFirst == pdFALSE )
+    {
+        return;
+    }
+
+    #if ( tsnconfigCONTROLLER_BUSY_POLL_NS > 0 )
+        // The item must be visible before the polling flag is read
+        portMEMORY_BARRIER();
+
+        // A polling controller only needs its signal to be raised
+        if( ( pxQueue->pxController != NULL ) && ( pxQueue->pxController->xIsPolling != pdFALSE ) )
+        {
+            pxQueue->pxController->xPollSignal = pdTRUE;
+            return;
+        }
+    #endif
+
+    // Notify the controller
+    xNotifyController( pxQueue->pxController );
+}
+
 /**
  * @brief Pushes a network queue item into a network queue.
  *
  * This function pushes a network queue item into a network queue. It first calls the
  * `fnOnPush` callback function if queue event callbacks are enabled. Then, it uses
  * the `xQueueSendToBack` function to send the item to the back of the queue. If the
- * item is successfully pushed, it updates the priority of the TSN controller (if
- * dynamic priority is enabled), notifies the controller, and returns `pdPASS`.
+ * item is successfully pushed, it updates the priority of the TSN controller
+ * serving the queue (if dynamic priority is enabled), notifies the controller,
+ * and returns `pdPASS`.
  * Otherwise, it returns `pdFAIL`.
+ * The priority is only changed when the IPV of the queue is higher than the
+ * current priority of the controller, and the notification is only sent if
+ * the queue was empty or the priority was raised, and the controller was not
+ * notified since the start of its last pass, so that pushing to a busy
+ * controller does not enter the kernel.
  *
  * @param pxQueue The network queue to push the item into.
  * @param pxItem The network queue item to push.
@@ -222,27 +459,186 @@ BaseType_t xNetworkQueuePush( NetworkQueue_t * pxQueue,
                               const NetworkQueueItem_t * pxItem,
                               UBaseType_t uxTimeout )
 {
-    // Call the fnOnPush callback function if queue event callbacks are enabled
+    if( prvNetworkQueueEnqueue( pxQueue, pxItem, uxTimeout ) == pdPASS )
+    {
+        // Wake up the controller serving the queue
+        prvNetworkQueueNotify( pxQueue, prvNetworkQueueArm( pxQueue ) );
+
+        // Return pdPASS to indicate successful push
+        return pdPASS;
+    }
+
+    // Return pdFAIL to indicate failed push
+    return pdFAIL;
+}
+
+/**
+ * @brief Notify the controllers of the queues which received items
+ *
+ * @param pxToNotify The queue with the highest IPV of each controller.
+ * @param pxFirst For each controller, pdTRUE if one of its queues was empty.
+ * @param uxNotifyCount The number of queues.
+ */
+static void prvNetworkQueueNotifyAll( NetworkQueue_t * const * pxToNotify,
+                                      const BaseType_t * pxFirst,
+                                      UBaseType_t uxNotifyCount )
+{
+    for( UBaseType_t uxIndex = 0; uxIndex < uxNotifyCount; ++uxIndex )
+    {
+        prvNetworkQueueNotify( pxToNotify[ uxIndex ], pxFirst[ uxIndex ] );
+    }
+}
+
+/**
+ * @brief Insert a batch of items in the queues chosen by their filters.
+ *
+ * The items are inserted in order, stopping at the first one which cannot
+ * be inserted. Each controller serving the queues which received items is
+ * notified once, at the end of the batch, and with dynamic priority it is
+ * raised to the highest IPV among them. If a queue is full, the controllers
+ * are notified before waiting for them to make room.
+ *
+ * @param pxItems The network queue items to insert.
+ * @param uxCount The number of items.
+ * @param uxTimeout The time to wait for room in the queues, for the whole
+ * batch.
+ * @return The number of items inserted, starting from the first one.
+ */
+UBaseType_t uxNetworkQueueInsertPacketsByFilter( const NetworkQueueItem_t * pxItems,
+                                                 UBaseType_t uxCount,
+                                                 UBaseType_t uxTimeout )
+{
+    NetworkQueue_t * pxToNotify[ tsnconfigMAX_CONTROLLERS + 1 ];
+    BaseType_t xFirst[ tsnconfigMAX_CONTROLLERS + 1 ];
+    BaseType_t xQueueFirst;
+    UBaseType_t uxNotifyCount = 0;
+    UBaseType_t uxInserted;
+    TickType_t xTicksToWait = ( TickType_t ) uxTimeout;
+    TimeOut_t xTimeOut;
+
+    vTaskSetTimeOutState( &xTimeOut );
+
+    for( uxInserted = 0; uxInserted < uxCount; ++uxInserted )
+    {
+        NetworkQueue_t * pxQueue = pxNetworkQueueFindByFilter( &pxItems[ uxInserted ] );
+        UBaseType_t uxIndex;
+
+        if( pxQueue == NULL )
+        {
+            break;
+        }
+
+        if( uxQueueSpacesAvailable( pxQueue->xQueue ) == 0U )
+        {
+            // The controllers may be the ones to drain the queue
+            prvNetworkQueueNotifyAll( pxToNotify, xFirst, uxNotifyCount );
+            uxNotifyCount = 0;
+
+            if( xTaskCheckForTimeOut( &xTimeOut, &xTicksToWait ) != pdFALSE )
+            {
+                xTicksToWait = 0U;
+            }
+        }
+
+        if( prvNetworkQueueEnqueue( pxQueue, &pxItems[ uxInserted ], xTicksToWait ) != pdPASS )
+        {
+            break;
+        }
+
+        xQueueFirst = prvNetworkQueueArm( pxQueue );
+
+        // Remember the queue with the highest IPV of each controller
+        for( uxIndex = 0; uxIndex < uxNotifyCount; ++uxIndex )
+        {
+            if( pxToNotify[ uxIndex ]->pxController == pxQueue->pxController )
+            {
+                if( pxQueue->uxIPV > pxToNotify[ uxIndex ]->uxIPV )
+                {
+                    pxToNotify[ uxIndex ] = pxQueue;
+                }
+
+                if( xQueueFirst != pdFALSE )
+                {
+                    xFirst[ uxIndex ] = pdTRUE;
+                }
+
+                break;
+            }
+        }
+
+        if( uxIndex == uxNotifyCount )
+        {
+            pxToNotify[ uxNotifyCount ] = pxQueue;
+            xFirst[ uxNotifyCount ] = xQueueFirst;
+            uxNotifyCount++;
+        }
+    }
+
+    prvNetworkQueueNotifyAll( pxToNotify, xFirst, uxNotifyCount );
+
+    return uxInserted;
+}
+
+/**
+ * @brief Interrupt safe version of xNetworkQueuePush().
+ *
+ * The priority of the controller cannot be raised from an interrupt, so
+ * with dynamic priority the controller computes its priority again when it
+ * wakes up.
+ *
+ * @param pxQueue The network queue to push the item into.
+ * @param pxItem The network queue item to push.
+ * @param pxHigherPriorityTaskWoken Set to pdTRUE if a context switch should be requested before the interrupt exits.
+ * @return pdPASS if the network queue item is successfully pushed, pdFAIL otherwise.
+ */
+BaseType_t xNetworkQueuePushFromISR( NetworkQueue_t * pxQueue,
+                                     const NetworkQueueItem_t * pxItem,
+                                     BaseType_t * pxHigherPriorityTaskWoken )
+{
+    BaseType_t xFirst;
+    UBaseType_t uxSavedInterruptStatus;
+
     #if ( tsnconfigINCLUDE_QUEUE_EVENT_CALLBACKS != tsnconfigDISABLE )
-        pxQueue->fnOnPush( ( NetworkBufferDescriptor_t * ) pxItem->pvData );
+        pxQueue->fnOnPush( pxItem->pxBuf );
     #endif
 
-    // Send the item to the back of the queue using xQueueSendToBack function
-    if( xQueueSendToBack( pxQueue->xQueue, ( void * ) pxItem, uxTimeout ) == pdPASS )
+    if( xQueueSendToBackFromISR( pxQueue->xQueue, ( void * ) pxItem, pxHigherPriorityTaskWoken ) == pdPASS )
     {
-        // Update the priority of the TSN controller if dynamic priority is enabled
+        uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+        {
+            xFirst = ( pxQueue->xNotified == pdFALSE ) ? pdTRUE : pdFALSE;
+            pxQueue->xNotified = pdTRUE;
+        }
+        taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+
         #if ( tsnconfigCONTROLLER_HAS_DYNAMIC_PRIO != tsnconfigDISABLE )
-            xTSNControllerUpdatePriority( pxQueue->uxIPV );
+            if( xTSNControllerUpdatePriorityFromISR( pxQueue->pxController, pxQueue->uxIPV ) != pdFALSE )
+            {
+                xFirst = pdTRUE;
+            }
+        #endif
+
+        // The controller already knows about the items in the queue
+        if( xFirst == pdFALSE )
+        {
+            return pdPASS;
+        }
+
+        #if ( tsnconfigCONTROLLER_BUSY_POLL_NS > 0 )
+            portMEMORY_BARRIER();
+
+            if( ( pxQueue->pxController != NULL ) && ( pxQueue->pxController->xIsPolling != pdFALSE ) )
+            {
+                pxQueue->pxController->xPollSignal = pdTRUE;
+                return pdPASS;
+            }
         #endif
 
-        // Notify the controller
-        xNotifyController();
+        xNotifyControllerFromISR( pxQueue->pxController, pxHigherPriorityTaskWoken );
 
-        // Return pdPASS to indicate successful push
         return pdPASS;
     }
 
-    // Return pdFAIL to indicate failed push
     return pdFAIL;
 }
 
@@ -251,6 +647,7 @@ BaseType_t xNetworkQueuePush( NetworkQueue_t * pxQueue,
  *
  * This function pops an item from the specified network queue. If the queue is empty,
  * the function will wait for a specified timeout period for an item to become available.
+ * When the queue becomes empty, the next push notifies the controller again.
  *
  * @param pxQueue The network queue to pop the item from.
  * @param pxItem The network queue item to pop.
@@ -268,9 +665,19 @@ BaseType_t xNetworkQueuePop( NetworkQueue_t * pxQueue,
         return pdFAIL;
     }
 
+    // Let the next push notify the controller once the queue is drained
+    taskENTER_CRITICAL();
+    {
+        if( uxQueueMessagesWaiting( pxQueue->xQueue ) == 0U )
+        {
+            pxQueue->xNotified = pdFALSE;
+        }
+    }
+    taskEXIT_CRITICAL();
+
     // Call the callback function if enabled
     #if ( tsnconfigINCLUDE_QUEUE_EVENT_CALLBACKS != tsnconfigDISABLE )
-        pxQueue->fnOnPop( ( NetworkBufferDescriptor_t * ) pxItem->pvData );
+        pxQueue->fnOnPop( pxItem->pxBuf );
     #endif
 
     return pdPASS;
@@ -13,8 +13,7 @@
 #include "task.h"
 
 #include "FreeRTOS_TSN_NetworkSchedulerBlock.h"
-
-TickType_t uxNextWakeup = 0;
+#include "FreeRTOS_TSN_Controller.h"
 
 /**
  * @brief Default ready function for schedulers.
@@ -194,9 +193,13 @@ NetworkQueue_t * pxNetworkSchedulerCall( NetworkNode_t * pxNode )
         {
             /* terminal node */
 
-            if( !xNetworkQueueIsEmpty( pxNode->pxQueue ) )
+            #if ( tsnconfigCONTROLLER_HAS_BUDGET != tsnconfigDISABLE )
+                if( !xNetworkQueueIsEmpty( pxNode->pxQueue ) && ( pxNode->pxQueue->xDeferred == pdFALSE ) )
+            #else
+                if( !xNetworkQueueIsEmpty( pxNode->pxQueue ) )
+            #endif
             {
-                /* queue not empty */
+                /* queue not empty and not deferred by the controller */
                 pxResult = pxNode->pxQueue;
             }
         }
@@ -236,17 +239,19 @@ NetworkBufferDescriptor_t * pxPeekNextPacket( NetworkNode_t * pxNode )
 /**
  * @brief Gets the ticks until the next wakeup event.
  *
- * This function is used to get the number of ticks until the next wakeup event.
+ * This function is used to get the number of ticks until the next wakeup event
+ * of the calling TSN controller.
  *
  * @return Number of ticks until the next wakeup event.
  */
 TickType_t uxNetworkQueueGetTicksUntilWakeup( void )
 {
+    TSNController_t * pxController = pxTSNControllerGetCurrent();
     TickType_t uxNow = xTaskGetTickCount();
 
-    if( uxNow < uxNextWakeup )
+    if( ( pxController != NULL ) && ( uxNow < pxController->uxNextWakeup ) )
     {
-        return uxNextWakeup - uxNow;
+        return pxController->uxNextWakeup - uxNow;
     }
     else
     {
@@ -261,15 +266,22 @@ TickType_t uxNetworkQueueGetTicksUntilWakeup( void )
  * messages, calling this function can help speed up serving waiting packets.
  * Any scheduler that has implemented a ready function that not always returns
  * true should think of suggesting the TSN controller when to check again.
+ * The wakeup is added to the controller which is running the scheduler.
  *
  * @param uxTime Time at which to add the wakeup event.
  */
 void vNetworkQueueAddWakeupEvent( TickType_t uxTime )
 {
+    TSNController_t * pxController = pxTSNControllerGetCurrent();
     TickType_t uxNow = xTaskGetTickCount();
 
-    if( ( uxTime < uxNextWakeup ) || ( uxNextWakeup <= uxNow ) )
+    if( pxController == NULL )
+    {
+        return;
+    }
+
+    if( ( uxTime < pxController->uxNextWakeup ) || ( pxController->uxNextWakeup <= uxNow ) )
     {
-        uxNextWakeup = uxTime;
+        pxController->uxNextWakeup = uxTime;
     }
 }
@@ -202,3 +202,86 @@ BaseType_t xNetworkQueueIsEmpty( NetworkQueue_t * pxQueue )
 {
     return uxQueueMessagesWaiting( pxQueue->xQueue ) == 0 ? pdTRUE : pdFALSE;
 }
+
+/**
+ * @brief Set the metadata filter of a network queue.
+ *
+ * The metadata filter receives the headers parsed when the packet entered
+ * the TSN layer, and is used in place of the filter given at creation.
+ * Passing NULL restores the original filter.
+ *
+ * @param pxQueue A pointer to the network queue.
+ * @param fnFilterMeta The metadata filter function, or NULL.
+ * @return pdPASS if the filter is set, pdFAIL otherwise.
+ */
+BaseType_t xNetworkQueueSetFilterMeta( NetworkQueue_t * pxQueue,
+                                       FilterMetaFunction_t fnFilterMeta )
+{
+    if( pxQueue == NULL )
+    {
+        return pdFAIL;
+    }
+
+    pxQueue->fnFilterMeta = fnFilterMeta;
+
+    return pdPASS;
+}
+
+#if ( tsnconfigCONTROLLER_HAS_EXPRESS_PATH != tsnconfigDISABLE )
+
+/**
+ * @brief Enable or disable the express path of a network queue.
+ *
+ * When enabled, a task sending a packet that is assigned to this queue
+ * transmits it directly if the controller is idle and none of its queues has
+ * waiting packets. This only applies to queues which are not shaped by the
+ * network scheduler; packets for shaped queues always go through the
+ * controller.
+ *
+ * @param pxQueue A pointer to the network queue.
+ * @param xExpress pdTRUE to enable the express path, pdFALSE to disable it.
+ * @return pdPASS if the flag is set, pdFAIL otherwise.
+ */
+    BaseType_t xNetworkQueueSetExpress( NetworkQueue_t * pxQueue,
+                                        BaseType_t xExpress )
+    {
+        if( pxQueue == NULL )
+        {
+            return pdFAIL;
+        }
+
+        pxQueue->xExpress = ( xExpress != pdFALSE ) ? pdTRUE : pdFALSE;
+
+        return pdPASS;
+    }
+
+#endif /* if ( tsnconfigCONTROLLER_HAS_EXPRESS_PATH != tsnconfigDISABLE ) */
+
+#if ( tsnconfigINCLUDE_PASSTHROUGH_QUEUES != tsnconfigDISABLE )
+
+/**
+ * @brief Enable or disable the pass-through mode of a network queue.
+ *
+ * Received packets assigned to a pass-through queue are delivered to their
+ * TSN socket as soon as they are received, skipping the network scheduler.
+ * This is meant for streams that need no RX scheduling. Packets which are
+ * not bound to a TSN socket are still queued and handled by the controller.
+ *
+ * @param pxQueue A pointer to the network queue.
+ * @param xPassThrough pdTRUE to enable the pass-through mode, pdFALSE to disable it.
+ * @return pdPASS if the flag is set, pdFAIL otherwise.
+ */
+    BaseType_t xNetworkQueueSetPassThrough( NetworkQueue_t * pxQueue,
+                                            BaseType_t xPassThrough )
+    {
+        if( pxQueue == NULL )
+        {
+            return pdFAIL;
+        }
+
+        pxQueue->xPassThrough = ( xPassThrough != pdFALSE ) ? pdTRUE : pdFALSE;
+
+        return pdPASS;
+    }
+
+#endif /* if ( tsnconfigINCLUDE_PASSTHROUGH_QUEUES != tsnconfigDISABLE ) */
@@ -0,0 +1,551 @@
+/**
+ * @file FreeRTOS_TSN_Parser.c
+ * @brief Single pass parser for the frames handled by the TSN layer
+ *
+ * The parser walks the headers of a frame once and stores the result in a
+ * PacketMetadata_t, which travels with the frame in the network queues.
+ * Filters, the controller and the sockets read the metadata instead of
+ * parsing the headers again.
+ */
+
+#include <string.h>
+
+#include "FreeRTOS.h"
+
+#include "FreeRTOS_IP.h"
+
+#include "FreeRTOS_TSN_VLANTags.h"
+#include "FreeRTOS_TSN_DS.h"
+#include "FreeRTOS_TSN_FRER.h"
+#include "FreeRTOS_TSN_Parser.h"
+
+/**
+ * @brief Parse the transport header of a frame
+ *
+ * @param[in] pucBuffer The ethernet buffer
+ * @param[in] uxLength Length of the ethernet buffer
+ * @param[in] uxEnd End of the IP packet, which may be shorter than the frame
+ * because of padding
+ * @param[in,out] pxMeta The metadata, with usL4Offset and ucProtocol set
+ */
+static void prvParseTransport( const uint8_t * pucBuffer,
+                               size_t uxLength,
+                               size_t uxEnd,
+                               PacketMetadata_t * pxMeta )
+{
+    const size_t uxOffset = pxMeta->usL4Offset;
+    size_t uxHeaderLength;
+
+    switch( pxMeta->ucProtocol )
+    {
+        case ipPROTOCOL_UDP:
+
+            if( uxOffset + ipSIZE_OF_UDP_HEADER > uxLength )
+            {
+                return;
+            }
+
+            {
+                const UDPHeader_t * pxUDPHeader = ( const UDPHeader_t * ) &pucBuffer[ uxOffset ];
+                size_t uxUDPLength = FreeRTOS_ntohs( pxUDPHeader->usLength );
+
+                pxMeta->usSourcePort = pxUDPHeader->usSourcePort;
+                pxMeta->usDestinationPort = pxUDPHeader->usDestinationPort;
+
+                if( uxUDPLength < ipSIZE_OF_UDP_HEADER )
+                {
+                    uxUDPLength = ipSIZE_OF_UDP_HEADER;
+                }
+
+                uxEnd = configMIN( uxEnd, uxOffset + uxUDPLength );
+                uxHeaderLength = ipSIZE_OF_UDP_HEADER;
+            }
+            break;
+
+        case ipPROTOCOL_TCP:
+
+            if( uxOffset + ipSIZE_OF_TCP_HEADER > uxLength )
+            {
+                return;
+            }
+
+            {
+                const TCPHeader_t * pxTCPHeader = ( const TCPHeader_t * ) &pucBuffer[ uxOffset ];
+
+                pxMeta->usSourcePort = pxTCPHeader->usSourcePort;
+                pxMeta->usDestinationPort = pxTCPHeader->usDestinationPort;
+                uxHeaderLength = ( size_t ) ( ( pxTCPHeader->ucTCPOffset >> 4 ) << 2 );
+
+                if( uxHeaderLength < ipSIZE_OF_TCP_HEADER )
+                {
+                    uxHeaderLength = ipSIZE_OF_TCP_HEADER;
+                }
+            }
+            break;
+
+        case ipPROTOCOL_ICMP:
+        case ipPROTOCOL_ICMP_IPv6:
+        case ipPROTOCOL_IGMP:
+        default:
+            uxHeaderLength = 0;
+            break;
+    }
+
+    if( uxOffset + uxHeaderLength > uxEnd )
+    {
+        return;
+    }
+
+    pxMeta->usPayloadOffset = ( uint16_t ) ( uxOffset + uxHeaderLength );
+    pxMeta->usPayloadLength = ( uint16_t ) ( uxEnd - uxOffset - uxHeaderLength );
+}
+
+/**
+ * @brief Parse the headers of a frame
+ *
+ * Walks the ethernet header, up to two VLAN tags, the R-TAG of FRER streams,
+ * the IPv4 or IPv6 header and the UDP or TCP header, filling the metadata on
+ * the way. The frame is not modified. Parsing stops at the first truncated or
+ * unsupported header, the fields of the following layers are left to their
+ * default values.
+ *
+ * @param[in] pxBuf The network buffer holding the frame
+ * @param[out] pxMeta The metadata to fill
+ * @return pdPASS if at least the ethernet header could be parsed, pdFAIL
+ * otherwise
+ */
+BaseType_t xPacketParse( const NetworkBufferDescriptor_t * pxBuf,
+                         PacketMetadata_t * pxMeta )
+{
+    const uint8_t * const pucBuffer = pxBuf->pucEthernetBuffer;
+    const size_t uxLength = pxBuf->xDataLength;
+    size_t uxOffset = offsetof( EthernetHeader_t, usFrameType );
+    size_t uxEnd = uxLength;
+    uint16_t usFrameType;
+
+    memset( pxMeta, 0, sizeof( PacketMetadata_t ) );
+    pxMeta->ucPCP = parserNO_PCP;
+    pxMeta->ucDSCP = parserNO_DSCP;
+    pxMeta->ucProtocol = parserNO_PROTOCOL;
+
+    if( uxLength < ipSIZE_OF_ETH_HEADER )
+    {
+        return pdFAIL;
+    }
+
+    memcpy( &usFrameType, &pucBuffer[ uxOffset ], sizeof( usFrameType ) );
+
+    /* The outer tag of a double tagged frame is the service tag */
+    while( ( pxMeta->ucNumTags < 2U ) &&
+           ( ( usFrameType == FreeRTOS_htons( vlantagTPID_DOUBLE_TAG ) ) || ( usFrameType == FreeRTOS_htons( vlantagTPID_DEFAULT ) ) ) )
+    {
+        const struct xVLAN_TAG * pxTag = ( const struct xVLAN_TAG * ) &pucBuffer[ uxOffset ];
+
+        if( uxOffset + sizeof( struct xVLAN_TAG ) + sizeof( usFrameType ) > uxLength )
+        {
+            return pdPASS;
+        }
+
+        if( usFrameType == FreeRTOS_htons( vlantagTPID_DOUBLE_TAG ) )
+        {
+            pxMeta->usVLANSTCI = FreeRTOS_ntohs( pxTag->usTCI );
+        }
+        else
+        {
+            pxMeta->usVLANCTCI = FreeRTOS_ntohs( pxTag->usTCI );
+        }
+
+        pxMeta->ucPCP = ( uint8_t ) vlantagGET_PCP_FROM_TCI( FreeRTOS_ntohs( pxTag->usTCI ) );
+        pxMeta->ucNumTags++;
+        uxOffset += sizeof( struct xVLAN_TAG );
+        memcpy( &usFrameType, &pucBuffer[ uxOffset ], sizeof( usFrameType ) );
+    }
+
+    /* The R-TAG of FRER streams follows the VLAN tags */
+    if( ( usFrameType == FreeRTOS_htons( frerRTAG_TPID ) ) &&
+        ( uxOffset + sizeof( struct xFRER_RTAG ) + sizeof( usFrameType ) <= uxLength ) )
+    {
+        const struct xFRER_RTAG * pxRTag = ( const struct xFRER_RTAG * ) &pucBuffer[ uxOffset ];
+
+        pxMeta->usSequenceNumber = FreeRTOS_ntohs( pxRTag->usSequenceNumber );
+        pxMeta->ucHasRTag = pdTRUE;
+        uxOffset += sizeof( struct xFRER_RTAG );
+        memcpy( &usFrameType, &pucBuffer[ uxOffset ], sizeof( usFrameType ) );
+    }
+
+    pxMeta->usFrameType = usFrameType;
+    uxOffset += sizeof( usFrameType );
+    pxMeta->usL3Offset = ( uint16_t ) uxOffset;
+
+    switch( usFrameType )
+    {
+        case ipIPv4_FRAME_TYPE:
+
+            if( uxOffset + ipSIZE_OF_IPv4_HEADER > uxLength )
+            {
+                return pdPASS;
+            }
+
+            {
+                const IPHeader_t * pxIPHeader = ( const IPHeader_t * ) &pucBuffer[ uxOffset ];
+                size_t uxHeaderLength = ( size_t ) ( ( pxIPHeader->ucVersionHeaderLength & 0x0FU ) << 2 );
+
+                if( ( uxHeaderLength < ipSIZE_OF_IPv4_HEADER ) || ( uxOffset + uxHeaderLength > uxLength ) )
+                {
+                    return pdPASS;
+                }
+
+                pxMeta->ucDSCP = ( uint8_t ) diffservGET_DSCLASS_IPv4( pxIPHeader );
+                pxMeta->ucProtocol = pxIPHeader->ucProtocol;
+                uxEnd = configMIN( uxEnd, uxOffset + FreeRTOS_ntohs( pxIPHeader->usLength ) );
+                uxOffset += uxHeaderLength;
+            }
+            break;
+
+        case ipIPv6_FRAME_TYPE:
+
+            if( uxOffset + ipSIZE_OF_IPv6_HEADER > uxLength )
+            {
+                return pdPASS;
+            }
+
+            {
+                const IPHeader_IPv6_t * pxIPv6Header = ( const IPHeader_IPv6_t * ) &pucBuffer[ uxOffset ];
+
+                /* Extension headers are not supported, ucProtocol will
+                 * hold the type of the first extension header */
+                pxMeta->ucDSCP = ( uint8_t ) diffservGET_DSCLASS_IPv6( pxIPv6Header );
+                pxMeta->ucProtocol = pxIPv6Header->ucNextHeader;
+                uxOffset += ipSIZE_OF_IPv6_HEADER;
+                uxEnd = configMIN( uxEnd, uxOffset + FreeRTOS_ntohs( pxIPv6Header->usPayloadLength ) );
+            }
+            break;
+
+        default:
+            /* Frames of other EtherTypes, e.g. for raw sockets, carry
+             * their payload right after the frame type */
+            pxMeta->usPayloadOffset = ( uint16_t ) uxOffset;
+            pxMeta->usPayloadLength = ( uint16_t ) ( uxLength - uxOffset );
+            return pdPASS;
+    }
+
+    pxMeta->usL4Offset = ( uint16_t ) uxOffset;
+
+    if( uxEnd < uxOffset )
+    {
+        /* Inconsistent length in the IP header */
+        return pdPASS;
+    }
+
+    prvParseTransport( pucBuffer, uxLength, uxEnd, pxMeta );
+
+    return pdPASS;
+}
+
+/**
+ * @brief Read the IP source address of a parsed frame
+ *
+ * @param[in] pxBuf The network buffer holding the frame
+ * @param[in] pxMeta The metadata of the frame
+ * @param[out] pxAddress The source address, zeroed if the frame has no
+ * complete IP header
+ * @return pdPASS if the frame has a complete IPv4 or IPv6 header, pdFAIL
+ * otherwise
+ */
+BaseType_t xPacketGetSourceAddress( const NetworkBufferDescriptor_t * pxBuf,
+                                    const PacketMetadata_t * pxMeta,
+                                    IP_Address_t * pxAddress )
+{
+    const uint8_t * const pucIPHeader = &pxBuf->pucEthernetBuffer[ pxMeta->usL3Offset ];
+
+    memset( pxAddress, 0, sizeof( IP_Address_t ) );
+
+    /* usL4Offset is only set once the whole IP header was found */
+    if( pxMeta->usL4Offset == 0U )
+    {
+        return pdFAIL;
+    }
+
+    switch( pxMeta->usFrameType )
+    {
+        case ipIPv4_FRAME_TYPE:
+            pxAddress->ulIP_IPv4 = ( ( const IPHeader_t * ) pucIPHeader )->ulSourceIPAddress;
+            return pdPASS;
+
+        case ipIPv6_FRAME_TYPE:
+            pxAddress->xIP_IPv6 = ( ( const IPHeader_IPv6_t * ) pucIPHeader )->xSourceAddress;
+            return pdPASS;
+
+        default:
+            return pdFAIL;
+    }
+}
+
+/**
+ * @brief Remove the VLAN tags and the R-TAG from a parsed frame
+ *
+ * Only the MAC addresses are moved over the tags, then the start of the
+ * buffer is advanced past them, so the cost does not depend on the size of
+ * the frame. The offsets in the metadata are updated. The VLAN fields of the
+ * metadata are kept, so that later stages can still retrieve the tags.
+ * The buffer must get its start back with vPacketRestoreStart() before it
+ * is released or passed to Plus TCP.
+ *
+ * @param[in] pxBuf The network buffer holding the frame
+ * @param[in,out] pxMeta The metadata of the frame
+ */
+void vPacketStripTags( NetworkBufferDescriptor_t * pxBuf,
+                       PacketMetadata_t * pxMeta )
+{
+    size_t uxTagsSize;
+
+    if( pxMeta->usL3Offset <= ipSIZE_OF_ETH_HEADER )
+    {
+        return;
+    }
+
+    uxTagsSize = pxMeta->usL3Offset - ipSIZE_OF_ETH_HEADER;
+
+    memmove( &pxBuf->pucEthernetBuffer[ uxTagsSize ], pxBuf->pucEthernetBuffer, vlantagETH_TAG_OFFSET );
+
+    pxBuf->pucEthernetBuffer += uxTagsSize;
+    pxBuf->xDataLength -= uxTagsSize;
+    pxMeta->ucStrippedSize += ( uint8_t ) uxTagsSize;
+
+    pxMeta->usL3Offset -= ( uint16_t ) uxTagsSize;
+
+    if( pxMeta->usL4Offset != 0U )
+    {
+        pxMeta->usL4Offset -= ( uint16_t ) uxTagsSize;
+    }
+
+    if( pxMeta->usPayloadOffset != 0U )
+    {
+        pxMeta->usPayloadOffset -= ( uint16_t ) uxTagsSize;
+    }
+}
+
+/**
+ * @brief Give back its start to a buffer stripped by vPacketStripTags()
+ *
+ * Plus TCP and the buffer allocator find the descriptor of a buffer from its
+ * start, so this must be done before the buffer leaves the TSN layer.
+ * Frames passed to Plus TCP are moved back to the start of the buffer, which
+ * is the only case where a tagged frame is copied. Frames which are released
+ * are not moved. It does nothing if the frame was not stripped.
+ *
+ * @param[in] pxBuf The network buffer holding the frame
+ * @param[in,out] pxMeta The metadata of the frame
+ * @param[in] xMoveFrame pdTRUE to move the frame back to the start
+ */
+void vPacketRestoreStart( NetworkBufferDescriptor_t * pxBuf,
+                          PacketMetadata_t * pxMeta,
+                          BaseType_t xMoveFrame )
+{
+    const size_t uxStrippedSize = pxMeta->ucStrippedSize;
+
+    if( uxStrippedSize == 0U )
+    {
+        return;
+    }
+
+    pxBuf->pucEthernetBuffer -= uxStrippedSize;
+    pxMeta->ucStrippedSize = 0U;
+
+    if( xMoveFrame != pdFALSE )
+    {
+        memmove( pxBuf->pucEthernetBuffer, &pxBuf->pucEthernetBuffer[ uxStrippedSize ], pxBuf->xDataLength );
+    }
+    else
+    {
+        pxBuf->xDataLength += uxStrippedSize;
+    }
+}
+
+#if ( tsnconfigSELF_TEST != tsnconfigDISABLE )
+
+/** @brief A frame built by the parser self test, and the expected metadata */
+    struct xPARSER_SELF_TEST_CASE
+    {
+        uint8_t ucNumTags;        /**< 0, a customer tag, or a service and a customer tag */
+        uint8_t ucHasRTag;        /**< pdTRUE to add an R-TAG after the VLAN tags */
+        uint8_t ucIPVersion;      /**< 4 or 6 */
+        uint8_t ucExtraLength;    /**< Bytes of IPv4 options, or of an IPv6 hop-by-hop header */
+        uint16_t usL3Offset;      /**< Expected offset of the IP header */
+        uint16_t usL4Offset;      /**< Expected offset of the transport header */
+        uint16_t usPayloadOffset; /**< Expected offset of the payload */
+        uint16_t usPayloadLength; /**< Expected length of the payload */
+        uint8_t ucProtocol;       /**< Expected protocol */
+    };
+
+/**
+ * @brief Write a 16 bit value in network byte order
+ *
+ * @param[out] pucData Where the value is written
+ * @param[in] usValue The value
+ */
+    static void prvPutShort( uint8_t * pucData,
+                             uint16_t usValue )
+    {
+        pucData[ 0 ] = ( uint8_t ) ( usValue >> 8 );
+        pucData[ 1 ] = ( uint8_t ) usValue;
+    }
+
+/**
+ * @brief Build the frame of a parser self test case
+ *
+ * The frame carries a UDP datagram with 4 bytes of payload, and is padded
+ * to the minimum ethernet frame size as a driver would receive it.
+ *
+ * @param[out] pucFrame The buffer of the frame
+ * @param[in] pxCase The test case
+ * @return The length of the frame
+ */
+    static size_t prvBuildSelfTestFrame( uint8_t * pucFrame,
+                                         const struct xPARSER_SELF_TEST_CASE * pxCase )
+    {
+        const size_t uxUDPLength = ipSIZE_OF_UDP_HEADER + 4U;
+        size_t uxOffset = 2U * ipMAC_ADDRESS_LENGTH_BYTES;
+
+        if( pxCase->ucNumTags == 2U )
+        {
+            prvPutShort( &pucFrame[ uxOffset ], vlantagTPID_DOUBLE_TAG );
+            prvPutShort( &pucFrame[ uxOffset + 2U ], 0x2005U ); /* PCP 1, VID 5 */
+            uxOffset += sizeof( struct xVLAN_TAG );
+        }
+
+        if( pxCase->ucNumTags >= 1U )
+        {
+            prvPutShort( &pucFrame[ uxOffset ], vlantagTPID_DEFAULT );
+            prvPutShort( &pucFrame[ uxOffset + 2U ], 0xA00AU ); /* PCP 5, VID 10 */
+            uxOffset += sizeof( struct xVLAN_TAG );
+        }
+
+        if( pxCase->ucHasRTag != pdFALSE )
+        {
+            prvPutShort( &pucFrame[ uxOffset ], frerRTAG_TPID );
+            prvPutShort( &pucFrame[ uxOffset + 4U ], 0x1234U );
+            uxOffset += sizeof( struct xFRER_RTAG );
+        }
+
+        if( pxCase->ucIPVersion == 4U )
+        {
+            const size_t uxHeaderLength = ipSIZE_OF_IPv4_HEADER + pxCase->ucExtraLength;
+
+            prvPutShort( &pucFrame[ uxOffset ], 0x0800U );
+            uxOffset += 2U;
+            pucFrame[ uxOffset ] = ( uint8_t ) ( 0x40U | ( uxHeaderLength >> 2 ) );
+            prvPutShort( &pucFrame[ uxOffset + offsetof( IPHeader_t, usLength ) ], ( uint16_t ) ( uxHeaderLength + uxUDPLength ) );
+            pucFrame[ uxOffset + offsetof( IPHeader_t, ucProtocol ) ] = ipPROTOCOL_UDP;
+            uxOffset += uxHeaderLength;
+        }
+        else
+        {
+            prvPutShort( &pucFrame[ uxOffset ], 0x86DDU );
+            uxOffset += 2U;
+            pucFrame[ uxOffset ] = 0x60U;
+            prvPutShort( &pucFrame[ uxOffset + offsetof( IPHeader_IPv6_t, usPayloadLength ) ], ( uint16_t ) ( pxCase->ucExtraLength + uxUDPLength ) );
+            pucFrame[ uxOffset + offsetof( IPHeader_IPv6_t, ucNextHeader ) ] = ( pxCase->ucExtraLength != 0U ) ? 0U : ipPROTOCOL_UDP;
+            uxOffset += ipSIZE_OF_IPv6_HEADER;
+
+            if( pxCase->ucExtraLength != 0U )
+            {
+                /* Hop-by-hop options header of 8 bytes, then UDP */
+                pucFrame[ uxOffset ] = ipPROTOCOL_UDP;
+                uxOffset += pxCase->ucExtraLength;
+            }
+        }
+
+        prvPutShort( &pucFrame[ uxOffset ], 0x1111U );
+        prvPutShort( &pucFrame[ uxOffset + 2U ], 0x2222U );
+        prvPutShort( &pucFrame[ uxOffset + 4U ], ( uint16_t ) uxUDPLength );
+        uxOffset += uxUDPLength;
+
+        return configMAX( uxOffset, 60U );
+    }
+
+/**
+ * @brief Check the offsets found by the parser
+ *
+ * Parses frames with no tag, a customer tag, a service and a customer tag
+ * (QinQ), and an R-TAG after them, carrying UDP over IPv4 with and without
+ * options, and over IPv6. The payload length must ignore the padding of
+ * short frames. IPv6 extension headers are not parsed: the protocol is the
+ * type of the first extension header, and the transport offsets stop at the
+ * fixed header. Every frame is then stripped of its tags, and its start
+ * restored.
+ *
+ * @return pdPASS if the metadata is as expected, pdFAIL otherwise
+ */
+    BaseType_t xPacketSelfTest( void )
+    {
+        static const struct xPARSER_SELF_TEST_CASE xCases[] =
+        {
+            /* Tags, R-TAG, IP, extra, L3, L4, payload, length, protocol */
+            { 0U, pdFALSE, 4U, 0U, 14U, 34U, 42U, 4U,  ipPROTOCOL_UDP },
+            { 1U, pdFALSE, 4U, 4U, 18U, 42U, 50U, 4U,  ipPROTOCOL_UDP },
+            { 2U, pdFALSE, 6U, 0U, 22U, 62U, 70U, 4U,  ipPROTOCOL_UDP },
+            { 2U, pdTRUE,  4U, 0U, 28U, 48U, 56U, 4U,  ipPROTOCOL_UDP },
+            { 1U, pdFALSE, 6U, 8U, 18U, 58U, 58U, 20U, 0U             }
+        };
+        static uint8_t ucFrame[ 128 ];
+        NetworkBufferDescriptor_t xBuf;
+        PacketMetadata_t xMeta;
+
+        for( size_t uxIndex = 0; uxIndex < sizeof( xCases ) / sizeof( xCases[ 0 ] ); ++uxIndex )
+        {
+            const struct xPARSER_SELF_TEST_CASE * pxCase = &xCases[ uxIndex ];
+            const uint16_t usPort = ( pxCase->ucProtocol == ipPROTOCOL_UDP ) ? FreeRTOS_htons( 0x2222U ) : 0U;
+            const size_t uxTagsSize = ( size_t ) ( pxCase->usL3Offset - ipSIZE_OF_ETH_HEADER );
+
+            memset( ucFrame, 0, sizeof( ucFrame ) );
+            memset( &xBuf, 0, sizeof( xBuf ) );
+            xBuf.pucEthernetBuffer = ucFrame;
+            xBuf.xDataLength = prvBuildSelfTestFrame( ucFrame, pxCase );
+
+            if( ( xPacketParse( &xBuf, &xMeta ) != pdPASS ) ||
+                ( xMeta.ucNumTags != pxCase->ucNumTags ) ||
+                ( xMeta.ucHasRTag != pxCase->ucHasRTag ) ||
+                ( xMeta.usFrameType != ( ( pxCase->ucIPVersion == 4U ) ? ipIPv4_FRAME_TYPE : ipIPv6_FRAME_TYPE ) ) ||
+                ( xMeta.usL3Offset != pxCase->usL3Offset ) ||
+                ( xMeta.usL4Offset != pxCase->usL4Offset ) ||
+                ( xMeta.usPayloadOffset != pxCase->usPayloadOffset ) ||
+                ( xMeta.usPayloadLength != pxCase->usPayloadLength ) ||
+                ( xMeta.ucProtocol != pxCase->ucProtocol ) ||
+                ( xMeta.usDestinationPort != usPort ) )
+            {
+                return pdFAIL;
+            }
+
+            if( ( xMeta.ucPCP != ( ( pxCase->ucNumTags != 0U ) ? 5U : parserNO_PCP ) ) ||
+                ( xMeta.usVLANCTCI != ( ( pxCase->ucNumTags != 0U ) ? 0xA00AU : 0U ) ) ||
+                ( xMeta.usVLANSTCI != ( ( pxCase->ucNumTags == 2U ) ? 0x2005U : 0U ) ) ||
+                ( xMeta.usSequenceNumber != ( ( pxCase->ucHasRTag != pdFALSE ) ? 0x1234U : 0U ) ) )
+            {
+                return pdFAIL;
+            }
+
+            vPacketStripTags( &xBuf, &xMeta );
+
+            if( ( xBuf.pucEthernetBuffer != &ucFrame[ uxTagsSize ] ) ||
+                ( xMeta.usL3Offset != ipSIZE_OF_ETH_HEADER ) ||
+                ( xMeta.usL4Offset != pxCase->usL4Offset - uxTagsSize ) ||
+                ( xMeta.usPayloadOffset != pxCase->usPayloadOffset - uxTagsSize ) ||
+                ( ( xBuf.pucEthernetBuffer[ ipSIZE_OF_ETH_HEADER ] >> 4 ) != pxCase->ucIPVersion ) )
+            {
+                return pdFAIL;
+            }
+
+            vPacketRestoreStart( &xBuf, &xMeta, pdFALSE );
+
+            if( ( xBuf.pucEthernetBuffer != ucFrame ) || ( xMeta.ucStrippedSize != 0U ) )
+            {
+                return pdFAIL;
+            }
+        }
+
+        return pdPASS;
+    }
+
+#endif /* if ( tsnconfigSELF_TEST != tsnconfigDISABLE ) */
+
@@ -0,0 +1,253 @@
+/**
+ * @file FreeRTOS_TSN_SharedBuffer.c
+ * @brief Reference counted network buffers
+ *
+ * A received frame delivered to several sockets is not copied: each extra
+ * receiver gets a reference, which is a network buffer descriptor taken from
+ * a static pool and pointing to the ethernet buffer of the original
+ * descriptor. The frame is read-only while shared. Per-receiver information,
+ * such as the address and the tags of the frame, is kept in the ancillary
+ * message of each receiver. The original descriptor is given back to Plus
+ * TCP when its last reference is released with vSharedBufferRelease().
+ *
+ * References must never reach Plus TCP or the network drivers, which would
+ * release them as their own descriptors, so they are only delivered to TSN
+ * sockets.
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "FreeRTOS_IP.h"
+
+#include "FreeRTOS_TSN_SharedBuffer.h"
+
+#if ( tsnconfigSHARED_BUFFER_POOL_SIZE > 0 )
+
+/** @brief A frame with outstanding references */
+    struct xSHARED_FRAME
+    {
+        NetworkBufferDescriptor_t * pxOrigin; /**< Descriptor owning the ethernet buffer, NULL if the record is free */
+        UBaseType_t uxReferences;             /**< References in use */
+        UBaseType_t uxOriginHolders;          /**< Holders of the original descriptor, see vSharedBufferLoan() */
+    };
+
+/** @brief A reference to a shared frame
+ *
+ * The descriptor is the first member, so that a pointer to the descriptor
+ * is a pointer to the reference. Whether a descriptor is a reference is told
+ * by its address.
+ */
+    struct xSHARED_REFERENCE
+    {
+        NetworkBufferDescriptor_t xDescriptor;  /**< Descriptor handed to the receiver */
+        struct xSHARED_FRAME * pxFrame;         /**< The frame referenced */
+        struct xSHARED_REFERENCE * pxNextFree;  /**< Next free reference, while in the pool */
+    };
+
+    static struct xSHARED_FRAME xSharedFrames[ tsnconfigSHARED_BUFFER_POOL_SIZE ];
+
+    static struct xSHARED_REFERENCE xSharedReferences[ tsnconfigSHARED_BUFFER_POOL_SIZE ];
+
+    static struct xSHARED_REFERENCE * pxSharedFreeList = NULL;
+
+    static BaseType_t xSharedPoolInitialised = pdFALSE;
+
+/* Number of frames in xSharedFrames, so that releasing a buffer which was
+ * never shared does not look up the table */
+    static UBaseType_t uxSharedFrameCount = 0U;
+
+    #define sharedbufferIS_REFERENCE( pxBuf )                                                                 \
+    ( ( ( const struct xSHARED_REFERENCE * ) ( pxBuf ) >= &xSharedReferences[ 0 ] ) &&                     \
+      ( ( const struct xSHARED_REFERENCE * ) ( pxBuf ) < &xSharedReferences[ tsnconfigSHARED_BUFFER_POOL_SIZE ] ) )
+
+/**
+ * @brief Find the record of a frame
+ *
+ * Must be called in a critical section.
+ *
+ * @param pxOrigin The original descriptor of the frame, or NULL for a free record
+ * @return The record, or NULL if not found
+ */
+    static struct xSHARED_FRAME * prvFindFrame( const NetworkBufferDescriptor_t * pxOrigin )
+    {
+        for( size_t uxIndex = 0; uxIndex < tsnconfigSHARED_BUFFER_POOL_SIZE; ++uxIndex )
+        {
+            if( xSharedFrames[ uxIndex ].pxOrigin == pxOrigin )
+            {
+                return &xSharedFrames[ uxIndex ];
+            }
+        }
+
+        return NULL;
+    }
+
+/**
+ * @brief Free the record of a frame if it is no longer shared
+ *
+ * Must be called in a critical section, after the counters of the frame
+ * changed.
+ *
+ * @param pxFrame The record of the frame
+ * @return The original descriptor if nobody holds the frame anymore, NULL
+ * otherwise
+ */
+    static NetworkBufferDescriptor_t * prvFrameUpdate( struct xSHARED_FRAME * pxFrame )
+    {
+        NetworkBufferDescriptor_t * pxOrigin = pxFrame->pxOrigin;
+
+        /* A single holder of the original descriptor owns it again */
+        if( ( pxFrame->uxReferences > 0U ) || ( pxFrame->uxOriginHolders > 1U ) )
+        {
+            return NULL;
+        }
+
+        pxFrame->pxOrigin = NULL;
+        uxSharedFrameCount--;
+
+        return ( pxFrame->uxOriginHolders == 0U ) ? pxOrigin : NULL;
+    }
+
+/**
+ * @brief Take a reference to a frame
+ *
+ * The new descriptor points to the same ethernet buffer and carries the same
+ * fields as pxBuf, except for its list item. It must be taken before pxBuf is
+ * queued in a socket, which replaces its ethernet buffer pointer.
+ *
+ * @param pxBuf The frame, either its original descriptor or a reference
+ * @return The reference, or NULL if the pool is exhausted
+ */
+    NetworkBufferDescriptor_t * pxSharedBufferRetain( NetworkBufferDescriptor_t * pxBuf )
+    {
+        struct xSHARED_REFERENCE * pxReference;
+        struct xSHARED_FRAME * pxFrame = NULL;
+
+        taskENTER_CRITICAL();
+        {
+            if( xSharedPoolInitialised == pdFALSE )
+            {
+                for( size_t uxIndex = 0; uxIndex < tsnconfigSHARED_BUFFER_POOL_SIZE; ++uxIndex )
+                {
+                    xSharedReferences[ uxIndex ].pxNextFree = pxSharedFreeList;
+                    pxSharedFreeList = &xSharedReferences[ uxIndex ];
+                }
+
+                xSharedPoolInitialised = pdTRUE;
+            }
+
+            pxReference = pxSharedFreeList;
+
+            if( pxReference != NULL )
+            {
+                if( sharedbufferIS_REFERENCE( pxBuf ) )
+                {
+                    pxFrame = ( ( struct xSHARED_REFERENCE * ) pxBuf )->pxFrame;
+                }
+                else if( ( uxSharedFrameCount == 0U ) || ( ( pxFrame = prvFindFrame( pxBuf ) ) == NULL ) )
+                {
+                    pxFrame = prvFindFrame( NULL );
+
+                    if( pxFrame != NULL )
+                    {
+                        pxFrame->pxOrigin = pxBuf;
+                        pxFrame->uxReferences = 0U;
+                        pxFrame->uxOriginHolders = 1U;
+                        uxSharedFrameCount++;
+                    }
+                }
+            }
+
+            if( pxFrame != NULL )
+            {
+                pxSharedFreeList = pxReference->pxNextFree;
+                pxReference->pxFrame = pxFrame;
+                pxFrame->uxReferences++;
+            }
+        }
+        taskEXIT_CRITICAL();
+
+        if( pxFrame == NULL )
+        {
+            return NULL;
+        }
+
+        pxReference->xDescriptor = *pxBuf;
+        vListInitialiseItem( &( pxReference->xDescriptor.xBufferListItem ) );
+        listSET_LIST_ITEM_OWNER( &( pxReference->xDescriptor.xBufferListItem ), &( pxReference->xDescriptor ) );
+
+        return &( pxReference->xDescriptor );
+    }
+
+/**
+ * @brief Release a received network buffer, which may be shared
+ *
+ * Used in place of vReleaseNetworkBufferAndDescriptor() by the receivers of
+ * the frames. The frame is given back to Plus TCP with its last reference.
+ *
+ * @param pxBuf The original descriptor of a frame, or a reference to it
+ */
+    void vSharedBufferRelease( NetworkBufferDescriptor_t * pxBuf )
+    {
+        NetworkBufferDescriptor_t * pxRelease = pxBuf;
+        struct xSHARED_FRAME * pxFrame;
+
+        taskENTER_CRITICAL();
+        {
+            if( sharedbufferIS_REFERENCE( pxBuf ) )
+            {
+                struct xSHARED_REFERENCE * const pxReference = ( struct xSHARED_REFERENCE * ) pxBuf;
+
+                pxFrame = pxReference->pxFrame;
+                pxReference->pxNextFree = pxSharedFreeList;
+                pxSharedFreeList = pxReference;
+
+                pxFrame->uxReferences--;
+                pxRelease = prvFrameUpdate( pxFrame );
+            }
+            else if( ( uxSharedFrameCount > 0U ) && ( ( pxFrame = prvFindFrame( pxBuf ) ) != NULL ) )
+            {
+                pxFrame->uxOriginHolders--;
+                pxRelease = prvFrameUpdate( pxFrame );
+            }
+        }
+        taskEXIT_CRITICAL();
+
+        if( pxRelease != NULL )
+        {
+            vReleaseNetworkBufferAndDescriptor( pxRelease );
+        }
+    }
+
+/**
+ * @brief Turn a reference into a hold on the original descriptor
+ *
+ * Zero copy receive calls loan the payload to the application, which gives
+ * it back with FreeRTOS_TSN_ReleaseUDPPayloadBuffer(). That function can only
+ * find the original descriptor from the payload, so the reference is given
+ * back to the pool now and the frame is kept through its original
+ * descriptor. Other descriptors are left as they are.
+ *
+ * @param pxBuf The descriptor whose payload is loaned
+ */
+    void vSharedBufferLoan( NetworkBufferDescriptor_t * pxBuf )
+    {
+        if( sharedbufferIS_REFERENCE( pxBuf ) )
+        {
+            struct xSHARED_REFERENCE * const pxReference = ( struct xSHARED_REFERENCE * ) pxBuf;
+
+            taskENTER_CRITICAL();
+            {
+                pxReference->pxFrame->uxReferences--;
+                pxReference->pxFrame->uxOriginHolders++;
+                pxReference->pxNextFree = pxSharedFreeList;
+                pxSharedFreeList = pxReference;
+
+                /* Never releases the frame, which is held by the application */
+                ( void ) prvFrameUpdate( pxReference->pxFrame );
+            }
+            taskEXIT_CRITICAL();
+        }
+    }
+
+#endif /* if ( tsnconfigSHARED_BUFFER_POOL_SIZE > 0 ) */
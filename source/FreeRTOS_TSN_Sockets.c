@@ -16,30 +16,381 @@
 #include "FreeRTOS_IP_Private.h"
 #include "FreeRTOS_ARP.h"
 
+#if ( ipconfigUSE_IPv6 != 0 )
+    #include "FreeRTOS_ND.h"
+#endif
+
 #include "FreeRTOS_TSN_Sockets.h"
 #include "FreeRTOS_TSN_NetworkScheduler.h"
 #include "FreeRTOS_TSN_VLANTags.h"
 #include "FreeRTOS_TSN_DS.h"
+#include "FreeRTOS_TSN_Parser.h"
+#include "FreeRTOS_TSN_Checksum.h"
+#include "FreeRTOS_TSN_ARP.h"
+#include "FreeRTOS_TSN_SharedBuffer.h"
+#include "FreeRTOS_TSN_FRER.h"
+#include "NetworkWrapper.h"
 
 /* private definitions from FreeRTOS_Sockets.c */
 #define tsnsocketSET_SOCKET_PORT( pxSocket, usPort )    listSET_LIST_ITEM_VALUE( ( &( ( pxSocket )->xBoundSocketListItem ) ), ( usPort ) )
 #define tsnsocketGET_SOCKET_PORT( pxSocket )            listGET_LIST_ITEM_VALUE( ( &( ( pxSocket )->xBoundSocketListItem ) ) )
 #define tsnsocketSOCKET_IS_BOUND( pxSocket )            ( listLIST_ITEM_CONTAINER( &( pxSocket )->xBoundSocketListItem ) != NULL )
 
+/* TPIDs of the tags removed from the received frames before they reach the
+ * sockets, which raw sockets cannot bind to. usFrameType is in network byte
+ * order. */
+#define tsnsocketIS_TAG_TPID( usFrameType )                            \
+    ( ( ( usFrameType ) == FreeRTOS_htons( vlantagTPID_DEFAULT ) ) ||    \
+      ( ( usFrameType ) == FreeRTOS_htons( vlantagTPID_DOUBLE_TAG ) ) || \
+      ( ( usFrameType ) == FreeRTOS_htons( frerRTAG_TPID ) ) )
+
 /* @brief List of bound TSN sockets
  *
  * TSN sockets are stored with key their port, in network byte order. Note that
  * TSN sockets are listed here, and their underlining Plus TCP sockets are also
- * listed in xBoundSocketListItem inside Plus TCP.
+ * listed in xBoundSocketListItem inside Plus TCP. The controllers walk the
+ * list to invalidate the header templates, it is changed in a critical
+ * section.
  */
 static List_t xTSNBoundUDPSocketList;
 
+/* @brief List of bound raw TSN sockets
+ *
+ * Raw sockets are stored with key their EtherType, in network byte order.
+ * Their Plus TCP sockets are never bound, and only hold the list of the
+ * received packets. The list is walked by the controllers and changed by
+ * the application tasks, always in a critical section.
+ */
+static List_t xTSNBoundRawSocketList;
+
+/* @brief Incremented every time a TSN socket is unbound
+ *
+ * Socket pointers cached in the packet metadata are only valid if they were
+ * looked up in the current generation. 0 is never used, so that a zeroed
+ * metadata is never valid.
+ */
+static volatile UBaseType_t uxTSNSocketGeneration = 1U;
+
+#if ( tsnconfigSOCKET_TEMPLATE_REVALIDATE_MS > 0 )
+    #define tsnsocketDROP_TEMPLATE( pxSocket )    ( ( pxSocket )->xTemplate.ucLength = 0U )
+#else
+    #define tsnsocketDROP_TEMPLATE( pxSocket )    do {} while( 0 )
+#endif
+
+#if ( tsnconfigSOCKET_HASH_SIZE > 0 )
+
+    #define tsnsocketHASH_MASK    ( tsnconfigSOCKET_HASH_SIZE - 1U )
+    #define tsnsocketHASH( usPort )    ( ( UBaseType_t ) ( ( ( uint32_t ) ( usPort ) * 2654435761UL ) >> 16 ) & tsnsocketHASH_MASK )
+
+/* @brief Index of xTSNBoundUDPSocketList by port
+ *
+ * Open addressing with linear probing. Removals shift back the following
+ * entries of the cluster, so that no tombstones are needed. If a socket
+ * cannot be inserted because the table is full, xTSNSocketHashOverflow is
+ * set and the lookups which miss the table scan the list as well.
+ */
+    static FreeRTOS_TSN_Socket_t * pxTSNSocketHash[ tsnconfigSOCKET_HASH_SIZE ];
+
+    static BaseType_t xTSNSocketHashOverflow = pdFALSE;
+
+/**
+ * @brief Insert a bound socket in the hash table. Call in a critical section.
+ *
+ * @param pxSocket The socket to insert, its port must already be set
+ * @return pdPASS if the socket is inserted, pdFAIL if the table is full
+ */
+    static BaseType_t prvSocketHashInsert( FreeRTOS_TSN_Socket_t * pxSocket )
+    {
+        UBaseType_t uxIndex = tsnsocketHASH( tsnsocketGET_SOCKET_PORT( pxSocket ) );
+
+        for( UBaseType_t uxProbe = 0; uxProbe < tsnconfigSOCKET_HASH_SIZE; ++uxProbe )
+        {
+            if( pxTSNSocketHash[ uxIndex ] == NULL )
+            {
+                pxTSNSocketHash[ uxIndex ] = pxSocket;
+                return pdPASS;
+            }
+
+            uxIndex = ( uxIndex + 1U ) & tsnsocketHASH_MASK;
+        }
+
+        return pdFAIL;
+    }
+
+/**
+ * @brief Remove a socket from the hash table. Call in a critical section.
+ *
+ * @param pxSocket The socket to remove
+ */
+    static void prvSocketHashRemove( FreeRTOS_TSN_Socket_t * pxSocket )
+    {
+        UBaseType_t uxHole = tsnsocketHASH( tsnsocketGET_SOCKET_PORT( pxSocket ) );
+        UBaseType_t uxNext, uxHome;
+        UBaseType_t uxProbe;
+
+        for( uxProbe = 0; uxProbe < tsnconfigSOCKET_HASH_SIZE; ++uxProbe )
+        {
+            if( pxTSNSocketHash[ uxHole ] == pxSocket )
+            {
+                break;
+            }
+
+            if( pxTSNSocketHash[ uxHole ] == NULL )
+            {
+                /* Not in the table, it was inserted while full */
+                return;
+            }
+
+            uxHole = ( uxHole + 1U ) & tsnsocketHASH_MASK;
+        }
+
+        if( uxProbe == tsnconfigSOCKET_HASH_SIZE )
+        {
+            return;
+        }
+
+        /* Move back the entries that would become unreachable */
+        uxNext = uxHole;
+
+        for( ; ; )
+        {
+            uxNext = ( uxNext + 1U ) & tsnsocketHASH_MASK;
+
+            if( ( pxTSNSocketHash[ uxNext ] == NULL ) || ( uxNext == uxHole ) )
+            {
+                break;
+            }
+
+            uxHome = tsnsocketHASH( tsnsocketGET_SOCKET_PORT( pxTSNSocketHash[ uxNext ] ) );
+
+            if( ( uxHole < uxNext ) ? ( ( uxHome <= uxHole ) || ( uxHome > uxNext ) )
+                                    : ( ( uxHome <= uxHole ) && ( uxHome > uxNext ) ) )
+            {
+                pxTSNSocketHash[ uxHole ] = pxTSNSocketHash[ uxNext ];
+                uxHole = uxNext;
+            }
+        }
+
+        pxTSNSocketHash[ uxHole ] = NULL;
+    }
+
+/**
+ * @brief Find a socket in the hash table. Call in a critical section.
+ *
+ * @param xPort The bound port, in network byte order
+ * @return The socket, or NULL if the port is not in the table
+ */
+    static FreeRTOS_TSN_Socket_t * prvSocketHashFind( TickType_t xPort )
+    {
+        UBaseType_t uxIndex = tsnsocketHASH( xPort );
+        FreeRTOS_TSN_Socket_t * pxSocket;
+
+        for( UBaseType_t uxProbe = 0; uxProbe < tsnconfigSOCKET_HASH_SIZE; ++uxProbe )
+        {
+            pxSocket = pxTSNSocketHash[ uxIndex ];
+
+            if( pxSocket == NULL )
+            {
+                break;
+            }
+
+            if( tsnsocketGET_SOCKET_PORT( pxSocket ) == xPort )
+            {
+                return pxSocket;
+            }
+
+            uxIndex = ( uxIndex + 1U ) & tsnsocketHASH_MASK;
+        }
+
+        return NULL;
+    }
+
+    #if ( tsnconfigSELF_TEST != tsnconfigDISABLE )
+
+/**
+ * @brief Find a port whose home slot in the hash table is given
+ *
+ * @param[in] uxHome The home slot
+ * @param[in] usAfter The port to start the search after
+ * @return The first port after usAfter with that home slot
+ */
+        static uint16_t prvSocketHashPortFor( UBaseType_t uxHome,
+                                              uint16_t usAfter )
+        {
+            uint16_t usPort = usAfter;
+
+            do
+            {
+                usPort++;
+            } while( tsnsocketHASH( usPort ) != uxHome );
+
+            return usPort;
+        }
+
+/**
+ * @brief Count the sockets found in the hash table by their port
+ *
+ * @param[in] pxSockets The sockets
+ * @param[in] uxCount The number of sockets
+ * @return The number of sockets which prvSocketHashFind() returns
+ */
+        static UBaseType_t prvSocketHashCountFound( FreeRTOS_TSN_Socket_t * pxSockets,
+                                                    UBaseType_t uxCount )
+        {
+            UBaseType_t uxFound = 0U;
+
+            for( UBaseType_t uxIndex = 0; uxIndex < uxCount; ++uxIndex )
+            {
+                if( prvSocketHashFind( tsnsocketGET_SOCKET_PORT( &pxSockets[ uxIndex ] ) ) == &pxSockets[ uxIndex ] )
+                {
+                    uxFound++;
+                }
+            }
+
+            return uxFound;
+        }
+
+/**
+ * @brief Check the collision chains of the hash table
+ *
+ * Builds a cluster which wraps around the end of the table, with three
+ * sockets sharing the last slot and two sockets whose home slots are taken
+ * by the cluster, then removes them from the head, the middle and the tail
+ * of the cluster: after every backward shift all the remaining sockets
+ * must still be found. Also fills the table to check that a full table
+ * rejects insertions and ignores the removal of a socket it does not hold.
+ * The table of the bound sockets is saved and restored around the test,
+ * in a critical section. Tables of fewer than 8 slots are not checked.
+ *
+ * @return pdPASS if the table behaves as expected, pdFAIL otherwise
+ */
+        BaseType_t xSocketHashSelfTest( void )
+        {
+            #if ( tsnconfigSOCKET_HASH_SIZE < 8 )
+                return pdPASS;
+            #else
+            static FreeRTOS_TSN_Socket_t xSockets[ 6 ];
+            static FreeRTOS_TSN_Socket_t * pxSaved[ tsnconfigSOCKET_HASH_SIZE ];
+            FreeRTOS_TSN_Socket_t * const pxExtra = &xSockets[ 5 ];
+            BaseType_t xReturn = pdPASS;
+            uint16_t usPort = 0U;
+
+            memset( xSockets, 0, sizeof( xSockets ) );
+
+            /* 0-2 share the last slot, 3 belongs to slot 0 and 4 to slot 1 */
+            for( UBaseType_t uxIndex = 0; uxIndex < 3U; ++uxIndex )
+            {
+                usPort = prvSocketHashPortFor( tsnsocketHASH_MASK, usPort );
+                tsnsocketSET_SOCKET_PORT( &xSockets[ uxIndex ], usPort );
+            }
+
+            tsnsocketSET_SOCKET_PORT( &xSockets[ 3 ], prvSocketHashPortFor( 0U, 0U ) );
+            tsnsocketSET_SOCKET_PORT( &xSockets[ 4 ], prvSocketHashPortFor( 1U, 0U ) );
+
+            /* Not inserted, it must end the probes at the end of the cluster */
+            tsnsocketSET_SOCKET_PORT( pxExtra, prvSocketHashPortFor( tsnsocketHASH_MASK, usPort ) );
+
+            taskENTER_CRITICAL();
+            {
+                memcpy( pxSaved, pxTSNSocketHash, sizeof( pxSaved ) );
+                memset( pxTSNSocketHash, 0, sizeof( pxTSNSocketHash ) );
+
+                for( UBaseType_t uxIndex = 0; uxIndex < 5U; ++uxIndex )
+                {
+                    ( void ) prvSocketHashInsert( &xSockets[ uxIndex ] );
+                }
+
+                if( ( prvSocketHashCountFound( xSockets, 5U ) != 5U ) ||
+                    ( pxTSNSocketHash[ 3 ] != &xSockets[ 4 ] ) ||
+                    ( prvSocketHashFind( tsnsocketGET_SOCKET_PORT( pxExtra ) ) != NULL ) )
+                {
+                    xReturn = pdFAIL;
+                }
+
+                /* Head of the cluster: everything after it shifts back */
+                prvSocketHashRemove( &xSockets[ 0 ] );
+
+                if( ( prvSocketHashCountFound( &xSockets[ 1 ], 4U ) != 4U ) ||
+                    ( prvSocketHashFind( tsnsocketGET_SOCKET_PORT( &xSockets[ 0 ] ) ) != NULL ) ||
+                    ( pxTSNSocketHash[ 3 ] != NULL ) )
+                {
+                    xReturn = pdFAIL;
+                }
+
+                /* Middle of the cluster, across the end of the table */
+                prvSocketHashRemove( &xSockets[ 2 ] );
+
+                if( ( prvSocketHashFind( tsnsocketGET_SOCKET_PORT( &xSockets[ 1 ] ) ) != &xSockets[ 1 ] ) ||
+                    ( prvSocketHashCountFound( &xSockets[ 3 ], 2U ) != 2U ) ||
+                    ( prvSocketHashFind( tsnsocketGET_SOCKET_PORT( &xSockets[ 2 ] ) ) != NULL ) )
+                {
+                    xReturn = pdFAIL;
+                }
+
+                /* Tail of the cluster, then the rest */
+                prvSocketHashRemove( &xSockets[ 4 ] );
+                prvSocketHashRemove( &xSockets[ 1 ] );
+
+                if( prvSocketHashFind( tsnsocketGET_SOCKET_PORT( &xSockets[ 3 ] ) ) != &xSockets[ 3 ] )
+                {
+                    xReturn = pdFAIL;
+                }
+
+                prvSocketHashRemove( &xSockets[ 3 ] );
+
+                for( UBaseType_t uxIndex = 0; uxIndex < tsnconfigSOCKET_HASH_SIZE; ++uxIndex )
+                {
+                    if( pxTSNSocketHash[ uxIndex ] != NULL )
+                    {
+                        xReturn = pdFAIL;
+                    }
+                }
+
+                /* A full table */
+                for( UBaseType_t uxIndex = 0; uxIndex < tsnconfigSOCKET_HASH_SIZE; ++uxIndex )
+                {
+                    ( void ) prvSocketHashInsert( &xSockets[ 0 ] );
+                }
+
+                prvSocketHashRemove( pxExtra );
+
+                if( ( prvSocketHashInsert( pxExtra ) != pdFAIL ) ||
+                    ( prvSocketHashFind( tsnsocketGET_SOCKET_PORT( pxExtra ) ) != NULL ) )
+                {
+                    xReturn = pdFAIL;
+                }
+
+                for( UBaseType_t uxIndex = 0; uxIndex < tsnconfigSOCKET_HASH_SIZE; ++uxIndex )
+                {
+                    if( pxTSNSocketHash[ uxIndex ] != &xSockets[ 0 ] )
+                    {
+                        xReturn = pdFAIL;
+                    }
+                }
+
+                memcpy( pxTSNSocketHash, pxSaved, sizeof( pxSaved ) );
+            }
+            taskEXIT_CRITICAL();
+
+            return xReturn;
+            #endif /* if ( tsnconfigSOCKET_HASH_SIZE < 8 ) */
+        }
+
+    #endif /* if ( tsnconfigSELF_TEST != tsnconfigDISABLE ) */
+
+#endif /* if ( tsnconfigSOCKET_HASH_SIZE > 0 ) */
+
 void vInitialiseTSNSockets()
 {
     if( !listLIST_IS_INITIALISED( &xTSNBoundUDPSocketList ) )
     {
         vListInitialise( &xTSNBoundUDPSocketList );
     }
+
+    if( !listLIST_IS_INITIALISED( &xTSNBoundRawSocketList ) )
+    {
+        vListInitialise( &xTSNBoundRawSocketList );
+    }
 }
 
 BaseType_t xSocketErrorQueueInsert( TSNSocket_t xTSNSocket,
@@ -76,6 +427,34 @@ void vSocketFromPort( TickType_t xSearchKey,
         return;
     }
 
+    #if ( tsnconfigSOCKET_HASH_SIZE > 0 )
+    {
+        FreeRTOS_TSN_Socket_t * pxFound;
+        BaseType_t xOverflow;
+
+        taskENTER_CRITICAL();
+        {
+            pxFound = prvSocketHashFind( xSearchKey );
+            xOverflow = xTSNSocketHashOverflow;
+        }
+        taskEXIT_CRITICAL();
+
+        if( pxFound != NULL )
+        {
+            *ppxTSNSocket = pxFound;
+            *ppxBaseSocket = pxFound->xBaseSocket;
+            return;
+        }
+
+        if( xOverflow == pdFALSE )
+        {
+            *ppxBaseSocket = pxUDPSocketLookup( xSearchKey );
+            *ppxTSNSocket = NULL;
+            return;
+        }
+    }
+    #endif /* if ( tsnconfigSOCKET_HASH_SIZE > 0 ) */
+
     const ListItem_t * pxEnd = ( ( const ListItem_t * ) &( xTSNBoundUDPSocketList.xListEnd ) );
 
     // Iterate through the TSN bound UDP socket list
@@ -99,627 +478,2753 @@ void vSocketFromPort( TickType_t xSearchKey,
 }
 
 /**
- * @brief Prepare a buffer for sending UDPv4 packets.
+ * @brief Find the raw socket receiving the frames of an EtherType and VID
  *
- * This function prepares a buffer for sending UDPv4 packets. It sets the necessary headers,
- * including Ethernet, IP, and UDP headers, and performs ARP cache lookup to obtain the
- * destination MAC address.
+ * A socket bound to the VID of the frame is preferred to a socket bound to
+ * FREERTOS_TSN_ANY_VID. Untagged frames have VID 0.
  *
- * @param pxSocket The TSN socket.
- * @param pxBuf The network buffer descriptor.
- * @param xFlags The flags for the send operation.
- * @param pxDestinationAddress The destination address.
- * @param xDestinationAddressLength The length of the destination address.
- * @return pdPASS if the buffer is prepared successfully, pdFAIL otherwise.
+ * Must be called in a critical section.
+ *
+ * @param usEtherType The EtherType, in network byte order
+ * @param usVID The VID of the frame, or FREERTOS_TSN_ANY_VID
+ * @return The socket, or NULL if no socket is bound to the EtherType
  */
-BaseType_t prvPrepareBufferUDPv4( FreeRTOS_TSN_Socket_t * pxSocket,
-                                  NetworkBufferDescriptor_t * pxBuf,
-                                  BaseType_t xFlags,
-                                  const struct freertos_sockaddr * pxDestinationAddress,
-                                  BaseType_t xDestinationAddressLength )
+static FreeRTOS_TSN_Socket_t * prvRawSocketFind( uint16_t usEtherType,
+                                                 uint16_t usVID )
 {
-    EthernetHeader_t * pxEthernetHeader;
-    IPHeader_t * pxIPHeader;
-    UDPHeader_t * pxUDPHeader;
-    eARPLookupResult_t eReturned;
-    NetworkEndPoint_t * pxEndPoint;
-
-    // Calculate the VLAN offset based on the number of VLAN tags
-    #if ( tsnconfigSOCKET_INSERTS_VLAN_TAGS != tsnconfigDISABLE )
-        const size_t uxVLANOffset = sizeof( struct xVLAN_TAG ) * pxSocket->ucVLANTagsCount;
-    #else
-        const size_t uxVLANOffset = 0;
-    #endif
-
-    // Calculate the payload size
-    const size_t uxPayloadSize = pxBuf->xDataLength - sizeof( UDPPacket_t ) - uxVLANOffset;
-
-    pxEthernetHeader = ( EthernetHeader_t * ) pxBuf->pucEthernetBuffer;
-
-    // Reset the destination MAC address to avoid random garbage matches in the ARP tables
-    memset( &pxEthernetHeader->xDestinationAddress, '\0', sizeof( MACAddress_t ) );
-
-    // Perform ARP cache lookup to obtain the destination MAC address
-    eReturned = eARPGetCacheEntry( &( pxBuf->xIPAddress.ulIP_IPv4 ), &( pxEthernetHeader->xDestinationAddress ), &( pxEndPoint ) );
+    FreeRTOS_TSN_Socket_t * pxFound = NULL;
+    const ListItem_t * pxIterator;
+    const ListItem_t * pxEnd = ( ( const ListItem_t * ) &( xTSNBoundRawSocketList.xListEnd ) );
 
-    if( eReturned != eARPCacheHit )
+    if( !listLIST_IS_INITIALISED( &( xTSNBoundRawSocketList ) ) )
     {
-        FreeRTOS_debug_printf( ( "sendto: IP is not in ARP cache\n" ) );
-        return pdFAIL;
+        return NULL;
     }
 
-    pxBuf->pxEndPoint = pxEndPoint;
-
-    // Copy the source MAC address from the endpoint to the Ethernet header
-    ( void ) memcpy( pxEthernetHeader->xSourceAddress.ucBytes, pxEndPoint->xMACAddress.ucBytes, ( size_t ) ipMAC_ADDRESS_LENGTH_BYTES );
+    for( pxIterator = listGET_NEXT( pxEnd );
+         pxIterator != pxEnd;
+         pxIterator = listGET_NEXT( pxIterator ) )
+    {
+        FreeRTOS_TSN_Socket_t * pxCandidate = ( FreeRTOS_TSN_Socket_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
 
-    // Set the VLAN tags in the Ethernet header based on the number of VLAN tags
-    #if ( tsnconfigSOCKET_INSERTS_VLAN_TAGS != tsnconfigDISABLE )
-        switch( pxSocket->ucVLANTagsCount )
+        if( listGET_LIST_ITEM_VALUE( pxIterator ) != usEtherType )
         {
-            case 0:
-                // No VLAN tags, can reuse previous struct
-                pxEthernetHeader->usFrameType = ipIPv4_FRAME_TYPE;
-                break;
-
-            case 1:
-                // Single VLAN tag
-                TaggedEthernetHeader_t * pxTEthHeader = ( TaggedEthernetHeader_t * ) pxEthernetHeader;
-                pxTEthHeader->xVLANTag.usTPID = FreeRTOS_htons( vlantagTPID_DEFAULT );
-                pxTEthHeader->xVLANTag.usTCI = FreeRTOS_htons( pxSocket->usVLANCTagTCI );
-                pxTEthHeader->usFrameType = ipIPv4_FRAME_TYPE;
-                break;
+            continue;
+        }
 
-            case 2:
-                // Double VLAN tag
-                DoubleTaggedEthernetHeader_t * pxDTEthHeader = ( DoubleTaggedEthernetHeader_t * ) pxEthernetHeader;
-                pxDTEthHeader->xVLANSTag.usTPID = FreeRTOS_htons( vlantagTPID_DOUBLE_TAG );
-                pxDTEthHeader->xVLANSTag.usTCI = FreeRTOS_htons( pxSocket->usVLANSTagTCI );
-                pxDTEthHeader->xVLANCTag.usTPID = FreeRTOS_htons( vlantagTPID_DEFAULT );
-                pxDTEthHeader->xVLANCTag.usTCI = FreeRTOS_htons( pxSocket->usVLANCTagTCI );
-                pxDTEthHeader->usFrameType = ipIPv4_FRAME_TYPE;
-                break;
+        if( pxCandidate->usVID == usVID )
+        {
+            return pxCandidate;
+        }
 
-            default:
-                return pdFAIL;
+        if( ( pxCandidate->usVID == FREERTOS_TSN_ANY_VID ) && ( pxFound == NULL ) )
+        {
+            pxFound = pxCandidate;
         }
-    #else
-        // No VLAN tags
-        pxEthernetHeader->usFrameType = ipIPv4_FRAME_TYPE;
-    #endif
+    }
 
-    // Set the IP header
-    pxIPHeader = ( IPHeader_t * ) &pxBuf->pucEthernetBuffer[ ipSIZE_OF_ETH_HEADER + uxVLANOffset ];
-    pxIPHeader->ucVersionHeaderLength = ipIPV4_VERSION_HEADER_LENGTH_MIN;
-    diffservSET_DSCLASS_IPv4( pxIPHeader, pxSocket->ucDSClass );
-    pxIPHeader->usLength = uxPayloadSize + sizeof( IPHeader_t ) + sizeof( UDPHeader_t );
-    pxIPHeader->usLength = FreeRTOS_htons( pxIPHeader->usLength );
-    pxIPHeader->usIdentification = 0;
-    pxIPHeader->usFragmentOffset = 0;
-    pxIPHeader->ucTimeToLive = ipconfigUDP_TIME_TO_LIVE;
-    pxIPHeader->ucProtocol = ipPROTOCOL_UDP;
-    pxIPHeader->ulSourceIPAddress = pxBuf->pxEndPoint->ipv4_settings.ulIPAddress;
-    pxIPHeader->ulDestinationIPAddress = pxBuf->xIPAddress.ulIP_IPv4;
+    return pxFound;
+}
 
-    // Set the UDP header
-    pxUDPHeader = ( UDPHeader_t * ) &pxBuf->pucEthernetBuffer[ ipSIZE_OF_ETH_HEADER + uxVLANOffset + ipSIZE_OF_IPv4_HEADER ];
-    pxUDPHeader->usDestinationPort = pxBuf->usPort;
-    pxUDPHeader->usSourcePort = pxBuf->usBoundPort;
-    pxUDPHeader->usLength = ( uint16_t ) ( uxPayloadSize + sizeof( UDPHeader_t ) );
-    pxUDPHeader->usLength = FreeRTOS_htons( pxUDPHeader->usLength );
+#if ( tsnconfigSHARED_BUFFER_POOL_SIZE > 0 )
 
-    // Calculate the IP and UDP checksums
-    #if ( ipconfigDRIVER_INCLUDED_TX_IP_CHECKSUM == 0 )
+/**
+ * @brief List the other raw sockets receiving a frame
+ *
+ * Every raw socket bound to the EtherType of a frame and to its VID, or to
+ * FREERTOS_TSN_ANY_VID, receives the frame. The first one is returned by
+ * vSocketFromMetadata(), this returns the others.
+ *
+ * @param pxMeta The metadata of the frame, with the sockets looked up
+ * @param pxSockets Array receiving the sockets
+ * @param uxMaxSockets Length of pxSockets
+ * @return The number of sockets stored in pxSockets
+ */
+    UBaseType_t uxSocketRawListReceivers( const PacketMetadata_t * pxMeta,
+                                          TSNSocket_t * pxSockets,
+                                          UBaseType_t uxMaxSockets )
     {
-        pxIPHeader->usHeaderChecksum = 0U;
-        pxIPHeader->usHeaderChecksum = usGenerateChecksum( 0U, ( uint8_t * ) &( pxIPHeader ), ipSIZE_OF_IPv4_HEADER );
-        pxIPHeader->usHeaderChecksum = ( uint16_t ) ~FreeRTOS_htons( pxIPHeader->usHeaderChecksum );
+        const uint16_t usVID = ( uint16_t ) vlantagGET_VID_FROM_TCI( pxMeta->usVLANCTCI );
+        const ListItem_t * pxIterator;
+        const ListItem_t * pxEnd = ( ( const ListItem_t * ) &( xTSNBoundRawSocketList.xListEnd ) );
+        UBaseType_t uxCount = 0U;
 
-        if( ( ucSocketOptions & ( uint8_t ) FREERTOS_SO_UDPCKSUM_OUT ) != 0U )
+        if( !listLIST_IS_INITIALISED( &( xTSNBoundRawSocketList ) ) )
         {
-            // Shift the Ethernet buffer forward so that ethertype is at fixed offset from start
-            ( void ) usGenerateProtocolChecksum( ( uint8_t * ) &pxBuf->pucEthernetBuffer[ uxVLANOffset ], pxNetworkBuffer->xDataLength - uxVLANOffset, pdTRUE );
+            return 0U;
         }
-        else
+
+        taskENTER_CRITICAL();
         {
-            pxUDPPacket->xUDPHeader.usChecksum = 0U;
+            for( pxIterator = listGET_NEXT( pxEnd );
+                 ( pxIterator != pxEnd ) && ( uxCount < uxMaxSockets );
+                 pxIterator = listGET_NEXT( pxIterator ) )
+            {
+                FreeRTOS_TSN_Socket_t * pxCandidate = ( FreeRTOS_TSN_Socket_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
+
+                if( ( listGET_LIST_ITEM_VALUE( pxIterator ) == pxMeta->usFrameType ) &&
+                    ( ( pxCandidate->usVID == usVID ) || ( pxCandidate->usVID == FREERTOS_TSN_ANY_VID ) ) &&
+                    ( pxCandidate != pxMeta->pxTSNSocket ) )
+                {
+                    pxSockets[ uxCount++ ] = pxCandidate;
+                }
+            }
         }
+        taskEXIT_CRITICAL();
+
+        return uxCount;
     }
-    #else
-    {
-        pxIPHeader->usHeaderChecksum = 0U;
-        pxUDPHeader->usChecksum = 0U;
-    }
-    #endif
 
-    // Add padding if the data length is less than the minimum packet bytes
-    #if ( ipconfigETHERNET_MINIMUM_PACKET_BYTES > 0 )
+#endif /* if ( tsnconfigSHARED_BUFFER_POOL_SIZE > 0 ) */
+
+/**
+ * @brief Retrieves the sockets bound to the local port of a packet, looking them up only once.
+ *
+ * The result of the first lookup is cached in the metadata of the packet,
+ * and returned by the following calls as long as no TSN socket has been
+ * unbound in the meantime. Note that Plus TCP sockets are closed without
+ * notice to this layer, so a cached base socket not belonging to a TSN
+ * socket should only be used to tell whether the port is bound.
+ * Frames which are not handled by Plus TCP are looked up among the raw
+ * sockets instead, by EtherType and VID.
+ *
+ * @param pxMeta The metadata of the packet.
+ * @param usLocalPort The local port of the packet, in network byte order.
+ * @param pxBaseSocket Pointer to the base socket variable where the retrieved base socket will be stored.
+ * @param pxTSNSocket Pointer to the TSN socket variable where the retrieved TSN socket will be stored.
+ */
+void vSocketFromMetadata( PacketMetadata_t * pxMeta,
+                          uint16_t usLocalPort,
+                          Socket_t * pxBaseSocket,
+                          TSNSocket_t * pxTSNSocket )
+{
+    const UBaseType_t uxGeneration = uxTSNSocketGeneration;
+
+    if( pxMeta->uxSocketGeneration != uxGeneration )
     {
-        if( pxBuf->xDataLength < ( size_t ) ipconfigETHERNET_MINIMUM_PACKET_BYTES )
+        Socket_t xBaseSocket = NULL;
+        TSNSocket_t xTSNSocket = NULL;
+
+        if( tsnsocketIS_RAW_FRAME_TYPE( pxMeta->usFrameType ) )
         {
-            BaseType_t xIndex;
+            FreeRTOS_TSN_Socket_t * pxRawSocket;
 
-            for( xIndex = ( BaseType_t ) pxBuf->xDataLength; xIndex < ( BaseType_t ) ipconfigETHERNET_MINIMUM_PACKET_BYTES; xIndex++ )
+            taskENTER_CRITICAL();
             {
-                pxBuf->pucEthernetBuffer[ xIndex ] = 0U;
+                pxRawSocket = prvRawSocketFind( pxMeta->usFrameType, ( uint16_t ) vlantagGET_VID_FROM_TCI( pxMeta->usVLANCTCI ) );
             }
+            taskEXIT_CRITICAL();
 
-            pxBuf->xDataLength = ( size_t ) ipconfigETHERNET_MINIMUM_PACKET_BYTES;
+            if( pxRawSocket != NULL )
+            {
+                xBaseSocket = pxRawSocket->xBaseSocket;
+                xTSNSocket = pxRawSocket;
+            }
+        }
+        else
+        {
+            vSocketFromPort( usLocalPort, &xBaseSocket, &xTSNSocket );
         }
+
+        pxMeta->xBaseSocket = xBaseSocket;
+        pxMeta->pxTSNSocket = xTSNSocket;
+        pxMeta->uxSocketGeneration = uxGeneration;
     }
-    #endif
 
-    return pdPASS;
+    *pxBaseSocket = pxMeta->xBaseSocket;
+    *pxTSNSocket = pxMeta->pxTSNSocket;
 }
 
+#if ( tsnconfigWRAPPER_INSERTS_VLAN_TAGS != tsnconfigDISABLE )
+
 /**
- * @brief Prepares a UDPv6 buffer for transmission.
- *
- * This function prepares a buffer for UDPv6 transmission by initializing the necessary data structures
- * and copying the destination address into the packet header.
+ * @brief Find the configuration of the interface a socket sends to
  *
- * @param pxSocket The socket to which the buffer belongs.
- * @param pxBuf The network buffer descriptor to be prepared.
- * @param xFlags Flags to control the behavior of the function.
- * @param pxDestinationAddress Pointer to the destination address structure.
- * @param xDestinationAddressLength Length of the destination address.
+ * This is the interface of the end-point of the socket, or the first
+ * interface for the sockets which are not bound to an end-point.
  *
- * @return pdFAIL if the buffer preparation fails, pdPASS otherwise.
+ * @param pxSocket The TSN socket
+ * @return The configuration, or NULL if there is no interface
  */
-BaseType_t prvPrepareBufferUDPv6( FreeRTOS_TSN_Socket_t * pxSocket,
-                                  NetworkBufferDescriptor_t * pxBuf,
-                                  BaseType_t xFlags,
-                                  const struct freertos_sockaddr * pxDestinationAddress,
-                                  BaseType_t xDestinationAddressLength )
-{
-	/* UDP on IPv6 is not yet supported. This function is never called because
-	 * trying to create a socket with IPPROTO as IPv6 will always fail
-	 */
-	( void ) pxSocket;
-	( void ) pxBuf;
-	( void ) xFlags;
-	( void ) pxDestinationAddress;
-	( void ) xDestinationAddressLength;
+    static const NetworkInterfaceConfig_t * prvGetInterfaceConfig( const FreeRTOS_TSN_Socket_t * pxSocket )
+    {
+        const NetworkEndPoint_t * pxEndPoint = pxSocket->pxEndPoint;
+        const NetworkInterface_t * pxInterface;
 
-    //UDPPacket_IPv6_t * pxUDPPacket;
+        if( pxEndPoint == NULL )
+        {
+            pxEndPoint = ( ( const FreeRTOS_Socket_t * ) pxSocket->xBaseSocket )->pxEndPoint;
+        }
 
-    /*( void ) memcpy( pxUDPPacket_IPv6->xIPHeader.xDestinationAddress.ucBytes, pxDestinationAddress->sin_address.xIP_IPv6.ucBytes, ipSIZE_OF_IPv6_ADDRESS ); */
+        pxInterface = ( pxEndPoint != NULL ) ? pxEndPoint->pxNetworkInterface : FreeRTOS_FirstNetworkInterface();
 
+        return ( pxInterface != NULL ) ? ( const NetworkInterfaceConfig_t * ) pxInterface->pvArgument : NULL;
+    }
 
-    return pdFAIL;
-}
+#endif /* if ( tsnconfigWRAPPER_INSERTS_VLAN_TAGS != tsnconfigDISABLE ) */
 
 /**
- * @brief Moves the buffer pointer to the start of the payload and updates the payload size.
+ * @brief Number of VLAN tags in the frames sent by a socket
  *
- * This function is used to move the buffer pointer to the start of the payload and update the payload size
- * based on the frame type and protocol. It supports IPv4 and IPv6 frames with UDP, TCP, ICMP, ICMPv6, and IGMP protocols.
+ * These are the tags set with the socket options if the socket inserts the
+ * tags. If the wrapper does, frames are built with room for the tags of the
+ * interface, which the wrapper then writes in place instead of resizing the
+ * frame, see pxVLANTagsInsert().
  *
- * @param[in,out] ppvBuf Pointer to the buffer pointer.
- * @param[in,out] puxSize Pointer to the payload size.
+ * @param pxSocket The TSN socket
+ * @return The number of tags, 0, 1 or 2 if valid
  */
-void prvMoveToStartOfPayload( void ** ppvBuf,
-                              size_t * puxSize )
+static uint8_t prvGetVLANTagsCount( const FreeRTOS_TSN_Socket_t * pxSocket )
 {
-    uint8_t * const pucEthernetBuffer = ( uint8_t * ) *ppvBuf;
-    size_t uxPrefix = ipSIZE_OF_ETH_HEADER;
-    uint8_t ucProtocol;
-
-    const uint16_t usFrameType = ( ( EthernetHeader_t * ) *ppvBuf )->usFrameType;
+    #if ( tsnconfigSOCKET_INSERTS_VLAN_TAGS != tsnconfigDISABLE )
+        return pxSocket->ucVLANTagsCount;
+    #elif ( tsnconfigWRAPPER_INSERTS_VLAN_TAGS != tsnconfigDISABLE )
+        const NetworkInterfaceConfig_t * pxInterfaceConfig = prvGetInterfaceConfig( pxSocket );
 
-    switch( usFrameType )
-    {
-        case ipIPv4_FRAME_TYPE:
-            ucProtocol = ( ( IPHeader_t * ) &pucEthernetBuffer[ uxPrefix ] )->ucProtocol;
-            uxPrefix += ipSIZE_OF_IPv4_HEADER;
-            break;
+        return ( pxInterfaceConfig != NULL ) ? wrapperINTERFACE_TAGS( pxInterfaceConfig ) : 0U;
+    #else
+        ( void ) pxSocket;
 
-        case ipIPv6_FRAME_TYPE:
-            ucProtocol = ( ( IPHeader_IPv6_t * ) &pucEthernetBuffer[ uxPrefix ] )->ucNextHeader;
-            uxPrefix += ipSIZE_OF_IPv6_HEADER;
-            break;
+        return 0U;
+    #endif
+}
 
-        default:
-            ucProtocol = 255;
-            break;
-    }
+/**
+ * @brief TCIs of the VLAN tags of the frames sent by a socket
+ *
+ * @param pxSocket The TSN socket
+ * @param ucNumTags The number of tags, from prvGetVLANTagsCount()
+ * @param[out] pusSTagTCI TCI of the service tag
+ * @param[out] pusCTagTCI TCI of the customer tag, 0 if untagged
+ */
+static void prvGetVLANTagsTCI( const FreeRTOS_TSN_Socket_t * pxSocket,
+                               uint8_t ucNumTags,
+                               uint16_t * pusSTagTCI,
+                               uint16_t * pusCTagTCI )
+{
+    *pusSTagTCI = 0U;
+    *pusCTagTCI = 0U;
 
-    switch( ucProtocol )
-    {
-        case ipPROTOCOL_UDP:
-            *puxSize = FreeRTOS_ntohs( ( ( UDPHeader_t * ) &pucEthernetBuffer[ uxPrefix ] )->usLength );
-            uxPrefix += ipSIZE_OF_UDP_HEADER;
-            break;
+    #if ( tsnconfigSOCKET_INSERTS_VLAN_TAGS != tsnconfigDISABLE )
+        ( void ) ucNumTags;
 
-        case ipPROTOCOL_TCP:
-        case ipPROTOCOL_ICMP:
-        case ipPROTOCOL_ICMP_IPv6:
-        case ipPROTOCOL_IGMP:
-        default:
-            /* shouldn't get here, but just in case return raw packet */
-            return;
-    }
+        *pusSTagTCI = pxSocket->usVLANSTagTCI;
+        *pusCTagTCI = pxSocket->usVLANCTagTCI;
+    #elif ( tsnconfigWRAPPER_INSERTS_VLAN_TAGS != tsnconfigDISABLE )
+        if( ucNumTags > 0U )
+        {
+            const NetworkInterfaceConfig_t * pxInterfaceConfig = prvGetInterfaceConfig( pxSocket );
 
-    *ppvBuf = &pucEthernetBuffer[ uxPrefix ];
+            *pusSTagTCI = pxInterfaceConfig->usServiceVLANTag;
+            *pusCTagTCI = pxInterfaceConfig->usVLANTag;
+        }
+    #else
+        ( void ) pxSocket;
+        ( void ) ucNumTags;
+    #endif
 }
 
 /**
- * @brief Creates a TSN socket.
+ * @brief Length of the tags in the frames sent by a socket
  *
- * This function creates a TSN socket with the specified domain, type, and protocol.
- * Only UDP sockets are supported at the moment.
- *
- * @param xDomain   The domain of the socket.
- * @param xType     The type of the socket.
- * @param xProtocol The protocol of the socket.
+ * These are the VLAN tags, followed by the room of an R-TAG if the frames
+ * have the VID of an FRER stream, see uxFRERTxRoom(). The R-TAG is then
+ * written in place by the wrapper instead of resizing the frame.
  *
- * @return The created TSN socket, or FREERTOS_TSN_INVALID_SOCKET if an error occurred.
+ * @param pxSocket The TSN socket
+ * @return The length of the tags, between the MAC addresses and the EtherType
  */
-TSNSocket_t FreeRTOS_TSN_socket(BaseType_t xDomain,
-                                BaseType_t xType,
-                                BaseType_t xProtocol)
+static size_t prvGetTagsLength( const FreeRTOS_TSN_Socket_t * pxSocket )
 {
-    // Check if the socket type is supported
-    if (xType != FREERTOS_SOCK_DGRAM)
-    {
-        /* Only UDP is supported up to now */
-        return FREERTOS_TSN_INVALID_SOCKET;
-    }
-
-    // Allocate memory for the TSN socket
-    TSNSocket_t pxSocket = (TSNSocket_t)pvPortMalloc(sizeof(FreeRTOS_TSN_Socket_t));
+    const uint8_t ucNumTags = prvGetVLANTagsCount( pxSocket );
+    uint16_t usSTagTCI, usCTagTCI;
 
-    if (pxSocket == NULL)
+    if( ucNumTags > 2U )
     {
-        return FREERTOS_TSN_INVALID_SOCKET;
+        return ucNumTags * sizeof( struct xVLAN_TAG );
     }
 
-    // Create the underlying base socket
-    pxSocket->xBaseSocket = FreeRTOS_socket(xDomain, xType, xProtocol);
+    prvGetVLANTagsTCI( pxSocket, ucNumTags, &usSTagTCI, &usCTagTCI );
 
-    if (pxSocket->xBaseSocket == FREERTOS_INVALID_SOCKET)
+    if( ucNumTags == 0U )
     {
-        vPortFree(pxSocket);
-        return FREERTOS_TSN_INVALID_SOCKET;
+        usCTagTCI = 0U;
     }
 
-    // Create the error queue
-    pxSocket->xErrQueue = xQueueCreate(tsnconfigERRQUEUE_LENGTH, sizeof(struct msghdr *));
+    return ( ucNumTags * sizeof( struct xVLAN_TAG ) ) + uxFRERTxRoom( ( uint16_t ) vlantagGET_VID_FROM_TCI( usCTagTCI ) );
+}
 
-    if (pxSocket->xErrQueue == NULL)
+/**
+ * @brief Pad a frame shorter than the minimum ethernet frame
+ *
+ * @param pxBuf The network buffer, with all the headers set
+ */
+static void prvPadFrame( NetworkBufferDescriptor_t * pxBuf )
+{
+    #if ( ipconfigETHERNET_MINIMUM_PACKET_BYTES > 0 )
     {
-        vPortFree(pxSocket);
-        return FREERTOS_TSN_INVALID_SOCKET;
-    }
+        if( pxBuf->xDataLength < ( size_t ) ipconfigETHERNET_MINIMUM_PACKET_BYTES )
+        {
+            BaseType_t xIndex;
 
-    // Initialize the bound socket list item
-    vListInitialiseItem(&(pxSocket->xBoundSocketListItem));
-    listSET_LIST_ITEM_OWNER(&(pxSocket->xBoundSocketListItem), (void *)pxSocket);
+            for( xIndex = ( BaseType_t ) pxBuf->xDataLength; xIndex < ( BaseType_t ) ipconfigETHERNET_MINIMUM_PACKET_BYTES; xIndex++ )
+            {
+                pxBuf->pucEthernetBuffer[ xIndex ] = 0U;
+            }
 
-    return pxSocket;
+            pxBuf->xDataLength = ( size_t ) ipconfigETHERNET_MINIMUM_PACKET_BYTES;
+        }
+    }
+    #else
+        ( void ) pxBuf;
+    #endif
 }
 
 /**
- * @brief Set socket options for a TSN socket.
- *
- * This function sets various options for a TSN socket.
- *
- * @param xSocket The TSN socket to set options for.
- * @param lLevel The level at which the option is defined.
- * @param lOptionName The name of the option to set.
- * @param pvOptionValue A pointer to the value of the option.
- * @param uxOptionLength The length of the option value.
+ * @brief Set the UDP checksum and pad a UDPv4 frame ready to be sent
  *
- * @return pdPASS if the option is set successfully, or a negative value if an error occurs.
+ * @param pxSocket The sending socket
+ * @param pxBuf The network buffer, with all the headers set
+ * @param uxVLANOffset Size of the tags of the frame, see prvGetTagsLength()
  */
-BaseType_t FreeRTOS_TSN_setsockopt( TSNSocket_t xSocket,
-                                    int32_t lLevel,
-                                    int32_t lOptionName,
-                                    const void * pvOptionValue,
-                                    size_t uxOptionLength )
+static void prvFinaliseBufferUDPv4( const FreeRTOS_TSN_Socket_t * pxSocket,
+                                    NetworkBufferDescriptor_t * pxBuf,
+                                    size_t uxVLANOffset )
 {
-    BaseType_t xReturn = -pdFREERTOS_ERRNO_EINVAL;
-    FreeRTOS_TSN_Socket_t * pxSocket = ( FreeRTOS_TSN_Socket_t * ) xSocket;
-    BaseType_t ulOptionValue = *( BaseType_t * ) pvOptionValue;
+    UDPHeader_t * pxUDPHeader = ( UDPHeader_t * ) &pxBuf->pucEthernetBuffer[ ipSIZE_OF_ETH_HEADER + uxVLANOffset + ipSIZE_OF_IPv4_HEADER ];
 
-    if( xSocketValid( pxSocket->xBaseSocket ) == pdTRUE )
+    pxUDPHeader->usChecksum = 0U;
+
+    #if ( ipconfigDRIVER_INCLUDED_TX_IP_CHECKSUM == 0 )
     {
-        switch( lOptionName )
-        {
-            #if ( tsnconfigSOCKET_INSERTS_VLAN_TAGS != tsnconfigDISABLE )
-                case FREERTOS_SO_VLAN_CTAG_PCP:
+        const FreeRTOS_Socket_t * pxBaseSocket = ( const FreeRTOS_Socket_t * ) pxSocket->xBaseSocket;
 
-                    // Set the PCP value from the TCI
-                    if( ulOptionValue < 8 )
-                    {
-                        vlantagSET_PCP_FROM_TCI( pxSocket->usVLANCTagTCI, ulOptionValue );
+        if( ( pxBaseSocket->ucSocketOptions & ( uint8_t ) FREERTOS_SO_UDPCKSUM_OUT ) != 0U )
+        {
+            const IPHeader_t * pxIPHeader = ( const IPHeader_t * ) &pxBuf->pucEthernetBuffer[ ipSIZE_OF_ETH_HEADER + uxVLANOffset ];
 
-                        // If no VLAN tags are set, set the count to 1
-                        if( pxSocket->ucVLANTagsCount == 0 )
-                        {
-                            pxSocket->ucVLANTagsCount = 1;
-                        }
+            pxUDPHeader->usChecksum = usChecksumUDPv4( pxIPHeader, ( const uint8_t * ) pxUDPHeader, FreeRTOS_ntohs( pxUDPHeader->usLength ) );
+        }
+    }
+    #else
+        ( void ) pxSocket;
+    #endif
 
-                        xReturn = 0;
-                    }
+    prvPadFrame( pxBuf );
+}
 
-                    break;
+#if ( ipconfigUSE_IPv6 != 0 )
 
-                case FREERTOS_SO_VLAN_STAG_PCP:
+/**
+ * @brief Set the UDP checksum and pad a UDPv6 frame ready to be sent
+ *
+ * The checksum is mandatory over IPv6, so FREERTOS_SO_UDPCKSUM_OUT is not
+ * checked.
+ *
+ * @param pxBuf The network buffer, with all the headers set
+ * @param uxVLANOffset Size of the tags of the frame, see prvGetTagsLength()
+ */
+    static void prvFinaliseBufferUDPv6( NetworkBufferDescriptor_t * pxBuf,
+                                        size_t uxVLANOffset )
+    {
+        UDPHeader_t * pxUDPHeader = ( UDPHeader_t * ) &pxBuf->pucEthernetBuffer[ ipSIZE_OF_ETH_HEADER + uxVLANOffset + ipSIZE_OF_IPv6_HEADER ];
 
-                    // Set the PCP value from the TCI
-                    if( ulOptionValue < 8 )
-                    {
-                        vlantagSET_PCP_FROM_TCI( pxSocket->usVLANSTagTCI, ulOptionValue );
+        pxUDPHeader->usChecksum = 0U;
 
-                        // Set the VLAN tags count to 2
-                        pxSocket->ucVLANTagsCount = 2;
-                        xReturn = 0;
-                    }
+        #if ( ipconfigDRIVER_INCLUDED_TX_IP_CHECKSUM == 0 )
+        {
+            const IPHeader_IPv6_t * pxIPHeader = ( const IPHeader_IPv6_t * ) &pxBuf->pucEthernetBuffer[ ipSIZE_OF_ETH_HEADER + uxVLANOffset ];
 
-                    break;
+            pxUDPHeader->usChecksum = usChecksumUDPv6( pxIPHeader, ( const uint8_t * ) pxUDPHeader, FreeRTOS_ntohs( pxUDPHeader->usLength ) );
+        }
+        #endif
 
-                case FREERTOS_SO_VLAN_TAG_RST:
-                    // Reset the VLAN tags count
-                    pxSocket->ucVLANTagsCount = 0;
-                    xReturn = 0;
-                    break;
-            #endif /* if ( tsnconfigSOCKET_INSERTS_VLAN_TAGS != tsnconfigDISABLE ) */
+        prvPadFrame( pxBuf );
+    }
 
-			/* In feature may want to replace this to provide an interface
-			 * similar to the Linux sockets' IP_TOS field.
-			 */
-            case FREERTOS_SO_DS_CLASS:
+#endif /* if ( ipconfigUSE_IPv6 != 0 ) */
 
-                // Set the DS class value
-                if( ulOptionValue < 64 )
-                {
-                    pxSocket->ucDSClass = ulOptionValue;
-                    xReturn = 0;
-                }
+/**
+ * @brief Take the IPv4 identification of the next packet of a socket
+ *
+ * Several tasks may send through the same socket, the identification is
+ * taken in a critical section as Plus TCP does.
+ *
+ * @param pxSocket The sending socket
+ * @return The identification, in network byte order
+ */
+static uint16_t prvTakeIPIdentification( FreeRTOS_TSN_Socket_t * pxSocket )
+{
+    uint16_t usIdentification;
 
-                break;
+    taskENTER_CRITICAL();
+    {
+        usIdentification = pxSocket->usIPIdentification;
+        pxSocket->usIPIdentification++;
+    }
+    taskEXIT_CRITICAL();
 
-            case FREERTOS_SO_TIMESTAMPING:
+    return FreeRTOS_htons( usIdentification );
+}
 
-                // Set the timestamping flags
-                if( ulOptionValue & ~SOF_TIMESTAMPING_MASK )
-                {
-                    xReturn = pdFREERTOS_ERRNO_EINVAL;
-                }
-                else
-                {
-                    // Reset the error queue and set the timestamping flags
-                    ( void ) xQueueReset( pxSocket->xErrQueue );
-                    pxSocket->ulTSFlags = ulOptionValue;
-                    xReturn = 0;
-                }
+#if ( tsnconfigSOCKET_TEMPLATE_REVALIDATE_MS > 0 )
 
-                break;
+/**
+ * @brief Check if an address is the one the socket is connected to
+ *
+ * @param pxSocket The sending socket
+ * @param pxAddress The destination of a frame
+ * @return pdTRUE if the socket is connected to that address and port
+ */
+    static BaseType_t prvIsConnectedAddress( const FreeRTOS_TSN_Socket_t * pxSocket,
+                                             const struct freertos_sockaddr * pxAddress )
+    {
+        const struct freertos_sockaddr * pxConnected = &pxSocket->xConnectedAddress;
 
-            default:
-                // Call the base socket's setsockopt function
-                xReturn = FreeRTOS_setsockopt( pxSocket->xBaseSocket, lLevel, lOptionName, pvOptionValue, uxOptionLength );
-                break;
+        if( ( pxSocket->xIsConnected == pdFALSE ) || ( pxAddress->sin_family != pxConnected->sin_family ) ||
+            ( pxAddress->sin_port != pxConnected->sin_port ) )
+        {
+            return pdFALSE;
         }
-    }
-    else
-    {
-        xReturn = -pdFREERTOS_ERRNO_EINVAL;
-    }
 
-    return xReturn;
-}
+        #if ( ipconfigUSE_IPv6 != 0 )
+            if( pxAddress->sin_family == FREERTOS_AF_INET6 )
+            {
+                return ( memcmp( pxAddress->sin_address.xIP_IPv6.ucBytes, pxConnected->sin_address.xIP_IPv6.ucBytes, ipSIZE_OF_IPv6_ADDRESS ) == 0 ) ? pdTRUE : pdFALSE;
+            }
+        #endif
+
+        return ( pxAddress->sin_address.ulIP_IPv4 == pxConnected->sin_address.ulIP_IPv4 ) ? pdTRUE : pdFALSE;
+    }
 
 /**
- * @brief Binds a TSN socket to a specific address.
+ * @brief Check if the header template of a socket can be used for a frame
  *
- * This function binds a TSN socket to a specific address specified by `pxAddress`.
+ * @param pxSocket The sending socket
+ * @param pxDestinationAddress The destination of the frame
+ * @param uxPayloadOffset The offset of the payload in the frame
+ * @return pdTRUE if the template can be copied in the frame
+ */
+    static BaseType_t prvTemplateIsUsable( const FreeRTOS_TSN_Socket_t * pxSocket,
+                                           const struct freertos_sockaddr * pxDestinationAddress,
+                                           size_t uxPayloadOffset )
+    {
+        const TSNHeaderTemplate_t * pxTemplate = &pxSocket->xTemplate;
+        const NetworkEndPoint_t * pxEndPoint = pxTemplate->pxEndPoint;
+        uint16_t usSTagTCI, usCTagTCI;
+
+        if( pxTemplate->ucLength != uxPayloadOffset )
+        {
+            return pdFALSE;
+        }
+
+        // The PCP or VID of the interface may change with the same tags length
+        prvGetVLANTagsTCI( pxSocket, prvGetVLANTagsCount( pxSocket ), &usSTagTCI, &usCTagTCI );
+
+        if( ( usSTagTCI != pxTemplate->usSTagTCI ) || ( usCTagTCI != pxTemplate->usCTagTCI ) )
+        {
+            return pdFALSE;
+        }
+
+        if( prvIsConnectedAddress( pxSocket, pxDestinationAddress ) == pdFALSE )
+        {
+            return pdFALSE;
+        }
+
+        if( pxEndPoint->bits.bEndPointUp == pdFALSE_UNSIGNED )
+        {
+            return pdFALSE;
+        }
+
+        #if ( ipconfigUSE_IPv6 != 0 )
+            if( pxDestinationAddress->sin_family == FREERTOS_AF_INET6 )
+            {
+                if( memcmp( pxEndPoint->ipv6_settings.xIPAddress.ucBytes, pxTemplate->xSourceAddress.xIP_IPv6.ucBytes, ipSIZE_OF_IPv6_ADDRESS ) != 0 )
+                {
+                    return pdFALSE;
+                }
+            }
+            else
+        #endif
+        if( pxEndPoint->ipv4_settings.ulIPAddress != pxTemplate->xSourceAddress.ulIP_IPv4 )
+        {
+            return pdFALSE;
+        }
+
+        /* Look up the ARP or neighbor cache again from time to time */
+        return ( ( xTaskGetTickCount() - pxTemplate->xBuildTime ) < pdMS_TO_TICKS( tsnconfigSOCKET_TEMPLATE_REVALIDATE_MS ) ) ? pdTRUE : pdFALSE;
+    }
+
+/**
+ * @brief Save the headers of a prepared UDP frame as the socket template
+ *
+ * @param pxSocket The sending socket
+ * @param pxBuf The network buffer, prepared by prvPrepareBufferUDPv4() or
+ * prvPrepareBufferUDPv6()
+ * @param uxPayloadOffset The offset of the payload in the frame
+ */
+    static void prvTemplateStore( FreeRTOS_TSN_Socket_t * pxSocket,
+                                  const NetworkBufferDescriptor_t * pxBuf,
+                                  size_t uxPayloadOffset )
+    {
+        TSNHeaderTemplate_t * pxTemplate = &pxSocket->xTemplate;
+        UDPHeader_t * pxUDPHeader;
+
+        if( uxPayloadOffset > sizeof( pxTemplate->ucHeaders ) )
+        {
+            return;
+        }
+
+        memcpy( pxTemplate->ucHeaders, pxBuf->pucEthernetBuffer, uxPayloadOffset );
+
+        pxUDPHeader = ( UDPHeader_t * ) &pxTemplate->ucHeaders[ uxPayloadOffset - ipSIZE_OF_UDP_HEADER ];
+        pxUDPHeader->usLength = 0U;
+        pxUDPHeader->usChecksum = 0U;
+
+        #if ( ipconfigUSE_IPv6 != 0 )
+            if( pxSocket->xConnectedAddress.sin_family == FREERTOS_AF_INET6 )
+            {
+                IPHeader_IPv6_t * pxIPHeader = ( IPHeader_IPv6_t * ) &pxTemplate->ucHeaders[ uxPayloadOffset - ipSIZE_OF_UDP_HEADER - ipSIZE_OF_IPv6_HEADER ];
+
+                NetworkEndPoint_t * pxEndPoint = NULL;
+                MACAddress_t xMACAddress;
+
+                pxIPHeader->usPayloadLength = 0U;
+                memcpy( pxTemplate->xSourceAddress.xIP_IPv6.ucBytes, pxBuf->pxEndPoint->ipv6_settings.xIPAddress.ucBytes, ipSIZE_OF_IPv6_ADDRESS );
+
+                memcpy( pxTemplate->xNextHop.xIP_IPv6.ucBytes, pxIPHeader->xDestinationAddress.ucBytes, ipSIZE_OF_IPv6_ADDRESS );
+                ( void ) eNDGetCacheEntry( &pxTemplate->xNextHop.xIP_IPv6, &xMACAddress, &pxEndPoint );
+            }
+            else
+        #endif
+        {
+            IPHeader_t * pxIPHeader = ( IPHeader_t * ) &pxTemplate->ucHeaders[ uxPayloadOffset - ipSIZE_OF_UDP_HEADER - ipSIZE_OF_IPv4_HEADER ];
+            uint32_t ulNextHop = pxIPHeader->ulDestinationIPAddress;
+            NetworkEndPoint_t * pxEndPoint = NULL;
+            MACAddress_t xMACAddress;
+
+            // The lookup gives the gateway for the destinations off the network
+            ( void ) eTSNARPGetCacheEntry( &ulNextHop, &xMACAddress, &pxEndPoint );
+            pxTemplate->xNextHop.ulIP_IPv4 = ulNextHop;
+
+            #if ( ipconfigDRIVER_INCLUDED_TX_IP_CHECKSUM == 0 )
+            {
+                // Keep the checksum valid for zero length and identification
+                pxIPHeader->usHeaderChecksum = usChecksumUpdate16( pxIPHeader->usHeaderChecksum, pxIPHeader->usLength, 0U );
+                pxIPHeader->usHeaderChecksum = usChecksumUpdate16( pxIPHeader->usHeaderChecksum, pxIPHeader->usIdentification, 0U );
+            }
+            #endif
+
+            pxIPHeader->usLength = 0U;
+            pxIPHeader->usIdentification = 0U;
+            pxTemplate->xSourceAddress.ulIP_IPv4 = pxBuf->pxEndPoint->ipv4_settings.ulIPAddress;
+        }
+
+        prvGetVLANTagsTCI( pxSocket, prvGetVLANTagsCount( pxSocket ), &pxTemplate->usSTagTCI, &pxTemplate->usCTagTCI );
+        pxTemplate->pxEndPoint = pxBuf->pxEndPoint;
+        pxTemplate->xBuildTime = xTaskGetTickCount();
+        pxTemplate->ucLength = ( uint8_t ) uxPayloadOffset;
+    }
+
+/**
+ * @brief Write the DiffServ class of the socket in its template
+ *
+ * @param pxSocket The socket, with a valid template
+ */
+    static void prvTemplateSetDSClass( FreeRTOS_TSN_Socket_t * pxSocket )
+    {
+        TSNHeaderTemplate_t * pxTemplate = &pxSocket->xTemplate;
+
+        #if ( ipconfigUSE_IPv6 != 0 )
+            if( pxSocket->xConnectedAddress.sin_family == FREERTOS_AF_INET6 )
+            {
+                IPHeader_IPv6_t * pxIPHeader = ( IPHeader_IPv6_t * ) &pxTemplate->ucHeaders[ pxTemplate->ucLength - ipSIZE_OF_UDP_HEADER - ipSIZE_OF_IPv6_HEADER ];
+
+                diffservSET_DSCLASS_IPv6( pxIPHeader, pxSocket->ucDSClass );
+                return;
+            }
+        #endif
+
+        vDSClassSetIPv4( ( IPHeader_t * ) &pxTemplate->ucHeaders[ pxTemplate->ucLength - ipSIZE_OF_UDP_HEADER - ipSIZE_OF_IPv4_HEADER ],
+                         pxSocket->ucDSClass );
+    }
+
+/**
+ * @brief Prepare a UDPv4 frame copying the headers from the socket template
+ *
+ * Only the lengths, the identification and the checksums are written, the
+ * IPv4 header checksum is updated incrementally from the one of the template.
+ *
+ * @param pxSocket The sending socket, with a usable template
+ * @param pxBuf The network buffer, with the payload after the template
+ */
+    static void prvPrepareBufferUDPv4FromTemplate( FreeRTOS_TSN_Socket_t * pxSocket,
+                                                   NetworkBufferDescriptor_t * pxBuf )
+    {
+        const TSNHeaderTemplate_t * pxTemplate = &pxSocket->xTemplate;
+        const size_t uxHeadersLength = pxTemplate->ucLength;
+        const size_t uxVLANOffset = uxHeadersLength - ipSIZE_OF_ETH_HEADER - ipSIZE_OF_IPv4_HEADER - ipSIZE_OF_UDP_HEADER;
+        const uint16_t usIPLength = ( uint16_t ) ( pxBuf->xDataLength - ipSIZE_OF_ETH_HEADER - uxVLANOffset );
+        const uint16_t usIPLengthNet = FreeRTOS_htons( usIPLength );
+        const uint16_t usIdentificationNet = prvTakeIPIdentification( pxSocket );
+        IPHeader_t * pxIPHeader;
+        UDPHeader_t * pxUDPHeader;
+
+        memcpy( pxBuf->pucEthernetBuffer, pxTemplate->ucHeaders, uxHeadersLength );
+        pxBuf->pxEndPoint = pxTemplate->pxEndPoint;
+
+        pxIPHeader = ( IPHeader_t * ) &pxBuf->pucEthernetBuffer[ ipSIZE_OF_ETH_HEADER + uxVLANOffset ];
+        pxIPHeader->usLength = usIPLengthNet;
+        pxIPHeader->usIdentification = usIdentificationNet;
+
+        #if ( ipconfigDRIVER_INCLUDED_TX_IP_CHECKSUM == 0 )
+        {
+            // The template holds both fields set to 0
+            pxIPHeader->usHeaderChecksum = usChecksumUpdate16( pxIPHeader->usHeaderChecksum, 0U, usIPLengthNet );
+            pxIPHeader->usHeaderChecksum = usChecksumUpdate16( pxIPHeader->usHeaderChecksum, 0U, usIdentificationNet );
+        }
+        #endif
+
+        pxUDPHeader = ( UDPHeader_t * ) &pxBuf->pucEthernetBuffer[ uxHeadersLength - ipSIZE_OF_UDP_HEADER ];
+        pxUDPHeader->usLength = FreeRTOS_htons( ( uint16_t ) ( usIPLength - ipSIZE_OF_IPv4_HEADER ) );
+
+        prvFinaliseBufferUDPv4( pxSocket, pxBuf, uxVLANOffset );
+    }
+
+    #if ( ipconfigUSE_IPv6 != 0 )
+
+/**
+ * @brief Prepare a UDPv6 frame copying the headers from the socket template
+ *
+ * IPv6 has no header checksum and no identification, only the lengths and
+ * the UDP checksum are written.
+ *
+ * @param pxSocket The sending socket, with a usable template
+ * @param pxBuf The network buffer, with the payload after the template
+ */
+        static void prvPrepareBufferUDPv6FromTemplate( const FreeRTOS_TSN_Socket_t * pxSocket,
+                                                       NetworkBufferDescriptor_t * pxBuf )
+        {
+            const TSNHeaderTemplate_t * pxTemplate = &pxSocket->xTemplate;
+            const size_t uxHeadersLength = pxTemplate->ucLength;
+            const size_t uxVLANOffset = uxHeadersLength - ipSIZE_OF_ETH_HEADER - ipSIZE_OF_IPv6_HEADER - ipSIZE_OF_UDP_HEADER;
+            const uint16_t usUDPLengthNet = FreeRTOS_htons( ( uint16_t ) ( pxBuf->xDataLength - uxHeadersLength + ipSIZE_OF_UDP_HEADER ) );
+            IPHeader_IPv6_t * pxIPHeader;
+            UDPHeader_t * pxUDPHeader;
+
+            memcpy( pxBuf->pucEthernetBuffer, pxTemplate->ucHeaders, uxHeadersLength );
+            pxBuf->pxEndPoint = pxTemplate->pxEndPoint;
+
+            // The UDP datagram is the whole IPv6 payload
+            pxIPHeader = ( IPHeader_IPv6_t * ) &pxBuf->pucEthernetBuffer[ ipSIZE_OF_ETH_HEADER + uxVLANOffset ];
+            pxIPHeader->usPayloadLength = usUDPLengthNet;
+
+            pxUDPHeader = ( UDPHeader_t * ) &pxBuf->pucEthernetBuffer[ uxHeadersLength - ipSIZE_OF_UDP_HEADER ];
+            pxUDPHeader->usLength = usUDPLengthNet;
+
+            prvFinaliseBufferUDPv6( pxBuf, uxVLANOffset );
+        }
+
+    #endif /* if ( ipconfigUSE_IPv6 != 0 ) */
+
+#endif /* if ( tsnconfigSOCKET_TEMPLATE_REVALIDATE_MS > 0 ) */
+
+/**
+ * @brief Invalidate the header templates resolved from a neighbor
+ *
+ * Call when the ARP or neighbor cache entry of a neighbor may have changed,
+ * e.g. when an ARP packet is received. Only the templates whose next hop is
+ * the neighbor and whose destination MAC address differs are dropped, they
+ * are rebuilt by the next frame sent.
+ *
+ * @param pxNeighbor The address of the neighbor, or NULL to drop all the
+ * templates of the family
+ * @param xIsIPv6 pdTRUE for an IPv6 neighbor, pdFALSE for an IPv4 one
+ * @param pxMACAddress The MAC address of the neighbor, unused if pxNeighbor
+ * is NULL
+ */
+void vTSNSocketInvalidateTemplates( const IP_Address_t * pxNeighbor,
+                                    BaseType_t xIsIPv6,
+                                    const MACAddress_t * pxMACAddress )
+{
+    #if ( tsnconfigSOCKET_TEMPLATE_REVALIDATE_MS > 0 )
+        const ListItem_t * pxIterator;
+        const ListItem_t * pxEnd = ( ( const ListItem_t * ) &( xTSNBoundUDPSocketList.xListEnd ) );
+
+        if( !listLIST_IS_INITIALISED( &( xTSNBoundUDPSocketList ) ) )
+        {
+            return;
+        }
+
+        // Connected sockets are bound, the walk sees all the templates
+        taskENTER_CRITICAL();
+        {
+            for( pxIterator = listGET_NEXT( pxEnd );
+                 pxIterator != pxEnd;
+                 pxIterator = listGET_NEXT( pxIterator ) )
+            {
+                FreeRTOS_TSN_Socket_t * pxSocket = ( FreeRTOS_TSN_Socket_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
+                const TSNHeaderTemplate_t * pxTemplate = &pxSocket->xTemplate;
+                BaseType_t xSameNeighbor;
+
+                if( ( pxTemplate->ucLength == 0U ) ||
+                    ( ( pxSocket->xConnectedAddress.sin_family == FREERTOS_AF_INET6 ) != ( xIsIPv6 != pdFALSE ) ) )
+                {
+                    continue;
+                }
+
+                if( pxNeighbor == NULL )
+                {
+                    tsnsocketDROP_TEMPLATE( pxSocket );
+                    continue;
+                }
+
+                #if ( ipconfigUSE_IPv6 != 0 )
+                    if( xIsIPv6 != pdFALSE )
+                    {
+                        xSameNeighbor = ( memcmp( pxTemplate->xNextHop.xIP_IPv6.ucBytes, pxNeighbor->xIP_IPv6.ucBytes, ipSIZE_OF_IPv6_ADDRESS ) == 0 ) ? pdTRUE : pdFALSE;
+                    }
+                    else
+                #endif
+                {
+                    xSameNeighbor = ( pxTemplate->xNextHop.ulIP_IPv4 == pxNeighbor->ulIP_IPv4 ) ? pdTRUE : pdFALSE;
+                }
+
+                // The destination MAC address starts the headers
+                if( ( xSameNeighbor != pdFALSE ) &&
+                    ( memcmp( pxTemplate->ucHeaders, pxMACAddress->ucBytes, ipMAC_ADDRESS_LENGTH_BYTES ) != 0 ) )
+                {
+                    tsnsocketDROP_TEMPLATE( pxSocket );
+                }
+            }
+        }
+        taskEXIT_CRITICAL();
+    #else /* if ( tsnconfigSOCKET_TEMPLATE_REVALIDATE_MS > 0 ) */
+        ( void ) pxNeighbor;
+        ( void ) xIsIPv6;
+        ( void ) pxMACAddress;
+    #endif /* if ( tsnconfigSOCKET_TEMPLATE_REVALIDATE_MS > 0 ) */
+}
+
+/**
+ * @brief Write the VLAN tags of the socket and the frame type of a frame
+ *
+ * If the wrapper inserts the tags, the tags of the interface are written
+ * here, in the room reserved by prvGetPayloadOffset(), so that the wrapper
+ * does not have to resize the frame. The room of an R-TAG gets an R-TAG with
+ * sequence number 0, which the wrapper sets with pxFRERTxTag().
+ *
+ * @param pxSocket The sending socket
+ * @param pxEthernetHeader The ethernet header, with the MAC addresses set
+ * @param usFrameType The EtherType following the tags, in network byte order
+ * @param uxTagsLength The length of the tags, from prvGetTagsLength()
+ * @return pdPASS on success, pdFAIL if the socket has an invalid tag count,
+ * or if its tags changed since the length was taken
+ */
+static BaseType_t prvSetFrameType( const FreeRTOS_TSN_Socket_t * pxSocket,
+                                   EthernetHeader_t * pxEthernetHeader,
+                                   uint16_t usFrameType,
+                                   size_t uxTagsLength )
+{
+    const uint8_t ucNumTags = prvGetVLANTagsCount( pxSocket );
+    const size_t uxVLANTagsLength = ucNumTags * sizeof( struct xVLAN_TAG );
+    uint16_t usSTagTCI, usCTagTCI;
+
+    if( ucNumTags > 2U )
+    {
+        return pdFAIL;
+    }
+
+    prvGetVLANTagsTCI( pxSocket, ucNumTags, &usSTagTCI, &usCTagTCI );
+
+    if( uxTagsLength == uxVLANTagsLength )
+    {
+        vVLANTagsWrite( ( uint8_t * ) pxEthernetHeader, ucNumTags, usSTagTCI, usCTagTCI, usFrameType );
+    }
+    else if( uxTagsLength == uxVLANTagsLength + sizeof( struct xFRER_RTAG ) )
+    {
+        uint8_t * const pucRTag = &( ( uint8_t * ) pxEthernetHeader )[ vlantagETH_TAG_OFFSET + uxVLANTagsLength ];
+        struct xFRER_RTAG xRTag;
+
+        xRTag.usTPID = FreeRTOS_htons( frerRTAG_TPID );
+        xRTag.usReserved = 0U;
+        xRTag.usSequenceNumber = 0U;
+
+        vVLANTagsWrite( ( uint8_t * ) pxEthernetHeader, ucNumTags, usSTagTCI, usCTagTCI, xRTag.usTPID );
+        memcpy( pucRTag, &xRTag, sizeof( xRTag ) );
+        memcpy( &pucRTag[ sizeof( xRTag ) ], &usFrameType, sizeof( usFrameType ) );
+    }
+    else
+    {
+        return pdFAIL;
+    }
+
+    return pdPASS;
+}
+
+/**
+ * @brief Prepare a buffer for sending UDPv4 packets.
+ *
+ * This function prepares a buffer for sending UDPv4 packets. It sets the necessary headers,
+ * including Ethernet, IP, and UDP headers, and performs ARP cache lookup to obtain the
+ * destination MAC address.
+ * If the destination is not resolved yet and tsnconfigARP_PENDING_DESTINATIONS
+ * is enabled, the frame is prepared all the same, without the destination
+ * MAC address, and pxResolved is set to pdFALSE.
+ *
+ * @param pxSocket The TSN socket.
+ * @param pxBuf The network buffer descriptor.
+ * @param xFlags The flags for the send operation.
+ * @param pxDestinationAddress The destination address.
+ * @param xDestinationAddressLength The length of the destination address.
+ * @param uxVLANOffset The length of the tags, see prvGetTagsLength().
+ * @param[out] pxResolved pdTRUE if the destination MAC address is set.
+ * @return pdPASS if the buffer is prepared successfully, pdFAIL otherwise.
+ */
+BaseType_t prvPrepareBufferUDPv4( FreeRTOS_TSN_Socket_t * pxSocket,
+                                  NetworkBufferDescriptor_t * pxBuf,
+                                  BaseType_t xFlags,
+                                  const struct freertos_sockaddr * pxDestinationAddress,
+                                  BaseType_t xDestinationAddressLength,
+                                  size_t uxVLANOffset,
+                                  BaseType_t * pxResolved )
+{
+    EthernetHeader_t * pxEthernetHeader;
+    IPHeader_t * pxIPHeader;
+    UDPHeader_t * pxUDPHeader;
+    eARPLookupResult_t eReturned;
+    NetworkEndPoint_t * pxEndPoint = NULL;
+    uint32_t ulNextHop = pxBuf->xIPAddress.ulIP_IPv4;
+
+    // Calculate the payload size
+    const size_t uxPayloadSize = pxBuf->xDataLength - sizeof( UDPPacket_t ) - uxVLANOffset;
+
+    pxEthernetHeader = ( EthernetHeader_t * ) pxBuf->pucEthernetBuffer;
+
+    // Reset the destination MAC address to avoid random garbage matches in the ARP tables
+    memset( &pxEthernetHeader->xDestinationAddress, '\0', sizeof( MACAddress_t ) );
+
+    // Perform ARP cache lookup to obtain the destination MAC address, the next hop may become the gateway
+    eReturned = eTSNARPGetCacheEntry( &ulNextHop, &( pxEthernetHeader->xDestinationAddress ), &( pxEndPoint ) );
+    *pxResolved = pdTRUE;
+
+    #if ( tsnconfigARP_PENDING_DESTINATIONS > 0 )
+        // Queue behind the frames already waiting for this destination
+        if( ( eReturned == eARPCacheHit ) && ( xTSNARPIsPending( pxBuf->xIPAddress.ulIP_IPv4 ) != pdFALSE ) )
+        {
+            eReturned = eARPCacheMiss;
+        }
+
+        if( eReturned == eARPCacheMiss )
+        {
+            if( pxEndPoint == NULL )
+            {
+                pxEndPoint = FreeRTOS_FindEndPointOnNetMask( ulNextHop, 0 );
+            }
+
+            if( pxEndPoint == NULL )
+            {
+                pxEndPoint = ( ( FreeRTOS_Socket_t * ) pxSocket->xBaseSocket )->pxEndPoint;
+            }
+
+            if( pxEndPoint != NULL )
+            {
+                // Sent once the controller finds the destination in the ARP cache
+                memset( &pxEthernetHeader->xDestinationAddress, '\0', sizeof( MACAddress_t ) );
+                *pxResolved = pdFALSE;
+                eReturned = eARPCacheHit;
+            }
+        }
+    #endif /* if ( tsnconfigARP_PENDING_DESTINATIONS > 0 ) */
+
+    if( eReturned != eARPCacheHit )
+    {
+        FreeRTOS_debug_printf( ( "sendto: IP is not in ARP cache\n" ) );
+        return pdFAIL;
+    }
+
+    pxBuf->pxEndPoint = pxEndPoint;
+
+    // Copy the source MAC address from the endpoint to the Ethernet header
+    ( void ) memcpy( pxEthernetHeader->xSourceAddress.ucBytes, pxEndPoint->xMACAddress.ucBytes, ( size_t ) ipMAC_ADDRESS_LENGTH_BYTES );
+
+    if( prvSetFrameType( pxSocket, pxEthernetHeader, ipIPv4_FRAME_TYPE, uxVLANOffset ) != pdPASS )
+    {
+        return pdFAIL;
+    }
+
+    // Set the IP header
+    pxIPHeader = ( IPHeader_t * ) &pxBuf->pucEthernetBuffer[ ipSIZE_OF_ETH_HEADER + uxVLANOffset ];
+    pxIPHeader->ucVersionHeaderLength = ipIPV4_VERSION_HEADER_LENGTH_MIN;
+    diffservSET_DSCLASS_IPv4( pxIPHeader, pxSocket->ucDSClass );
+    pxIPHeader->usLength = uxPayloadSize + sizeof( IPHeader_t ) + sizeof( UDPHeader_t );
+    pxIPHeader->usLength = FreeRTOS_htons( pxIPHeader->usLength );
+    pxIPHeader->usIdentification = prvTakeIPIdentification( pxSocket );
+    pxIPHeader->usFragmentOffset = 0;
+    pxIPHeader->ucTimeToLive = ipconfigUDP_TIME_TO_LIVE;
+    pxIPHeader->ucProtocol = ipPROTOCOL_UDP;
+    pxIPHeader->ulSourceIPAddress = pxBuf->pxEndPoint->ipv4_settings.ulIPAddress;
+    pxIPHeader->ulDestinationIPAddress = pxBuf->xIPAddress.ulIP_IPv4;
+
+    // Set the UDP header
+    pxUDPHeader = ( UDPHeader_t * ) &pxBuf->pucEthernetBuffer[ ipSIZE_OF_ETH_HEADER + uxVLANOffset + ipSIZE_OF_IPv4_HEADER ];
+    pxUDPHeader->usDestinationPort = pxBuf->usPort;
+    pxUDPHeader->usSourcePort = pxBuf->usBoundPort;
+    pxUDPHeader->usLength = ( uint16_t ) ( uxPayloadSize + sizeof( UDPHeader_t ) );
+    pxUDPHeader->usLength = FreeRTOS_htons( pxUDPHeader->usLength );
+
+    // Calculate the IP checksum, then the UDP one
+    #if ( ipconfigDRIVER_INCLUDED_TX_IP_CHECKSUM == 0 )
+    {
+        pxIPHeader->usHeaderChecksum = 0U;
+        pxIPHeader->usHeaderChecksum = usChecksumIPv4Header( pxIPHeader );
+    }
+    #else
+    {
+        pxIPHeader->usHeaderChecksum = 0U;
+    }
+    #endif
+
+    prvFinaliseBufferUDPv4( pxSocket, pxBuf, uxVLANOffset );
+
+    return pdPASS;
+}
+
+#if ( ipconfigUSE_IPv6 != 0 )
+
+/**
+ * @brief Prepares a UDPv6 buffer for transmission.
+ *
+ * The IPv6 counterpart of prvPrepareBufferUDPv4(). The destination MAC
+ * address is taken from the neighbor cache of Plus TCP. On a miss a neighbor
+ * solicitation is sent and the preparation fails, as Plus TCP does for its
+ * own sockets.
+ *
+ * @param pxSocket The socket to which the buffer belongs.
+ * @param pxBuf The network buffer descriptor to be prepared, with the
+ * destination address in xIPAddress.
+ * @param xFlags Flags to control the behavior of the function.
+ * @param pxDestinationAddress Pointer to the destination address structure.
+ * @param xDestinationAddressLength Length of the destination address.
+ * @param uxVLANOffset The length of the tags, see prvGetTagsLength().
+ *
+ * @return pdFAIL if the buffer preparation fails, pdPASS otherwise.
+ */
+    BaseType_t prvPrepareBufferUDPv6( FreeRTOS_TSN_Socket_t * pxSocket,
+                                      NetworkBufferDescriptor_t * pxBuf,
+                                      BaseType_t xFlags,
+                                      const struct freertos_sockaddr * pxDestinationAddress,
+                                      BaseType_t xDestinationAddressLength,
+                                      size_t uxVLANOffset )
+    {
+        EthernetHeader_t * pxEthernetHeader;
+        IPHeader_IPv6_t * pxIPHeader;
+        UDPHeader_t * pxUDPHeader;
+        eARPLookupResult_t eReturned;
+        NetworkEndPoint_t * pxEndPoint = NULL;
+        IPv6_Address_t xNextHop;
+
+        const size_t uxUDPLength = pxBuf->xDataLength - ipSIZE_OF_ETH_HEADER - uxVLANOffset - ipSIZE_OF_IPv6_HEADER;
+
+        ( void ) xFlags;
+        ( void ) pxDestinationAddress;
+        ( void ) xDestinationAddressLength;
+
+        pxEthernetHeader = ( EthernetHeader_t * ) pxBuf->pucEthernetBuffer;
+        memset( &pxEthernetHeader->xDestinationAddress, '\0', sizeof( MACAddress_t ) );
+
+        // Multicast destinations are mapped to their MAC address by the lookup
+        memcpy( xNextHop.ucBytes, pxBuf->xIPAddress.xIP_IPv6.ucBytes, ipSIZE_OF_IPv6_ADDRESS );
+        eReturned = eNDGetCacheEntry( &xNextHop, &( pxEthernetHeader->xDestinationAddress ), &( pxEndPoint ) );
+
+        if( ( eReturned == eARPCacheHit ) && ( pxEndPoint == NULL ) )
+        {
+            pxEndPoint = FreeRTOS_FindEndPointOnNetMask_IPv6( &pxBuf->xIPAddress.xIP_IPv6 );
+        }
+
+        if( eReturned == eARPCacheMiss )
+        {
+            vTSNNDSendSolicitation( &xNextHop );
+        }
+
+        if( ( eReturned != eARPCacheHit ) || ( pxEndPoint == NULL ) || ( pxEndPoint->bits.bIPv6 == pdFALSE_UNSIGNED ) )
+        {
+            FreeRTOS_debug_printf( ( "sendto: IP is not in ND cache\n" ) );
+            return pdFAIL;
+        }
+
+        pxBuf->pxEndPoint = pxEndPoint;
+
+        ( void ) memcpy( pxEthernetHeader->xSourceAddress.ucBytes, pxEndPoint->xMACAddress.ucBytes, ( size_t ) ipMAC_ADDRESS_LENGTH_BYTES );
+
+        if( prvSetFrameType( pxSocket, pxEthernetHeader, ipIPv6_FRAME_TYPE, uxVLANOffset ) != pdPASS )
+        {
+            return pdFAIL;
+        }
+
+        // Set the IP header, the UDP datagram is the whole payload
+        pxIPHeader = ( IPHeader_IPv6_t * ) &pxBuf->pucEthernetBuffer[ ipSIZE_OF_ETH_HEADER + uxVLANOffset ];
+        pxIPHeader->ucVersionTrafficClass = 0x60U;
+        pxIPHeader->ucTrafficClassFlow = 0U;
+        pxIPHeader->usFlowLabel = 0U;
+        diffservSET_DSCLASS_IPv6( pxIPHeader, pxSocket->ucDSClass );
+        pxIPHeader->usPayloadLength = FreeRTOS_htons( ( uint16_t ) uxUDPLength );
+        pxIPHeader->ucNextHeader = ipPROTOCOL_UDP;
+        pxIPHeader->ucHopLimit = ipconfigUDP_TIME_TO_LIVE;
+        memcpy( pxIPHeader->xSourceAddress.ucBytes, pxEndPoint->ipv6_settings.xIPAddress.ucBytes, ipSIZE_OF_IPv6_ADDRESS );
+        memcpy( pxIPHeader->xDestinationAddress.ucBytes, pxBuf->xIPAddress.xIP_IPv6.ucBytes, ipSIZE_OF_IPv6_ADDRESS );
+
+        // Set the UDP header
+        pxUDPHeader = ( UDPHeader_t * ) &pxBuf->pucEthernetBuffer[ ipSIZE_OF_ETH_HEADER + uxVLANOffset + ipSIZE_OF_IPv6_HEADER ];
+        pxUDPHeader->usDestinationPort = pxBuf->usPort;
+        pxUDPHeader->usSourcePort = pxBuf->usBoundPort;
+        pxUDPHeader->usLength = FreeRTOS_htons( ( uint16_t ) uxUDPLength );
+
+        prvFinaliseBufferUDPv6( pxBuf, uxVLANOffset );
+
+        return pdPASS;
+    }
+
+#endif /* if ( ipconfigUSE_IPv6 != 0 ) */
+
+/**
+ * @brief Creates a TSN socket.
+ *
+ * This function creates a TSN socket with the specified domain, type, and protocol.
+ * UDP sockets and raw layer 2 sockets, i.e. FREERTOS_SOCK_RAW sockets of
+ * the FREERTOS_AF_PACKET domain, are supported at the moment. Raw sockets
+ * must be bound to an EtherType with FreeRTOS_TSN_bind().
+ *
+ * @param xDomain   The domain of the socket.
+ * @param xType     The type of the socket.
+ * @param xProtocol The protocol of the socket.
+ *
+ * @return The created TSN socket, or FREERTOS_TSN_INVALID_SOCKET if an error occurred.
+ */
+TSNSocket_t FreeRTOS_TSN_socket(BaseType_t xDomain,
+                                BaseType_t xType,
+                                BaseType_t xProtocol)
+{
+    BaseType_t xIsRaw = pdFALSE;
+
+    // Check if the socket type is supported
+    if ((xDomain == FREERTOS_AF_PACKET) && (xType == FREERTOS_SOCK_RAW))
+    {
+        /* The Plus TCP socket only holds the received frames */
+        xIsRaw = pdTRUE;
+        xDomain = FREERTOS_AF_INET;
+        xType = FREERTOS_SOCK_DGRAM;
+        xProtocol = FREERTOS_IPPROTO_UDP;
+    }
+    else if (xType != FREERTOS_SOCK_DGRAM)
+    {
+        /* Only UDP is supported up to now */
+        return FREERTOS_TSN_INVALID_SOCKET;
+    }
+
+    // Allocate memory for the TSN socket
+    TSNSocket_t pxSocket = (TSNSocket_t)pvPortMalloc(sizeof(FreeRTOS_TSN_Socket_t));
+
+    if (pxSocket == NULL)
+    {
+        return FREERTOS_TSN_INVALID_SOCKET;
+    }
+
+    memset(pxSocket, 0, sizeof(FreeRTOS_TSN_Socket_t));
+    pxSocket->xIsRaw = xIsRaw;
+
+    // Create the underlying base socket
+    pxSocket->xBaseSocket = FreeRTOS_socket(xDomain, xType, xProtocol);
+
+    if (pxSocket->xBaseSocket == FREERTOS_INVALID_SOCKET)
+    {
+        vPortFree(pxSocket);
+        return FREERTOS_TSN_INVALID_SOCKET;
+    }
+
+    // Create the error queue
+    pxSocket->xErrQueue = xQueueCreate(tsnconfigERRQUEUE_LENGTH, sizeof(struct msghdr *));
+
+    if (pxSocket->xErrQueue == NULL)
+    {
+        vPortFree(pxSocket);
+        return FREERTOS_TSN_INVALID_SOCKET;
+    }
+
+    // Initialize the bound socket list item
+    vListInitialiseItem(&(pxSocket->xBoundSocketListItem));
+    listSET_LIST_ITEM_OWNER(&(pxSocket->xBoundSocketListItem), (void *)pxSocket);
+
+    return pxSocket;
+}
+
+/**
+ * @brief Set socket options for a TSN socket.
+ *
+ * This function sets various options for a TSN socket.
+ *
+ * @param xSocket The TSN socket to set options for.
+ * @param lLevel The level at which the option is defined.
+ * @param lOptionName The name of the option to set.
+ * @param pvOptionValue A pointer to the value of the option.
+ * @param uxOptionLength The length of the option value.
+ *
+ * @return pdPASS if the option is set successfully, or a negative value if an error occurs.
+ */
+BaseType_t FreeRTOS_TSN_setsockopt( TSNSocket_t xSocket,
+                                    int32_t lLevel,
+                                    int32_t lOptionName,
+                                    const void * pvOptionValue,
+                                    size_t uxOptionLength )
+{
+    BaseType_t xReturn = -pdFREERTOS_ERRNO_EINVAL;
+    FreeRTOS_TSN_Socket_t * pxSocket = ( FreeRTOS_TSN_Socket_t * ) xSocket;
+    BaseType_t ulOptionValue = *( BaseType_t * ) pvOptionValue;
+
+    if( xSocketValid( pxSocket->xBaseSocket ) == pdTRUE )
+    {
+        switch( lOptionName )
+        {
+            #if ( tsnconfigSOCKET_INSERTS_VLAN_TAGS != tsnconfigDISABLE )
+                case FREERTOS_SO_VLAN_CTAG_PCP:
+
+                    // Set the PCP value from the TCI
+                    if( ulOptionValue < 8 )
+                    {
+                        vlantagSET_PCP_FROM_TCI( pxSocket->usVLANCTagTCI, ulOptionValue );
+
+                        // If no VLAN tags are set, set the count to 1
+                        if( pxSocket->ucVLANTagsCount == 0 )
+                        {
+                            pxSocket->ucVLANTagsCount = 1;
+                        }
+
+                        tsnsocketDROP_TEMPLATE( pxSocket );
+                        xReturn = 0;
+                    }
+
+                    break;
+
+                case FREERTOS_SO_VLAN_STAG_PCP:
+
+                    // Set the PCP value from the TCI
+                    if( ulOptionValue < 8 )
+                    {
+                        vlantagSET_PCP_FROM_TCI( pxSocket->usVLANSTagTCI, ulOptionValue );
+
+                        // Set the VLAN tags count to 2
+                        pxSocket->ucVLANTagsCount = 2;
+                        tsnsocketDROP_TEMPLATE( pxSocket );
+                        xReturn = 0;
+                    }
+
+                    break;
+
+                case FREERTOS_SO_VLAN_TAG_RST:
+                    // Reset the VLAN tags count
+                    pxSocket->ucVLANTagsCount = 0;
+                    tsnsocketDROP_TEMPLATE( pxSocket );
+                    xReturn = 0;
+                    break;
+            #endif /* if ( tsnconfigSOCKET_INSERTS_VLAN_TAGS != tsnconfigDISABLE ) */
+
+			/* In feature may want to replace this to provide an interface
+			 * similar to the Linux sockets' IP_TOS field.
+			 */
+            case FREERTOS_SO_DS_CLASS:
+
+                // Set the DS class value
+                if( ulOptionValue < 64 )
+                {
+                    pxSocket->ucDSClass = ulOptionValue;
+
+                    #if ( tsnconfigSOCKET_TEMPLATE_REVALIDATE_MS > 0 )
+                        if( pxSocket->xTemplate.ucLength != 0U )
+                        {
+                            // Remark the cached header, no need to build it again
+                            prvTemplateSetDSClass( pxSocket );
+                        }
+                    #endif
+
+                    xReturn = 0;
+                }
+
+                break;
+
+            case FREERTOS_SO_TIMESTAMPING:
+
+                // Set the timestamping flags
+                if( ulOptionValue & ~SOF_TIMESTAMPING_MASK )
+                {
+                    xReturn = pdFREERTOS_ERRNO_EINVAL;
+                }
+                else
+                {
+                    // Reset the error queue and set the timestamping flags
+                    ( void ) xQueueReset( pxSocket->xErrQueue );
+                    pxSocket->ulTSFlags = ulOptionValue;
+                    xReturn = 0;
+                }
+
+                break;
+
+            case FREERTOS_SO_TSN_RXINFO:
+
+                // Enable the FREERTOS_SCM_TSN_RXINFO control messages
+                pxSocket->ucRxInfo = ( ulOptionValue != 0 ) ? pdTRUE : pdFALSE;
+                xReturn = 0;
+
+                break;
+
+            default:
+                // Call the base socket's setsockopt function
+                xReturn = FreeRTOS_setsockopt( pxSocket->xBaseSocket, lLevel, lOptionName, pvOptionValue, uxOptionLength );
+                break;
+        }
+    }
+    else
+    {
+        xReturn = -pdFREERTOS_ERRNO_EINVAL;
+    }
+
+    return xReturn;
+}
+
+/**
+ * @brief Bind a raw TSN socket to an EtherType and a VID
+ *
+ * The frames are sent from the MAC address of the first endpoint. If the
+ * socket inserts the VLAN tags and a VID other than 0 is given, the frames
+ * are tagged with that VID.
+ *
+ * @param pxSocket The raw socket
+ * @param pxLinkAddress The EtherType and VID to bind
+ * @param xAddressLength The length of the address structure
+ * @return 0 on success, or a negative error code
+ */
+static BaseType_t prvBindRaw( FreeRTOS_TSN_Socket_t * pxSocket,
+                              const struct freertos_sockaddr_ll * pxLinkAddress,
+                              socklen_t xAddressLength )
+{
+    NetworkEndPoint_t * pxEndPoint;
+    BaseType_t xReturn = 0;
+
+    if( ( pxLinkAddress == NULL ) || ( xAddressLength < ( socklen_t ) sizeof( struct freertos_sockaddr_ll ) ) ||
+        ( pxLinkAddress->sll_family != FREERTOS_AF_PACKET ) )
+    {
+        return -pdFREERTOS_ERRNO_EINVAL;
+    }
+
+    // IP and ARP are left to Plus TCP, the tags never reach the sockets
+    if( !tsnsocketIS_RAW_FRAME_TYPE( pxLinkAddress->sll_protocol ) || tsnsocketIS_TAG_TPID( pxLinkAddress->sll_protocol ) ||
+        ( ( pxLinkAddress->sll_vid > vlantagVID_BIT_MASK ) && ( pxLinkAddress->sll_vid != FREERTOS_TSN_ANY_VID ) ) )
+    {
+        return -pdFREERTOS_ERRNO_EINVAL;
+    }
+
+    pxEndPoint = FreeRTOS_FirstEndPoint( NULL );
+
+    if( pxEndPoint == NULL )
+    {
+        return -pdFREERTOS_ERRNO_EADDRNOTAVAIL;
+    }
+
+    // Checked and inserted at once, against a concurrent bind of the same address
+    taskENTER_CRITICAL();
+    {
+        if( tsnsocketSOCKET_IS_BOUND( pxSocket ) )
+        {
+            xReturn = -pdFREERTOS_ERRNO_EINVAL;
+        }
+
+        #if ( tsnconfigSHARED_BUFFER_POOL_SIZE == 0 )
+            else
+            {
+                // Without shared buffers a frame is received by a single socket
+                const FreeRTOS_TSN_Socket_t * pxBound = prvRawSocketFind( pxLinkAddress->sll_protocol, pxLinkAddress->sll_vid );
+
+                if( ( pxBound != NULL ) && ( pxBound->usVID == pxLinkAddress->sll_vid ) )
+                {
+                    xReturn = -pdFREERTOS_ERRNO_EADDRINUSE;
+                }
+            }
+        #endif
+
+        if( xReturn == 0 )
+        {
+            pxSocket->usEtherType = pxLinkAddress->sll_protocol;
+            pxSocket->usVID = pxLinkAddress->sll_vid;
+            pxSocket->pxEndPoint = pxEndPoint;
+
+            tsnsocketSET_SOCKET_PORT( pxSocket, pxSocket->usEtherType );
+            vListInsertEnd( &xTSNBoundRawSocketList, &( pxSocket->xBoundSocketListItem ) );
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    if( xReturn != 0 )
+    {
+        return xReturn;
+    }
+
+    #if ( tsnconfigSOCKET_INSERTS_VLAN_TAGS != tsnconfigDISABLE )
+        if( ( pxSocket->usVID != 0U ) && ( pxSocket->usVID != FREERTOS_TSN_ANY_VID ) )
+        {
+            vlantagSET_VID_FROM_TCI( pxSocket->usVLANCTagTCI, pxSocket->usVID );
+
+            if( pxSocket->ucVLANTagsCount == 0 )
+            {
+                pxSocket->ucVLANTagsCount = 1;
+            }
+        }
+    #endif
+
+    return 0;
+}
+
+/**
+ * @brief Binds a TSN socket to a specific address.
+ *
+ * This function binds a TSN socket to a specific address specified by `pxAddress`.
  * The `xAddressLength` parameter specifies the length of the address structure.
+ * Raw sockets are bound to a freertos_sockaddr_ll instead, holding the
+ * EtherType and the VID of the frames to receive, see prvBindRaw().
+ *
+ * @param xSocket The TSN socket to bind.
+ * @param pxAddress Pointer to the address structure.
+ * @param xAddressLength The length of the address structure.
+ *
+ * @return If the socket is successfully bound, the function returns 0. Otherwise, it returns a negative value.
+ */
+BaseType_t FreeRTOS_TSN_bind( TSNSocket_t xSocket,
+                              struct freertos_sockaddr const * pxAddress,
+                              socklen_t xAddressLength )
+{
+    BaseType_t xRet;
+    FreeRTOS_TSN_Socket_t * pxSocket = ( FreeRTOS_TSN_Socket_t * ) xSocket;
+    FreeRTOS_Socket_t * pxBaseSocket = ( FreeRTOS_Socket_t * ) pxSocket->xBaseSocket;
+
+    if( pxSocket->xIsRaw != pdFALSE )
+    {
+        return prvBindRaw( pxSocket, ( const struct freertos_sockaddr_ll * ) pxAddress, xAddressLength );
+    }
+
+    // Bind the base socket
+    xRet = FreeRTOS_bind( pxSocket->xBaseSocket, pxAddress, xAddressLength );
+
+    if( xRet == 0 )
+    {
+        // Set the socket port
+        tsnsocketSET_SOCKET_PORT( pxSocket, FreeRTOS_htons( pxBaseSocket->usLocalPort ) );
+
+        taskENTER_CRITICAL();
+        {
+            // Insert the socket into the bound UDP socket list, which the controllers walk
+            vListInsertEnd( &xTSNBoundUDPSocketList, &( pxSocket->xBoundSocketListItem ) );
+
+            #if ( tsnconfigSOCKET_HASH_SIZE > 0 )
+                if( prvSocketHashInsert( pxSocket ) != pdPASS )
+                {
+                    xTSNSocketHashOverflow = pdTRUE;
+                }
+            #endif
+        }
+        taskEXIT_CRITICAL();
+    }
+
+    return xRet;
+}
+
+/**
+ * @brief Sets the default destination of a TSN socket.
+ *
+ * Frames sent with FreeRTOS_TSN_send(), or with a NULL destination, go to
+ * the connected address. The headers of the first frame sent to that
+ * address are cached, so that the following frames only copy them and patch
+ * the lengths and checksums, see tsnconfigSOCKET_TEMPLATE_REVALIDATE_MS.
+ * If the address is not in the ARP or neighbor cache, a request is sent
+ * and the call still succeeds. Received frames are not filtered by the connected address.
+ * Connecting to an address of family FREERTOS_AF_UNSPEC removes the
+ * default destination. Raw sockets connect to a freertos_sockaddr_ll
+ * holding the destination MAC address.
+ *
+ * @param xSocket The bound TSN socket.
+ * @param pxAddress The destination address.
+ * @param xAddressLength The length of the address structure.
+ *
+ * @return 0 on success, or a negative error code.
+ */
+BaseType_t FreeRTOS_TSN_connect( TSNSocket_t xSocket,
+                                 struct freertos_sockaddr const * pxAddress,
+                                 socklen_t xAddressLength )
+{
+    FreeRTOS_TSN_Socket_t * pxSocket = ( FreeRTOS_TSN_Socket_t * ) xSocket;
+    MACAddress_t xMACAddress;
+    NetworkEndPoint_t * pxEndPoint = NULL;
+    uint32_t ulIPAddress;
+    size_t uxAddressSize = sizeof( struct freertos_sockaddr );
+
+    #if ( ipconfigUSE_IPv6 != 0 )
+        IPv6_Address_t xIPv6Address;
+    #endif
+
+    if( ( pxSocket == NULL ) || ( pxSocket == FREERTOS_TSN_INVALID_SOCKET ) || ( pxAddress == NULL ) )
+    {
+        return -pdFREERTOS_ERRNO_EINVAL;
+    }
+
+    if( pxAddress->sin_family == FREERTOS_AF_PACKET )
+    {
+        uxAddressSize = sizeof( struct freertos_sockaddr_ll );
+    }
+
+    if( xAddressLength < ( socklen_t ) uxAddressSize )
+    {
+        return -pdFREERTOS_ERRNO_EINVAL;
+    }
+
+    if( !tsnsocketSOCKET_IS_BOUND( pxSocket ) )
+    {
+        FreeRTOS_debug_printf( ( "connect: socket is not bound\n" ) );
+        return -pdFREERTOS_ERRNO_EBADF;
+    }
+
+    pxSocket->xIsConnected = pdFALSE;
+    tsnsocketDROP_TEMPLATE( pxSocket );
+
+    switch( pxAddress->sin_family )
+    {
+        case FREERTOS_AF_UNSPEC:
+            return 0;
+
+        case FREERTOS_AF_PACKET:
+
+            if( pxSocket->xIsRaw == pdFALSE )
+            {
+                return -pdFREERTOS_ERRNO_EAFNOSUPPORT;
+            }
+
+            break;
+
+        #if ( ipconfigUSE_IPv4 != 0 )
+            case FREERTOS_AF_INET4:
+        #endif
+        #if ( ipconfigUSE_IPv6 != 0 )
+            case FREERTOS_AF_INET6:
+        #endif
+
+            if( pxSocket->xIsRaw != pdFALSE )
+            {
+                return -pdFREERTOS_ERRNO_EAFNOSUPPORT;
+            }
+
+            break;
+
+        default:
+            return -pdFREERTOS_ERRNO_EAFNOSUPPORT;
+    }
+
+    memset( &pxSocket->xConnectedAddress, 0, sizeof( pxSocket->xConnectedAddress ) );
+    memcpy( &pxSocket->xConnectedAddress, pxAddress, uxAddressSize );
+    pxSocket->xIsConnected = pdTRUE;
+
+    // There is nothing to resolve for link layer destinations
+    if( pxSocket->xIsRaw != pdFALSE )
+    {
+        return 0;
+    }
+
+    // Start resolving the destination, so that the first frame finds it
+    #if ( ipconfigUSE_IPv6 != 0 )
+        if( pxAddress->sin_family == FREERTOS_AF_INET6 )
+        {
+            memcpy( xIPv6Address.ucBytes, pxAddress->sin_address.xIP_IPv6.ucBytes, ipSIZE_OF_IPv6_ADDRESS );
+
+            if( eNDGetCacheEntry( &xIPv6Address, &xMACAddress, &pxEndPoint ) == eARPCacheMiss )
+            {
+                vTSNNDSendSolicitation( &xIPv6Address );
+            }
+
+            return 0;
+        }
+    #endif /* if ( ipconfigUSE_IPv6 != 0 ) */
+
+    ulIPAddress = pxAddress->sin_address.ulIP_IPv4;
+
+    if( eTSNARPGetCacheEntry( &ulIPAddress, &xMACAddress, &pxEndPoint ) == eARPCacheMiss )
+    {
+        FreeRTOS_OutputARPRequest( ulIPAddress );
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Take the network buffer out of the msghdr it carries
+ *
+ * Received network buffers point to their ancillary message while they are
+ * waiting in the socket, see prvReceiveUDPPacketTSN(). Restore the original
+ * ethernet buffer, i.e. the start of the buffer before the VLAN tags were
+ * stripped. The frame without the tags stays in the iovec of the message.
+ *
+ * @param pxNetworkBuffer The network buffer removed from the socket list
+ * @return The ancillary message of the buffer
+ */
+static struct msghdr * prvDetachMsghdr( NetworkBufferDescriptor_t * pxNetworkBuffer )
+{
+    struct msghdr * pxMsgh = ( struct msghdr * ) pxNetworkBuffer->pucEthernetBuffer;
+
+    pxNetworkBuffer->pucEthernetBuffer = ( uint8_t * ) pxMsgh->msg_iov[ 0 ].iov_base -
+                                         pxAncillaryMsgGetMetadata( pxMsgh )->ucStrippedSize;
+
+    return pxMsgh;
+}
+
+/**
+ * @brief Release the frames waiting in a socket which is being closed
+ *
+ * Plus TCP would release them as plain network buffers, while they point to
+ * their ancillary message and may be shared with other sockets.
+ *
+ * @param pxSocket The TSN socket
+ */
+static void prvReleaseWaitingPackets( FreeRTOS_TSN_Socket_t * pxSocket )
+{
+    FreeRTOS_Socket_t * const pxBaseSocket = ( FreeRTOS_Socket_t * ) pxSocket->xBaseSocket;
+    NetworkBufferDescriptor_t * pxNetworkBuffer;
+
+    for( ; ; )
+    {
+        pxNetworkBuffer = NULL;
+
+        vTaskSuspendAll();
+        {
+            if( listCURRENT_LIST_LENGTH( &( pxBaseSocket->u.xUDP.xWaitingPacketsList ) ) > 0U )
+            {
+                pxNetworkBuffer = ( NetworkBufferDescriptor_t * ) listGET_OWNER_OF_HEAD_ENTRY( &( pxBaseSocket->u.xUDP.xWaitingPacketsList ) );
+                ( void ) uxListRemove( &( pxNetworkBuffer->xBufferListItem ) );
+            }
+        }
+        ( void ) xTaskResumeAll();
+
+        if( pxNetworkBuffer == NULL )
+        {
+            break;
+        }
+
+        vAncillaryMsgFreeAll( prvDetachMsghdr( pxNetworkBuffer ) );
+        vSharedBufferRelease( pxNetworkBuffer );
+    }
+}
+
+/**
+ * @brief Closes a TSN socket.
+ *
+ * This function closes the specified TSN socket.
+ *
+ * @param xSocket The TSN socket to be closed.
+ *
+ * @return If the socket is successfully closed, the function returns 0. Otherwise, it returns an error code.
+ */
+BaseType_t FreeRTOS_TSN_closesocket( TSNSocket_t xSocket )
+{
+    FreeRTOS_TSN_Socket_t * pxSocket = ( FreeRTOS_TSN_Socket_t * ) xSocket;
+
+    /*FreeRTOS_Socket_t * pxBaseSocket = ( FreeRTOS_Socket_t * ) pxSocket->xBaseSocket; */
+
+    // Check if the socket is invalid
+    if( xSocket == FREERTOS_TSN_INVALID_SOCKET )
+    {
+        return 0;
+    }
+
+    if( tsnsocketSOCKET_IS_BOUND( pxSocket ) )
+    {
+        taskENTER_CRITICAL();
+        {
+            #if ( tsnconfigSOCKET_HASH_SIZE > 0 )
+                // Raw sockets are not in the hash table
+                if( pxSocket->xIsRaw == pdFALSE )
+                {
+                    prvSocketHashRemove( pxSocket );
+                }
+            #endif
+
+            // Remove the socket from the bound socket list, which the controllers walk
+            ( void ) uxListRemove( &( pxSocket->xBoundSocketListItem ) );
+
+            #if ( tsnconfigSOCKET_HASH_SIZE > 0 )
+                if( listCURRENT_LIST_LENGTH( &xTSNBoundUDPSocketList ) == 0U )
+                {
+                    xTSNSocketHashOverflow = pdFALSE;
+                }
+            #endif
+
+            // Invalidate the sockets cached in the packets, before any task
+            // can miss the socket in the list or the hash table
+            if( ++uxTSNSocketGeneration == 0U )
+            {
+                uxTSNSocketGeneration = 1U;
+            }
+        }
+        taskEXIT_CRITICAL();
+    }
+
+    prvReleaseWaitingPackets( pxSocket );
+
+    // Close the base socket
+    return FreeRTOS_closesocket( pxSocket->xBaseSocket );
+}
+
+/* Bounds of the offset of a payload, used to validate zero copy buffers.
+ * The smallest offset is found in the untagged frames of raw sockets, the
+ * largest in received frames carrying two VLAN tags, an R-TAG and an IPv4
+ * header with options. The offset of a received payload counts the tags,
+ * which stay in front of the frame once stripped.
+ */
+#define tsnsocketMIN_PAYLOAD_OFFSET    ( ipSIZE_OF_ETH_HEADER )
+#define tsnsocketMAX_PAYLOAD_OFFSET    ( ipSIZE_OF_ETH_HEADER + 2U * sizeof( struct xVLAN_TAG ) + sizeof( struct xFRER_RTAG ) + 60U + ipSIZE_OF_UDP_HEADER )
+
+/* Max advance of the start of a received buffer, i.e. the tags stripped by
+ * the parser, which are included in the offset of a received payload */
+#define tsnsocketMAX_STRIPPED_SIZE     ( 2U * sizeof( struct xVLAN_TAG ) + sizeof( struct xFRER_RTAG ) )
+
+/**
+ * @brief Offset of the payload in the frames sent by a socket
+ *
+ * The payload follows the UDP header or, for raw sockets, the EtherType.
+ *
+ * @param pxSocket The TSN socket
+ * @param xFamily The address family of the destination
+ * @param[out] puxMaxPayloadLength The maximum payload length for the family
+ * @return The offset, or 0 if the family is not supported by the socket
+ */
+static size_t prvGetPayloadOffset( const FreeRTOS_TSN_Socket_t * pxSocket,
+                                   BaseType_t xFamily,
+                                   size_t * puxMaxPayloadLength )
+{
+    size_t uxPayloadOffset;
+
+    // Raw sockets only send to link layer addresses
+    if( ( pxSocket->xIsRaw != pdFALSE ) != ( xFamily == FREERTOS_AF_PACKET ) )
+    {
+        return 0;
+    }
+
+    switch( xFamily )
+    {
+        case FREERTOS_AF_PACKET:
+            uxPayloadOffset = ipSIZE_OF_ETH_HEADER;
+            *puxMaxPayloadLength = ipconfigNETWORK_MTU;
+            break;
+
+        #if ( ipconfigUSE_IPv6 != 0 )
+            case FREERTOS_AF_INET6:
+                uxPayloadOffset = ipSIZE_OF_ETH_HEADER + ipSIZE_OF_IPv6_HEADER + ipSIZE_OF_UDP_HEADER;
+                *puxMaxPayloadLength = ipconfigNETWORK_MTU - ( ipSIZE_OF_IPv6_HEADER + ipSIZE_OF_UDP_HEADER );
+                break;
+        #endif
+
+        #if ( ipconfigUSE_IPv4 != 0 )
+            case FREERTOS_AF_INET4:
+                uxPayloadOffset = ipSIZE_OF_ETH_HEADER + ipSIZE_OF_IPv4_HEADER + ipSIZE_OF_UDP_HEADER;
+                *puxMaxPayloadLength = ipconfigNETWORK_MTU - ( ipSIZE_OF_IPv4_HEADER + ipSIZE_OF_UDP_HEADER );
+                break;
+        #endif
+
+        default:
+            return 0;
+    }
+
+    uxPayloadOffset += prvGetTagsLength( pxSocket );
+
+    return uxPayloadOffset;
+}
+
+/**
+ * @brief Remember the payload offset of a zero copy buffer
+ *
+ * The offset is stored in the two bytes preceding the payload, i.e. in the
+ * UDP checksum field, or in the EtherType for raw sockets, which is only
+ * written when the frame is prepared and is not needed anymore once a frame
+ * is received.
+ *
+ * @param pucPayload The payload buffer handed to the application
+ * @param uxPayloadOffset Offset of the payload in the ethernet buffer
+ */
+static void prvZeroCopyStoreOffset( uint8_t * pucPayload,
+                                    size_t uxPayloadOffset )
+{
+    const uint16_t usOffset = ( uint16_t ) uxPayloadOffset;
+
+    memcpy( pucPayload - sizeof( usOffset ), &usOffset, sizeof( usOffset ) );
+}
+
+/**
+ * @brief Retrieve the network buffer of a zero copy payload
+ *
+ * @param pvPayload The payload buffer returned by FreeRTOS_TSN_GetUDPPayloadBuffer()
+ * @param[out] puxPayloadOffset Offset of the payload in the ethernet buffer
+ * @return The network buffer, or NULL if pvPayload is not a valid payload buffer
+ * or its descriptor does not point back to it
+ */
+static NetworkBufferDescriptor_t * prvZeroCopyToNetworkBuffer( const void * pvPayload,
+                                                               size_t * puxPayloadOffset )
+{
+    const uint8_t * const pucPayload = ( const uint8_t * ) pvPayload;
+    const uint8_t * pucStart;
+    NetworkBufferDescriptor_t * pxBuf;
+    uint16_t usOffset;
+
+    if( pucPayload == NULL )
+    {
+        return NULL;
+    }
+
+    memcpy( &usOffset, pucPayload - sizeof( usOffset ), sizeof( usOffset ) );
+
+    if( ( usOffset < tsnsocketMIN_PAYLOAD_OFFSET ) || ( usOffset > tsnsocketMAX_PAYLOAD_OFFSET ) )
+    {
+        return NULL;
+    }
+
+    pucStart = pucPayload - usOffset;
+    pxBuf = pxPacketBuffer_to_NetworkBuffer( pucStart );
+
+    /* As pxUDPPayloadBuffer_to_NetworkBuffer() does, make sure that the
+     * descriptor found before the ethernet buffer points back to it, so that
+     * a stray pointer or a corrupted offset is rejected. The start of a
+     * received buffer is past the stripped tags, which are counted in the
+     * offset. */
+    if( ( pxBuf == NULL ) || ( pxBuf->pucEthernetBuffer < pucStart ) ||
+        ( pxBuf->pucEthernetBuffer > &( pucStart[ tsnsocketMAX_STRIPPED_SIZE ] ) ) )
+    {
+        return NULL;
+    }
+
+    *puxPayloadOffset = usOffset;
+
+    return pxBuf;
+}
+
+/**
+ * @brief Get a network buffer to be filled in place and sent with zero copy
+ *
+ * The returned pointer is the start of the UDP payload, placed after room for
+ * the headers and the VLAN tags currently configured on the socket. Fill it
+ * and pass it to FreeRTOS_TSN_sendto() or FreeRTOS_TSN_sendmsg() with the
+ * FREERTOS_ZERO_COPY flag, to a destination of the same IP version. The
+ * VLAN options of the socket, or the VLAN tags of its interface if the
+ * wrapper inserts them, must not be changed in the meantime.
+ * If the buffer is not sent, it must be released with
+ * FreeRTOS_TSN_ReleaseUDPPayloadBuffer().
+ *
+ * @param xSocket The TSN socket which will send the buffer
+ * @param uxRequestedSizeBytes The size of the payload
+ * @param uxBlockTimeTicks Max time to wait for a network buffer
+ * @param ucIPType ipTYPE_IPv4 or ipTYPE_IPv6, ignored by raw sockets
+ * @return A pointer to the payload, or NULL on failure
+ */
+void * FreeRTOS_TSN_GetUDPPayloadBuffer( TSNSocket_t xSocket,
+                                         size_t uxRequestedSizeBytes,
+                                         TickType_t uxBlockTimeTicks,
+                                         uint8_t ucIPType )
+{
+    FreeRTOS_TSN_Socket_t * pxSocket = ( FreeRTOS_TSN_Socket_t * ) xSocket;
+    NetworkBufferDescriptor_t * pxBuf;
+    size_t uxPayloadOffset, uxMaxPayloadLength;
+    BaseType_t xFamily;
+
+    if( ( pxSocket == NULL ) || ( pxSocket == FREERTOS_TSN_INVALID_SOCKET ) )
+    {
+        return NULL;
+    }
+
+    if( pxSocket->xIsRaw != pdFALSE )
+    {
+        xFamily = FREERTOS_AF_PACKET;
+    }
+    else
+    {
+        xFamily = ( ucIPType == ( uint8_t ) ipTYPE_IPv6 ) ? FREERTOS_AF_INET6 : FREERTOS_AF_INET4;
+    }
+
+    uxPayloadOffset = prvGetPayloadOffset( pxSocket, xFamily, &uxMaxPayloadLength );
+
+    if( ( uxPayloadOffset == 0 ) || ( uxRequestedSizeBytes > uxMaxPayloadLength ) )
+    {
+        return NULL;
+    }
+
+    pxBuf = pxGetNetworkBufferWithDescriptor( uxRequestedSizeBytes + uxPayloadOffset, uxBlockTimeTicks );
+
+    if( pxBuf == NULL )
+    {
+        return NULL;
+    }
+
+    pxBuf->xDataLength = uxRequestedSizeBytes + uxPayloadOffset;
+    prvZeroCopyStoreOffset( &pxBuf->pucEthernetBuffer[ uxPayloadOffset ], uxPayloadOffset );
+
+    return &pxBuf->pucEthernetBuffer[ uxPayloadOffset ];
+}
+
+/**
+ * @brief Release a zero copy buffer
+ *
+ * Used both for buffers obtained with FreeRTOS_TSN_GetUDPPayloadBuffer()
+ * which have not been sent, and for payloads received with the
+ * FREERTOS_ZERO_COPY flag.
+ *
+ * @param pvBuffer The payload buffer
+ */
+void FreeRTOS_TSN_ReleaseUDPPayloadBuffer( void const * pvBuffer )
+{
+    size_t uxPayloadOffset;
+    NetworkBufferDescriptor_t * pxBuf = prvZeroCopyToNetworkBuffer( pvBuffer, &uxPayloadOffset );
+
+    configASSERT( pxBuf != NULL );
+
+    if( pxBuf != NULL )
+    {
+        vSharedBufferRelease( pxBuf );
+    }
+}
+
+/**
+ * @brief Prepare a buffer sent by a raw socket
+ *
+ * Only the ethernet header and the VLAN tags are written, the payload
+ * follows the EtherType of the socket.
+ *
+ * @param pxSocket The raw socket
+ * @param pxBuf The network buffer, with the payload at the socket offset
+ * @param pxDestinationAddress The destination, a freertos_sockaddr_ll
+ * @param xDestinationAddressLength The length of the destination address
+ * @param uxTagsLength The length of the tags, see prvGetTagsLength()
+ * @return pdPASS if the buffer is prepared successfully, pdFAIL otherwise
+ */
+static BaseType_t prvPrepareBufferRaw( FreeRTOS_TSN_Socket_t * pxSocket,
+                                       NetworkBufferDescriptor_t * pxBuf,
+                                       const struct freertos_sockaddr * pxDestinationAddress,
+                                       socklen_t xDestinationAddressLength,
+                                       size_t uxTagsLength )
+{
+    const struct freertos_sockaddr_ll * pxLinkAddress = ( const struct freertos_sockaddr_ll * ) pxDestinationAddress;
+    EthernetHeader_t * pxEthernetHeader = ( EthernetHeader_t * ) pxBuf->pucEthernetBuffer;
+
+    if( ( xDestinationAddressLength < ( socklen_t ) sizeof( struct freertos_sockaddr_ll ) ) ||
+        ( pxLinkAddress->sll_halen != ipMAC_ADDRESS_LENGTH_BYTES ) || ( pxSocket->pxEndPoint == NULL ) )
+    {
+        return pdFAIL;
+    }
+
+    // There are no ports, and nothing to resolve
+    pxBuf->pxEndPoint = pxSocket->pxEndPoint;
+    pxBuf->usPort = 0U;
+    pxBuf->usBoundPort = 0U;
+
+    ( void ) memcpy( pxEthernetHeader->xDestinationAddress.ucBytes, pxLinkAddress->sll_addr, ( size_t ) ipMAC_ADDRESS_LENGTH_BYTES );
+    ( void ) memcpy( pxEthernetHeader->xSourceAddress.ucBytes, pxSocket->pxEndPoint->xMACAddress.ucBytes, ( size_t ) ipMAC_ADDRESS_LENGTH_BYTES );
+
+    if( prvSetFrameType( pxSocket, pxEthernetHeader, pxSocket->usEtherType, uxTagsLength ) != pdPASS )
+    {
+        return pdFAIL;
+    }
+
+    prvPadFrame( pxBuf );
+
+    return pdPASS;
+}
+
+/**
+ * @brief Build the headers around a payload and fill the queue item
+ *
+ * @param pxSocket The sending socket
+ * @param pxBuf The network buffer, with the payload at the socket offset
+ * @param uxTotalDataLength The length of the payload
+ * @param uxPayloadOffset The offset of the payload, which sets the length of
+ * the tags
+ * @param xFlags Flags of the send operation
+ * @param pxDestinationAddress The destination address
+ * @param xDestinationAddressLength The length of the destination address
+ * @param[out] pxEvent The item to insert in the network queues
+ * @param[out] pxResolved pdFALSE if the item must wait for address resolution
+ * @return pdPASS if the frame is ready to be queued, pdFAIL otherwise
+ */
+static BaseType_t prvPrepareNetworkItem( FreeRTOS_TSN_Socket_t * pxSocket,
+                                         NetworkBufferDescriptor_t * pxBuf,
+                                         size_t uxTotalDataLength,
+                                         size_t uxPayloadOffset,
+                                         BaseType_t xFlags,
+                                         const struct freertos_sockaddr * pxDestinationAddress,
+                                         socklen_t xDestinationAddressLength,
+                                         NetworkQueueItem_t * pxEvent,
+                                         BaseType_t * pxResolved )
+{
+    FreeRTOS_Socket_t * pxBaseSocket = ( FreeRTOS_Socket_t * ) pxSocket->xBaseSocket;
+    BaseType_t xPrepared = pdFAIL;
+
+    *pxResolved = pdTRUE;
+
+    pxBuf->xDataLength = uxTotalDataLength + uxPayloadOffset;
+    pxBuf->pxEndPoint = pxBaseSocket->pxEndPoint;
+    pxBuf->usPort = pxDestinationAddress->sin_port;
+    pxBuf->usBoundPort = ( uint16_t ) tsnsocketGET_SOCKET_PORT( pxBaseSocket );
+
+    switch( pxDestinationAddress->sin_family )
+    {
+        case FREERTOS_AF_PACKET:
+            xPrepared = prvPrepareBufferRaw( pxSocket, pxBuf, pxDestinationAddress, xDestinationAddressLength,
+                                             uxPayloadOffset - ipSIZE_OF_ETH_HEADER );
+            break;
+
+        #if ( ipconfigUSE_IPv6 != 0 )
+            case FREERTOS_AF_INET6:
+                ( void ) memcpy( pxBuf->xIPAddress.xIP_IPv6.ucBytes, pxDestinationAddress->sin_address.xIP_IPv6.ucBytes, ipSIZE_OF_IPv6_ADDRESS );
+
+                #if ( tsnconfigSOCKET_TEMPLATE_REVALIDATE_MS > 0 )
+                    if( prvTemplateIsUsable( pxSocket, pxDestinationAddress, uxPayloadOffset ) != pdFALSE )
+                    {
+                        prvPrepareBufferUDPv6FromTemplate( pxSocket, pxBuf );
+                        xPrepared = pdPASS;
+                        break;
+                    }
+                #endif
+
+                xPrepared = prvPrepareBufferUDPv6( pxSocket, pxBuf, xFlags, pxDestinationAddress, xDestinationAddressLength,
+                                                   uxPayloadOffset - ipSIZE_OF_ETH_HEADER - ipSIZE_OF_IPv6_HEADER - ipSIZE_OF_UDP_HEADER );
+
+                #if ( tsnconfigSOCKET_TEMPLATE_REVALIDATE_MS > 0 )
+                    if( ( xPrepared == pdPASS ) && ( prvIsConnectedAddress( pxSocket, pxDestinationAddress ) != pdFALSE ) )
+                    {
+                        prvTemplateStore( pxSocket, pxBuf, uxPayloadOffset );
+                    }
+                #endif
+                break;
+        #endif /* ( ipconfigUSE_IPv6 != 0 ) */
+
+        #if ( ipconfigUSE_IPv4 != 0 )
+            case FREERTOS_AF_INET4:
+                pxBuf->xIPAddress.ulIP_IPv4 = pxDestinationAddress->sin_address.ulIP_IPv4;
+
+                #if ( tsnconfigSOCKET_TEMPLATE_REVALIDATE_MS > 0 )
+                    if( prvTemplateIsUsable( pxSocket, pxDestinationAddress, uxPayloadOffset ) != pdFALSE )
+                    {
+                        prvPrepareBufferUDPv4FromTemplate( pxSocket, pxBuf );
+                        xPrepared = pdPASS;
+                        break;
+                    }
+                #endif
+
+                xPrepared = prvPrepareBufferUDPv4( pxSocket, pxBuf, xFlags, pxDestinationAddress, xDestinationAddressLength,
+                                                   uxPayloadOffset - ipSIZE_OF_ETH_HEADER - ipSIZE_OF_IPv4_HEADER - ipSIZE_OF_UDP_HEADER, pxResolved );
+
+                #if ( tsnconfigSOCKET_TEMPLATE_REVALIDATE_MS > 0 )
+                    if( ( xPrepared == pdPASS ) && ( *pxResolved != pdFALSE ) &&
+                        ( prvIsConnectedAddress( pxSocket, pxDestinationAddress ) != pdFALSE ) )
+                    {
+                        prvTemplateStore( pxSocket, pxBuf, uxPayloadOffset );
+                    }
+                #endif
+                break;
+        #endif /* ( ipconfigUSE_IPv4 != 0 ) */
+
+        default:
+            break;
+    }
+
+    if( xPrepared != pdPASS )
+    {
+        return pdFAIL;
+    }
+
+    pxEvent->eEventType = eNetworkTxEvent;
+    pxEvent->pxBuf = ( void * ) pxBuf;
+    pxEvent->pxMsgh = NULL;
+    pxEvent->xReleaseAfterSend = pdTRUE;
+    ( void ) xPacketParse( pxBuf, &pxEvent->xMeta );
+
+    // The sending socket is already known, save the lookup to the wrapper
+    pxEvent->xMeta.xBaseSocket = pxSocket->xBaseSocket;
+    pxEvent->xMeta.pxTSNSocket = pxSocket;
+    pxEvent->xMeta.uxSocketGeneration = uxTSNSocketGeneration;
+
+    return pdPASS;
+}
+
+#if ( tsnconfigCONTROLLER_HAS_EXPRESS_PATH != tsnconfigDISABLE )
+
+/**
+ * @brief Send a prepared frame directly if the controller of its queue is idle
+ *
+ * See xTSN_NetworkInterfaceOutputExpress(). A frame which is sent is owned by
+ * the stack, even if the MAC did not accept it, as a queued frame would be.
+ *
+ * @param pxQueue The queue chosen for the frame
+ * @param pxItem The prepared transmit item
+ * @return pdTRUE if the frame was sent, pdFALSE if it must be queued
+ */
+    static BaseType_t prvSendExpress( NetworkQueue_t * pxQueue,
+                                      NetworkQueueItem_t * pxItem )
+    {
+        NetworkBufferDescriptor_t * const pxBuf = pxItem->pxBuf;
+        BaseType_t xReturn;
+
+        if( ( pxQueue->xExpress == pdFALSE ) || ( pxBuf->pxEndPoint == NULL ) )
+        {
+            return pdFALSE;
+        }
+
+        if( xTSN_NetworkInterfaceOutputExpress( pxBuf->pxEndPoint->pxNetworkInterface, pxQueue, pxItem, &xReturn ) == pdFALSE )
+        {
+            return pdFALSE;
+        }
+
+        if( xReturn != pdPASS )
+        {
+            FreeRTOS_debug_printf( ( "sendto: express frame not accepted by the MAC\n" ) );
+        }
+
+        return pdTRUE;
+    }
+
+#endif /* if ( tsnconfigCONTROLLER_HAS_EXPRESS_PATH != tsnconfigDISABLE ) */
+
+/**
+ * @brief Prepare a network buffer holding the payload and queue it
+ *
+ * Shared by the copy and zero copy send paths. The ownership of the buffer
+ * passes to the network queues only on success. Frames of express queues
+ * are sent by the calling task when the controller is idle.
+ *
+ * @param pxSocket The sending socket
+ * @param pxBuf The network buffer, with the payload at the socket offset
+ * @param uxTotalDataLength The length of the payload
+ * @param uxPayloadOffset The offset of the payload
+ * @param xFlags Flags of the send operation
+ * @param pxDestinationAddress The destination address
+ * @param xDestinationAddressLength The length of the destination address
+ * @param pxTimeOut The timeout state of the operation
+ * @param pxRemainingTime The remaining blocking time
+ * @return The number of bytes sent, or a negative error code
+ */
+static int32_t prvSendNetworkBuffer( FreeRTOS_TSN_Socket_t * pxSocket,
+                                     NetworkBufferDescriptor_t * pxBuf,
+                                     size_t uxTotalDataLength,
+                                     size_t uxPayloadOffset,
+                                     BaseType_t xFlags,
+                                     const struct freertos_sockaddr * pxDestinationAddress,
+                                     socklen_t xDestinationAddressLength,
+                                     TimeOut_t * pxTimeOut,
+                                     TickType_t * pxRemainingTime )
+{
+    NetworkQueueItem_t xEvent;
+    NetworkQueue_t * pxQueue;
+    BaseType_t xResolved;
+
+    if( prvPrepareNetworkItem( pxSocket, pxBuf, uxTotalDataLength, uxPayloadOffset, xFlags,
+                               pxDestinationAddress, xDestinationAddressLength, &xEvent, &xResolved ) != pdPASS )
+    {
+        return -pdFREERTOS_ERRNO_EAGAIN;
+    }
+
+    #if ( tsnconfigARP_PENDING_DESTINATIONS > 0 )
+        if( xResolved == pdFALSE )
+        {
+            // Parked until the controller finds the destination in the ARP cache
+            if( xTSNARPPendingAdd( &xEvent ) != pdPASS )
+            {
+                FreeRTOS_debug_printf( ( "sendto: too many frames waiting for ARP\n" ) );
+                return -pdFREERTOS_ERRNO_EAGAIN;
+            }
+
+            return ( int32_t ) uxTotalDataLength;
+        }
+    #endif
+
+    pxQueue = pxNetworkQueueFindByFilter( &xEvent );
+
+    if( pxQueue == NULL )
+    {
+        FreeRTOS_debug_printf( ( "sendto: no network queue for the frame\n" ) );
+        return -pdFREERTOS_ERRNO_EAGAIN;
+    }
+
+    #if ( tsnconfigCONTROLLER_HAS_EXPRESS_PATH != tsnconfigDISABLE )
+        if( prvSendExpress( pxQueue, &xEvent ) != pdFALSE )
+        {
+            return ( int32_t ) uxTotalDataLength;
+        }
+    #endif
+
+    if( xTaskCheckForTimeOut( pxTimeOut, pxRemainingTime ) != pdFALSE )
+    {
+        FreeRTOS_debug_printf( ( "sendto: timeout occurred\n" ) );
+        return -pdFREERTOS_ERRNO_ETIMEDOUT;
+    }
+
+    if( xNetworkQueuePush( pxQueue, &xEvent, *pxRemainingTime ) != pdPASS )
+    {
+        FreeRTOS_debug_printf( ( "sendto: cannot insert into network queues\n" ) );
+        return -pdFREERTOS_ERRNO_EAGAIN;
+    }
+
+    return ( int32_t ) uxTotalDataLength;
+}
+
+/**
+ * @brief Sends data to a TSN socket.
  *
- * @param xSocket The TSN socket to bind.
- * @param pxAddress Pointer to the address structure.
- * @param xAddressLength The length of the address structure.
+ * This function sends data to a TSN socket specified by the `xSocket` parameter.
+ * With the FREERTOS_ZERO_COPY flag, pvBuffer must be a payload buffer
+ * obtained with FreeRTOS_TSN_GetUDPPayloadBuffer(), which is sent without
+ * copying. The buffer is owned by the stack if the call succeeds, and still
+ * owned by the caller otherwise.
  *
- * @return If the socket is successfully bound, the function returns 0. Otherwise, it returns a negative value.
+ * @param xSocket The TSN socket to send data to.
+ * @param pvBuffer Pointer to the data buffer containing the data to send.
+ * @param uxTotalDataLength The total length of the data to send.
+ * @param xFlags Flags to control the behavior of the send operation.
+ * @param pxDestinationAddress Pointer to the destination address structure.
+ * @param xDestinationAddressLength The length of the destination address structure.
+ *
+ * @return The number of bytes sent on success, or a negative error code on failure.
  */
-BaseType_t FreeRTOS_TSN_bind( TSNSocket_t xSocket,
-                              struct freertos_sockaddr const * pxAddress,
-                              socklen_t xAddressLength )
+int32_t FreeRTOS_TSN_sendto( TSNSocket_t xSocket,
+                             const void * pvBuffer,
+                             size_t uxTotalDataLength,
+                             BaseType_t xFlags,
+                             const struct freertos_sockaddr * pxDestinationAddress,
+                             socklen_t xDestinationAddressLength )
 {
-    BaseType_t xRet;
     FreeRTOS_TSN_Socket_t * pxSocket = ( FreeRTOS_TSN_Socket_t * ) xSocket;
     FreeRTOS_Socket_t * pxBaseSocket = ( FreeRTOS_Socket_t * ) pxSocket->xBaseSocket;
+    TimeOut_t xTimeOut;
+    TickType_t xRemainingTime = pxBaseSocket->xSendBlockTime;
+    size_t uxMaxPayloadLength, uxPayloadOffset, uxBufferOffset;
+    NetworkBufferDescriptor_t * pxBuf;
+    const BaseType_t xZeroCopy = ( ( ( UBaseType_t ) xFlags & ( UBaseType_t ) FREERTOS_ZERO_COPY ) != 0U ) ? pdTRUE : pdFALSE;
+    int32_t lReturn;
 
-    // Bind the base socket
-    xRet = FreeRTOS_bind( pxSocket->xBaseSocket, pxAddress, xAddressLength );
+    vTaskSetTimeOutState( &xTimeOut );
 
-    if( xRet == 0 )
+    if( ( pxDestinationAddress == NULL ) && ( pxSocket->xIsConnected != pdFALSE ) )
     {
-        // Set the socket port
-        tsnsocketSET_SOCKET_PORT( pxSocket, FreeRTOS_htons( pxBaseSocket->usLocalPort ) );
+        pxDestinationAddress = &pxSocket->xConnectedAddress;
+        xDestinationAddressLength = sizeof( pxSocket->xConnectedAddress );
+    }
 
-        // Insert the socket into the bound UDP socket list
-        vListInsertEnd( &xTSNBoundUDPSocketList, &( pxSocket->xBoundSocketListItem ) );
+    if( pxDestinationAddress == NULL )
+    {
+        FreeRTOS_debug_printf( ( "sendto: invalid destination address\n" ) );
+        return -pdFREERTOS_ERRNO_EINVAL;
     }
 
-    return xRet;
+    if( !tsnsocketSOCKET_IS_BOUND( pxSocket ) )
+    {
+        FreeRTOS_debug_printf( ( "sendto: socket is not bound\n" ) );
+        return -pdFREERTOS_ERRNO_EBADF;
+    }
+
+    uxPayloadOffset = prvGetPayloadOffset( pxSocket, pxDestinationAddress->sin_family, &uxMaxPayloadLength );
+
+    if( uxPayloadOffset == 0 )
+    {
+        FreeRTOS_debug_printf( ( "sendto: invalid sin familyl\n" ) );
+        return -pdFREERTOS_ERRNO_EINVAL;
+    }
+
+    if( uxTotalDataLength > uxMaxPayloadLength )
+    {
+        FreeRTOS_debug_printf( ( "sendto: payload is too large\n" ) );
+        return -pdFREERTOS_ERRNO_EINVAL;
+    }
+
+    if( xZeroCopy != pdFALSE )
+    {
+        pxBuf = prvZeroCopyToNetworkBuffer( pvBuffer, &uxBufferOffset );
+
+        if( ( pxBuf == NULL ) || ( uxBufferOffset != uxPayloadOffset ) ||
+            ( uxTotalDataLength + uxPayloadOffset > pxBuf->xDataLength ) )
+        {
+            FreeRTOS_debug_printf( ( "sendto: invalid zero copy buffer\n" ) );
+            return -pdFREERTOS_ERRNO_EINVAL;
+        }
+    }
+    else
+    {
+        pxBuf = pxGetNetworkBufferWithDescriptor( uxTotalDataLength + uxPayloadOffset, pxBaseSocket->xSendBlockTime );
+
+        if( pxBuf == NULL )
+        {
+            FreeRTOS_debug_printf( ( "sendto: couldn't acquire network buffer\n" ) );
+            return -pdFREERTOS_ERRNO_EAGAIN;
+        }
+
+        memcpy( &pxBuf->pucEthernetBuffer[ uxPayloadOffset ], pvBuffer, uxTotalDataLength );
+    }
+
+    lReturn = prvSendNetworkBuffer( pxSocket, pxBuf, uxTotalDataLength, uxPayloadOffset, xFlags,
+                                    pxDestinationAddress, xDestinationAddressLength, &xTimeOut, &xRemainingTime );
+
+    if( lReturn < 0 )
+    {
+        if( xZeroCopy != pdFALSE )
+        {
+            /* Still owned by the caller, make it valid again */
+            pxBuf->xDataLength = uxTotalDataLength + uxPayloadOffset;
+            prvZeroCopyStoreOffset( &pxBuf->pucEthernetBuffer[ uxPayloadOffset ], uxPayloadOffset );
+        }
+        else
+        {
+            vReleaseNetworkBufferAndDescriptor( pxBuf );
+        }
+    }
+
+    return lReturn;
 }
 
 /**
- * @brief Closes a TSN socket.
+ * @brief Sends data to the address of a connected TSN socket.
  *
- * This function closes the specified TSN socket.
+ * Same as FreeRTOS_TSN_sendto() with the address set by
+ * FreeRTOS_TSN_connect().
  *
- * @param xSocket The TSN socket to be closed.
+ * @param xSocket The connected TSN socket.
+ * @param pvBuffer Pointer to the data to send, or the zero copy buffer.
+ * @param uxDataLength The length of the data to send.
+ * @param xFlags Flags to control the behavior of the send operation.
  *
- * @return If the socket is successfully closed, the function returns 0. Otherwise, it returns an error code.
+ * @return The number of bytes sent on success, or a negative error code on failure.
  */
-BaseType_t FreeRTOS_TSN_closesocket( TSNSocket_t xSocket )
+int32_t FreeRTOS_TSN_send( TSNSocket_t xSocket,
+                           const void * pvBuffer,
+                           size_t uxDataLength,
+                           BaseType_t xFlags )
+{
+    FreeRTOS_TSN_Socket_t * pxSocket = ( FreeRTOS_TSN_Socket_t * ) xSocket;
+
+    if( ( pxSocket == NULL ) || ( pxSocket == FREERTOS_TSN_INVALID_SOCKET ) )
+    {
+        return -pdFREERTOS_ERRNO_EINVAL;
+    }
+
+    if( pxSocket->xIsConnected == pdFALSE )
+    {
+        return -pdFREERTOS_ERRNO_ENOTCONN;
+    }
+
+    return FreeRTOS_TSN_sendto( xSocket, pvBuffer, uxDataLength, xFlags, &pxSocket->xConnectedAddress, sizeof( pxSocket->xConnectedAddress ) );
+}
+
+/**
+ * @brief Get a network buffer holding the payload of a message
+ *
+ * With FREERTOS_ZERO_COPY the message must contain a single buffer obtained
+ * with FreeRTOS_TSN_GetUDPPayloadBuffer(), otherwise the iovec buffers are
+ * gathered in a new network buffer.
+ *
+ * @param pxSocket The sending socket
+ * @param pxMsgh The message to send
+ * @param xFlags Flags of the send operation
+ * @param[out] ppxBuf The network buffer
+ * @param[out] puxTotalDataLength The length of the payload
+ * @param[out] puxPayloadOffset The offset of the payload in the buffer
+ * @return 0 on success, or a negative error code
+ */
+static int32_t prvBufferFromMsg( FreeRTOS_TSN_Socket_t * pxSocket,
+                                 const struct msghdr * pxMsgh,
+                                 BaseType_t xFlags,
+                                 NetworkBufferDescriptor_t ** ppxBuf,
+                                 size_t * puxTotalDataLength,
+                                 size_t * puxPayloadOffset )
+{
+    FreeRTOS_Socket_t * pxBaseSocket = ( FreeRTOS_Socket_t * ) pxSocket->xBaseSocket;
+    const struct freertos_sockaddr * pxDestinationAddress = ( const struct freertos_sockaddr * ) pxMsgh->msg_name;
+    size_t uxTotalDataLength = 0, uxMaxPayloadLength, uxPayloadOffset, uxBufferOffset, uxCopied;
+    NetworkBufferDescriptor_t * pxBuf;
+
+    if( ( pxDestinationAddress == NULL ) || ( pxMsgh->msg_iovlen == 0 ) || ( pxMsgh->msg_iov == NULL ) )
+    {
+        FreeRTOS_debug_printf( ( "sendmsg: invalid message\n" ) );
+        return -pdFREERTOS_ERRNO_EINVAL;
+    }
+
+    uxPayloadOffset = prvGetPayloadOffset( pxSocket, pxDestinationAddress->sin_family, &uxMaxPayloadLength );
+
+    if( uxPayloadOffset == 0 )
+    {
+        return -pdFREERTOS_ERRNO_EINVAL;
+    }
+
+    for( size_t uxIter = 0; uxIter < pxMsgh->msg_iovlen; ++uxIter )
+    {
+        uxTotalDataLength += pxMsgh->msg_iov[ uxIter ].iov_len;
+    }
+
+    if( uxTotalDataLength > uxMaxPayloadLength )
+    {
+        FreeRTOS_debug_printf( ( "sendmsg: payload is too large\n" ) );
+        return -pdFREERTOS_ERRNO_EINVAL;
+    }
+
+    if( ( ( UBaseType_t ) xFlags & ( UBaseType_t ) FREERTOS_ZERO_COPY ) != 0U )
+    {
+        pxBuf = prvZeroCopyToNetworkBuffer( pxMsgh->msg_iov[ 0 ].iov_base, &uxBufferOffset );
+
+        if( ( pxMsgh->msg_iovlen != 1 ) || ( pxBuf == NULL ) || ( uxBufferOffset != uxPayloadOffset ) ||
+            ( uxTotalDataLength + uxPayloadOffset > pxBuf->xDataLength ) )
+        {
+            FreeRTOS_debug_printf( ( "sendmsg: invalid zero copy buffer\n" ) );
+            return -pdFREERTOS_ERRNO_EINVAL;
+        }
+    }
+    else
+    {
+        pxBuf = pxGetNetworkBufferWithDescriptor( uxTotalDataLength + uxPayloadOffset, pxBaseSocket->xSendBlockTime );
+
+        if( pxBuf == NULL )
+        {
+            FreeRTOS_debug_printf( ( "sendmsg: couldn't acquire network buffer\n" ) );
+            return -pdFREERTOS_ERRNO_EAGAIN;
+        }
+
+        // Gather the payload
+        uxCopied = uxPayloadOffset;
+
+        for( size_t uxIter = 0; uxIter < pxMsgh->msg_iovlen; ++uxIter )
+        {
+            memcpy( &pxBuf->pucEthernetBuffer[ uxCopied ], pxMsgh->msg_iov[ uxIter ].iov_base, pxMsgh->msg_iov[ uxIter ].iov_len );
+            uxCopied += pxMsgh->msg_iov[ uxIter ].iov_len;
+        }
+    }
+
+    *ppxBuf = pxBuf;
+    *puxTotalDataLength = uxTotalDataLength;
+    *puxPayloadOffset = uxPayloadOffset;
+
+    return 0;
+}
+
+/**
+ * @brief Give back a network buffer which could not be sent
+ *
+ * Copies are released, zero copy buffers stay with the application and are
+ * made valid again for FreeRTOS_TSN_ReleaseUDPPayloadBuffer().
+ *
+ * @param pxBuf The network buffer
+ * @param uxTotalDataLength The length of the payload
+ * @param uxPayloadOffset The offset of the payload
+ * @param xFlags Flags of the send operation
+ */
+static void prvDiscardUnsentBuffer( NetworkBufferDescriptor_t * pxBuf,
+                                    size_t uxTotalDataLength,
+                                    size_t uxPayloadOffset,
+                                    BaseType_t xFlags )
+{
+    if( ( ( UBaseType_t ) xFlags & ( UBaseType_t ) FREERTOS_ZERO_COPY ) != 0U )
+    {
+        pxBuf->xDataLength = uxTotalDataLength + uxPayloadOffset;
+        prvZeroCopyStoreOffset( &pxBuf->pucEthernetBuffer[ uxPayloadOffset ], uxPayloadOffset );
+    }
+    else
+    {
+        vReleaseNetworkBufferAndDescriptor( pxBuf );
+    }
+}
+
+/**
+ * @brief Sends a message from a TSN socket.
+ *
+ * The destination is taken from msg_name and the payload is gathered from
+ * the msg_iov buffers into a single frame. With the FREERTOS_ZERO_COPY flag,
+ * msg_iov must contain exactly one buffer obtained with
+ * FreeRTOS_TSN_GetUDPPayloadBuffer(), see FreeRTOS_TSN_sendto().
+ * Control messages are currently ignored.
+ *
+ * @param xSocket The TSN socket to send the message from.
+ * @param pxMsgh The message to send.
+ * @param xFlags Flags to control the behavior of the send operation.
+ *
+ * @return The number of bytes sent on success, or a negative error code on failure.
+ */
+int32_t FreeRTOS_TSN_sendmsg( TSNSocket_t xSocket,
+                              const struct msghdr * pxMsgh,
+                              BaseType_t xFlags )
+{
+    FreeRTOS_TSN_Socket_t * pxSocket = ( FreeRTOS_TSN_Socket_t * ) xSocket;
+    FreeRTOS_Socket_t * pxBaseSocket;
+    TimeOut_t xTimeOut;
+    TickType_t xRemainingTime;
+    size_t uxTotalDataLength, uxPayloadOffset;
+    NetworkBufferDescriptor_t * pxBuf;
+    int32_t lReturn;
+
+    if( ( pxSocket == NULL ) || ( pxSocket == FREERTOS_TSN_INVALID_SOCKET ) || ( pxMsgh == NULL ) )
+    {
+        return -pdFREERTOS_ERRNO_EINVAL;
+    }
+
+    pxBaseSocket = ( FreeRTOS_Socket_t * ) pxSocket->xBaseSocket;
+    xRemainingTime = pxBaseSocket->xSendBlockTime;
+    vTaskSetTimeOutState( &xTimeOut );
+
+    if( !tsnsocketSOCKET_IS_BOUND( pxSocket ) )
+    {
+        FreeRTOS_debug_printf( ( "sendmsg: socket is not bound\n" ) );
+        return -pdFREERTOS_ERRNO_EBADF;
+    }
+
+    lReturn = prvBufferFromMsg( pxSocket, pxMsgh, xFlags, &pxBuf, &uxTotalDataLength, &uxPayloadOffset );
+
+    if( lReturn < 0 )
+    {
+        return lReturn;
+    }
+
+    lReturn = prvSendNetworkBuffer( pxSocket, pxBuf, uxTotalDataLength, uxPayloadOffset, xFlags,
+                                    pxMsgh->msg_name, pxMsgh->msg_namelen, &xTimeOut, &xRemainingTime );
+
+    if( lReturn < 0 )
+    {
+        prvDiscardUnsentBuffer( pxBuf, uxTotalDataLength, uxPayloadOffset, xFlags );
+    }
+
+    return lReturn;
+}
+
+/**
+ * @brief Sends multiple messages from a TSN socket.
+ *
+ * Each message is prepared like in FreeRTOS_TSN_sendmsg(), but the frames
+ * are inserted in the network queues in batches of up to
+ * tsnconfigSOCKET_MMSG_BATCH, notifying each controller once per batch,
+ * and the timeout covers the whole call. Messages are sent in order, and
+ * the call stops at the first one which cannot be sent. The number of bytes
+ * sent for each message is stored in msg_len.
+ *
+ * @param xSocket The TSN socket to send the messages from.
+ * @param pxMsgVec The messages to send.
+ * @param uxVLen The number of messages in pxMsgVec.
+ * @param xFlags Flags to control the behavior of the send operation.
+ *
+ * @return The number of messages sent, or a negative error code if none was sent.
+ */
+int32_t FreeRTOS_TSN_sendmmsg( TSNSocket_t xSocket,
+                               struct mmsghdr * pxMsgVec,
+                               size_t uxVLen,
+                               BaseType_t xFlags )
 {
     FreeRTOS_TSN_Socket_t * pxSocket = ( FreeRTOS_TSN_Socket_t * ) xSocket;
+    FreeRTOS_Socket_t * pxBaseSocket;
+    NetworkQueueItem_t xEvents[ tsnconfigSOCKET_MMSG_BATCH ];
+    size_t uxLengths[ tsnconfigSOCKET_MMSG_BATCH ];
+    size_t uxOffsets[ tsnconfigSOCKET_MMSG_BATCH ];
+    TimeOut_t xTimeOut;
+    TickType_t xRemainingTime;
+    size_t uxSent = 0;
+    int32_t lError = 0;
+
+    if( ( pxSocket == NULL ) || ( pxSocket == FREERTOS_TSN_INVALID_SOCKET ) || ( pxMsgVec == NULL ) || ( uxVLen == 0 ) )
+    {
+        return -pdFREERTOS_ERRNO_EINVAL;
+    }
+
+    pxBaseSocket = ( FreeRTOS_Socket_t * ) pxSocket->xBaseSocket;
+    xRemainingTime = pxBaseSocket->xSendBlockTime;
+    vTaskSetTimeOutState( &xTimeOut );
+
+    if( !tsnsocketSOCKET_IS_BOUND( pxSocket ) )
+    {
+        FreeRTOS_debug_printf( ( "sendmmsg: socket is not bound\n" ) );
+        return -pdFREERTOS_ERRNO_EBADF;
+    }
+
+    while( ( uxSent < uxVLen ) && ( lError == 0 ) )
+    {
+        UBaseType_t uxPrepared = 0, uxToInsert, uxInserted;
+        BaseType_t xResolved = pdTRUE;
+
+        // Prepare the frames of this batch
+        while( ( uxPrepared < tsnconfigSOCKET_MMSG_BATCH ) && ( uxSent + uxPrepared < uxVLen ) )
+        {
+            const struct msghdr * pxMsgh = &pxMsgVec[ uxSent + uxPrepared ].msg_hdr;
+            NetworkBufferDescriptor_t * pxBuf;
+
+            lError = prvBufferFromMsg( pxSocket, pxMsgh, xFlags, &pxBuf, &uxLengths[ uxPrepared ], &uxOffsets[ uxPrepared ] );
+
+            if( lError < 0 )
+            {
+                break;
+            }
+
+            if( prvPrepareNetworkItem( pxSocket, pxBuf, uxLengths[ uxPrepared ], uxOffsets[ uxPrepared ], xFlags,
+                                       pxMsgh->msg_name, pxMsgh->msg_namelen, &xEvents[ uxPrepared ], &xResolved ) != pdPASS )
+            {
+                prvDiscardUnsentBuffer( pxBuf, uxLengths[ uxPrepared ], uxOffsets[ uxPrepared ], xFlags );
+                lError = -pdFREERTOS_ERRNO_EAGAIN;
+                break;
+            }
+
+            ++uxPrepared;
+
+            if( xResolved == pdFALSE )
+            {
+                // The unresolved frame is parked after the ones preceding it
+                break;
+            }
+        }
+
+        if( uxPrepared == 0 )
+        {
+            break;
+        }
+
+        uxToInsert = ( xResolved == pdFALSE ) ? ( uxPrepared - 1U ) : uxPrepared;
+        uxInserted = 0;
+
+        #if ( tsnconfigCONTROLLER_HAS_EXPRESS_PATH != tsnconfigDISABLE )
+            // Send the leading frames directly while their controllers are idle
+            while( uxInserted < uxToInsert )
+            {
+                NetworkQueue_t * const pxQueue = pxNetworkQueueFindByFilter( &xEvents[ uxInserted ] );
+
+                if( ( pxQueue == NULL ) || ( prvSendExpress( pxQueue, &xEvents[ uxInserted ] ) == pdFALSE ) )
+                {
+                    break;
+                }
+
+                ++uxInserted;
+            }
+        #endif
+
+        // Insert the rest of the batch with a single notification
+        if( ( uxInserted < uxPrepared ) && ( xTaskCheckForTimeOut( &xTimeOut, &xRemainingTime ) != pdFALSE ) )
+        {
+            lError = -pdFREERTOS_ERRNO_ETIMEDOUT;
+        }
+        else
+        {
+            if( uxToInsert > uxInserted )
+            {
+                uxInserted += uxNetworkQueueInsertPacketsByFilter( &xEvents[ uxInserted ], uxToInsert - uxInserted, xRemainingTime );
+            }
+
+            #if ( tsnconfigARP_PENDING_DESTINATIONS > 0 )
+                if( ( uxInserted == uxToInsert ) && ( uxToInsert < uxPrepared ) &&
+                    ( xTSNARPPendingAdd( &xEvents[ uxToInsert ] ) == pdPASS ) )
+                {
+                    ++uxInserted;
+                }
+            #endif
+        }
+
+        for( UBaseType_t uxIndex = 0; uxIndex < uxPrepared; ++uxIndex )
+        {
+            if( uxIndex < uxInserted )
+            {
+                pxMsgVec[ uxSent + uxIndex ].msg_len = ( unsigned int ) uxLengths[ uxIndex ];
+            }
+            else
+            {
+                prvDiscardUnsentBuffer( xEvents[ uxIndex ].pxBuf, uxLengths[ uxIndex ], uxOffsets[ uxIndex ], xFlags );
+            }
+        }
 
-    /*FreeRTOS_Socket_t * pxBaseSocket = ( FreeRTOS_Socket_t * ) pxSocket->xBaseSocket; */
+        uxSent += uxInserted;
 
-    // Check if the socket is invalid
-    if( xSocket == FREERTOS_TSN_INVALID_SOCKET )
-    {
-        return 0;
+        if( ( uxInserted < uxPrepared ) && ( lError == 0 ) )
+        {
+            FreeRTOS_debug_printf( ( "sendmmsg: cannot insert into network queues\n" ) );
+            lError = -pdFREERTOS_ERRNO_EAGAIN;
+        }
     }
 
-    // Remove the socket from the bound socket list
-    ( void ) uxListRemove( &( pxSocket->xBoundSocketListItem ) );
-
-    // Close the base socket
-    return FreeRTOS_closesocket( pxSocket->xBaseSocket );
+    return ( uxSent > 0 ) ? ( int32_t ) uxSent : lError;
 }
 
 /**
- * @brief Sends data to a TSN socket.
- *
- * This function sends data to a TSN socket specified by the `xSocket` parameter.
- *
- * @param xSocket The TSN socket to send data to.
- * @param pvBuffer Pointer to the data buffer containing the data to send.
- * @param uxTotalDataLength The total length of the data to send.
- * @param xFlags Flags to control the behavior of the send operation.
- * @param pxDestinationAddress Pointer to the destination address structure.
- * @param xDestinationAddressLength The length of the destination address structure.
+ * @brief Wait for packets in the list of a TSN socket
  *
- * @return The number of bytes sent on success, or a negative error code on failure.
+ * @param pxBaseSocket The base socket of the TSN socket
+ * @param xFlags Flags of the receive operation
+ * @return The number of packets waiting, 0 if the timeout expired
  */
-int32_t FreeRTOS_TSN_sendto( TSNSocket_t xSocket,
-                             const void * pvBuffer,
-                             size_t uxTotalDataLength,
-                             BaseType_t xFlags,
-                             const struct freertos_sockaddr * pxDestinationAddress,
-                             socklen_t xDestinationAddressLength )
+static BaseType_t prvWaitForPackets( FreeRTOS_Socket_t * pxBaseSocket,
+                                     BaseType_t xFlags )
 {
-    FreeRTOS_TSN_Socket_t * pxSocket = ( FreeRTOS_TSN_Socket_t * ) xSocket;
-    FreeRTOS_Socket_t * pxBaseSocket = ( FreeRTOS_Socket_t * ) pxSocket->xBaseSocket;
+    BaseType_t xTimed = pdFALSE;
+    TickType_t xRemainingTime = pxBaseSocket->xReceiveBlockTime;
+    BaseType_t lPacketCount;
     TimeOut_t xTimeOut;
-    TickType_t xRemainingTime = pxBaseSocket->xSendBlockTime;
-    NetworkQueueItem_t xEvent;
-    size_t uxMaxPayloadLength, uxPayloadOffset;
-    NetworkBufferDescriptor_t * pxBuf;
-
-    vTaskSetTimeOutState( &xTimeOut );
-
-    if( pxDestinationAddress == NULL )
-    {
-        FreeRTOS_debug_printf( ( "sendto: invalid destination address\n" ) );
-        return -pdFREERTOS_ERRNO_EINVAL;
-    }
 
-    if( !tsnsocketSOCKET_IS_BOUND( pxBaseSocket ) )
-    {
-        FreeRTOS_debug_printf( ( "sendto: socket is not bound\n" ) );
-        return -pdFREERTOS_ERRNO_EBADF;
-    }
+    // Get the number of packets waiting to be processed by the socket
+    lPacketCount = ( BaseType_t ) listCURRENT_LIST_LENGTH( &( pxBaseSocket->u.xUDP.xWaitingPacketsList ) );
 
-    switch( pxDestinationAddress->sin_family )
+    // If there are no packets waiting, wait for a packet to arrive
+    while( lPacketCount == 0 )
     {
-        #if ( ipconfigUSE_IPv6 != 0 )
-            case FREERTOS_AF_INET6:
-
-				/* Note: This part is to be revised and completed. For now it
-				 * will always fail after prvPrepareBufferUDPv6().
-				 */
+        // Check if the socket is non-blocking
+        if( xTimed == pdFALSE )
+        {
+            // Check if the remaining time has expired
+            if( xRemainingTime == ( TickType_t ) 0 )
+            {
+                break;
+            }
 
-                uxPayloadOffset = ipSIZE_OF_ETH_HEADER + ipSIZE_OF_IPv6_HEADER + ipSIZE_OF_UDP_HEADER;
-                #if ( tsnconfigSOCKET_INSERTS_VLAN_TAGS != tsnconfigDISABLE )
-                    uxPayloadOffset += pxSocket->ucVLANTagsCount * sizeof( struct xVLAN_TAG );
-                #endif
-                uxMaxPayloadLength = ipconfigNETWORK_MTU - ( ipSIZE_OF_IPv6_HEADER + ipSIZE_OF_UDP_HEADER );
-                pxBuf = pxGetNetworkBufferWithDescriptor( uxTotalDataLength + uxPayloadOffset, pxBaseSocket->xSendBlockTime );
+            // Check if the FREERTOS_MSG_DONTWAIT flag is set
+            if( ( ( ( UBaseType_t ) xFlags ) & ( ( UBaseType_t ) FREERTOS_MSG_DONTWAIT ) ) != 0U )
+            {
+                break;
+            }
 
-                if( pxBuf == NULL )
-                {
-                    FreeRTOS_debug_printf( ( "sendto: couldn't acquire network buffer\n" ) );
-                    return -pdFREERTOS_ERRNO_EAGAIN;
-                }
+            // Set the timed flag and fetch the current time
+            xTimed = pdTRUE;
+            vTaskSetTimeOutState( &xTimeOut );
+        }
 
-                pxBuf->xDataLength = uxTotalDataLength + uxPayloadOffset;
-                pxBuf->pxEndPoint = pxBaseSocket->pxEndPoint;
-                pxBuf->usPort = pxDestinationAddress->sin_port;
-                pxBuf->usBoundPort = ( uint16_t ) tsnsocketGET_SOCKET_PORT( pxBaseSocket );
-                ( void ) memcpy( pxBuf->xIPAddress.xIP_IPv6.ucBytes, pxDestinationAddress->sin_address.xIP_IPv6.ucBytes, ipSIZE_OF_IPv6_ADDRESS );
+        // Wait for a packet to arrive or an interrupt to occur
+        ( void ) xEventGroupWaitBits( pxBaseSocket->xEventGroup, ( ( EventBits_t ) eSOCKET_RECEIVE ) | ( ( EventBits_t ) eSOCKET_INTR ),
+                                      pdTRUE /*xClearOnExit*/, pdFALSE /*xWaitAllBits*/, xRemainingTime );
 
-                if( prvPrepareBufferUDPv6( pxSocket, pxBuf, xFlags, pxDestinationAddress, xDestinationAddressLength ) != pdPASS )
-                {
-                    vReleaseNetworkBufferAndDescriptor( pxBuf );
-                    return -pdFREERTOS_ERRNO_EAGAIN;
-                }
-                break;
-        #endif /* ( ipconfigUSE_IPv6 != 0 ) */
+        // Update the packet count
+        lPacketCount = ( BaseType_t ) listCURRENT_LIST_LENGTH( &( pxBaseSocket->u.xUDP.xWaitingPacketsList ) );
 
-        #if ( ipconfigUSE_IPv4 != 0 )
-            case FREERTOS_AF_INET4:
-                uxPayloadOffset = ipSIZE_OF_ETH_HEADER + ipSIZE_OF_IPv4_HEADER + ipSIZE_OF_UDP_HEADER;
-                #if ( tsnconfigSOCKET_INSERTS_VLAN_TAGS != tsnconfigDISABLE )
-                    uxPayloadOffset += pxSocket->ucVLANTagsCount * sizeof( struct xVLAN_TAG );
-                #endif
-                uxMaxPayloadLength = ipconfigNETWORK_MTU - ( ipSIZE_OF_IPv4_HEADER + ipSIZE_OF_UDP_HEADER );
-                pxBuf = pxGetNetworkBufferWithDescriptor( uxTotalDataLength + uxPayloadOffset, pxBaseSocket->xSendBlockTime );
+        // If a packet has arrived, break the loop
+        if( lPacketCount != 0 )
+        {
+            break;
+        }
 
-                if( pxBuf == NULL )
-                {
-                    FreeRTOS_debug_printf( ( "sendto: couldn't acquire network buffer\n" ) );
-                    return -pdFREERTOS_ERRNO_EAGAIN;
-                }
+        // Check if the timeout has been reached
+        if( xTaskCheckForTimeOut( &xTimeOut, &xRemainingTime ) != pdFALSE )
+        {
+            break;
+        }
+    } /* while( lPacketCount == 0 ) */
 
-                pxBuf->xDataLength = uxTotalDataLength + uxPayloadOffset;
-                pxBuf->pxEndPoint = pxBaseSocket->pxEndPoint;
-                pxBuf->usPort = pxDestinationAddress->sin_port;
-                pxBuf->usBoundPort = ( uint16_t ) tsnsocketGET_SOCKET_PORT( pxBaseSocket );
-                pxBuf->xIPAddress.ulIP_IPv4 = pxDestinationAddress->sin_address.ulIP_IPv4;
+    return lPacketCount;
+}
 
-                if( prvPrepareBufferUDPv4( pxSocket, pxBuf, xFlags, pxDestinationAddress, xDestinationAddressLength ) != pdPASS )
-                {
-                    vReleaseNetworkBufferAndDescriptor( pxBuf );
-                    return -pdFREERTOS_ERRNO_EAGAIN;
-                }
-                break;
-        #endif /* ( ipconfigUSE_IPv4 != 0 ) */
+/**
+ * @brief Hand a received message to the user
+ *
+ * Copies the name, the payload and the control messages of pxMsgh into the
+ * user msghdr. Unless peeking, the ancillary message is then freed and the
+ * network buffer released, or loaned to the user with FREERTOS_ZERO_COPY.
+ *
+ * @param pxSocket The receiving socket
+ * @param pxNetworkBuffer The network buffer of the message, NULL for errqueue messages
+ * @param pxMsgh The ancillary message
+ * @param pxMsghUser The user msghdr
+ * @param xFlags Flags of the receive operation
+ * @return The length of the payload
+ */
+static int32_t prvRecvToUser( FreeRTOS_TSN_Socket_t * pxSocket,
+                              NetworkBufferDescriptor_t * pxNetworkBuffer,
+                              struct msghdr * pxMsgh,
+                              struct msghdr * pxMsghUser,
+                              BaseType_t xFlags )
+{
+    const BaseType_t xPeek = ( ( ( UBaseType_t ) xFlags & ( UBaseType_t ) FREERTOS_MSG_PEEK ) != 0U ) ? pdTRUE : pdFALSE;
+    size_t uxPayloadLen = 0;
+    size_t uxLen;
 
-        default:
-            FreeRTOS_debug_printf( ( "sendto: invalid sin familyl\n" ) );
-            return -pdFREERTOS_ERRNO_EINVAL;
+    // Copy the message name if available
+    if( ( pxMsgh->msg_name != NULL ) && ( pxMsghUser->msg_name != NULL ) )
+    {
+        uxLen = configMIN( pxMsghUser->msg_namelen, pxMsgh->msg_namelen );
+        memcpy( pxMsghUser->msg_name, pxMsgh->msg_name, uxLen );
+        pxMsghUser->msg_namelen = uxLen;
     }
-
-    if( uxTotalDataLength > uxMaxPayloadLength )
+    else
     {
-        FreeRTOS_debug_printf( ( "sendto: payload is too large\n" ) );
-        vReleaseNetworkBufferAndDescriptor( pxBuf );
-        return -pdFREERTOS_ERRNO_EINVAL;
+        pxMsghUser->msg_namelen = 0;
     }
 
-    memcpy( &pxBuf->pucEthernetBuffer[ uxPayloadOffset ], pvBuffer, uxTotalDataLength );
+    // Copy the message payload if available
+    if( ( pxMsgh->msg_iov != NULL ) && ( pxMsghUser->msg_iov != NULL ) )
+    {
+        const PacketMetadata_t * pxMeta = pxAncillaryMsgGetMetadata( pxMsgh );
+        uint8_t * pucPayload = ( uint8_t * ) pxMsgh->msg_iov[ 0 ].iov_base;
+        size_t uxPayloadSize = pxMsgh->msg_iov[ 0 ].iov_len;
 
-    xEvent.eEventType = eNetworkTxEvent;
-    xEvent.pxBuf = ( void * ) pxBuf;
-    xEvent.pxMsgh = NULL;
-    xEvent.xReleaseAfterSend = pdTRUE;
+        // Skip the headers, using the offsets found by the parser
+        if( pxMeta->usPayloadOffset != 0U )
+        {
+            pucPayload += pxMeta->usPayloadOffset;
+            uxPayloadSize = pxMeta->usPayloadLength;
+        }
 
-    if( xTaskCheckForTimeOut( &xTimeOut, &xRemainingTime ) != pdTRUE )
-    {
-        if( xNetworkQueueInsertPacketByFilter( &xEvent, xRemainingTime ) == pdPASS )
+        if( ( ( UBaseType_t ) xFlags & ( UBaseType_t ) FREERTOS_ZERO_COPY ) != 0U )
         {
-            return uxTotalDataLength;
+            if( ( pxNetworkBuffer != NULL ) && ( pxMeta->usPayloadOffset != 0U ) && ( pxMsghUser->msg_iovlen > 0 ) )
+            {
+                // Loan the payload to the application, it will release the buffer
+                vSharedBufferLoan( pxNetworkBuffer );
+                prvZeroCopyStoreOffset( pucPayload, ( size_t ) pxMeta->usPayloadOffset + pxMeta->ucStrippedSize );
+                pxMsghUser->msg_iov[ 0 ].iov_base = pucPayload;
+                pxMsghUser->msg_iov[ 0 ].iov_len = uxPayloadSize;
+                pxMsghUser->msg_iovlen = 1;
+                uxPayloadLen = uxPayloadSize;
+                pxNetworkBuffer = NULL;
+            }
+            else
+            {
+                pxMsghUser->msg_iovlen = 0;
+            }
         }
-        else
+        else if( pxMsghUser->msg_iovlen > 0 )
         {
-            FreeRTOS_debug_printf( ( "sendto: cannot insert into network queues\n" ) );
-            vReleaseNetworkBufferAndDescriptor( pxBuf );
-            return -pdFREERTOS_ERRNO_EAGAIN;
+            // The payload is contiguous, scatter it over the user buffers
+            size_t uxIter;
+
+            for( uxIter = 0; ( uxIter < pxMsghUser->msg_iovlen ) && ( uxPayloadLen < uxPayloadSize ); ++uxIter )
+            {
+                uxLen = configMIN( pxMsghUser->msg_iov[ uxIter ].iov_len, uxPayloadSize - uxPayloadLen );
+                memcpy( pxMsghUser->msg_iov[ uxIter ].iov_base, &pucPayload[ uxPayloadLen ], uxLen );
+                pxMsghUser->msg_iov[ uxIter ].iov_len = uxLen;
+                uxPayloadLen += uxLen;
+            }
+
+            pxMsghUser->msg_iovlen = uxIter;
         }
     }
     else
     {
-        FreeRTOS_debug_printf( ( "sendto: timeout occurred\n" ) );
-        vReleaseNetworkBufferAndDescriptor( pxBuf );
-        return -pdFREERTOS_ERRNO_ETIMEDOUT;
+        pxMsghUser->msg_iovlen = 0;
+    }
+
+    // Copy the message flags
+    pxMsghUser->msg_flags = pxMsgh->msg_flags;
+
+    // Build the control messages only if the user asked for them
+    if( pxMsghUser->msg_control != NULL )
+    {
+        pxMsghUser->msg_controllen = uxAncillaryMsgControlBuild( pxMsgh, pxSocket, pxMsghUser->msg_control,
+                                                                 pxMsghUser->msg_controllen, &pxMsghUser->msg_flags );
+    }
+    else
+    {
+        pxMsghUser->msg_controllen = 0;
+    }
+
+    if( xPeek == pdFALSE )
+    {
+        // Free any ancillary messages
+        vAncillaryMsgFreeAll( pxMsgh );
+
+        // Release the network buffer, which may be shared with other sockets
+        if( pxNetworkBuffer != NULL )
+        {
+            vSharedBufferRelease( pxNetworkBuffer );
+        }
     }
+
+    // Return the length of the payload
+    return uxPayloadLen;
 }
 
 /**
@@ -728,6 +3233,11 @@ int32_t FreeRTOS_TSN_sendto( TSNSocket_t xSocket,
  * This function receives a message from the specified TSN socket. It retrieves the message
  * from the waiting packets list of the underlying base socket. If the `FREERTOS_MSG_ERRQUEUE`
  * flag is set, it retrieves the message from the error queue of the TSN socket.
+ * With the `FREERTOS_ZERO_COPY` flag the payload is not copied: the first
+ * iovec of the user is set to point to the payload inside the network
+ * buffer, which remains owned by the application until it is released with
+ * FreeRTOS_TSN_ReleaseUDPPayloadBuffer(). The user must provide at least one
+ * iovec, whose buffer is ignored.
  *
  * @param xSocket The TSN socket from which to receive the message.
  * @param pxMsghUser Pointer to the `msghdr` structure that will hold the received message.
@@ -740,7 +3250,9 @@ int32_t FreeRTOS_TSN_recvmsg( TSNSocket_t xSocket,
                               BaseType_t xFlags )
 {
     FreeRTOS_TSN_Socket_t * pxSocket = ( FreeRTOS_TSN_Socket_t * ) xSocket;
-    FreeRTOS_Socket_t * pxBaseSocket = ( FreeRTOS_Socket_t * ) pxSocket->xBaseSocket;
+    FreeRTOS_Socket_t * pxBaseSocket;
+    NetworkBufferDescriptor_t * pxNetworkBuffer = NULL;
+    struct msghdr * pxMsgh;
 
     // Check if the socket is valid
     if( ( pxSocket == NULL ) || ( pxSocket == FREERTOS_TSN_INVALID_SOCKET ) )
@@ -748,8 +3260,10 @@ int32_t FreeRTOS_TSN_recvmsg( TSNSocket_t xSocket,
         return -pdFREERTOS_ERRNO_EINVAL;
     }
 
+    pxBaseSocket = ( FreeRTOS_Socket_t * ) pxSocket->xBaseSocket;
+
     // Check if the base socket is bound
-    if( !tsnsocketSOCKET_IS_BOUND( pxBaseSocket ) )
+    if( !tsnsocketSOCKET_IS_BOUND( pxSocket ) )
     {
         return -pdFREERTOS_ERRNO_EINVAL;
     }
@@ -760,17 +3274,12 @@ int32_t FreeRTOS_TSN_recvmsg( TSNSocket_t xSocket,
         return -pdFREERTOS_ERRNO_EINVAL;
     }
 
-    BaseType_t xTimed = pdFALSE;
-    TickType_t xRemainingTime = pxBaseSocket->xReceiveBlockTime;
-    BaseType_t lPacketCount;
-    TimeOut_t xTimeOut;
-    NetworkBufferDescriptor_t * pxNetworkBuffer = NULL;
-    struct msghdr * pxMsgh;
-    size_t uxPayloadLen = 0;
-    size_t uxLen;
-
-    // Get the number of packets waiting to be processed by the socket
-    lPacketCount = ( BaseType_t ) listCURRENT_LIST_LENGTH( &( pxBaseSocket->u.xUDP.xWaitingPacketsList ) );
+    // A loaned buffer cannot stay in the list of waiting packets
+    if( ( ( ( UBaseType_t ) xFlags & ( UBaseType_t ) FREERTOS_ZERO_COPY ) != 0U ) &&
+        ( ( ( UBaseType_t ) xFlags & ( UBaseType_t ) FREERTOS_MSG_PEEK ) != 0U ) )
+    {
+        return -pdFREERTOS_ERRNO_EINVAL;
+    }
 
     // Check if the FREERTOS_MSG_ERRQUEUE flag is set
     if( xFlags & FREERTOS_MSG_ERRQUEUE )
@@ -780,54 +3289,14 @@ int32_t FreeRTOS_TSN_recvmsg( TSNSocket_t xSocket,
         {
             return -pdFREERTOS_ERRNO_EWOULDBLOCK;
         }
+
+        // Errqueue messages cannot be peeked
+        xFlags &= ~FREERTOS_MSG_PEEK;
     }
     else
     {
-        // If there are no packets waiting, wait for a packet to arrive
-        while( lPacketCount == 0 )
-        {
-            // Check if the socket is non-blocking
-            if( xTimed == pdFALSE )
-            {
-                // Check if the remaining time has expired
-                if( xRemainingTime == ( TickType_t ) 0 )
-                {
-                    break;
-                }
-
-                // Check if the FREERTOS_MSG_DONTWAIT flag is set
-                if( ( ( ( UBaseType_t ) xFlags ) & ( ( UBaseType_t ) FREERTOS_MSG_DONTWAIT ) ) != 0U )
-                {
-                    break;
-                }
-
-                // Set the timed flag and fetch the current time
-                xTimed = pdTRUE;
-                vTaskSetTimeOutState( &xTimeOut );
-            }
-
-            // Wait for a packet to arrive or an interrupt to occur
-            ( void ) xEventGroupWaitBits( pxBaseSocket->xEventGroup, ( ( EventBits_t ) eSOCKET_RECEIVE ) | ( ( EventBits_t ) eSOCKET_INTR ),
-                                          pdTRUE /*xClearOnExit*/, pdFALSE /*xWaitAllBits*/, xRemainingTime );
-
-            // Update the packet count
-            lPacketCount = ( BaseType_t ) listCURRENT_LIST_LENGTH( &( pxBaseSocket->u.xUDP.xWaitingPacketsList ) );
-
-            // If a packet has arrived, break the loop
-            if( lPacketCount != 0 )
-            {
-                break;
-            }
-
-            // Check if the timeout has been reached
-            if( xTaskCheckForTimeOut( &xTimeOut, &xRemainingTime ) != pdFALSE )
-            {
-                break;
-            }
-        } /* while( lPacketCount == 0 ) */
-
         // If there are packets waiting, retrieve the first packet
-        if( lPacketCount > 0 )
+        if( prvWaitForPackets( pxBaseSocket, xFlags ) > 0 )
         {
             vTaskSuspendAll();
             {
@@ -849,76 +3318,122 @@ int32_t FreeRTOS_TSN_recvmsg( TSNSocket_t xSocket,
             return -pdFREERTOS_ERRNO_EWOULDBLOCK;
         }
 
-        // Get the msghdr structure from the network buffer
-        pxMsgh = ( struct msghdr * ) pxNetworkBuffer->pucEthernetBuffer;
-        pxNetworkBuffer->pucEthernetBuffer = ( uint8_t * ) pxMsgh->msg_iov[ 0 ].iov_base;
+        // Get the msghdr structure from the network buffer, a peeked buffer keeps it
+        if( ( ( UBaseType_t ) xFlags & ( UBaseType_t ) FREERTOS_MSG_PEEK ) == 0U )
+        {
+            pxMsgh = prvDetachMsghdr( pxNetworkBuffer );
+        }
+        else
+        {
+            pxMsgh = ( struct msghdr * ) pxNetworkBuffer->pucEthernetBuffer;
+        }
     }
 
-    // Copy the message name if available
-    if( ( pxMsgh->msg_name != NULL ) && ( pxMsghUser->msg_name != NULL ) )
+    return prvRecvToUser( pxSocket, pxNetworkBuffer, pxMsgh, pxMsghUser, xFlags );
+}
+
+/**
+ * @brief Receives multiple messages from a TSN socket.
+ *
+ * Waits for the first message like FreeRTOS_TSN_recvmsg(), then takes all
+ * the messages already waiting, up to uxVLen, removing them from the socket
+ * with a single critical section. The length of each message is stored in
+ * msg_len. FREERTOS_MSG_PEEK is not supported.
+ *
+ * @param xSocket The TSN socket from which to receive the messages.
+ * @param pxMsgVec The messages, each with its own user msghdr.
+ * @param uxVLen The number of messages in pxMsgVec.
+ * @param xFlags Flags that control the behavior of the receive operation.
+ *
+ * @return The number of messages received, or a negative error code if none was received.
+ */
+int32_t FreeRTOS_TSN_recvmmsg( TSNSocket_t xSocket,
+                               struct mmsghdr * pxMsgVec,
+                               size_t uxVLen,
+                               BaseType_t xFlags )
+{
+    FreeRTOS_TSN_Socket_t * pxSocket = ( FreeRTOS_TSN_Socket_t * ) xSocket;
+    FreeRTOS_Socket_t * pxBaseSocket;
+    List_t xReceived;
+    size_t uxCount = 0;
+
+    if( ( pxSocket == NULL ) || ( pxSocket == FREERTOS_TSN_INVALID_SOCKET ) || ( pxMsgVec == NULL ) || ( uxVLen == 0 ) )
     {
-        uxLen = configMIN( pxMsghUser->msg_namelen, pxMsgh->msg_namelen );
-        memcpy( pxMsghUser->msg_name, pxMsgh->msg_name, uxLen );
-        pxMsghUser->msg_namelen = uxLen;
+        return -pdFREERTOS_ERRNO_EINVAL;
     }
-    else
+
+    if( ( ( UBaseType_t ) xFlags & ( UBaseType_t ) FREERTOS_MSG_PEEK ) != 0U )
     {
-        pxMsghUser->msg_namelen = 0;
+        return -pdFREERTOS_ERRNO_EINVAL;
     }
 
-    // Copy the message payload if available
-    if( ( pxMsgh->msg_iov != NULL ) && ( pxMsghUser->msg_iov != NULL ) )
-    {
-        prvMoveToStartOfPayload( &( pxMsgh->msg_iov[ 0 ].iov_base ), &( pxMsgh->msg_iov[ 0 ].iov_len ) );
+    pxBaseSocket = ( FreeRTOS_Socket_t * ) pxSocket->xBaseSocket;
 
-        pxMsghUser->msg_iovlen = configMIN( pxMsghUser->msg_iovlen, pxMsgh->msg_iovlen );
+    if( !tsnsocketSOCKET_IS_BOUND( pxSocket ) )
+    {
+        return -pdFREERTOS_ERRNO_EINVAL;
+    }
 
-        // Copy each element of the message payload array
-        for( BaseType_t uxIter = 0; uxIter < pxMsghUser->msg_iovlen; ++uxIter )
+    if( xFlags & FREERTOS_MSG_ERRQUEUE )
+    {
+        // Errqueue messages are not in the socket list, take them one by one
+        for( uxCount = 0; uxCount < uxVLen; ++uxCount )
         {
-            uxLen = configMIN( pxMsghUser->msg_iov[ uxIter ].iov_len, pxMsgh->msg_iov[ uxIter ].iov_len );
-            memcpy( pxMsghUser->msg_iov[ uxIter ].iov_base, pxMsgh->msg_iov[ uxIter ].iov_base, uxLen );
-            pxMsghUser->msg_iov[ uxIter ].iov_len = uxLen;
-            uxPayloadLen += uxLen;
+            int32_t lReturn = FreeRTOS_TSN_recvmsg( xSocket, &pxMsgVec[ uxCount ].msg_hdr, xFlags );
+
+            if( lReturn < 0 )
+            {
+                break;
+            }
+
+            pxMsgVec[ uxCount ].msg_len = ( unsigned int ) lReturn;
         }
-    }
-    else
-    {
-        pxMsghUser->msg_iovlen = 0;
+
+        return ( uxCount > 0 ) ? ( int32_t ) uxCount : -pdFREERTOS_ERRNO_EWOULDBLOCK;
     }
 
-    // Copy the message control if available
-    if( ( pxMsghUser->msg_control != NULL ) && ( pxMsgh->msg_control != NULL ) )
+    if( prvWaitForPackets( pxBaseSocket, xFlags ) == 0 )
     {
-        uxLen = configMIN( pxMsghUser->msg_controllen, pxMsgh->msg_controllen );
-        memcpy( pxMsghUser->msg_control, pxMsgh->msg_control, uxLen );
-        pxMsghUser->msg_controllen = uxLen;
+        return -pdFREERTOS_ERRNO_EWOULDBLOCK;
     }
-    else
+
+    vListInitialise( &xReceived );
+
+    // Move the waiting buffers to a private list
+    vTaskSuspendAll();
     {
-        pxMsghUser->msg_controllen = 0;
+        while( ( uxCount < uxVLen ) && ( listCURRENT_LIST_LENGTH( &( pxBaseSocket->u.xUDP.xWaitingPacketsList ) ) > 0U ) )
+        {
+            NetworkBufferDescriptor_t * pxNetworkBuffer = ( NetworkBufferDescriptor_t * ) listGET_OWNER_OF_HEAD_ENTRY( &( pxBaseSocket->u.xUDP.xWaitingPacketsList ) );
+
+            ( void ) uxListRemove( &( pxNetworkBuffer->xBufferListItem ) );
+            vListInsertEnd( &xReceived, &( pxNetworkBuffer->xBufferListItem ) );
+            ++uxCount;
+        }
     }
+    ( void ) xTaskResumeAll();
 
-    // Copy the message flags
-    pxMsghUser->msg_flags = pxMsgh->msg_flags;
+    for( size_t uxIter = 0; uxIter < uxCount; ++uxIter )
+    {
+        NetworkBufferDescriptor_t * pxNetworkBuffer = ( NetworkBufferDescriptor_t * ) listGET_OWNER_OF_HEAD_ENTRY( &xReceived );
+        struct msghdr * pxMsgh;
 
-    // Free any ancillary messages
-    vAncillaryMsgFreeAll( pxMsgh );
+        ( void ) uxListRemove( &( pxNetworkBuffer->xBufferListItem ) );
+        pxMsgh = prvDetachMsghdr( pxNetworkBuffer );
 
-    // Release the network buffer
-    if( pxNetworkBuffer != NULL )
-    {
-        vReleaseNetworkBufferAndDescriptor( pxNetworkBuffer );
+        pxMsgVec[ uxIter ].msg_len = ( unsigned int ) prvRecvToUser( pxSocket, pxNetworkBuffer, pxMsgh, &pxMsgVec[ uxIter ].msg_hdr, xFlags );
     }
 
-    // Return the length of the payload
-    return uxPayloadLen;
+    return ( int32_t ) uxCount;
 }
 
 /**
  * @brief Receive data from a TSN socket.
  *
  * This function receives data from a TSN socket and stores it in the provided buffer.
+ * As in Plus TCP, with the FREERTOS_ZERO_COPY flag pvBuffer is a pointer to a
+ * pointer, which is set to the payload inside the network buffer. The payload
+ * must then be released with FreeRTOS_TSN_ReleaseUDPPayloadBuffer().
  *
  * @param xSocket The TSN socket to receive data from.
  * @param pvBuffer Pointer to the buffer where the received data will be stored.
@@ -938,6 +3453,7 @@ int32_t FreeRTOS_TSN_recvfrom( TSNSocket_t xSocket,
 {
     struct msghdr xMsghdr;
     struct iovec xIovec;
+    int32_t lReturn;
 
     // Set the source address and its length in the msghdr structure
     xMsghdr.msg_name = pxSourceAddress;
@@ -959,5 +3475,13 @@ int32_t FreeRTOS_TSN_recvfrom( TSNSocket_t xSocket,
     xFlags &= ~FREERTOS_MSG_ERRQUEUE;
 
     // Call the FreeRTOS_TSN_recvmsg() function to receive the data
-    return FreeRTOS_TSN_recvmsg( xSocket, &xMsghdr, xFlags );
+    lReturn = FreeRTOS_TSN_recvmsg( xSocket, &xMsghdr, xFlags );
+
+    // Return the loaned payload
+    if( ( ( ( UBaseType_t ) xFlags & ( UBaseType_t ) FREERTOS_ZERO_COPY ) != 0U ) && ( lReturn >= 0 ) )
+    {
+        *( ( void ** ) pvBuffer ) = ( xMsghdr.msg_iovlen > 0 ) ? xIovec.iov_base : NULL;
+    }
+
+    return lReturn;
 }
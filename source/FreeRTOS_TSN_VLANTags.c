@@ -33,11 +33,11 @@ uint8_t ucGetNumberOfTags( NetworkBufferDescriptor_t * pxBuf )
 
     if( usEthType == vlantagTPID_DOUBLE_TAG )
     {
-        return ( uint8_t ) 1;
+        return ( uint8_t ) 2;
     }
     else if( usEthType == vlantagTPID_DEFAULT )
     {
-        return ( uint8_t ) 2;
+        return ( uint8_t ) 1;
     }
     else
     {
@@ -45,6 +45,112 @@ uint8_t ucGetNumberOfTags( NetworkBufferDescriptor_t * pxBuf )
     }
 }
 
+/**
+ * @brief Write the VLAN tags and the EtherType of a frame
+ *
+ * The tags are written in place after the MAC addresses, so the frame must
+ * already have room for them: nothing is moved. A single tag is a customer
+ * tag, two tags are a service tag followed by a customer tag.
+ *
+ * @param pucFrame The ethernet frame, with the MAC addresses set
+ * @param ucNumTags The number of tags to write, 0, 1 or 2
+ * @param usSTagTCI TCI of the service tag, used with 2 tags
+ * @param usCTagTCI TCI of the customer tag
+ * @param usFrameType The EtherType following the tags, in network byte order
+ */
+void vVLANTagsWrite( uint8_t * pucFrame,
+                     uint8_t ucNumTags,
+                     uint16_t usSTagTCI,
+                     uint16_t usCTagTCI,
+                     uint16_t usFrameType )
+{
+    switch( ucNumTags )
+    {
+        case 1:
+        {
+            TaggedEthernetHeader_t * pxTEthHeader = ( TaggedEthernetHeader_t * ) pucFrame;
+            pxTEthHeader->xVLANTag.usTPID = FreeRTOS_htons( vlantagTPID_DEFAULT );
+            pxTEthHeader->xVLANTag.usTCI = FreeRTOS_htons( usCTagTCI );
+            pxTEthHeader->usFrameType = usFrameType;
+            break;
+        }
+
+        case 2:
+        {
+            DoubleTaggedEthernetHeader_t * pxDTEthHeader = ( DoubleTaggedEthernetHeader_t * ) pucFrame;
+            pxDTEthHeader->xVLANSTag.usTPID = FreeRTOS_htons( vlantagTPID_DOUBLE_TAG );
+            pxDTEthHeader->xVLANSTag.usTCI = FreeRTOS_htons( usSTagTCI );
+            pxDTEthHeader->xVLANCTag.usTPID = FreeRTOS_htons( vlantagTPID_DEFAULT );
+            pxDTEthHeader->xVLANCTag.usTCI = FreeRTOS_htons( usCTagTCI );
+            pxDTEthHeader->usFrameType = usFrameType;
+            break;
+        }
+
+        default:
+            ( ( EthernetHeader_t * ) pucFrame )->usFrameType = usFrameType;
+            break;
+    }
+}
+
+/**
+ * @brief Give a frame the VLAN tags of the interface it is sent to
+ *
+ * Frames sent by the TSN sockets already have the tags, written when the
+ * headers were built in the room reserved for them, so only their TCIs are
+ * refreshed. Other frames, e.g. the ones built by Plus TCP, are untagged and
+ * are resized once to insert all the tags. Frames built for an interface
+ * with another number of tags get their tags replaced.
+ *
+ * @param pxBuf The frame to send
+ * @param ucNumTags The number of tags of the interface, 0, 1 or 2, frames
+ * are left as they are if 0
+ * @param usSTagTCI TCI of the service tag, used with 2 tags
+ * @param usCTagTCI TCI of the customer tag
+ * @return The frame, which may be another buffer, or NULL if it could not be
+ * resized, in which case pxBuf is released
+ */
+NetworkBufferDescriptor_t * pxVLANTagsInsert( NetworkBufferDescriptor_t * pxBuf,
+                                              uint8_t ucNumTags,
+                                              uint16_t usSTagTCI,
+                                              uint16_t usCTagTCI )
+{
+    const size_t uxPrefix = offsetof( EthernetHeader_t, usFrameType );
+    const size_t uxTagsSize = ucNumTags * sizeof( struct xVLAN_TAG );
+    const size_t uxFoundSize = ucGetNumberOfTags( pxBuf ) * sizeof( struct xVLAN_TAG );
+    const size_t uxLength = pxBuf->xDataLength;
+    uint16_t usFrameType;
+
+    if( ucNumTags == 0U )
+    {
+        return pxBuf;
+    }
+
+    if( uxFoundSize != uxTagsSize )
+    {
+        if( uxTagsSize > uxFoundSize )
+        {
+            /* pxBuf is released by a successful resize */
+            NetworkBufferDescriptor_t * pxNewBuf = pxResizeNetworkBufferWithDescriptor( pxBuf, uxLength - uxFoundSize + uxTagsSize );
+
+            if( pxNewBuf == NULL )
+            {
+                vReleaseNetworkBufferAndDescriptor( pxBuf );
+                return NULL;
+            }
+
+            pxBuf = pxNewBuf;
+        }
+
+        memmove( &pxBuf->pucEthernetBuffer[ uxPrefix + uxTagsSize ], &pxBuf->pucEthernetBuffer[ uxPrefix + uxFoundSize ], uxLength - uxPrefix - uxFoundSize );
+        pxBuf->xDataLength = uxLength - uxFoundSize + uxTagsSize;
+    }
+
+    memcpy( &usFrameType, &pxBuf->pucEthernetBuffer[ uxPrefix + uxTagsSize ], sizeof( usFrameType ) );
+    vVLANTagsWrite( pxBuf->pucEthernetBuffer, ucNumTags, usSTagTCI, usCTagTCI, usFrameType );
+
+    return pxBuf;
+}
+
 /**
  * @brief Get a pointer to the VLAN S-Tag in the network buffer.
  *
@@ -71,7 +71,8 @@
 
 /* FreeRTOS priority of the TSN controller task. If tsnconfigCONTROLLER_HAS_DYNAMIC_PRIO
  * this config entry is ignored as the base priority of the TSN controller is
- * the priority of the idle task plus 1
+ * the priority of the idle task plus 1, and so is the priority passed to
+ * xTSNControllerConfigure()
  */
 #ifndef tsnconfigTSN_CONTROLLER_PRIORITY
     #define tsnconfigTSN_CONTROLLER_PRIORITY    ( configMAX_PRIORITIES - 1 )
@@ -81,6 +82,217 @@
     #error Invalid tsnconfigTSN_CONTROLLER_PRIORITY configuration
 #endif
 
+/* Number of TSN controller instances. Every controller is a separate task
+ * serving its own network scheduler tree, assigned with
+ * xNetworkQueueAssignRootToController(). A queue can be linked in the tree of
+ * only one controller. On SMP ports the controllers can be pinned to different
+ * cores using xTSNControllerConfigure(), so that different interfaces or
+ * traffic classes are processed in parallel.
+ */
+#ifndef tsnconfigMAX_CONTROLLERS
+    #define tsnconfigMAX_CONTROLLERS    ( 1 )
+#endif
+
+#if ( tsnconfigMAX_CONTROLLERS < 1 )
+    #error tsnconfigMAX_CONTROLLERS must be a positive integer
+#endif
+
+/* Split every controller in two stages: the controller task runs the network
+ * scheduler and transmits, while a separate RX stage task delivers the
+ * received frames to the sockets or to the IP task. In this way a burst of
+ * received frames does not delay the next transmissions, and the two stages
+ * can run at different priorities (see xTSNControllerConfigureRxStage()).
+ */
+#ifndef tsnconfigCONTROLLER_SEPARATE_RX_STAGE
+    #define tsnconfigCONTROLLER_SEPARATE_RX_STAGE    tsnconfigDISABLE
+#endif
+
+#if ( ( tsnconfigCONTROLLER_SEPARATE_RX_STAGE != tsnconfigDISABLE ) && ( tsnconfigCONTROLLER_SEPARATE_RX_STAGE != tsnconfigENABLE ) )
+    #error Invalid tsnconfigCONTROLLER_SEPARATE_RX_STAGE configuration
+#endif
+
+/* Default FreeRTOS priority of the RX stage tasks. Only used if
+ * tsnconfigCONTROLLER_SEPARATE_RX_STAGE is enabled.
+ */
+#ifndef tsnconfigCONTROLLER_RX_STAGE_PRIORITY
+    #define tsnconfigCONTROLLER_RX_STAGE_PRIORITY    ( configMAX_PRIORITIES - 2 )
+#endif
+
+#if ( tsnconfigCONTROLLER_RX_STAGE_PRIORITY < 0 )
+    #error Invalid tsnconfigCONTROLLER_RX_STAGE_PRIORITY configuration
+#endif
+
+/* Number of frames that can wait between the controller and its RX stage.
+ * When this is full, the controller drops the received frames and counts
+ * them, see uxTSNControllerGetRxStageDrops().
+ */
+#ifndef tsnconfigCONTROLLER_RX_STAGE_QUEUE_LENGTH
+    #define tsnconfigCONTROLLER_RX_STAGE_QUEUE_LENGTH    ( ipconfigEVENT_QUEUE_LENGTH )
+#endif
+
+#if ( tsnconfigCONTROLLER_RX_STAGE_QUEUE_LENGTH <= 0 )
+    #error Invalid tsnconfigCONTROLLER_RX_STAGE_QUEUE_LENGTH configuration
+#endif
+
+/* Number of frames the RX stage delivers in a row before yielding to the
+ * other tasks with the same priority. A value of 0 means no limit.
+ */
+#ifndef tsnconfigCONTROLLER_RX_STAGE_BUDGET
+    #define tsnconfigCONTROLLER_RX_STAGE_BUDGET    ( 0U )
+#endif
+
+#if ( tsnconfigCONTROLLER_RX_STAGE_BUDGET < 0 )
+    #error tsnconfigCONTROLLER_RX_STAGE_BUDGET must be a non negative integer
+#endif
+
+/* Limit the work done by a controller every time it wakes up. When the budget
+ * of a direction is exhausted, the controller keeps serving the frames of the
+ * other direction. At the end of the pass, it notifies itself and sleeps for
+ * tsnconfigCONTROLLER_BUDGET_BACKOFF_TICKS, so that a flood of frames cannot
+ * starve the other tasks, including the ones with a lower priority.
+ * The initial budgets are given by the options below and can be changed at
+ * run time with xTSNControllerSetBudget(). Exhaustion counters can be read
+ * with xTSNControllerGetBudgetStats().
+ */
+#ifndef tsnconfigCONTROLLER_HAS_BUDGET
+    #define tsnconfigCONTROLLER_HAS_BUDGET    tsnconfigDISABLE
+#endif
+
+#if ( ( tsnconfigCONTROLLER_HAS_BUDGET != tsnconfigDISABLE ) && ( tsnconfigCONTROLLER_HAS_BUDGET != tsnconfigENABLE ) )
+    #error Invalid tsnconfigCONTROLLER_HAS_BUDGET configuration
+#endif
+
+/* Initial per-wakeup budgets of the controllers, in frames, bytes and
+ * nanoseconds, for the TX and the RX direction. A value of 0 means no limit.
+ * The time budget needs a running timebase.
+ */
+#ifndef tsnconfigCONTROLLER_TX_BUDGET_PACKETS
+    #define tsnconfigCONTROLLER_TX_BUDGET_PACKETS    ( 0U )
+#endif
+
+#if ( tsnconfigCONTROLLER_TX_BUDGET_PACKETS < 0 )
+    #error tsnconfigCONTROLLER_TX_BUDGET_PACKETS must be a non negative integer
+#endif
+
+#ifndef tsnconfigCONTROLLER_TX_BUDGET_BYTES
+    #define tsnconfigCONTROLLER_TX_BUDGET_BYTES    ( 0U )
+#endif
+
+#if ( tsnconfigCONTROLLER_TX_BUDGET_BYTES < 0 )
+    #error tsnconfigCONTROLLER_TX_BUDGET_BYTES must be a non negative integer
+#endif
+
+#ifndef tsnconfigCONTROLLER_TX_BUDGET_NS
+    #define tsnconfigCONTROLLER_TX_BUDGET_NS    ( 0U )
+#endif
+
+#if ( tsnconfigCONTROLLER_TX_BUDGET_NS < 0 )
+    #error tsnconfigCONTROLLER_TX_BUDGET_NS must be a non negative integer
+#endif
+
+#ifndef tsnconfigCONTROLLER_RX_BUDGET_PACKETS
+    #define tsnconfigCONTROLLER_RX_BUDGET_PACKETS    ( 0U )
+#endif
+
+#if ( tsnconfigCONTROLLER_RX_BUDGET_PACKETS < 0 )
+    #error tsnconfigCONTROLLER_RX_BUDGET_PACKETS must be a non negative integer
+#endif
+
+#ifndef tsnconfigCONTROLLER_RX_BUDGET_BYTES
+    #define tsnconfigCONTROLLER_RX_BUDGET_BYTES    ( 0U )
+#endif
+
+#if ( tsnconfigCONTROLLER_RX_BUDGET_BYTES < 0 )
+    #error tsnconfigCONTROLLER_RX_BUDGET_BYTES must be a non negative integer
+#endif
+
+#ifndef tsnconfigCONTROLLER_RX_BUDGET_NS
+    #define tsnconfigCONTROLLER_RX_BUDGET_NS    ( 0U )
+#endif
+
+#if ( tsnconfigCONTROLLER_RX_BUDGET_NS < 0 )
+    #error tsnconfigCONTROLLER_RX_BUDGET_NS must be a non negative integer
+#endif
+
+/* Ticks a controller sleeps after running out of budget, before resuming */
+#ifndef tsnconfigCONTROLLER_BUDGET_BACKOFF_TICKS
+    #define tsnconfigCONTROLLER_BUDGET_BACKOFF_TICKS    ( 1U )
+#endif
+
+#if ( tsnconfigCONTROLLER_BUDGET_BACKOFF_TICKS < 1 )
+    #error tsnconfigCONTROLLER_BUDGET_BACKOFF_TICKS must be a positive integer
+#endif
+
+/* Time in nanoseconds a controller keeps polling its queues after it ran out
+ * of work, before blocking on its notification. While polling, the producers
+ * do not notify the controller, saving a context switch per packet when
+ * packets arrive close to each other. The window shrinks when polling keeps
+ * failing. Requires a running timebase. A value of 0 disables polling.
+ */
+#ifndef tsnconfigCONTROLLER_BUSY_POLL_NS
+    #define tsnconfigCONTROLLER_BUSY_POLL_NS    ( 0U )
+#endif
+
+#if ( tsnconfigCONTROLLER_BUSY_POLL_NS < 0 ) || ( tsnconfigCONTROLLER_BUSY_POLL_NS >= 1000000000 )
+    #error tsnconfigCONTROLLER_BUSY_POLL_NS must be a non negative integer less than one second
+#endif
+
+/* Allow network queues to be marked as express with xNetworkQueueSetExpress().
+ * A task sending a packet for an unshaped express queue transmits it
+ * directly, without waking up the controller, if the controller is idle and
+ * none of its queues has waiting packets. This removes two context switches
+ * from the critical path, while the controller still handles every case in
+ * which packets compete for the interface.
+ */
+#ifndef tsnconfigCONTROLLER_HAS_EXPRESS_PATH
+    #define tsnconfigCONTROLLER_HAS_EXPRESS_PATH    tsnconfigDISABLE
+#endif
+
+#if ( ( tsnconfigCONTROLLER_HAS_EXPRESS_PATH != tsnconfigDISABLE ) && ( tsnconfigCONTROLLER_HAS_EXPRESS_PATH != tsnconfigENABLE ) )
+    #error Invalid tsnconfigCONTROLLER_HAS_EXPRESS_PATH configuration
+#endif
+
+/* Allow network queues to be marked as pass-through with
+ * xNetworkQueueSetPassThrough(). Received frames assigned to a pass-through
+ * queue and bound to a TSN socket are delivered by the network wrapper
+ * directly, saving a queue hop and a context switch per frame. The delivery
+ * then runs in the context of the driver task passing the frame to
+ * xSendEventStructToTSNController(), which must not be an interrupt.
+ */
+#ifndef tsnconfigINCLUDE_PASSTHROUGH_QUEUES
+    #define tsnconfigINCLUDE_PASSTHROUGH_QUEUES    tsnconfigDISABLE
+#endif
+
+#if ( ( tsnconfigINCLUDE_PASSTHROUGH_QUEUES != tsnconfigDISABLE ) && ( tsnconfigINCLUDE_PASSTHROUGH_QUEUES != tsnconfigENABLE ) )
+    #error Invalid tsnconfigINCLUDE_PASSTHROUGH_QUEUES configuration
+#endif
+
+/* Max number of packets the controller sends with a single scheduling
+ * decision. Batching is only applied to queues that are not shaped by any
+ * node of the scheduler tree nor compete with other queues through a custom
+ * select function, e.g. a priority node, and only to consecutive packets for
+ * the same interface. A value of 1 disables batching.
+ */
+#ifndef tsnconfigCONTROLLER_TX_BATCH_SIZE
+    #define tsnconfigCONTROLLER_TX_BATCH_SIZE    ( 1U )
+#endif
+
+#if ( tsnconfigCONTROLLER_TX_BATCH_SIZE < 1 )
+    #error tsnconfigCONTROLLER_TX_BATCH_SIZE must be a positive integer
+#endif
+
+/* Enable if the network driver implements xNetworkInterfaceOutputBatch(),
+ * see NetworkWrapper.h. Batches are otherwise passed to the driver one
+ * packet at a time. Only used if tsnconfigCONTROLLER_TX_BATCH_SIZE > 1.
+ */
+#ifndef tsnconfigWRAPPER_HAS_BATCH_OUTPUT
+    #define tsnconfigWRAPPER_HAS_BATCH_OUTPUT    tsnconfigDISABLE
+#endif
+
+#if ( ( tsnconfigWRAPPER_HAS_BATCH_OUTPUT != tsnconfigDISABLE ) && ( tsnconfigWRAPPER_HAS_BATCH_OUTPUT != tsnconfigENABLE ) )
+    #error Invalid tsnconfigWRAPPER_HAS_BATCH_OUTPUT configuration
+#endif
+
 /* If the network interface has no support for adding VLAN tags to 802.1Q
  * packets, enabling this feature can be a turnaround for sending tagged
  * packets. Note that the effect of this option highly depends on the behaviour
@@ -111,6 +323,207 @@
     #error tsnconfigWRAPPER_INSERTS_VLAN_TAGS and tsnconfigSOCKET_INSERTS_VLAN_TAGS cannot be enabled at the same time
 #endif
 
+/* Number of slots of the hash table indexing the bound TSN sockets by port.
+ * Must be a power of two, and should be larger than the number of TSN
+ * sockets bound at the same time. If the table fills up, lookups of ports
+ * not found in the table fall back to a linear scan of the bound sockets.
+ * Set to 0 to always use the linear scan.
+ */
+#ifndef tsnconfigSOCKET_HASH_SIZE
+    #define tsnconfigSOCKET_HASH_SIZE    ( 16U )
+#endif
+
+#if ( ( tsnconfigSOCKET_HASH_SIZE & ( tsnconfigSOCKET_HASH_SIZE - 1U ) ) != 0 )
+    #error tsnconfigSOCKET_HASH_SIZE must be 0 or a power of two
+#endif
+
+/* Kernel used for the IPv4 and UDP checksums computed by the TSN layer:
+ * - tsnconfigCHECKSUM_REFERENCE sums a 16 bit word at a time
+ * - tsnconfigCHECKSUM_WORD sums 32 bit words in a 64 bit accumulator
+ * - tsnconfigCHECKSUM_SIMD uses SSE2 or NEON when the compiler targets
+ *   them, otherwise it is the same as tsnconfigCHECKSUM_WORD
+ */
+#define tsnconfigCHECKSUM_REFERENCE    ( 0 )
+#define tsnconfigCHECKSUM_WORD         ( 1 )
+#define tsnconfigCHECKSUM_SIMD         ( 2 )
+
+#ifndef tsnconfigCHECKSUM_KERNEL
+    #define tsnconfigCHECKSUM_KERNEL    tsnconfigCHECKSUM_WORD
+#endif
+
+#if ( tsnconfigCHECKSUM_KERNEL < tsnconfigCHECKSUM_REFERENCE ) || ( tsnconfigCHECKSUM_KERNEL > tsnconfigCHECKSUM_SIMD )
+    #error Invalid tsnconfigCHECKSUM_KERNEL configuration
+#endif
+
+/* Compare the checksum kernel with the reference one when the controllers
+ * are initialised, logging and asserting if they differ. The test covers odd
+ * lengths, unaligned data and sums carrying on every addition, and checksums
+ * about 56 MB with the default MTU, which delays the startup by seconds on a
+ * microcontroller, so it is meant for bring-up and test builds.
+ */
+#ifndef tsnconfigCHECKSUM_SELF_TEST
+    #define tsnconfigCHECKSUM_SELF_TEST    tsnconfigDISABLE
+#endif
+
+/* Run the self tests of the TSN layer when the controllers are initialised,
+ * logging and asserting if one fails. They check on fixed inputs the header
+ * offsets found by the parser in tagged and untagged frames, the
+ * incremental checksum update and, if enabled, the collision chains of the
+ * socket hash table and the FRER sequence recovery window. They take well under a millisecond, but are only useful in
+ * bring-up and test builds.
+ */
+#ifndef tsnconfigSELF_TEST
+    #define tsnconfigSELF_TEST    tsnconfigDISABLE
+#endif
+
+#if ( ( tsnconfigSELF_TEST != tsnconfigDISABLE ) && ( tsnconfigSELF_TEST != tsnconfigENABLE ) )
+    #error Invalid tsnconfigSELF_TEST configuration
+#endif
+
+/* Max age in milliseconds of the headers cached by connected sockets. Once
+ * expired, the next frame looks up the ARP cache again and rebuilds the
+ * template. Templates are also dropped when an ARP or ICMPv6 packet changes
+ * the MAC address of their next hop. Set to 0 to prepare every frame from
+ * scratch.
+ */
+#ifndef tsnconfigSOCKET_TEMPLATE_REVALIDATE_MS
+    #define tsnconfigSOCKET_TEMPLATE_REVALIDATE_MS    ( 1000U )
+#endif
+
+#if ( tsnconfigSOCKET_TEMPLATE_REVALIDATE_MS < 0 )
+    #error Invalid tsnconfigSOCKET_TEMPLATE_REVALIDATE_MS configuration
+#endif
+
+/* Max number of frames prepared by FreeRTOS_TSN_sendmmsg() before inserting
+ * them in the network queues with a single notification. The queue items
+ * of a batch are kept on the stack of the sending task.
+ */
+#ifndef tsnconfigSOCKET_MMSG_BATCH
+    #define tsnconfigSOCKET_MMSG_BATCH    ( 8U )
+#endif
+
+#if ( tsnconfigSOCKET_MMSG_BATCH < 1 )
+    #error Invalid tsnconfigSOCKET_MMSG_BATCH configuration
+#endif
+
+/* Number of destinations for which frames sent by TSN sockets can wait for
+ * an ARP reply, instead of being dropped. The default 0 fails the send when
+ * the destination is not in the ARP cache. The frames which still get
+ * dropped are counted by uxTSNARPPendingGetDrops().
+ */
+#ifndef tsnconfigARP_PENDING_DESTINATIONS
+    #define tsnconfigARP_PENDING_DESTINATIONS    ( 0U )
+#endif
+
+#if ( tsnconfigARP_PENDING_DESTINATIONS < 0 )
+    #error Invalid tsnconfigARP_PENDING_DESTINATIONS configuration
+#endif
+
+/* Max number of frames waiting for the resolution of each destination */
+#ifndef tsnconfigARP_PENDING_PER_DESTINATION
+    #define tsnconfigARP_PENDING_PER_DESTINATION    ( 4U )
+#endif
+
+#if ( tsnconfigARP_PENDING_PER_DESTINATION < 1 )
+    #error Invalid tsnconfigARP_PENDING_PER_DESTINATION configuration
+#endif
+
+/* Time after which the frames waiting for an ARP reply are dropped */
+#ifndef tsnconfigARP_PENDING_TIMEOUT_MS
+    #define tsnconfigARP_PENDING_TIMEOUT_MS    ( 1000U )
+#endif
+
+#if ( tsnconfigARP_PENDING_TIMEOUT_MS < 1 )
+    #error Invalid tsnconfigARP_PENDING_TIMEOUT_MS configuration
+#endif
+
+/* Period at which the controllers check the ARP cache for the
+ * destinations with waiting frames and for the static neighbors.
+ */
+#ifndef tsnconfigARP_POLL_MS
+    #define tsnconfigARP_POLL_MS    ( 10U )
+#endif
+
+#if ( tsnconfigARP_POLL_MS < 0 )
+    #error Invalid tsnconfigARP_POLL_MS configuration
+#endif
+
+/* Number of neighbors which can be added with xTSNARPAddNeighbor(). Their
+ * addresses are never aged, so that the first frame of a time critical
+ * stream never waits for ARP. Set to 0 to disable the table.
+ */
+#ifndef tsnconfigARP_STATIC_NEIGHBORS
+    #define tsnconfigARP_STATIC_NEIGHBORS    ( 0U )
+#endif
+
+#if ( tsnconfigARP_STATIC_NEIGHBORS < 0 )
+    #error Invalid tsnconfigARP_STATIC_NEIGHBORS configuration
+#endif
+
+/* Number of streams using Frame Replication and Elimination for Reliability
+ * (IEEE 802.1CB), configured with xFRERStreamConfigure(). Sent frames of a
+ * stream get an R-TAG and are replicated on two member streams, received
+ * duplicates are discarded. Set to 0 to disable FRER.
+ */
+#ifndef tsnconfigFRER_STREAMS
+    #define tsnconfigFRER_STREAMS    ( 0U )
+#endif
+
+#if ( tsnconfigFRER_STREAMS < 0 )
+    #error Invalid tsnconfigFRER_STREAMS configuration
+#endif
+
+/* Number of sequence numbers remembered by the vector recovery algorithm of
+ * each stream. Frames further than this from the latest one are discarded.
+ */
+#ifndef tsnconfigFRER_HISTORY_LENGTH
+    #define tsnconfigFRER_HISTORY_LENGTH    ( 32U )
+#endif
+
+#if ( tsnconfigFRER_HISTORY_LENGTH < 2 ) || ( tsnconfigFRER_HISTORY_LENGTH > 32 )
+    #error Invalid tsnconfigFRER_HISTORY_LENGTH configuration
+#endif
+
+/* Time without accepted frames after which a stream takes any sequence
+ * number again, e.g. after the talker restarted.
+ */
+#ifndef tsnconfigFRER_RESET_MS
+    #define tsnconfigFRER_RESET_MS    ( 1000U )
+#endif
+
+#if ( tsnconfigFRER_RESET_MS < 1 )
+    #error Invalid tsnconfigFRER_RESET_MS configuration
+#endif
+
+/* Number of ancillary messages preallocated in a static pool. Each message
+ * holds the msghdr, the address, the iovec and the control messages in a
+ * single record; when the pool is exhausted records are allocated from the
+ * heap. Set to 0 to always use the heap.
+ */
+#ifndef tsnconfigANCILLARY_POOL_SIZE
+    #define tsnconfigANCILLARY_POOL_SIZE    ( 8U )
+#endif
+
+#if ( tsnconfigANCILLARY_POOL_SIZE < 0 )
+    #error Invalid tsnconfigANCILLARY_POOL_SIZE configuration
+#endif
+
+/* Number of extra references to received raw frames, used to deliver a
+ * frame to several raw sockets without copying it. Each reference is a
+ * network buffer descriptor taken from a static pool, pointing to the shared
+ * frame, see pxSharedBufferRetain(). Setting it above 0 also lets several
+ * raw sockets bind the same EtherType and VID, each receiving the frames.
+ * The default 0 delivers each frame to one socket only, and such a bind
+ * fails with EADDRINUSE. UDP frames always go to a single socket.
+ */
+#ifndef tsnconfigSHARED_BUFFER_POOL_SIZE
+    #define tsnconfigSHARED_BUFFER_POOL_SIZE    ( 0U )
+#endif
+
+#if ( tsnconfigSHARED_BUFFER_POOL_SIZE < 0 )
+    #error Invalid tsnconfigSHARED_BUFFER_POOL_SIZE configuration
+#endif
+
 /* The maximum number of messages waiting in a socket errqueue
  */
 #ifndef tsnconfigERRQUEUE_LENGTH
@@ -0,0 +1,37 @@
+#ifndef FREERTOS_TSN_ARP_H
+#define FREERTOS_TSN_ARP_H
+
+#include "FreeRTOS.h"
+
+#include "FreeRTOS_IP.h"
+#include "FreeRTOS_ARP.h"
+
+#include "FreeRTOSTSNConfig.h"
+#include "FreeRTOSTSNConfigDefaults.h"
+
+struct xNETQUEUE_ITEM;
+
+eARPLookupResult_t eTSNARPGetCacheEntry( uint32_t * pulIPAddress,
+                                         MACAddress_t * const pxMACAddress,
+                                         struct xNetworkEndPoint ** ppxEndPoint );
+
+#if ( tsnconfigARP_STATIC_NEIGHBORS > 0 )
+    BaseType_t xTSNARPAddNeighbor( uint32_t ulIPAddress,
+                                   const MACAddress_t * pxMACAddress );
+#endif
+
+#if ( tsnconfigARP_PENDING_DESTINATIONS > 0 )
+    BaseType_t xTSNARPIsPending( uint32_t ulIPAddress );
+
+    BaseType_t xTSNARPPendingAdd( const struct xNETQUEUE_ITEM * pxItem );
+
+    UBaseType_t uxTSNARPPendingGetDrops( void );
+#endif
+
+#if ( ipconfigUSE_IPv6 != 0 )
+    void vTSNNDSendSolicitation( const IPv6_Address_t * pxIPAddress );
+#endif
+
+TickType_t uxTSNARPPoll( void );
+
+#endif /* FREERTOS_TSN_ARP_H */
@@ -5,6 +5,11 @@
 
 #include "FreeRTOS_IP.h"
 
+#include "FreeRTOS_TSN_Parser.h"
+#include "FreeRTOS_TSN_Timebase.h"
+
+struct xTSN_SOCKET;
+
 struct iovec         /* Scatter/gather array items */
 {
     void * iov_base; /* Starting address */
@@ -22,6 +27,12 @@ struct msghdr
     int msg_flags;          /* flags on received message */
 };
 
+struct mmsghdr
+{
+    struct msghdr msg_hdr; /* message header */
+    unsigned int msg_len;  /* number of bytes transmitted */
+};
+
 struct cmsghdr
 {
     socklen_t cmsg_len; /* data byte count, including header */
@@ -42,6 +53,32 @@ struct sock_extended_err
     /* More data may follow */
 };
 
+#ifndef FREERTOS_AF_PACKET
+    #define FREERTOS_AF_PACKET    ( 17 ) /* Raw layer 2 sockets, see FREERTOS_SOCK_RAW */
+#endif
+
+/* Values of sll_pkttype */
+#define FREERTOS_PACKET_HOST         ( 0 )
+#define FREERTOS_PACKET_BROADCAST    ( 1 )
+#define FREERTOS_PACKET_MULTICAST    ( 2 )
+
+/** @brief Link layer address of raw TSN sockets
+ *
+ * Used instead of freertos_sockaddr with the FREERTOS_AF_PACKET family, and
+ * small enough to be stored in its place. The protocol is the EtherType in
+ * network byte order, the VID is in host byte order.
+ */
+struct freertos_sockaddr_ll
+{
+    uint8_t sll_len;        /* length of this structure */
+    uint8_t sll_family;     /* FREERTOS_AF_PACKET */
+    uint16_t sll_protocol;  /* EtherType */
+    uint16_t sll_vid;       /* VLAN identifier, or FREERTOS_TSN_ANY_VID */
+    uint8_t sll_pkttype;    /* FREERTOS_PACKET_* type, received frames only */
+    uint8_t sll_halen;      /* length of the MAC address */
+    uint8_t sll_addr[ 8 ];  /* MAC address */
+};
+
 #ifndef pdFREERTOS_ERRNO_ENOMSG
 /* This is somehow missing from projdefs.h */
     #define pdFREERTOS_ERRNO_ENOMSG    42
@@ -77,18 +114,50 @@ struct cmsghdr * __CMSG_NXTHDR( void * ctl,
 
 #define CMSG_NXTHDR( mhdr, cmsg )    __CMSG_NXTHDR( ( mhdr )->msg_control, ( mhdr )->msg_controllen, ( cmsg ) )
 
+/* Bits of ulValid in AncillaryRxInfo_t */
+#define ancillaryRX_HAS_SW_TIMESTAMP      ( 1UL << 0 )
+#define ancillaryRX_HAS_HW_TIMESTAMP      ( 1UL << 1 )
+#define ancillaryRX_HAS_QUEUE             ( 1UL << 2 )
+#define ancillaryRX_HAS_QUEUEING_DELAY    ( 1UL << 3 )
+
+/** @brief Raw information about a received frame
+ *
+ * Recorded in the ancillary message on the receive path, and turned into
+ * control messages only if the user asks for them, see
+ * uxAncillaryMsgControlBuild(). The VLAN tags are found in the metadata.
+ */
+struct xANCILLARY_RX_INFO
+{
+    uint32_t ulValid;                             /**< ancillaryRX_HAS_* bits of the fields which are set */
+    struct freertos_timespec xSoftwareTimestamp;  /**< Time at which the frame entered the TSN layer */
+    struct freertos_timespec xHardwareTimestamp;  /**< Timestamp taken by the MAC */
+    struct freertos_timespec xQueueingDelay;      /**< Time spent between reception and socket delivery */
+    UBaseType_t uxQueueIPV;                       /**< IPV of the network queue which scheduled the frame */
+};
+
+typedef struct xANCILLARY_RX_INFO AncillaryRxInfo_t;
 
 struct msghdr * pxAncillaryMsgMalloc();
 
 void vAncillaryMsgFree( struct msghdr * pxMsgh );
 
+PacketMetadata_t * pxAncillaryMsgGetMetadata( struct msghdr * pxMsgh );
+
+AncillaryRxInfo_t * pxAncillaryMsgGetRxInfo( struct msghdr * pxMsgh );
+
 void vAncillaryMsgFreeAll( struct msghdr * pxMsgh );
 
+struct msghdr * pxAncillaryMsgDuplicate( struct msghdr * pxMsgh );
+
 BaseType_t xAncillaryMsgFillName( struct msghdr * pxMsgh,
                                   IP_Address_t * xAddr,
                                   uint16_t usPort,
                                   BaseType_t xFamily );
 
+BaseType_t xAncillaryMsgFillLinkName( struct msghdr * pxMsgh,
+                                      const uint8_t * pucEthernetBuffer,
+                                      const PacketMetadata_t * pxMeta );
+
 void vAncillaryMsgFreeName( struct msghdr * pxMsgh );
 
 BaseType_t xAncillaryMsgFillPayload( struct msghdr * pxMsgh,
@@ -110,4 +179,10 @@ BaseType_t xAncillaryMsgControlFillSingle( struct msghdr * pxMsgh,
 
 void vAncillaryMsgFreeControl( struct msghdr * pxMsgh );
 
+size_t uxAncillaryMsgControlBuild( struct msghdr * pxMsgh,
+                                   const struct xTSN_SOCKET * pxTSNSocket,
+                                   void * pvControl,
+                                   size_t uxControlLen,
+                                   int * piFlags );
+
 #endif /* FREERTOS_TSN_ANCILLARY_H */
@@ -0,0 +1,46 @@
+#ifndef FREERTOS_TSN_CHECKSUM_H
+#define FREERTOS_TSN_CHECKSUM_H
+
+#include "FreeRTOS.h"
+
+#include "FreeRTOS_IP.h"
+
+#include "FreeRTOSTSNConfig.h"
+#include "FreeRTOSTSNConfigDefaults.h"
+
+uint16_t usChecksumAccumulate( uint16_t usSum,
+                               const uint8_t * pucData,
+                               size_t uxLength );
+
+uint16_t usChecksumUpdate16( uint16_t usChecksum,
+                             uint16_t usOldValue,
+                             uint16_t usNewValue );
+
+uint16_t usChecksumIPv4Header( const IPHeader_t * pxIPHeader );
+
+uint16_t usChecksumUDPv4( const IPHeader_t * pxIPHeader,
+                          const uint8_t * pucUDPSegment,
+                          size_t uxUDPLength );
+
+BaseType_t xChecksumVerifyIPv4UDP( const uint8_t * pucIPPacket,
+                                   size_t uxIPHeaderLength,
+                                   size_t uxUDPLength );
+
+#if ( ipconfigUSE_IPv6 != 0 )
+    uint16_t usChecksumUDPv6( const IPHeader_IPv6_t * pxIPHeader,
+                              const uint8_t * pucUDPSegment,
+                              size_t uxUDPLength );
+
+    BaseType_t xChecksumVerifyIPv6UDP( const uint8_t * pucIPPacket,
+                                       size_t uxUDPLength );
+#endif
+
+#if ( tsnconfigCHECKSUM_SELF_TEST != tsnconfigDISABLE )
+    BaseType_t xChecksumSelfTest( void );
+#endif
+
+#if ( tsnconfigSELF_TEST != tsnconfigDISABLE )
+    BaseType_t xChecksumUpdateSelfTest( void );
+#endif
+
+#endif /* FREERTOS_TSN_CHECKSUM_H */
@@ -2,13 +2,158 @@
 #define FREERTOS_TSN_CONTROLLER
 
 #include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
 #include "FreeRTOS_IP.h"
 
-BaseType_t xNotifyController();
+#include "FreeRTOSTSNConfig.h"
+#include "FreeRTOSTSNConfigDefaults.h"
 
-void vTSNControllerComputePriority( void );
+struct xNETQUEUE;
+struct xNETQUEUE_NODE;
+struct xNETQUEUE_ITEM;
 
-BaseType_t xTSNControllerUpdatePriority( UBaseType_t uxPriority );
+/* Value of the affinity mask for controllers that can run on any core */
+#define controllerNO_AFFINITY    ( ( UBaseType_t ) ~0U )
+
+#if ( tsnconfigCONTROLLER_HAS_BUDGET != tsnconfigDISABLE )
+
+/** @brief Directions of the traffic handled by a controller */
+    typedef enum
+    {
+        eControllerBudgetTx = 0, /**< Frames sent to the network interfaces */
+        eControllerBudgetRx,     /**< Frames delivered to the sockets or the IP task */
+        eControllerBudgetDirections
+    } eControllerBudgetDirection_t;
+
+/** @brief Work a controller can do in a direction before deferring it
+ *
+ * A value of 0 in any field means no limit on that resource.
+ */
+    struct xTSN_CONTROLLER_BUDGET
+    {
+        UBaseType_t uxPackets;  /**< Max number of frames per wakeup */
+        size_t uxBytes;         /**< Max number of bytes per wakeup */
+        uint32_t ulNanoseconds; /**< Max time spent handling frames per wakeup */
+    };
+
+    typedef struct xTSN_CONTROLLER_BUDGET TSNControllerBudget_t;
+
+/** @brief Number of wakeups ended by each budget, for a direction */
+    struct xTSN_CONTROLLER_BUDGET_STATS
+    {
+        uint32_t ulPacketsExhausted; /**< Times the packets budget ran out */
+        uint32_t ulBytesExhausted;   /**< Times the bytes budget ran out */
+        uint32_t ulTimeExhausted;    /**< Times the time budget ran out */
+    };
+
+    typedef struct xTSN_CONTROLLER_BUDGET_STATS TSNControllerBudgetStats_t;
+
+#endif /* if ( tsnconfigCONTROLLER_HAS_BUDGET != tsnconfigDISABLE ) */
+
+/** @brief A TSN controller instance
+ *
+ * Each controller is a task that serves its own network scheduler tree,
+ * starting from pxRoot. The queues found in the tree are bound to the
+ * controller when the root is assigned, and a queue can be bound to only one
+ * controller. In this way controllers never share queues and can run on
+ * different cores without contending on the same scheduler.
+ * Controllers can be dedicated to an interface or to a group of traffic
+ * classes simply by choosing the filters of the queues in their tree.
+ */
+struct xTSN_CONTROLLER
+{
+    TaskHandle_t xTaskHandle;        /**< Handle of the controller task, NULL if not started */
+    struct xNETQUEUE_NODE * pxRoot;  /**< Root of the network scheduler served by this controller */
+    UBaseType_t uxPriority;          /**< Priority of the task, used when dynamic priority is disabled */
+    UBaseType_t uxCoreAffinityMask;  /**< Cores on which the controller can run, controllerNO_AFFINITY for any */
+    TickType_t uxNextWakeup;         /**< Next tick at which a scheduler asked to be checked again */
+    volatile BaseType_t xNotifyPending; /**< pdTRUE if notified after the start of the last pass */
+    #if ( tsnconfigCONTROLLER_HAS_EXPRESS_PATH != tsnconfigDISABLE )
+        volatile BaseType_t xTokenHeld;   /**< pdTRUE while the controller or an express sender owns the output */
+        volatile BaseType_t xTokenWanted; /**< pdTRUE if the controller is waiting for the token */
+    #endif
+    #if ( tsnconfigCONTROLLER_HAS_DYNAMIC_PRIO != tsnconfigDISABLE )
+        volatile UBaseType_t uxCurrentPriority; /**< Last priority assigned to the task */
+        volatile BaseType_t xPriorityStale;     /**< pdTRUE if the priority must be computed again */
+    #endif
+    #if ( tsnconfigCONTROLLER_SEPARATE_RX_STAGE != tsnconfigDISABLE )
+        TaskHandle_t xRxStageHandle;         /**< Handle of the task delivering the received frames */
+        QueueHandle_t xRxStageQueue;         /**< Frames scheduled by the controller and waiting for delivery */
+        UBaseType_t uxRxStagePriority;       /**< Priority of the RX stage task */
+        volatile UBaseType_t uxRxStageDrops; /**< Frames dropped because the RX stage queue was full */
+    #endif
+    #if ( tsnconfigCONTROLLER_HAS_BUDGET != tsnconfigDISABLE )
+        TSNControllerBudget_t xBudget[ eControllerBudgetDirections ];     /**< Budget of each direction */
+        TSNControllerBudgetStats_t xStats[ eControllerBudgetDirections ]; /**< Budget exhaustion counters */
+    #endif
+    #if ( tsnconfigCONTROLLER_BUSY_POLL_NS > 0 )
+        volatile BaseType_t xIsPolling;  /**< pdTRUE while the controller is polling its queues */
+        volatile BaseType_t xPollSignal; /**< Set by the producers which skipped the notification while polling */
+        uint32_t ulPollWindow;           /**< Current length of the poll window in nanoseconds */
+        uint32_t ulPollHits;             /**< Times new packets were found while polling */
+        uint32_t ulPollMisses;           /**< Times the poll window expired */
+    #endif
+};
+
+typedef struct xTSN_CONTROLLER TSNController_t;
+
+BaseType_t xTSNControllerConfigure( BaseType_t xIndex,
+                                    UBaseType_t uxPriority,
+                                    UBaseType_t uxCoreAffinityMask );
+
+#if ( tsnconfigCONTROLLER_SEPARATE_RX_STAGE != tsnconfigDISABLE )
+    BaseType_t xTSNControllerConfigureRxStage( BaseType_t xIndex,
+                                               UBaseType_t uxPriority );
+
+    UBaseType_t uxTSNControllerGetRxStageDrops( BaseType_t xIndex );
+#endif
+
+#if ( tsnconfigCONTROLLER_HAS_BUDGET != tsnconfigDISABLE )
+    BaseType_t xTSNControllerSetBudget( BaseType_t xIndex,
+                                        eControllerBudgetDirection_t eDirection,
+                                        const TSNControllerBudget_t * pxBudget );
+
+    BaseType_t xTSNControllerGetBudgetStats( BaseType_t xIndex,
+                                             eControllerBudgetDirection_t eDirection,
+                                             TSNControllerBudgetStats_t * pxStats );
+#endif
+
+#if ( tsnconfigCONTROLLER_BUSY_POLL_NS > 0 )
+    BaseType_t xTSNControllerGetPollStats( BaseType_t xIndex,
+                                           uint32_t * pulHits,
+                                           uint32_t * pulMisses );
+#endif
+
+#if ( tsnconfigCONTROLLER_HAS_EXPRESS_PATH != tsnconfigDISABLE )
+    BaseType_t xTSNControllerTakeExpressToken( struct xNETQUEUE * pxQueue );
+
+    void vTSNControllerReleaseExpressToken( TSNController_t * pxController );
+#endif
+
+#if ( tsnconfigINCLUDE_PASSTHROUGH_QUEUES != tsnconfigDISABLE )
+    BaseType_t xTSNControllerDeliverToSocket( struct xNETQUEUE_ITEM * pxItem );
+#endif
+
+BaseType_t xTSNControllerSetRoot( BaseType_t xIndex,
+                                  struct xNETQUEUE_NODE * pxRoot );
+
+TSNController_t * pxTSNControllerGet( BaseType_t xIndex );
+
+TSNController_t * pxTSNControllerGetCurrent( void );
+
+BaseType_t xNotifyController( TSNController_t * pxController );
+
+BaseType_t xNotifyControllerFromISR( TSNController_t * pxController,
+                                     BaseType_t * pxHigherPriorityTaskWoken );
+
+void vTSNControllerComputePriority( TSNController_t * pxController );
+
+BaseType_t xTSNControllerUpdatePriority( TSNController_t * pxController,
+                                         UBaseType_t uxPriority );
+
+BaseType_t xTSNControllerUpdatePriorityFromISR( TSNController_t * pxController,
+                                                UBaseType_t uxPriority );
 
 void vTSNController_Initialise( void );
 
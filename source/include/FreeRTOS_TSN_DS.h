@@ -5,6 +5,8 @@
 
 #include "FreeRTOS_IP.h"
 
+#include "FreeRTOS_TSN_Parser.h"
+
 #define diffservCLASS_DF    ( 0 )
 /* diffservCLASS_CSx is either 0,8,16,24,32,40,48,54 (CS0 = DF)*/
 #define diffservCLASS_CSx( x )            ( ( 0 <= x && x <= 7 ) ? ( 8 * x ) : diffservCLASS_DF )
@@ -34,9 +36,13 @@
     } while( ipFALSE_BOOL )
 
 
-uint8_t ucDSClassGet( NetworkBufferDescriptor_t * pxBuf );
+uint8_t ucDSClassGet( const PacketMetadata_t * pxMeta );
+
+void vDSClassSetIPv4( IPHeader_t * pxIPHeader,
+                      uint8_t ucValue );
 
 BaseType_t xDSClassSet( NetworkBufferDescriptor_t * pxBuf,
+                        PacketMetadata_t * pxMeta,
                         uint8_t ucValue );
 
 #endif /* FREERTOS_TSN_DS_H */
@@ -0,0 +1,81 @@
+#ifndef FREERTOS_TSN_FRER_H
+#define FREERTOS_TSN_FRER_H
+
+#include "FreeRTOS.h"
+
+#include "FreeRTOS_IP.h"
+
+#include "FreeRTOSTSNConfig.h"
+#include "FreeRTOSTSNConfigDefaults.h"
+
+#include "FreeRTOS_TSN_Parser.h"
+
+/* EtherType of the redundancy tag of IEEE 802.1CB */
+#define frerRTAG_TPID    ( 0xF1C1U )
+
+#include "pack_struct_start.h"
+struct xFRER_RTAG
+{
+    uint16_t usTPID;           /**< frerRTAG_TPID */
+    uint16_t usReserved;       /**< Always 0 */
+    uint16_t usSequenceNumber; /**< Sequence number of the frame in its stream */
+}
+#include "pack_struct_end.h"
+
+/** @brief Identification and paths of an FRER stream
+ *
+ * A stream is identified by its destination MAC address and VID, as with
+ * the null stream identification of IEEE 802.1CB. Sent frames are first
+ * transmitted as they are, which is the first member stream, then with
+ * usReplicaVID on pxReplicaInterface, which is the second member stream.
+ * Received frames of either member stream are passed up only once.
+ */
+struct xFRER_STREAM_CONFIG
+{
+    MACAddress_t xDestinationAddress;        /**< Destination MAC address of the stream */
+    uint16_t usVID;                          /**< VID of the first member stream, 0 if untagged */
+    uint16_t usReplicaVID;                   /**< VID of the second member stream, used if tagged */
+    NetworkInterface_t * pxReplicaInterface; /**< Interface of the second member stream, NULL for the same one */
+};
+
+typedef struct xFRER_STREAM_CONFIG FRERStreamConfig_t;
+
+/** @brief Counters of an FRER stream */
+struct xFRER_STREAM_STATS
+{
+    uint32_t ulReplicated; /**< Sent frames replicated on both member streams */
+    uint32_t ulPassed;     /**< Received frames passed up */
+    uint32_t ulDiscarded;  /**< Received duplicates */
+    uint32_t ulRogue;      /**< Received frames out of the history window */
+    uint32_t ulResets;     /**< Times the recovery took any sequence number after a timeout */
+};
+
+typedef struct xFRER_STREAM_STATS FRERStreamStats_t;
+
+#if ( tsnconfigFRER_STREAMS > 0 )
+    BaseType_t xFRERStreamConfigure( BaseType_t xStream,
+                                     const FRERStreamConfig_t * pxConfig );
+
+    BaseType_t xFRERStreamGetStats( BaseType_t xStream,
+                                    FRERStreamStats_t * pxStats );
+
+    size_t uxFRERTxRoom( uint16_t usVID );
+
+    NetworkBufferDescriptor_t * pxFRERTxTag( NetworkBufferDescriptor_t * pxBuf,
+                                             BaseType_t * pxStream );
+
+    NetworkInterface_t * pxFRERTxReplica( NetworkBufferDescriptor_t * pxBuf,
+                                          BaseType_t xStream,
+                                          NetworkInterface_t * pxInterface );
+
+    BaseType_t xFRERReceive( const NetworkBufferDescriptor_t * pxBuf,
+                             const PacketMetadata_t * pxMeta );
+
+    #if ( tsnconfigSELF_TEST != tsnconfigDISABLE )
+        BaseType_t xFRERSelfTest( void );
+    #endif
+#else
+    #define uxFRERTxRoom( usVID )    ( ( size_t ) 0U )
+#endif
+
+#endif /* FREERTOS_TSN_FRER_H */
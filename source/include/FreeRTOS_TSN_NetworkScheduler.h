@@ -3,6 +3,7 @@
 
 #include "FreeRTOS_TSN_NetworkSchedulerBlock.h"
 #include "FreeRTOS_TSN_NetworkSchedulerQueue.h"
+#include "FreeRTOS_TSN_Controller.h"
 
 /** @brief A list of network queue pointer
  *
@@ -21,22 +22,38 @@ void vNetworkQueueListAdd( NetworkQueueList_t * pxItem );
 
 BaseType_t xNetworkQueueAssignRoot( NetworkNode_t * pxNode );
 
+BaseType_t xNetworkQueueAssignRootToController( NetworkNode_t * pxNode,
+                                                BaseType_t xControllerIndex );
+
 /* This must be defined by the user */
 void vNetworkQueueInit( void );
 
+NetworkQueue_t * pxNetworkQueueFindByFilter( const NetworkQueueItem_t * pxItem );
+
 BaseType_t xNetworkQueueInsertPacketByFilter( const NetworkQueueItem_t * pxItem,
                                               UBaseType_t uxTimeout );
 
+UBaseType_t uxNetworkQueueInsertPacketsByFilter( const NetworkQueueItem_t * pxItems,
+                                                 UBaseType_t uxCount,
+                                                 UBaseType_t uxTimeout );
+
+BaseType_t xNetworkQueueInsertPacketByFilterFromISR( const NetworkQueueItem_t * pxItem,
+                                                     BaseType_t * pxHigherPriorityTaskWoken );
+
 BaseType_t xNetworkQueueInsertPacketByName( const NetworkQueueItem_t * pxItem,
                                             char * pcQueueName,
                                             UBaseType_t uxTimeout );
 
-NetworkQueue_t * xNetworkQueueSchedule( void );
+NetworkQueue_t * xNetworkQueueSchedule( NetworkNode_t * pxRoot );
 
 BaseType_t xNetworkQueuePush( NetworkQueue_t * pxQueue,
                               const NetworkQueueItem_t * pxItem,
                               UBaseType_t uxTimeout );
 
+BaseType_t xNetworkQueuePushFromISR( NetworkQueue_t * pxQueue,
+                                     const NetworkQueueItem_t * pxItem,
+                                     BaseType_t * pxHigherPriorityTaskWoken );
+
 BaseType_t xNetworkQueuePop( NetworkQueue_t * pxQueue,
                              NetworkQueueItem_t * pxItem,
                              UBaseType_t uxTimeout );
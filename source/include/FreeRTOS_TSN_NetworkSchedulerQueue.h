@@ -7,6 +7,7 @@
 #include "FreeRTOS_IP.h"
 
 #include "FreeRTOS_TSN_Ancillary.h"
+#include "FreeRTOS_TSN_Parser.h"
 
 #include "FreeRTOSTSNConfig.h"
 #include "FreeRTOSTSNConfigDefaults.h"
@@ -18,6 +19,14 @@
  */
 typedef BaseType_t ( * FilterFunction_t ) ( NetworkBufferDescriptor_t * pxNetworkBuffer );
 
+/* Function pointer to a filtering function working on the metadata of the
+ * packet, which is filled once when the packet enters the TSN layer. When
+ * set, it is used instead of FilterFunction_t and avoids parsing the
+ * headers of the packet in every filter.
+ */
+typedef BaseType_t ( * FilterMetaFunction_t ) ( NetworkBufferDescriptor_t * pxNetworkBuffer,
+                                                 const PacketMetadata_t * pxMeta );
+
 typedef BaseType_t ( * PacketHandleFunction_t ) ( NetworkBufferDescriptor_t * pxBuf );
 
 typedef enum
@@ -49,6 +58,8 @@ typedef enum
  *   pxBuf->pucEthernetBuffer == pxMsgh
  *   pxMsgh->msg_iov[ 0 ].iov_base == pucOriginalEtherBuffer
  *   ```
+ * xMeta is filled by xPacketParse() when the item is created, and must be
+ * kept consistent with the buffer by anyone who modifies the headers.
  */
 struct xNETQUEUE_ITEM
 {
@@ -56,6 +67,7 @@ struct xNETQUEUE_ITEM
     NetworkBufferDescriptor_t * pxBuf; /** Pointer to the network buffer holding the data */
     struct msghdr * pxMsgh; /**< Pointer to message header holding ancillary data */
     BaseType_t xReleaseAfterSend; /**< Boolean specifying whether the network buffer should be released after its usage */
+    PacketMetadata_t xMeta; /**< Headers of the packet, parsed when the item is created */
 };
 
 typedef struct xNETQUEUE_ITEM NetworkQueueItem_t;
@@ -79,10 +91,31 @@ typedef struct xNETQUEUE_ITEM NetworkQueueItem_t;
  *   IPV among all the queues which have waiting packets.
  * - The filter function which restricts the type of packets that this queue
  *   is allowed to accept. This must be the signature of FilterFunction_t and
- *   return either pdTRUE or pdFALSE.
+ *   return either pdTRUE or pdFALSE. A filter reading the parsed metadata
+ *   of the packet can be set with xNetworkQueueSetFilterMeta(), in which case
+ *   it is used in place of the first one.
  * - The name field is currently unused in the socket API, but it can be used
  *   to insert a packet in a specific queue, without letting the scheduler
  *   decide on its own.
+ * - The controller serving the queue. This is set when the scheduler tree
+ *   containing the queue is assigned to a controller, and a queue is always
+ *   served by at most one controller.
+ * - Whether the queue is shaped. This is set when the tree is assigned to a
+ *   controller: a queue is unshaped if none of the nodes between the root and
+ *   the queue has a custom ready function. Packets from unshaped queues can
+ *   be sent directly by the sender if the queue is express.
+ * - Whether the queue is batchable, i.e. unshaped and not competing with
+ *   sibling queues through a custom select function. Packets from batchable
+ *   queues can be sent in batches.
+ * - The express flag. When the controller is idle and no other packet is
+ *   waiting, packets for an unshaped express queue are sent directly by the
+ *   sending task, without waking up the controller.
+ * - The pass-through flag. Received packets assigned to a pass-through queue
+ *   and bound to a TSN socket are delivered to the socket by the network
+ *   wrapper, without being queued. Other packets are queued as usual.
+ * - The deferred flag. It is set by the controller for the rest of a pass
+ *   when the next packet of the queue goes in a direction whose budget is
+ *   exhausted, and the scheduler treats the queue as empty meanwhile.
  */
 struct xNETQUEUE
 {
@@ -93,6 +126,20 @@ struct xNETQUEUE
         char cName[ tsnconfigMAX_QUEUE_NAME_LEN ]; /**< Name of the queue */
     #endif
     FilterFunction_t fnFilter;                     /**< Function to filter incoming packets */
+    FilterMetaFunction_t fnFilterMeta;             /**< Metadata filter, used instead of fnFilter if not NULL */
+    struct xTSN_CONTROLLER * pxController;         /**< Controller serving this queue */
+    BaseType_t xUnshaped;                          /**< pdTRUE if no scheduler node limits this queue */
+    BaseType_t xBatchable;                         /**< pdTRUE if packets can be sent in batches */
+    volatile BaseType_t xNotified;                 /**< pdTRUE if the controller was notified since the queue was last empty */
+    #if ( tsnconfigCONTROLLER_HAS_EXPRESS_PATH != tsnconfigDISABLE )
+        BaseType_t xExpress;                       /**< pdTRUE if the sender can bypass the controller */
+    #endif
+    #if ( tsnconfigINCLUDE_PASSTHROUGH_QUEUES != tsnconfigDISABLE )
+        BaseType_t xPassThrough;                   /**< pdTRUE if received packets skip the queue */
+    #endif
+    #if ( tsnconfigCONTROLLER_HAS_BUDGET != tsnconfigDISABLE )
+        BaseType_t xDeferred;                      /**< pdTRUE while the controller skips the queue */
+    #endif
     #if ( tsnconfigINCLUDE_QUEUE_EVENT_CALLBACKS != tsnconfigDISABLE )
         PacketHandleFunction_t fnOnPop;            /**< Function to be called on packet pop */
         PacketHandleFunction_t fnOnPush;           /**< Function to be called on packet push */
@@ -122,4 +169,17 @@ UBaseType_t uxNetworkQueuePacketsWaiting( NetworkQueue_t * pxQueue );
 
 BaseType_t xNetworkQueueIsEmpty( NetworkQueue_t * pxQueue );
 
+BaseType_t xNetworkQueueSetFilterMeta( NetworkQueue_t * pxQueue,
+                                       FilterMetaFunction_t fnFilterMeta );
+
+#if ( tsnconfigCONTROLLER_HAS_EXPRESS_PATH != tsnconfigDISABLE )
+    BaseType_t xNetworkQueueSetExpress( NetworkQueue_t * pxQueue,
+                                        BaseType_t xExpress );
+#endif
+
+#if ( tsnconfigINCLUDE_PASSTHROUGH_QUEUES != tsnconfigDISABLE )
+    BaseType_t xNetworkQueueSetPassThrough( NetworkQueue_t * pxQueue,
+                                            BaseType_t xPassThrough );
+#endif
+
 #endif /* FREERTOS_TSN_NETWORK_SCHEDULER_QUEUE_H */
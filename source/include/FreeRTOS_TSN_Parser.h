@@ -0,0 +1,80 @@
+#ifndef FREERTOS_TSN_PARSER_H
+#define FREERTOS_TSN_PARSER_H
+
+#include "FreeRTOS.h"
+
+#include "FreeRTOS_IP.h"
+#include "FreeRTOS_Sockets.h"
+
+#include "FreeRTOSTSNConfig.h"
+#include "FreeRTOSTSNConfigDefaults.h"
+
+struct xTSN_SOCKET;
+
+#define parserNO_PCP         ( ( uint8_t ) 0xFFU )
+#define parserNO_DSCP        ( ( uint8_t ) 0xFFU )
+#define parserNO_PROTOCOL    ( ( uint8_t ) 0xFFU )
+
+/** @brief Metadata of a frame, filled once by xPacketParse()
+ *
+ * The offsets always refer to the current layout of the ethernet buffer,
+ * i.e. they are updated by vPacketStripTags(), while the VLAN and R-TAG
+ * fields keep describing the tags found when the frame was parsed.
+ * ucStrippedSize tells how far the start of the buffer was advanced by
+ * vPacketStripTags().
+ * Ports are in network byte order, as in the Plus TCP headers, the TCIs are
+ * in host byte order.
+ * Fields belonging to layers which are not present (or not supported) are
+ * set to 0, or to the parserNO_* values.
+ * The structure is copied in every network queue slot, so it only holds
+ * what the filters and the controllers need for each frame. The IP
+ * addresses are read from the frame when needed, see
+ * xPacketGetSourceAddress().
+ * The sockets bound to the local port of the packet are not filled by the
+ * parser, but cached the first time they are looked up, see
+ * vSocketFromMetadata().
+ */
+struct xPACKET_METADATA
+{
+    Socket_t xBaseSocket;             /**< Cached socket bound to the local port */
+    struct xTSN_SOCKET * pxTSNSocket; /**< Cached TSN socket bound to the local port */
+    UBaseType_t uxSocketGeneration;   /**< Validity of the cached sockets, 0 if not looked up */
+    uint16_t usFrameType;          /**< EtherType following the VLAN tags */
+    uint16_t usVLANCTCI;           /**< TCI of the customer (inner) tag */
+    uint16_t usVLANSTCI;           /**< TCI of the service (outer) tag */
+    uint16_t usL3Offset;           /**< Offset of the IP header */
+    uint16_t usL4Offset;           /**< Offset of the UDP/TCP header */
+    uint16_t usPayloadOffset;      /**< Offset of the transport payload, or of the data following the EtherType of non IP frames */
+    uint16_t usPayloadLength;      /**< Length of the transport payload, or of the data following the EtherType */
+    uint16_t usSourcePort;         /**< UDP/TCP source port */
+    uint16_t usDestinationPort;    /**< UDP/TCP destination port */
+    uint16_t usSequenceNumber;     /**< Sequence number of the R-TAG, in host byte order */
+    uint8_t ucNumTags;             /**< Number of VLAN tags found in the frame */
+    uint8_t ucHasRTag;             /**< pdTRUE if an 802.1CB R-TAG follows the VLAN tags */
+    uint8_t ucPCP;                 /**< PCP of the innermost tag, or parserNO_PCP */
+    uint8_t ucDSCP;                /**< DiffServ class, or parserNO_DSCP */
+    uint8_t ucProtocol;            /**< IP protocol, or parserNO_PROTOCOL */
+    uint8_t ucStrippedSize;        /**< Bytes of tags removed from the start of the buffer */
+};
+
+typedef struct xPACKET_METADATA PacketMetadata_t;
+
+BaseType_t xPacketParse( const NetworkBufferDescriptor_t * pxBuf,
+                         PacketMetadata_t * pxMeta );
+
+BaseType_t xPacketGetSourceAddress( const NetworkBufferDescriptor_t * pxBuf,
+                                    const PacketMetadata_t * pxMeta,
+                                    IP_Address_t * pxAddress );
+
+void vPacketStripTags( NetworkBufferDescriptor_t * pxBuf,
+                       PacketMetadata_t * pxMeta );
+
+void vPacketRestoreStart( NetworkBufferDescriptor_t * pxBuf,
+                          PacketMetadata_t * pxMeta,
+                          BaseType_t xMoveFrame );
+
+#if ( tsnconfigSELF_TEST != tsnconfigDISABLE )
+    BaseType_t xPacketSelfTest( void );
+#endif
+
+#endif /* FREERTOS_TSN_PARSER_H */
@@ -0,0 +1,22 @@
+#ifndef FREERTOS_TSN_SHARED_BUFFER_H
+#define FREERTOS_TSN_SHARED_BUFFER_H
+
+#include "FreeRTOS.h"
+
+#include "FreeRTOS_IP.h"
+
+#include "FreeRTOSTSNConfig.h"
+#include "FreeRTOSTSNConfigDefaults.h"
+
+#if ( tsnconfigSHARED_BUFFER_POOL_SIZE > 0 )
+    NetworkBufferDescriptor_t * pxSharedBufferRetain( NetworkBufferDescriptor_t * pxBuf );
+
+    void vSharedBufferRelease( NetworkBufferDescriptor_t * pxBuf );
+
+    void vSharedBufferLoan( NetworkBufferDescriptor_t * pxBuf );
+#else
+    #define vSharedBufferRelease( pxBuf )    vReleaseNetworkBufferAndDescriptor( pxBuf )
+    #define vSharedBufferLoan( pxBuf )       /* empty */
+#endif
+
+#endif /* FREERTOS_TSN_SHARED_BUFFER_H */
@@ -6,13 +6,34 @@
 #include "list.h"
 
 #include "FreeRTOS_Sockets.h"
+#include "FreeRTOS_IP_Private.h"
 #include "FreeRTOS_TSN_Ancillary.h"
+#include "FreeRTOS_TSN_Parser.h"
+#include "FreeRTOS_TSN_FRER.h"
+#include "FreeRTOS_TSN_VLANTags.h"
 
 #include "FreeRTOSTSNConfig.h"
 #include "FreeRTOSTSNConfigDefaults.h"
 
 #define FREERTOS_TSN_INVALID_SOCKET      ( ( TSNSocket_t ) ~0U )
 
+#ifndef FREERTOS_AF_UNSPEC
+    #define FREERTOS_AF_UNSPEC           ( 0 ) /* Used to disconnect a TSN socket */
+#endif
+
+#ifndef FREERTOS_SOCK_RAW
+    #define FREERTOS_SOCK_RAW            ( 3 ) /* Raw layer 2 socket, with FREERTOS_AF_PACKET */
+#endif
+
+/* VID of the raw sockets receiving the frames of any VLAN */
+#define FREERTOS_TSN_ANY_VID             ( ( uint16_t ) 0xFFFFU )
+
+/* EtherTypes handled by Plus TCP, which cannot be bound by raw sockets */
+#define tsnsocketIS_RAW_FRAME_TYPE( usFrameType )    \
+    ( ( ( usFrameType ) != ipIPv4_FRAME_TYPE ) &&    \
+      ( ( usFrameType ) != ipIPv6_FRAME_TYPE ) &&    \
+      ( ( usFrameType ) != ipARP_FRAME_TYPE ) )
+
 #if ( tsnconfigSOCKET_INSERTS_VLAN_TAGS != tsnconfigDISABLE ) /*TODO: see SO_PRIORITY */
     #define FREERTOS_SO_VLAN_CTAG_PCP    ( 101 )
     #define FREERTOS_SO_VLAN_TAG_PCP     FREERTOS_SO_VLAN_CTAG
@@ -21,6 +42,8 @@
 #endif
 
 #define FREERTOS_SO_DS_CLASS             ( 104 )
+#define FREERTOS_SO_TSN_RXINFO           ( 105 )
+#define FREERTOS_SCM_TSN_RXINFO          FREERTOS_SO_TSN_RXINFO
 
 #define FREERTOS_SO_TIMESTAMP_OLD        ( 29 )
 #define FREERTOS_SO_TIMESTAMPNS_OLD      ( 35 )
@@ -41,6 +64,7 @@
 #define FREERTOS_IPV6_RECVERR            ( 25 )
 
 #define FREERTOS_MSG_ERRQUEUE            ( 2 << 13 )
+#define FREERTOS_MSG_CTRUNC              ( 2 << 14 )
 
 /* SO_TIMESTAMPING flags */
 enum
@@ -79,6 +103,58 @@ enum
     SCM_TSTAMP_ACK,   /* data acknowledged by peer */
 };
 
+/** @brief Payload of the FREERTOS_SCM_TSN_RXINFO control message
+ *
+ * Enabled with the FREERTOS_SO_TSN_RXINFO socket option. The queue fields
+ * are meaningful only if the respective ancillaryRX_HAS_* bit is set in
+ * ucValid. The queueing delay requires the timebase to be running.
+ */
+struct freertos_tsn_rxinfo
+{
+    uint16_t usVLANCTCI;                     /**< TCI of the customer tag, 0 if untagged */
+    uint16_t usVLANSTCI;                     /**< TCI of the service tag, 0 if not double tagged */
+    uint8_t ucNumTags;                       /**< Number of VLAN tags of the frame */
+    uint8_t ucValid;                         /**< ancillaryRX_HAS_QUEUE and ancillaryRX_HAS_QUEUEING_DELAY bits */
+    uint32_t ulQueueIPV;                     /**< IPV of the queue which scheduled the frame */
+    struct freertos_timespec xQueueingDelay; /**< Time between reception and delivery to the socket */
+};
+
+#if ( tsnconfigSOCKET_TEMPLATE_REVALIDATE_MS > 0 )
+
+/* Room for the ethernet header, two VLAN tags, an R-TAG, and the IP and UDP
+ * headers */
+    #if ( ipconfigUSE_IPv6 != 0 )
+        #define tsnsocketTEMPLATE_MAX_LENGTH    ( ipSIZE_OF_ETH_HEADER + 2U * sizeof( struct xVLAN_TAG ) + sizeof( struct xFRER_RTAG ) + ipSIZE_OF_IPv6_HEADER + sizeof( UDPHeader_t ) )
+    #else
+        #define tsnsocketTEMPLATE_MAX_LENGTH    ( ipSIZE_OF_ETH_HEADER + 2U * sizeof( struct xVLAN_TAG ) + sizeof( struct xFRER_RTAG ) + ipSIZE_OF_IPv4_HEADER + sizeof( UDPHeader_t ) )
+    #endif
+
+/** @brief Headers of the frames sent to the address of a connected socket
+ *
+ * Built from the first frame prepared for the connected address, with the
+ * lengths, the IP identification and the UDP checksum set to zero, and the
+ * IPv4 checksum matching these values unless the driver computes it. Frames
+ * sent later to the same address copy the headers and only patch those
+ * fields. The template is dropped when the VLAN options, the TCIs or the
+ * endpoint change, when an ARP or ICMPv6 packet changes the MAC address of
+ * its next hop, and periodically to check the ARP or neighbor cache again.
+ */
+    struct xTSN_HEADER_TEMPLATE
+    {
+        uint8_t ucHeaders[ tsnsocketTEMPLATE_MAX_LENGTH ]; /**< Headers up to the UDP payload */
+        uint8_t ucLength;                                  /**< Length of the headers, 0 if the template is not valid */
+        NetworkEndPoint_t * pxEndPoint;                    /**< Endpoint which resolved the destination */
+        IP_Address_t xSourceAddress;                       /**< Address of the endpoint when the template was built */
+        TickType_t xBuildTime;                             /**< Tick at which the ARP cache was checked */
+        IP_Address_t xNextHop;                             /**< Neighbor the destination MAC address was resolved from */
+        uint16_t usSTagTCI;                                /**< TCI of the service tag when built */
+        uint16_t usCTagTCI;                                /**< TCI of the customer tag when built */
+    };
+
+    typedef struct xTSN_HEADER_TEMPLATE TSNHeaderTemplate_t;
+
+#endif /* if ( tsnconfigSOCKET_TEMPLATE_REVALIDATE_MS > 0 ) */
+
 struct xTSN_SOCKET
 {
     Socket_t xBaseSocket;    /**< Reuse the same socket structure as Plus-TCP addon */
@@ -93,6 +169,19 @@ struct xTSN_SOCKET
     uint8_t ucDSClass;               /**< Differentiated services class */
 
     uint32_t ulTSFlags;              /**< Holds the timestamping config bits */
+    uint8_t ucRxInfo;                /**< pdTRUE to receive FREERTOS_SCM_TSN_RXINFO messages */
+
+    BaseType_t xIsConnected;                     /**< pdTRUE if a default destination is set */
+    struct freertos_sockaddr xConnectedAddress;  /**< Default destination set by FreeRTOS_TSN_connect() */
+    uint16_t usIPIdentification;                 /**< Identification of the next IPv4 packet */
+    #if ( tsnconfigSOCKET_TEMPLATE_REVALIDATE_MS > 0 )
+        TSNHeaderTemplate_t xTemplate;           /**< Cached headers for the connected address */
+    #endif
+
+    BaseType_t xIsRaw;               /**< pdTRUE for FREERTOS_SOCK_RAW sockets */
+    uint16_t usEtherType;            /**< EtherType bound by a raw socket, network byte order */
+    uint16_t usVID;                  /**< VID bound by a raw socket, or FREERTOS_TSN_ANY_VID */
+    NetworkEndPoint_t * pxEndPoint;  /**< Endpoint whose MAC address is used by a raw socket */
 
     ListItem_t xBoundSocketListItem; /** To keep track of TSN sockets */
     TaskHandle_t xSendTask;          /**< Task handle of the task who is sending ( should always be at most one ) */
@@ -109,9 +198,24 @@ void vSocketFromPort( TickType_t xSearchKey,
                       Socket_t * pxBaseSocket,
                       TSNSocket_t * pxTSNSocket );
 
+void vSocketFromMetadata( PacketMetadata_t * pxMeta,
+                          uint16_t usLocalPort,
+                          Socket_t * pxBaseSocket,
+                          TSNSocket_t * pxTSNSocket );
+
+#if ( tsnconfigSHARED_BUFFER_POOL_SIZE > 0 )
+    UBaseType_t uxSocketRawListReceivers( const PacketMetadata_t * pxMeta,
+                                          TSNSocket_t * pxSockets,
+                                          UBaseType_t uxMaxSockets );
+#endif
+
 BaseType_t xSocketErrorQueueInsert( TSNSocket_t xTSNSocket,
                                     struct msghdr * pxMsgh );
 
+#if ( tsnconfigSELF_TEST != tsnconfigDISABLE ) && ( tsnconfigSOCKET_HASH_SIZE > 0 )
+    BaseType_t xSocketHashSelfTest( void );
+#endif
+
 TSNSocket_t FreeRTOS_TSN_socket( BaseType_t xDomain,
                                  BaseType_t xType,
                                  BaseType_t xProtocol );
@@ -126,8 +230,16 @@ BaseType_t FreeRTOS_TSN_bind( TSNSocket_t xSocket,
                               struct freertos_sockaddr const * pxAddress,
                               socklen_t xAddressLength );
 
+BaseType_t FreeRTOS_TSN_connect( TSNSocket_t xSocket,
+                                 struct freertos_sockaddr const * pxAddress,
+                                 socklen_t xAddressLength );
+
 BaseType_t FreeRTOS_TSN_closesocket( TSNSocket_t xSocket );
 
+void vTSNSocketInvalidateTemplates( const IP_Address_t * pxNeighbor,
+                                    BaseType_t xIsIPv6,
+                                    const MACAddress_t * pxMACAddress );
+
 int32_t FreeRTOS_TSN_sendto( TSNSocket_t xSocket,
                              const void * pvBuffer,
                              size_t uxTotalDataLength,
@@ -135,6 +247,27 @@ int32_t FreeRTOS_TSN_sendto( TSNSocket_t xSocket,
                              const struct freertos_sockaddr * pxDestinationAddress,
                              socklen_t xDestinationAddressLength );
 
+int32_t FreeRTOS_TSN_send( TSNSocket_t xSocket,
+                           const void * pvBuffer,
+                           size_t uxDataLength,
+                           BaseType_t xFlags );
+
+int32_t FreeRTOS_TSN_sendmsg( TSNSocket_t xSocket,
+                              const struct msghdr * pxMsgh,
+                              BaseType_t xFlags );
+
+int32_t FreeRTOS_TSN_sendmmsg( TSNSocket_t xSocket,
+                               struct mmsghdr * pxMsgVec,
+                               size_t uxVLen,
+                               BaseType_t xFlags );
+
+void * FreeRTOS_TSN_GetUDPPayloadBuffer( TSNSocket_t xSocket,
+                                         size_t uxRequestedSizeBytes,
+                                         TickType_t uxBlockTimeTicks,
+                                         uint8_t ucIPType );
+
+void FreeRTOS_TSN_ReleaseUDPPayloadBuffer( void const * pvBuffer );
+
 int32_t FreeRTOS_TSN_recvfrom( TSNSocket_t xSocket,
                                void * pvBuffer,
                                size_t uxBufferLength,
@@ -146,4 +279,9 @@ int32_t FreeRTOS_TSN_recvmsg( TSNSocket_t xSocket,
                               struct msghdr * pxMsghUser,
                               BaseType_t xFlags );
 
+int32_t FreeRTOS_TSN_recvmmsg( TSNSocket_t xSocket,
+                               struct mmsghdr * pxMsgVec,
+                               size_t uxVLen,
+                               BaseType_t xFlags );
+
 #endif /* FREERTOS_TSN_SOCKETS_H */
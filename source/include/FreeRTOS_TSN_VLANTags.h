@@ -75,6 +75,17 @@ typedef struct xDOUBLE_TAGGED_ETH_HEADER DoubleTaggedEthernetHeader_t;
 
 uint8_t ucGetNumberOfTags( NetworkBufferDescriptor_t * pxBuf );
 
+void vVLANTagsWrite( uint8_t * pucFrame,
+                     uint8_t ucNumTags,
+                     uint16_t usSTagTCI,
+                     uint16_t usCTagTCI,
+                     uint16_t usFrameType );
+
+NetworkBufferDescriptor_t * pxVLANTagsInsert( NetworkBufferDescriptor_t * pxBuf,
+                                              uint8_t ucNumTags,
+                                              uint16_t usSTagTCI,
+                                              uint16_t usCTagTCI );
+
 BaseType_t xVLANSTagGetPCP( NetworkBufferDescriptor_t * pxBuf );
 BaseType_t xVLANSTagGetDEI( NetworkBufferDescriptor_t * pxBuf );
 BaseType_t xVLANSTagGetVID( NetworkBufferDescriptor_t * pxBuf );
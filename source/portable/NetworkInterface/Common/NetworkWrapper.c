@@ -11,7 +11,9 @@
 #include "FreeRTOS_TSN_NetworkScheduler.h"
 #include "FreeRTOS_TSN_Sockets.h"
 #include "FreeRTOS_TSN_VLANTags.h"
+#include "FreeRTOS_TSN_Parser.h"
 #include "FreeRTOS_TSN_Timestamp.h"
+#include "FreeRTOS_TSN_FRER.h"
 
 /* Wrap around NetworkInterface.c but rename drivers functions and
  * hijack signals to IPTasks to our TSN Controller task
@@ -22,6 +24,10 @@
 #define xGetPhyLinkStatus              xMAC_GetPhyLinkStatus
 #define pxFillInterfaceDescriptor      pxMAC_FillInterfaceDescriptor
 
+#if ( tsnconfigWRAPPER_HAS_BATCH_OUTPUT != tsnconfigDISABLE )
+    #define xNetworkInterfaceOutputBatch    xMAC_NetworkInterfaceOutputBatch
+#endif
+
 extern BaseType_t xSendEventStructToTSNController( const IPStackEvent_t * pxEvent,
                                                    TickType_t uxTimeout );
 #define xSendEventStructToIPTask    xSendEventStructToTSNController
@@ -33,6 +39,10 @@ extern BaseType_t xSendEventStructToTSNController( const IPStackEvent_t * pxEven
 #undef xNetworkInterfaceOutput
 #undef xGetPhyLinkStatus
 
+#if ( tsnconfigWRAPPER_HAS_BATCH_OUTPUT != tsnconfigDISABLE )
+    #undef xNetworkInterfaceOutputBatch
+#endif
+
 #undef xSendEventStructToIPTask
 
 BaseType_t xNetworkWrapperInitialised = pdFALSE;
@@ -57,80 +67,9 @@ extern void vTimebaseInit();
 /* Private function definitions
  */
 
-NetworkBufferDescriptor_t * prvInsertVLANTag( NetworkBufferDescriptor_t * const pxBuf,
-                                              uint16_t usTCI,
-                                              uint16_t usTPID );
-
 NetworkQueueItem_t * prvHandleReceive( NetworkBufferDescriptor_t * pxBuf );
 
 
-#define wrapperFIRST_TPID     ( 0x88a8 )
-#define wrapperSECOND_TPID    ( 0x8100 )
-
-NetworkBufferDescriptor_t * prvInsertVLANTag( NetworkBufferDescriptor_t * const pxBuf,
-                                              uint16_t usTCI,
-                                              uint16_t usTPID )
-{
-    NetworkBufferDescriptor_t * pxNewBuf;
-    const size_t uxTagSize = sizeof( usTCI ) + sizeof( usTPID );
-    const size_t uxNewSize = pxBuf->xDataLength + uxTagSize;
-
-    pxNewBuf = pxResizeNetworkBufferWithDescriptor( pxBuf, uxNewSize );
-
-    if( pxNewBuf == NULL )
-    {
-        vReleaseNetworkBufferAndDescriptor( pxBuf );
-        return NULL;
-    }
-
-    pxNewBuf->xDataLength = uxNewSize;
-    const size_t uxPrefix = offsetof( EthernetHeader_t, usFrameType );
-    uint8_t * const pucBuffer = pxNewBuf->pucEthernetBuffer;
-    usTCI = FreeRTOS_htons( usTCI );
-    usTPID = FreeRTOS_htons( usTPID );
-
-    memmove( &pucBuffer[ uxPrefix + uxTagSize ], &pucBuffer[ uxPrefix ], pxBuf->xDataLength - uxPrefix );
-    memcpy( &pucBuffer[ uxPrefix ], &usTPID, sizeof( usTPID ) );
-    memcpy( &pucBuffer[ uxPrefix + sizeof( usTPID ) ], &usTCI, sizeof( usTCI ) );
-
-    return pxNewBuf;
-}
-
-BaseType_t prvStripVLANTag( NetworkBufferDescriptor_t * pxBuf,
-                            uint16_t * pusVLANTCI,
-                            uint16_t * pusVLANServiceTCI )
-{
-    BaseType_t uxNumTags = ucGetNumberOfTags( pxBuf );
-    const size_t uxStart = offsetof( EthernetHeader_t, usFrameType );
-    struct xVLAN_TAG * const pxTag = ( struct xVLAN_TAG * ) &pxBuf->pucEthernetBuffer[ uxStart ];
-
-    switch( uxNumTags )
-    {
-        case 0:
-            return 0;
-
-        case 1:
-            *pusVLANTCI = pxTag->usTCI;
-            break;
-
-        case 2:
-        default:
-            *pusVLANServiceTCI = pxTag[ 0 ].usTCI;
-            *pusVLANTCI = pxTag[ 1 ].usTCI;
-            break;
-    }
-
-    const size_t uxTagSize = uxNumTags * sizeof( struct xVLAN_TAG );
-
-    memmove( &pxBuf->pucEthernetBuffer[ uxStart ],
-             &pxBuf->pucEthernetBuffer[ uxStart + uxTagSize ],
-             pxBuf->xDataLength - uxTagSize - uxStart );
-
-    pxBuf->xDataLength -= uxTagSize;
-
-    return uxNumTags;
-}
-
 #if ( tsnconfigDUMP_PACKETS == tsnconfigENABLE )
 	void prvDumpPacket( char * const pcPrefix, NetworkBufferDescriptor_t * pxBuf )
 	{
@@ -150,61 +89,46 @@ BaseType_t prvStripVLANTag( NetworkBufferDescriptor_t * pxBuf,
 	#define prvDumpPacket( pxPrefix, pxBuf ) /* empty */
 #endif
 
-BaseType_t prvAncillaryMsgControlFillForRx( struct msghdr * pxMsgh,
-                                            NetworkBufferDescriptor_t * pxBuf,
-                                            Socket_t xSocket,
-                                            TSNSocket_t xTSNSocket )
+/**
+ * @brief Record the receive information of a frame in its ancillary message
+ *
+ * Only the raw timestamps are taken here. The control messages are built
+ * by FreeRTOS_TSN_recvmsg(), and only if the user provides a buffer for
+ * them.
+ *
+ * @param[in] pxMsgh The ancillary message of the frame
+ * @param[in] pxBuf The received frame
+ * @param[in] xTSNSocket The socket receiving the frame
+ */
+void prvAncillaryMsgRecordRx( struct msghdr * pxMsgh,
+                              NetworkBufferDescriptor_t * pxBuf,
+                              TSNSocket_t xTSNSocket )
 {
     FreeRTOS_TSN_Socket_t * const pxTSNSocket = ( FreeRTOS_TSN_Socket_t * ) xTSNSocket;
-    /*FreeRTOS_Socket_t * const pxBaseSocket = ( FreeRTOS_Socket_t * ) pxTSNSocket->xBaseSocket; */
-
-    struct cmsghdr xControlMsg[ 1 ];
-    void * pucControlData[ 1 ];
-    size_t uxPayloadSize[ 1 ];
-    struct freertos_scm_timestamping xTimestamp;
-    BaseType_t xOptions = 0;
+    AncillaryRxInfo_t * const pxInfo = pxAncillaryMsgGetRxInfo( pxMsgh );
+    const BaseType_t xWantsTimestamp = ( pxTSNSocket->ulTSFlags & ( SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_RX_HARDWARE ) ) ? pdTRUE : pdFALSE;
 
-    if( pxTSNSocket != NULL )
+    if( xTimebaseGetState() != eTimebaseEnabled )
     {
-        if( pxTSNSocket->ulTSFlags & SOF_TIMESTAMPING_RX_SOFTWARE && ( xTimebaseGetState() == eTimebaseEnabled ) )
-        {
-            uxPayloadSize[ xOptions ] = sizeof( xTimestamp );
-            xControlMsg[ xOptions ].cmsg_len = CMSG_LEN( uxPayloadSize[ xOptions ] );
-            xControlMsg[ xOptions ].cmsg_level = FREERTOS_SOL_SOCKET;
-            xControlMsg[ xOptions ].cmsg_type = FREERTOS_SCM_TIMESTAMPING;
-            vTimestampAcquireSoftware( &xTimestamp.ts[ 0 ] );
-            xTimestamp.ts[ 1 ].tv_sec = 0;
-            xTimestamp.ts[ 1 ].tv_nsec = 0;
-            vRetrieveHardwareTimestamp( pxBuf->pxInterface, pxBuf, &xTimestamp.ts[ 2 ].tv_sec, &xTimestamp.ts[ 2 ].tv_nsec );
-            pucControlData[ xOptions ] = &xTimestamp;
-            ++xOptions;
-        }
-
-        /* Other eventual options... */
-        /* ++xOptions; ... */
+        return;
     }
 
-    /* Other eventual options... */
-
-    if( xOptions > 0 )
+    /* The software timestamp is also the reference for the queueing delay */
+    if( ( xWantsTimestamp != pdFALSE ) || ( pxTSNSocket->ucRxInfo != pdFALSE ) )
     {
-        if( xAncillaryMsgControlFill( pxMsgh, xControlMsg, pucControlData, uxPayloadSize, xOptions ) != pdPASS )
-        {
-            /* no memory for filling control msgs*/
-            return 0;
-        }
+        vTimestampAcquireSoftware( &pxInfo->xSoftwareTimestamp );
+        pxInfo->ulValid |= ancillaryRX_HAS_SW_TIMESTAMP;
     }
-    else
+
+    if( xWantsTimestamp != pdFALSE )
     {
-        pxMsgh->msg_control = NULL;
-        pxMsgh->msg_controllen = 0;
+        vRetrieveHardwareTimestamp( pxBuf->pxInterface, pxBuf, &pxInfo->xHardwareTimestamp.tv_sec, &pxInfo->xHardwareTimestamp.tv_nsec );
+        pxInfo->ulValid |= ancillaryRX_HAS_HW_TIMESTAMP;
     }
-
-    return xOptions;
 }
 
 BaseType_t prvAncillaryMsgControlFillForTx( struct msghdr * pxMsgh,
-                                            NetworkBufferDescriptor_t * pxBuf,
+                                            const struct freertos_scm_timestamping * pxTimestamp,
                                             Socket_t xSocket,
                                             TSNSocket_t xTSNSocket )
 {
@@ -214,7 +138,6 @@ BaseType_t prvAncillaryMsgControlFillForTx( struct msghdr * pxMsgh,
     struct cmsghdr xControlMsg[ 2 ];
     void * pucControlData[ 2 ];
     size_t uxPayloadSize[ 2 ];
-    struct freertos_scm_timestamping xTimestamp;
     struct sock_extended_err xSockErr;
     BaseType_t xOptions = 0;
 
@@ -233,15 +156,11 @@ BaseType_t prvAncillaryMsgControlFillForTx( struct msghdr * pxMsgh,
             pucControlData[ xOptions ] = &xSockErr;
             ++xOptions;
 
-            uxPayloadSize[ xOptions ] = sizeof( xTimestamp );
+            uxPayloadSize[ xOptions ] = sizeof( *pxTimestamp );
             xControlMsg[ xOptions ].cmsg_len = CMSG_LEN( uxPayloadSize[ xOptions ] );
             xControlMsg[ xOptions ].cmsg_level = FREERTOS_SOL_SOCKET;
             xControlMsg[ xOptions ].cmsg_type = FREERTOS_SCM_TIMESTAMPING;
-            vTimestampAcquireSoftware( &xTimestamp.ts[ 0 ] );
-            xTimestamp.ts[ 1 ].tv_sec = 0;
-            xTimestamp.ts[ 1 ].tv_nsec = 0;
-            vRetrieveHardwareTimestamp( pxBuf->pxInterface, pxBuf, &xTimestamp.ts[ 2 ].tv_sec, &xTimestamp.ts[ 2 ].tv_nsec );
-            pucControlData[ xOptions ] = &xTimestamp;
+            pucControlData[ xOptions ] = ( void * ) pxTimestamp;
             ++xOptions;
         }
 
@@ -270,6 +189,153 @@ BaseType_t prvAncillaryMsgControlFillForTx( struct msghdr * pxMsgh,
     return xOptions;
 }
 
+/**
+ * @brief Insert the VLAN tags configured for the interface
+ *
+ * Only the TCIs are written in the frames which already carry the tags,
+ * so that a change of the configuration of the interface applies to them.
+ *
+ * @param[in] pxInterface The interface the buffer is sent to
+ * @param[in] pxBuffer The buffer to send
+ * @return The buffer to pass to the MAC, which may differ from pxBuffer, or
+ * NULL if the buffer could not be resized, in which case it is released
+ */
+NetworkBufferDescriptor_t * prvInsertInterfaceTags( NetworkInterface_t * pxInterface,
+                                                    NetworkBufferDescriptor_t * pxBuffer )
+{
+    #if ( tsnconfigWRAPPER_INSERTS_VLAN_TAGS != tsnconfigDISABLE )
+        const NetworkInterfaceConfig_t * pxInterfaceConfig = ( const NetworkInterfaceConfig_t * ) pxInterface->pvArgument;
+
+        /* Frames of the TSN sockets have room for the tags, the other ones
+         * are resized */
+        pxBuffer = pxVLANTagsInsert( pxBuffer, wrapperINTERFACE_TAGS( pxInterfaceConfig ),
+                                     pxInterfaceConfig->usServiceVLANTag, pxInterfaceConfig->usVLANTag );
+    #else  /* if ( tsnconfigWRAPPER_INSERTS_VLAN_TAGS != tsnconfigDISABLE ) */
+        /* The driver will insert the VLAN tag */
+        ( void ) pxInterface;
+    #endif /* if ( tsnconfigWRAPPER_INSERTS_VLAN_TAGS != tsnconfigDISABLE ) */
+
+    return pxBuffer;
+}
+
+/**
+ * @brief Take what the TX report of a packet needs before it goes to the MAC
+ *
+ * Once passed to the driver with bReleaseAfterSend set, the buffer may be
+ * released at any time, so the timestamps are taken here and the report is
+ * queued later by prvReportTransmission().
+ *
+ * @param[in] xTSNSocket The TSN socket the packet is sent from, or NULL
+ * @param[in] pxBuffer The buffer to send
+ * @param[out] pxTimestamp The timestamps of the packet
+ */
+void prvCaptureTransmission( TSNSocket_t xTSNSocket,
+                             NetworkBufferDescriptor_t * pxBuffer,
+                             struct freertos_scm_timestamping * pxTimestamp )
+{
+    const FreeRTOS_TSN_Socket_t * const pxTSNSocket = ( const FreeRTOS_TSN_Socket_t * ) xTSNSocket;
+
+    prvDumpPacket( "Sending: ", pxBuffer );
+
+    memset( pxTimestamp, 0, sizeof( *pxTimestamp ) );
+
+    if( ( pxTSNSocket != NULL ) && ( ( pxTSNSocket->ulTSFlags & SOF_TIMESTAMPING_TX_SOFTWARE ) != 0U ) )
+    {
+        vTimestampAcquireSoftware( &pxTimestamp->ts[ 0 ] );
+        vRetrieveHardwareTimestamp( pxBuffer->pxInterface, pxBuffer, &pxTimestamp->ts[ 2 ].tv_sec, &pxTimestamp->ts[ 2 ].tv_nsec );
+    }
+}
+
+/**
+ * @brief Queue the TX report of a sent packet in the error queue of its socket
+ *
+ * @param[in] xSocket The Plus TCP socket the packet was sent from
+ * @param[in] xTSNSocket The TSN socket the packet was sent from, or NULL
+ * @param[in] pxTimestamp The timestamps taken by prvCaptureTransmission()
+ */
+void prvReportTransmission( Socket_t xSocket,
+                            TSNSocket_t xTSNSocket,
+                            const struct freertos_scm_timestamping * pxTimestamp )
+{
+    struct msghdr * pxMsgh;
+
+    if( xTSNSocket != NULL )
+    {
+        pxMsgh = pxAncillaryMsgMalloc();
+
+        if( pxMsgh != NULL )
+        {
+            if( prvAncillaryMsgControlFillForTx( pxMsgh, pxTimestamp, xSocket, xTSNSocket ) > 0 )
+            {
+                ( void ) xAncillaryMsgFillName( pxMsgh, NULL, 0, 0 );
+
+                /* pxMsgh->msg_iov is empty, unlikely from linux */
+
+                ( void ) xSocketErrorQueueInsert( xTSNSocket, pxMsgh );
+            }
+            else
+            {
+                vAncillaryMsgFreeAll( pxMsgh );
+            }
+        }
+    }
+}
+
+#if ( tsnconfigFRER_STREAMS > 0 )
+
+/**
+ * @brief Send the first member stream of a frame belonging to an FRER stream
+ *
+ * The R-TAG is inserted and the frame is passed to the MAC, then turned into
+ * the second member stream, which the caller sends as any other frame.
+ * Drivers which copy the frame get the same buffer twice, zero-copy drivers
+ * keep it and get a duplicate for the first member stream instead.
+ *
+ * @param[in,out] ppxInterface The interface to send to, updated to the
+ * interface of the second member stream
+ * @param[in] pxBuffer The frame, with the VLAN tags of the interface
+ * @return The buffer to send, or NULL if the R-TAG could not be inserted, in
+ * which case the buffer is released
+ */
+    static NetworkBufferDescriptor_t * prvFRERReplicate( NetworkInterface_t ** ppxInterface,
+                                                         NetworkBufferDescriptor_t * pxBuffer )
+    {
+        BaseType_t xStream;
+
+        pxBuffer = pxFRERTxTag( pxBuffer, &xStream );
+
+        if( ( pxBuffer == NULL ) || ( xStream < 0 ) )
+        {
+            return pxBuffer;
+        }
+
+        #if ( ipconfigZERO_COPY_TX_DRIVER != 0 )
+        {
+            /* The only copy of the replication, forced by the driver: a zero
+             * copy driver owns each buffer it gets until its DMA is done, and
+             * then releases it with vReleaseNetworkBufferAndDescriptor(). A
+             * reference from the shared buffer pool would be released to
+             * Plus TCP as its own descriptor, and the buffer cannot be
+             * handed over twice, since the second member stream rewrites
+             * its VID while the first one may still be in transmission. */
+            NetworkBufferDescriptor_t * pxCopy = pxDuplicateNetworkBufferWithDescriptor( pxBuffer, pxBuffer->xDataLength );
+
+            if( pxCopy != NULL )
+            {
+                ( void ) xMAC_NetworkInterfaceOutput( *ppxInterface, pxCopy, pdTRUE );
+            }
+        }
+        #else
+            ( void ) xMAC_NetworkInterfaceOutput( *ppxInterface, pxBuffer, pdFALSE );
+        #endif
+
+        *ppxInterface = pxFRERTxReplica( pxBuffer, xStream, *ppxInterface );
+
+        return pxBuffer;
+    }
+
+#endif /* if ( tsnconfigFRER_STREAMS > 0 ) */
+
 /* Network interface wrapper function definitions
  */
 
@@ -278,22 +344,110 @@ BaseType_t xTSN_NetworkInterfaceInitialise( NetworkInterface_t * pxInterface )
     return xMAC_NetworkInterfaceInitialise( pxInterface );
 }
 
+/** @brief Send a packet to the MAC, bypassing the network scheduler
+ *
+ * This inserts the VLAN tags of the interface, passes the packet to the
+ * original network interface and generates the TX report for the socket.
+ * The caller must own the output of the interface: this is the TSN
+ * controller, or a task holding the express token of the controller.
+ */
+BaseType_t xTSN_NetworkInterfaceOutputDirect( NetworkInterface_t * pxInterface,
+                                              NetworkBufferDescriptor_t * const pxBuffer,
+                                              BaseType_t bReleaseAfterSend )
+{
+    Socket_t xSocket = NULL;
+    TSNSocket_t xTSNSocket = NULL;
+    struct freertos_scm_timestamping xTimestamp;
+    NetworkBufferDescriptor_t * pxNewBuffer;
+
+    pxNewBuffer = prvInsertInterfaceTags( pxInterface, pxBuffer );
+
+    #if ( tsnconfigFRER_STREAMS > 0 )
+        if( pxNewBuffer != NULL )
+        {
+            pxNewBuffer = prvFRERReplicate( &pxInterface, pxNewBuffer );
+        }
+    #endif
+
+    if( pxNewBuffer == NULL )
+    {
+        return pdFALSE;
+    }
+
+    /* The driver may release the buffer, the report must not read it */
+    vSocketFromPort( pxNewBuffer->usBoundPort, &xSocket, &xTSNSocket );
+    prvCaptureTransmission( xTSNSocket, pxNewBuffer, &xTimestamp );
+
+    if( xMAC_NetworkInterfaceOutput( pxInterface, pxNewBuffer, bReleaseAfterSend ) != pdFAIL )
+    {
+        prvReportTransmission( xSocket, xTSNSocket, &xTimestamp );
+
+        return pdPASS;
+    }
+    else
+    {
+        /* in future we can eventually pass an error cmsg here */
+        return pdFAIL;
+    }
+}
+
+#if ( tsnconfigCONTROLLER_HAS_EXPRESS_PATH != tsnconfigDISABLE )
+
+/** @brief Send a packet directly if the controller of its queue is idle
+ *
+ * This is the express path of the tasks sending packets, i.e. the IP task
+ * through xTSN_NetworkInterfaceOutput() and the tasks using the TSN sockets.
+ * The packet is sent by the calling task only if it gets the express token
+ * of the controller, see xTSNControllerTakeExpressToken(). Otherwise the
+ * item is left untouched and must be queued.
+ *
+ * @param[in] pxInterface The interface the packet is sent to
+ * @param[in] pxQueue The queue the packet was assigned to
+ * @param[in] pxItem The transmit item
+ * @param[out] pxReturn The result of xTSN_NetworkInterfaceOutputDirect(),
+ * set only if the packet was sent
+ * @return pdTRUE if the packet was passed to the MAC, pdFALSE if it must be
+ * queued
+ */
+    BaseType_t xTSN_NetworkInterfaceOutputExpress( NetworkInterface_t * pxInterface,
+                                                   NetworkQueue_t * pxQueue,
+                                                   NetworkQueueItem_t * pxItem,
+                                                   BaseType_t * pxReturn )
+    {
+        if( xTSNControllerTakeExpressToken( pxQueue ) == pdFALSE )
+        {
+            return pdFALSE;
+        }
+
+        /* As done by the controller before sending */
+        if( pxItem->pxMsgh != NULL )
+        {
+            vAncillaryMsgFreeAll( pxItem->pxMsgh );
+            pxItem->pxMsgh = NULL;
+        }
+
+        *pxReturn = xTSN_NetworkInterfaceOutputDirect( pxInterface, pxItem->pxBuf, pxItem->xReleaseAfterSend );
+        vTSNControllerReleaseExpressToken( pxQueue->pxController );
+
+        return pdTRUE;
+    }
+
+#endif /* if ( tsnconfigCONTROLLER_HAS_EXPRESS_PATH != tsnconfigDISABLE ) */
+
 /** @brief The function used to send a packet
  *
  * If called from the TSN controller, forwards the packet to the original
  * network interface, otherwise the packets is queued inside the network
  * scheduler and the controller will take care of it in due time.
+ * Packets for an express queue are sent directly by the caller when the
+ * controller is idle, see xTSNControllerTakeExpressToken().
  */
 BaseType_t xTSN_NetworkInterfaceOutput( NetworkInterface_t * pxInterface,
                                         NetworkBufferDescriptor_t * const pxBuffer,
                                         BaseType_t bReleaseAfterSend )
 {
     NetworkQueueItem_t xItem;
-    NetworkInterfaceConfig_t * pxInterfaceConfig;
-    Socket_t xSocket = NULL;
-    TSNSocket_t xTSNSocket = NULL;
-    NetworkBufferDescriptor_t * pxNewBuffer;
-    struct msghdr * pxMsgh;
+    NetworkQueue_t * pxQueue;
 
     /* Only the TSN controller is allowed to send packets to the MAC.
      * If the caller is the TSN controller proceed, otherwise put the message
@@ -301,86 +455,182 @@ BaseType_t xTSN_NetworkInterfaceOutput( NetworkInterface_t * pxInterface,
      */
     if( xIsCallingFromTSNController() )
     {
-        #if ( tsnconfigWRAPPER_INSERTS_VLAN_TAGS != tsnconfigDISABLE )
-            pxInterfaceConfig = ( NetworkInterfaceConfig_t * ) pxInterface->pvArgument;
+        return xTSN_NetworkInterfaceOutputDirect( pxInterface, pxBuffer, bReleaseAfterSend );
+    }
+    /*
+     * else if( xIsCallingFromIPTask() ) ...*/
+    else
+    {
+        xItem.eEventType = eNetworkTxEvent;
+        xItem.pxBuf = ( void * ) pxBuffer;
+        xItem.xReleaseAfterSend = bReleaseAfterSend;
+		xItem.pxMsgh = NULL;
+        ( void ) xPacketParse( pxBuffer, &xItem.xMeta );
 
-            if( pxInterfaceConfig->xNumTags >= 1 )
-            {
-                pxNewBuffer = prvInsertVLANTag( pxBuffer, pxInterfaceConfig->usVLANTag, wrapperSECOND_TPID );
+        pxQueue = pxNetworkQueueFindByFilter( &xItem );
 
-                if( pxNewBuffer == NULL )
-                {
-                    return pdFALSE;
-                }
+        if( pxQueue == NULL )
+        {
+            return pdFAIL;
+        }
 
-                if( pxInterfaceConfig->xNumTags >= 2 )
-                {
-                    pxNewBuffer = prvInsertVLANTag( pxNewBuffer, pxInterfaceConfig->usServiceVLANTag, wrapperFIRST_TPID );
+        #if ( tsnconfigCONTROLLER_HAS_EXPRESS_PATH != tsnconfigDISABLE )
+        {
+            BaseType_t xReturn;
 
-                    if( pxNewBuffer == NULL )
-                    {
-                        return pdFALSE;
-                    }
-                }
+            if( xTSN_NetworkInterfaceOutputExpress( pxInterface, pxQueue, &xItem, &xReturn ) != pdFALSE )
+            {
+                return xReturn;
             }
-        #else  /* if ( tsnconfigWRAPPER_INSERTS_VLAN_TAGS != tsnconfigDISABLE ) */
-              /* The driver will insert the VLAN tag */
-        #endif /* if ( tsnconfigWRAPPER_INSERTS_VLAN_TAGS != tsnconfigDISABLE ) */
+        }
+        #endif
 
-        if( xMAC_NetworkInterfaceOutput( pxInterface, pxBuffer, bReleaseAfterSend ) != pdFAIL )
+        return xNetworkQueuePush( pxQueue, &xItem, tsnconfigDEFAULT_QUEUE_TIMEOUT );
+    }
+}
+
+#if ( tsnconfigCONTROLLER_TX_BATCH_SIZE > 1 )
+
+/**
+ * @brief Queue the TX reports of a run of sent packets
+ *
+ * The buffers are not read, the driver may have released them already.
+ *
+ * @param[in] pxSockets The sockets which sent each buffer
+ * @param[in] pxTSNSockets The TSN sockets which sent each buffer
+ * @param[in] pxTimestamps The timestamps captured for each buffer
+ * @param[in] uxCount Number of sent buffers
+ */
+    static void prvReportTransmissionBatch( const Socket_t * pxSockets,
+                                            const TSNSocket_t * pxTSNSockets,
+                                            const struct freertos_scm_timestamping * pxTimestamps,
+                                            size_t uxCount )
+    {
+        for( size_t uxIndex = 0; uxIndex < uxCount; ++uxIndex )
         {
-			prvDumpPacket( "Sending: ", pxBuffer );
+            prvReportTransmission( pxSockets[ uxIndex ], pxTSNSockets[ uxIndex ], &pxTimestamps[ uxIndex ] );
+        }
+    }
 
-            vSocketFromPort( pxBuffer->usBoundPort, &xSocket, &xTSNSocket );
+/** @brief The function used by the TSN controller to send a batch of packets
+ *
+ * All the items must be transmissions for pxInterface and share the same
+ * xReleaseAfterSend value. If the driver implements
+ * xNetworkInterfaceOutputBatch() and tsnconfigWRAPPER_HAS_BATCH_OUTPUT is
+ * enabled, the whole batch is handed to the driver in a single call, so that
+ * the cost of descriptor ring updates and doorbell writes is paid once.
+ * Otherwise the packets are passed one by one to xNetworkInterfaceOutput().
+ * Only the TSN controller is allowed to call this function.
+ *
+ * @param[in] pxInterface The interface the packets are sent to
+ * @param[in] pxItems The items popped from the network queue
+ * @param[in] uxCount Number of items, at most tsnconfigCONTROLLER_TX_BATCH_SIZE
+ * @return The number of packets accepted by the driver
+ */
+    size_t xTSN_NetworkInterfaceOutputBatch( NetworkInterface_t * pxInterface,
+                                             NetworkQueueItem_t * pxItems,
+                                             size_t uxCount )
+    {
+        NetworkBufferDescriptor_t * pxBuffers[ tsnconfigCONTROLLER_TX_BATCH_SIZE ];
+        Socket_t xSockets[ tsnconfigCONTROLLER_TX_BATCH_SIZE ];
+        TSNSocket_t xTSNSockets[ tsnconfigCONTROLLER_TX_BATCH_SIZE ];
+        struct freertos_scm_timestamping xTimestamps[ tsnconfigCONTROLLER_TX_BATCH_SIZE ];
+        const BaseType_t xReleaseAfterSend = pxItems[ 0 ].xReleaseAfterSend;
+        size_t uxReady = 0, uxSent = 0, uxDiverted = 0;
 
-            if( xTSNSocket != NULL )
-            {
-                pxMsgh = pxAncillaryMsgMalloc();
+        configASSERT( xIsCallingFromTSNController() );
+        configASSERT( uxCount <= tsnconfigCONTROLLER_TX_BATCH_SIZE );
+
+        for( size_t uxIndex = 0; uxIndex < uxCount; ++uxIndex )
+        {
+            /* Resolve the sockets before the driver can release the buffer,
+             * reusing the lookup cached in the metadata if any */
+            vSocketFromMetadata( &pxItems[ uxIndex ].xMeta, pxItems[ uxIndex ].pxBuf->usBoundPort,
+                                 &xSockets[ uxReady ], &xTSNSockets[ uxReady ] );
 
-                if( pxMsgh != NULL )
+            pxBuffers[ uxReady ] = prvInsertInterfaceTags( pxInterface, pxItems[ uxIndex ].pxBuf );
+
+            #if ( tsnconfigFRER_STREAMS > 0 )
+                if( pxBuffers[ uxReady ] != NULL )
                 {
-                    if( prvAncillaryMsgControlFillForTx( pxMsgh, pxBuffer, xSocket, xTSNSocket ) > 0 )
-                    {
-                        ( void ) xAncillaryMsgFillName( pxMsgh, NULL, 0, 0 );
+                    NetworkInterface_t * pxReplicaInterface = pxInterface;
 
-                        /* pxMsgh->msg_iov is empty, unlikely from linux */
+                    pxBuffers[ uxReady ] = prvFRERReplicate( &pxReplicaInterface, pxBuffers[ uxReady ] );
 
-                        ( void ) xSocketErrorQueueInsert( xTSNSocket, pxMsgh );
-                    }
-                    else
+                    if( ( pxBuffers[ uxReady ] != NULL ) && ( pxReplicaInterface != pxInterface ) )
                     {
-                        vAncillaryMsgFree( pxMsgh );
+                        /* The second member stream leaves from another interface */
+                        prvCaptureTransmission( xTSNSockets[ uxReady ], pxBuffers[ uxReady ], &xTimestamps[ uxReady ] );
+
+                        if( xMAC_NetworkInterfaceOutput( pxReplicaInterface, pxBuffers[ uxReady ], xReleaseAfterSend ) != pdFAIL )
+                        {
+                            prvReportTransmission( xSockets[ uxReady ], xTSNSockets[ uxReady ], &xTimestamps[ uxReady ] );
+                            ++uxDiverted;
+                        }
+
+                        continue;
                     }
                 }
-            }
+            #endif /* if ( tsnconfigFRER_STREAMS > 0 ) */
 
-            return pdPASS;
-        }
-        else
-        {
-            /* in future we can eventually pass an error cmsg here */
-            return pdFAIL;
+            if( pxBuffers[ uxReady ] != NULL )
+            {
+                /* The driver owns the buffer once called */
+                prvCaptureTransmission( xTSNSockets[ uxReady ], pxBuffers[ uxReady ], &xTimestamps[ uxReady ] );
+                ++uxReady;
+            }
         }
+
+        #if ( tsnconfigWRAPPER_HAS_BATCH_OUTPUT != tsnconfigDISABLE )
+            if( uxReady > 0 )
+            {
+                uxSent = xMAC_NetworkInterfaceOutputBatch( pxInterface, pxBuffers, uxReady, xReleaseAfterSend );
+            }
+        #else
+            for( size_t uxIndex = 0; uxIndex < uxReady; ++uxIndex )
+            {
+                if( xMAC_NetworkInterfaceOutput( pxInterface, pxBuffers[ uxIndex ], xReleaseAfterSend ) != pdFAIL )
+                {
+                    /* Keep the sent buffers at the beginning of the array */
+                    xSockets[ uxSent ] = xSockets[ uxIndex ];
+                    xTSNSockets[ uxSent ] = xTSNSockets[ uxIndex ];
+                    xTimestamps[ uxSent++ ] = xTimestamps[ uxIndex ];
+                }
+            }
+        #endif /* if ( tsnconfigWRAPPER_HAS_BATCH_OUTPUT != tsnconfigDISABLE ) */
+
+        prvReportTransmissionBatch( xSockets, xTSNSockets, xTimestamps, uxSent );
+
+        return uxSent + uxDiverted;
     }
-    /*
-     * else if( xIsCallingFromIPTask() ) ...*/
-    else
-    {
-        xItem.eEventType = eNetworkTxEvent;
-        xItem.pxBuf = ( void * ) pxBuffer;
-        xItem.xReleaseAfterSend = bReleaseAfterSend;
-		xItem.pxMsgh = NULL;
-        return xNetworkQueueInsertPacketByFilter( &xItem, tsnconfigDEFAULT_QUEUE_TIMEOUT );
-    }
-}
+
+#endif /* if ( tsnconfigCONTROLLER_TX_BATCH_SIZE > 1 ) */
 
 NetworkInterface_t * pxTSN_FillInterfaceDescriptor( BaseType_t xEMACIndex,
                                                     NetworkInterface_t * pxInterface,
                                                     NetworkInterfaceConfig_t * pxInterfaceConfig )
 {
-    static char pcName[ 17 ];
+    char * const pcName = pxInterfaceConfig->pcName;
+    size_t uxLength = 3U;
+
+    /* Written by hand rather than with snprintf(), and kept in the
+     * configuration so that every interface has its own name */
+    memcpy( pcName, "eth", uxLength );
+
+    for( BaseType_t xRest = xEMACIndex; ( xRest >= 0 ) && ( uxLength < sizeof( pxInterfaceConfig->pcName ) - 1U ); xRest /= 10 )
+    {
+        /* Shift the digits already written, the new one is more significant */
+        memmove( &pcName[ 4 ], &pcName[ 3 ], uxLength - 3U );
+        pcName[ 3 ] = ( char ) ( '0' + ( xRest % 10 ) );
+        uxLength++;
+
+        if( xRest < 10 )
+        {
+            break;
+        }
+    }
 
-    snprintf( pcName, sizeof( pcName ), "eth%u", ( unsigned ) xEMACIndex );
+    pcName[ uxLength ] = '\0';
 
     memset( pxInterface, '\0', sizeof( *pxInterface ) );
     pxInterface->pcName = pcName; /* Just for logging, debugging. */
@@ -469,6 +719,8 @@ void vRetrieveHardwareTimestamp( NetworkInterface_t * pxInterface,
  * This function is also responsible for generating the ancillary
  * message with the packet and acquiring the timestamp if timestamping
  * is enabled.
+ * Frames assigned to a pass-through queue and bound to a TSN socket are
+ * delivered to the socket right away, without waking up the controller.
  *
  * @param[in] pxEvent Pointer to the IP stack event structure
  * @param[in] uxTimeout Timeout value for sending the event
@@ -479,6 +731,7 @@ BaseType_t xSendEventStructToTSNController( const IPStackEvent_t * pxEvent,
 {
     BaseType_t xReturn = pdFALSE;
     NetworkQueueItem_t * pxItem;
+    NetworkQueue_t * pxQueue;
 
 	prvDumpPacket( "Received: ", ( NetworkBufferDescriptor_t * ) pxEvent->pvData );
 
@@ -491,7 +744,45 @@ BaseType_t xSendEventStructToTSNController( const IPStackEvent_t * pxEvent,
             return pdFAIL;
         }
 
-        xReturn = xNetworkQueueInsertPacketByFilter( pxItem, uxTimeout );
+        pxQueue = pxNetworkQueueFindByFilter( pxItem );
+
+        if( ( pxQueue != NULL ) && ( pxItem->pxMsgh != NULL ) )
+        {
+            AncillaryRxInfo_t * const pxInfo = pxAncillaryMsgGetRxInfo( pxItem->pxMsgh );
+
+            pxInfo->uxQueueIPV = pxQueue->uxIPV;
+            pxInfo->ulValid |= ancillaryRX_HAS_QUEUE;
+        }
+
+        if( pxQueue == NULL )
+        {
+            xReturn = pdFAIL;
+        }
+
+        #if ( tsnconfigINCLUDE_PASSTHROUGH_QUEUES != tsnconfigDISABLE )
+            else if( ( pxQueue->xPassThrough != pdFALSE ) && ( xTSNControllerDeliverToSocket( pxItem ) == pdPASS ) )
+            {
+                xReturn = pdPASS;
+            }
+        #endif
+        else
+        {
+            xReturn = xNetworkQueuePush( pxQueue, pxItem, uxTimeout );
+        }
+
+        if( xReturn != pdPASS )
+        {
+            /* The caller still owns the network buffer */
+            vPacketRestoreStart( pxItem->pxBuf, &pxItem->xMeta, pdFALSE );
+
+            if( pxItem->pxMsgh != NULL )
+            {
+                vAncillaryMsgFreeAll( pxItem->pxMsgh );
+            }
+        }
+
+        /* The item has been copied in the queue */
+        NetworkQueueItemFree( pxItem );
     }
     else
     {
@@ -507,66 +798,41 @@ NetworkQueueItem_t * prvHandleReceive( NetworkBufferDescriptor_t * pxBuf )
     NetworkQueueItem_t * pxItem;
     struct msghdr * pxMsgh;
     Socket_t xSocket;
-    TSNSocket_t xTSNSocket;
-    uint16_t usVLANTCI, usVLANServiceTCI, usFrameType, usDestinationPort = 0, usSourcePort = 0;
-    uint8_t ucProtocol;
-    size_t uxPrefix = 0;
-    uint8_t * pucEBuf = pxBuf->pucEthernetBuffer;
-    IP_Address_t xDestinationAddr;
-    BaseType_t uxNumVLANTags;
-
-    uxNumVLANTags = prvStripVLANTag( pxBuf, &usVLANTCI, &usVLANServiceTCI );
-    usFrameType = ( ( EthernetHeader_t * ) pucEBuf )->usFrameType;
-    uxPrefix = ipSIZE_OF_ETH_HEADER;
-
-    switch( usFrameType )
-    {
-        case ipIPv4_FRAME_TYPE:
-            ucProtocol = ( ( IPHeader_t * ) &pucEBuf[ uxPrefix ] )->ucProtocol;
-            xDestinationAddr.ulIP_IPv4 = ( ( IPHeader_t * ) &pucEBuf[ uxPrefix ] )->ulDestinationIPAddress;
-            uxPrefix += ipSIZE_OF_IPv4_HEADER;
-            break;
-
-        case ipIPv6_FRAME_TYPE:
-            ucProtocol = ( ( IPHeader_IPv6_t * ) &pucEBuf[ uxPrefix ] )->ucNextHeader;
-            xDestinationAddr.xIP_IPv6 = ( ( IPHeader_IPv6_t * ) &pucEBuf[ uxPrefix ] )->xDestinationAddress;
-            uxPrefix += ipSIZE_OF_IPv6_HEADER;
-            break;
+    TSNSocket_t xTSNSocket = NULL;
+    PacketMetadata_t xMeta;
+    IP_Address_t xSourceAddress;
+    uint16_t usDestinationPort, usSourcePort;
 
-        default:
-            ucProtocol = 255;
-            break;
+    if( xPacketParse( pxBuf, &xMeta ) != pdPASS )
+    {
+        return NULL;
     }
 
-    switch( ucProtocol )
-    {
-        case ipPROTOCOL_UDP:
-            usDestinationPort = ( ( UDPHeader_t * ) &pucEBuf[ uxPrefix ] )->usDestinationPort;
-            usSourcePort = ( ( UDPHeader_t * ) &pucEBuf[ uxPrefix ] )->usSourcePort;
-            uxPrefix += ipSIZE_OF_UDP_HEADER;
-            break;
+    #if ( tsnconfigFRER_STREAMS > 0 )
+        /* Duplicates received from the other member stream stop here */
+        if( xFRERReceive( pxBuf, &xMeta ) != pdPASS )
+        {
+            return NULL;
+        }
+    #endif
 
-        case ipPROTOCOL_TCP:
-            usDestinationPort = ( ( TCPHeader_t * ) &pucEBuf[ uxPrefix ] )->usDestinationPort;
-            usSourcePort = ( ( TCPHeader_t * ) &pucEBuf[ uxPrefix ] )->usSourcePort;
-            uxPrefix += ipSIZE_OF_TCP_HEADER;
-            break;
+    /* The tags are kept in the metadata, Plus TCP expects untagged frames.
+     * The start of the buffer is advanced over the tags, and must be restored
+     * when the buffer leaves the TSN layer. */
+    vPacketStripTags( pxBuf, &xMeta );
 
-        case ipPROTOCOL_ICMP:
-        case ipPROTOCOL_ICMP_IPv6:
-        case ipPROTOCOL_IGMP:
-        default:
-            break;
-    }
+    usDestinationPort = xMeta.usDestinationPort;
+    usSourcePort = xMeta.usSourcePort;
 
 	pxBuf->usBoundPort = usDestinationPort;
 	pxBuf->usPort = usSourcePort;
 
-	if( usDestinationPort != 0 )
+	/* Frames of other EtherTypes may belong to a raw socket */
+	if( ( usDestinationPort != 0 ) || tsnsocketIS_RAW_FRAME_TYPE( xMeta.usFrameType ) )
 	{
 		xSocket = NULL;
 
-		vSocketFromPort( usDestinationPort, &xSocket, &xTSNSocket );
+		vSocketFromMetadata( &xMeta, usDestinationPort, &xSocket, &xTSNSocket );
 
 		if( xTSNSocket != NULL )
 		{
@@ -574,32 +840,40 @@ NetworkQueueItem_t * prvHandleReceive( NetworkBufferDescriptor_t * pxBuf )
 
 			if( pxMsgh != NULL )
 			{
-				( void ) prvAncillaryMsgControlFillForRx( pxMsgh, pxBuf, xSocket, xTSNSocket );
+				prvAncillaryMsgRecordRx( pxMsgh, pxBuf, xTSNSocket );
+
+				/* The name is the address of the sender, as for recvfrom() */
+				( void ) xPacketGetSourceAddress( pxBuf, &xMeta, &xSourceAddress );
 
-				switch( usFrameType )
+				switch( xMeta.usFrameType )
 				{
 					case ipIPv4_FRAME_TYPE:
-						( void ) xAncillaryMsgFillName( pxMsgh, &xDestinationAddr, usDestinationPort, FREERTOS_AF_INET );
+						( void ) xAncillaryMsgFillName( pxMsgh, &xSourceAddress, usSourcePort, FREERTOS_AF_INET );
 						break;
 
 					case ipIPv6_FRAME_TYPE:
-						( void ) xAncillaryMsgFillName( pxMsgh, &xDestinationAddr, usDestinationPort, FREERTOS_AF_INET6 );
+						( void ) xAncillaryMsgFillName( pxMsgh, &xSourceAddress, usSourcePort, FREERTOS_AF_INET6 );
 						break;
 
 					default:
+						/* Raw socket, the name is the link layer source */
+						( void ) xAncillaryMsgFillLinkName( pxMsgh, pxBuf->pucEthernetBuffer, &xMeta );
 						break;
 				}
 
 				( void ) xAncillaryMsgFillPayload( pxMsgh, pxBuf->pucEthernetBuffer, pxBuf->xDataLength );
+				*pxAncillaryMsgGetMetadata( pxMsgh ) = xMeta;
 			}
 		}
-		else if( xSocket != NULL )
+		else if( ( xSocket != NULL ) || ( usDestinationPort == 0 ) )
 		{
+			/* Bound to a Plus TCP socket, or not claimed by a raw socket */
 			pxMsgh = NULL;
 		}
 		else
 		{
 			/* no receiving socket */
+			vPacketRestoreStart( pxBuf, &xMeta, pdFALSE );
 			return NULL;
 		}
 	}
@@ -609,12 +883,17 @@ NetworkQueueItem_t * prvHandleReceive( NetworkBufferDescriptor_t * pxBuf )
 		pxMsgh = NULL;
 	}
 
-    ( void ) uxNumVLANTags; /* TODO: do something with this */
-
     pxItem = pxNetworkQueueItemMalloc();
 
     if( pxItem == NULL )
     {
+        /* The caller keeps the buffer, but nobody else owns the message */
+        if( pxMsgh != NULL )
+        {
+            vAncillaryMsgFreeAll( pxMsgh );
+        }
+
+        vPacketRestoreStart( pxBuf, &xMeta, pdFALSE );
         return NULL;
     }
 
@@ -622,6 +901,7 @@ NetworkQueueItem_t * prvHandleReceive( NetworkBufferDescriptor_t * pxBuf )
     pxItem->pxBuf = pxBuf;
     pxItem->pxMsgh = pxMsgh;
     pxItem->xReleaseAfterSend = pdTRUE;
+    pxItem->xMeta = xMeta;
 
     return pxItem;
 }
@@ -5,16 +5,25 @@
 
 #include "FreeRTOS_IP.h"
 
+#include "FreeRTOS_TSN_NetworkSchedulerQueue.h"
+
 struct xNETWORK_INTERFACE_CONFIG
 {
     BaseType_t xEMACIndex;
     BaseType_t xNumTags;
     uint16_t usVLANTag;
     uint16_t usServiceVLANTag;
+    char pcName[ 8 ]; /**< Name of the interface, "eth" and the EMAC index */
 };
 
 typedef struct xNETWORK_INTERFACE_CONFIG NetworkInterfaceConfig_t;
 
+/* Number of VLAN tags inserted in the frames sent to an interface, at most a
+ * service tag and a customer tag */
+#define wrapperINTERFACE_TAGS( pxConfig )                  \
+    ( ( uint8_t ) ( ( ( pxConfig )->xNumTags <= 0 ) ? 0U : \
+                    ( ( pxConfig )->xNumTags >= 2 ) ? 2U : 1U ) )
+
 /* Definitions used to create the API exported to the upper layers
  */
 BaseType_t xTSN_NetworkInterfaceInitialise( NetworkInterface_t * pxInterface );
@@ -23,6 +32,23 @@ BaseType_t xTSN_NetworkInterfaceOutput( NetworkInterface_t * pxInterface,
                                         NetworkBufferDescriptor_t * const pxBuffer,
                                         BaseType_t bReleaseAfterSend );
 
+BaseType_t xTSN_NetworkInterfaceOutputDirect( NetworkInterface_t * pxInterface,
+                                              NetworkBufferDescriptor_t * const pxBuffer,
+                                              BaseType_t bReleaseAfterSend );
+
+#if ( tsnconfigCONTROLLER_HAS_EXPRESS_PATH != tsnconfigDISABLE )
+    BaseType_t xTSN_NetworkInterfaceOutputExpress( NetworkInterface_t * pxInterface,
+                                                   NetworkQueue_t * pxQueue,
+                                                   NetworkQueueItem_t * pxItem,
+                                                   BaseType_t * pxReturn );
+#endif
+
+#if ( tsnconfigCONTROLLER_TX_BATCH_SIZE > 1 )
+    size_t xTSN_NetworkInterfaceOutputBatch( NetworkInterface_t * pxInterface,
+                                             NetworkQueueItem_t * pxItems,
+                                             size_t uxCount );
+#endif
+
 NetworkInterface_t * pxTSN_FillInterfaceDescriptor( BaseType_t xEMACIndex,
                                                     NetworkInterface_t * pxInterface,
                                                     NetworkInterfaceConfig_t * pxInterfaceConfig );
@@ -46,6 +72,20 @@ BaseType_t xMAC_NetworkInterfaceOutput( NetworkInterface_t * pxInterface,
 
 BaseType_t xMAC_GetPhyLinkStatus( NetworkInterface_t * pxInterface );
 
+#if ( tsnconfigWRAPPER_HAS_BATCH_OUTPUT != tsnconfigDISABLE )
+
+/* Optional driver hook, defined in NetworkInterface.c as
+ * xNetworkInterfaceOutputBatch(). It should queue all the buffers for
+ * transmission with a single update of the descriptor ring, and return the
+ * number of buffers accepted starting from the first. If bReleaseAfterSend is
+ * pdTRUE the driver owns all the buffers, including the rejected ones.
+ */
+    size_t xMAC_NetworkInterfaceOutputBatch( NetworkInterface_t * pxInterface,
+                                             NetworkBufferDescriptor_t * const * pxBuffers,
+                                             size_t uxCount,
+                                             BaseType_t bReleaseAfterSend );
+#endif
+
 
 void vRetrieveHardwareTimestamp( NetworkInterface_t * pxInterface,
                                  NetworkBufferDescriptor_t * pxBuf,
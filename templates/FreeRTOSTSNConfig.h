@@ -18,8 +18,42 @@
 #define tsnconfigUSE_PRIO_INHERIT                 tsnconfigDISABLE
 #define tsnconfigTSN_CONTROLLER_PRIORITY          ( configMAX_PRIORITIES - 1 )
 #define tsnconfigCONTROLLER_HAS_DYNAMIC_PRIO      tsnconfigDISABLE
+#define tsnconfigMAX_CONTROLLERS                  ( 1 )
+#define tsnconfigCONTROLLER_SEPARATE_RX_STAGE     tsnconfigDISABLE
+#define tsnconfigCONTROLLER_RX_STAGE_PRIORITY     ( configMAX_PRIORITIES - 2 )
+#define tsnconfigCONTROLLER_RX_STAGE_QUEUE_LENGTH ( ipconfigEVENT_QUEUE_LENGTH )
+#define tsnconfigCONTROLLER_RX_STAGE_BUDGET       ( 0U )
+#define tsnconfigCONTROLLER_HAS_BUDGET            tsnconfigDISABLE
+#define tsnconfigCONTROLLER_TX_BUDGET_PACKETS     ( 0U )
+#define tsnconfigCONTROLLER_TX_BUDGET_BYTES       ( 0U )
+#define tsnconfigCONTROLLER_TX_BUDGET_NS          ( 0U )
+#define tsnconfigCONTROLLER_RX_BUDGET_PACKETS     ( 0U )
+#define tsnconfigCONTROLLER_RX_BUDGET_BYTES       ( 0U )
+#define tsnconfigCONTROLLER_RX_BUDGET_NS          ( 0U )
+#define tsnconfigCONTROLLER_BUDGET_BACKOFF_TICKS  ( 1U )
+#define tsnconfigCONTROLLER_BUSY_POLL_NS          ( 0U )
+#define tsnconfigCONTROLLER_HAS_EXPRESS_PATH      tsnconfigDISABLE
+#define tsnconfigINCLUDE_PASSTHROUGH_QUEUES       tsnconfigDISABLE
+#define tsnconfigCONTROLLER_TX_BATCH_SIZE         ( 1U )
+#define tsnconfigWRAPPER_HAS_BATCH_OUTPUT         tsnconfigDISABLE
 #define tsnconfigWRAPPER_INSERTS_VLAN_TAGS        tsnconfigENABLE
 #define tsnconfigSOCKET_INSERTS_VLAN_TAGS         tsnconfigDISABLE
+#define tsnconfigSOCKET_HASH_SIZE                 ( 16U )
+#define tsnconfigCHECKSUM_KERNEL                  tsnconfigCHECKSUM_WORD
+#define tsnconfigCHECKSUM_SELF_TEST               tsnconfigDISABLE
+#define tsnconfigSELF_TEST                        tsnconfigDISABLE
+#define tsnconfigSOCKET_TEMPLATE_REVALIDATE_MS    ( 1000U )
+#define tsnconfigANCILLARY_POOL_SIZE              ( 8U )
+#define tsnconfigSHARED_BUFFER_POOL_SIZE          ( 0U )
+#define tsnconfigSOCKET_MMSG_BATCH                ( 8U )
+#define tsnconfigARP_PENDING_DESTINATIONS         ( 0U )
+#define tsnconfigARP_PENDING_PER_DESTINATION      ( 4U )
+#define tsnconfigARP_PENDING_TIMEOUT_MS           ( 1000U )
+#define tsnconfigARP_POLL_MS                      ( 10U )
+#define tsnconfigARP_STATIC_NEIGHBORS             ( 0U )
+#define tsnconfigFRER_STREAMS                     ( 0U )
+#define tsnconfigFRER_HISTORY_LENGTH              ( 32U )
+#define tsnconfigFRER_RESET_MS                    ( 1000U )
 #define tsnconfigERRQUEUE_LENGTH                  ( 16 )
 #define tsnconfigDUMP_PACKETS                     tsnconfigDISABLE
 